@@ -18,3 +18,5 @@ done
 for id in $IPCS_Q; do
   ipcrm -q $id;
 done
+
+rm -f /dev/shm/handicraft.* 2>/dev/null
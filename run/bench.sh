@@ -0,0 +1,59 @@
+#!/bin/bash
+
+# Timing of repeated runs of the simulation.
+#
+# Usage: ./bench.sh [-r runs] [launcher options]
+#   e.g. ./bench.sh -r 20         (ordinary pages)
+#        ./bench.sh -r 20 -H      (huge pages)
+#        for s in fixed oldest weighted throughput; do ./bench.sh -r 20 -s $s; done   (scheduling policies)
+#
+# The mean wall time and the mean simulation time (as reported in the run summary) per run are printed, together
+# with the number of requests of each kind served by the entrepreneur and their mean wait, averaged over the runs;
+# when perf is available, the dTLB misses summed over the launcher and all its children are printed as well.
+
+RUNS=10
+if [ "$1" == "-r" ]; then
+  RUNS=$2
+  shift 2
+fi
+
+PERF=`which perf 2>/dev/null`
+TOTAL=0
+rm -f bench.out
+LOADS=0
+STORES=0
+
+for i in $(seq 1 $RUNS)
+do
+  START=`date +%s%N`
+  if [ -n "$PERF" ]; then
+    echo -e "bench\ny" | $PERF stat -x, -e dTLB-load-misses,dTLB-store-misses -o bench.perf \
+                        ./probSemSharedMemAvHandicraft "$@" >>bench.out
+    L=`grep dTLB-load-misses bench.perf | cut -f1 -d, | tr -dc 0-9`
+    S=`grep dTLB-store-misses bench.perf | cut -f1 -d, | tr -dc 0-9`
+    LOADS=$((LOADS + ${L:-0}))
+    STORES=$((STORES + ${S:-0}))
+  else
+    echo -e "bench\ny" | ./probSemSharedMemAvHandicraft "$@" >>bench.out
+  fi
+  END=`date +%s%N`
+  TOTAL=$((TOTAL + END - START))
+done
+rm -f bench bench.perf
+
+echo "options: $@"
+echo "runs: $RUNS"
+echo "mean wall time: $((TOTAL / RUNS / 1000000)) ms"
+awk -v runs=$RUNS '
+  /^simulation:/ { sim += $2 }
+  /requests:.*served/ { k = $1 (($2 == "requests:") ? "" : " " $2);
+                        n = $(NF-5); w = $(NF-1); srv[k] += n; wait[k] += n * w }
+  END { printf "mean simulation time: %.3f ms\n", sim / runs;
+        for (k in srv)
+          printf "%s requests: %.1f served per run, mean wait %.1f us\n", k, srv[k] / runs,
+                 (srv[k] == 0) ? 0 : wait[k] / srv[k] }' bench.out
+rm -f bench.out
+if [ -n "$PERF" ]; then
+  echo "dTLB load misses: $LOADS"
+  echo "dTLB store misses: $STORES"
+fi
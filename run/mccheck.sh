@@ -0,0 +1,100 @@
+#!/bin/bash
+
+# Validation of the Monte Carlo engine against the process based simulation: the step cost of the engine is
+# calibrated on a first set of runs of the launcher and the engine, so calibrated, is then compared with a second,
+# separate set of runs, figure by figure, on the means of the loganalyze figures.
+#
+# Usage: ./mccheck.sh [-c runs] [-v runs] [-t tolerance] [-s "costs ..."] [-r replicas]
+#   e.g. ./mccheck.sh                               (20 calibration runs, 20 validation runs, 20% tolerance)
+#        ./mccheck.sh -c 40 -v 40 -t 15 -s "5 6 7 8"
+#
+# The step cost picked is the candidate whose figures are the closest to the ones of the calibration runs (least
+# sum of squared relative differences). Only the default settings are modelled by the engine, so the launcher is
+# run with no options. The exit status is 0 if every figure of the engine lies within the tolerance (in percent of
+# the mean of the validation runs) and 1 otherwise.
+
+CRUNS=20
+VRUNS=20
+TOL=20
+COSTS="2 4 6 8 10 12 16 20 30"
+REPL=2048
+while [ "$1" == "-c" ] || [ "$1" == "-v" ] || [ "$1" == "-t" ] || [ "$1" == "-s" ] || [ "$1" == "-r" ]; do
+  case "$1" in
+    -c) CRUNS=$2 ;;
+    -v) VRUNS=$2 ;;
+    -t) TOL=$2 ;;
+    -s) COSTS=$2 ;;
+    -r) REPL=$2 ;;
+  esac
+  shift 2
+done
+
+FIGS="steps sold util_e util_c"
+
+# means of the loganalyze figures over a number of runs of the launcher: steps, pieces sold per 1000 steps,
+# entrepreneur and craftsmen utilization
+procMeans ()
+{
+  rm -f mccheck.out
+  for i in $(seq 1 $1)
+  do
+    echo -e "mccheck\ny" | ./probSemSharedMemAvHandicraft >/dev/null 2>&1
+    bash apagaipcs.sh >/dev/null 2>&1
+    ./loganalyze mccheck >>mccheck.out 2>&1
+  done
+  awk -v runs=$1 '
+    /^Customers:/ { steps += $NF }
+    /pieces sold per 1000 steps:/ { sold += $NF }
+    /entrepreneur utilization/ { sub ("%", "", $NF); ue += $NF }
+    /craftsmen utilization/ { sub ("%", "", $NF); uc += $NF }
+    END { printf "%.3f %.3f %.3f %.3f\n", steps / runs, sold / runs, ue / runs, uc / runs }
+  ' mccheck.out
+}
+
+# means of the same figures over the replicas of the engine, for a given step cost and seed
+mcMeans ()
+{
+  ./montecarlo -r $REPL -c $1 -s $2 | awk '
+    /log rows \(steps\)/ { steps = $(NF-6) }
+    /pieces sold per 1000 steps/ { sold = $(NF-6) }
+    /entrepreneur utilization/ { ue = $(NF-6) }
+    /craftsmen utilization/ { uc = $(NF-6) }
+    END { printf "%.3f %.3f %.3f %.3f\n", steps, sold, ue, uc }
+  '
+}
+
+echo "calibration: $CRUNS runs of the launcher"
+CAL=$(procMeans $CRUNS)
+BEST=""
+for C in $COSTS
+do
+  MC=$(mcMeans $C 1)
+  ERR=$(echo "$CAL $MC" | awk '{ for (i = 1; i <= 4; i++) e += (($(i+4) - $i) / $i) ^ 2; printf "%.6f", e }')
+  printf "  step cost %5s us: squared relative difference %s\n" $C $ERR
+  if [ -z "$BEST" ] || awk -v a=$ERR -v b=$BESTERR 'BEGIN { exit !(a < b) }'; then
+    BEST=$C
+    BESTERR=$ERR
+  fi
+done
+echo "step cost picked: $BEST us"
+
+echo "validation: $VRUNS other runs of the launcher, engine seeded anew"
+VAL=$(procMeans $VRUNS)
+MC=$(mcMeans $BEST 2)
+rm -f mccheck mccheck.out
+echo "$VAL $MC" | awk -v tol=$TOL -v figs="$FIGS" '
+  BEGIN { split (figs, name, " ");
+          label["steps"] = "log rows (steps)"; label["sold"] = "pieces sold per 1000 steps";
+          label["util_e"] = "entrepreneur utilization (%)"; label["util_c"] = "craftsmen utilization (%)";
+          printf "  %-30s %10s %10s %9s\n", "figure", "processes", "engine", "diff" }
+  { fail = 0;
+    for (i = 1; i <= 4; i++)
+    { d = 100 * ($(i+4) - $i) / $i;
+      ok = (d <= tol) && (d >= -tol);
+      if (!ok) fail = 1;
+      printf "  %-30s %10.2f %10.2f %+8.1f%% %s\n", label[name[i]], $i, $(i+4), d, ok ? "" : "(out of tolerance)"
+    }
+    printf "tolerance: %s%%\n", tol;
+    print (fail ? "Monte Carlo check: FAILED" : "Monte Carlo check: passed");
+    exit fail
+  }'
@@ -0,0 +1,68 @@
+#!/bin/bash
+
+# Check of record and replay: runs are recorded and each one is replayed several times, every replay having to
+# finish within a time limit and to produce a log file identical to the one of the run recorded.
+#
+# Usage: ./replaycheck.sh [-r recordings] [-p replays] [-t seconds] [launcher options]
+#   e.g. ./replaycheck.sh                          (6 recordings, each one replayed 10 times)
+#        ./replaycheck.sh -r 2 -p 20 -k 3 -D       (batched production and door gate)
+#
+# The launcher options are used both on recording and on replaying. The exit status is 0 if every replay passed
+# and 1 otherwise; the launcher output of the failed ones is kept in replaycheck.out.
+
+RECS=6
+REPS=10
+LIMIT=30
+while [ "$1" == "-r" ] || [ "$1" == "-p" ] || [ "$1" == "-t" ]; do
+  case "$1" in
+    -r) RECS=$2 ;;
+    -p) REPS=$2 ;;
+    -t) LIMIT=$2 ;;
+  esac
+  shift 2
+done
+
+FAIL=0
+rm -f replaycheck.out
+
+for i in $(seq 1 $RECS)
+do
+  echo -e "rcrec\ny" | timeout $LIMIT ./probSemSharedMemAvHandicraft -R replaycheck.rep "$@" >rcrun.out 2>&1
+  RC=$?
+  bash apagaipcs.sh >/dev/null 2>&1
+  if [ $RC -ne 0 ]; then
+    echo "recording $i: failed (status $RC)"
+    cat rcrun.out >>replaycheck.out
+    FAIL=1
+    continue
+  fi
+  PASS=0
+  for j in $(seq 1 $REPS)
+  do
+    echo -e "rcrep\ny" | timeout $LIMIT ./probSemSharedMemAvHandicraft -P replaycheck.rep "$@" >rcrun.out 2>&1
+    RC=$?
+    bash apagaipcs.sh >/dev/null 2>&1
+    if [ $RC -eq 124 ]; then
+      echo "recording $i, replay $j: timed out after $LIMIT s"
+    elif [ $RC -ne 0 ]; then
+      echo "recording $i, replay $j: failed (status $RC)"
+    elif ! cmp -s rcrec rcrep; then
+      echo "recording $i, replay $j: log differs from the one recorded"
+    else
+      PASS=$((PASS + 1))
+      continue
+    fi
+    cat rcrun.out >>replaycheck.out
+    FAIL=1
+  done
+  echo "recording $i: $PASS of $REPS replays identical"
+done
+rm -f rcrec rcrep rcrun.out replaycheck.rep
+
+echo "options: $@"
+if [ $FAIL -ne 0 ]; then
+  echo "replay check: FAILED"
+  exit 1
+fi
+rm -f replaycheck.out
+echo "replay check: passed"
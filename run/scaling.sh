@@ -0,0 +1,48 @@
+#!/bin/bash
+
+# Scaling of the simulation with the number of shops: the programs are rebuilt for each number of shops and timed
+# with a single lock for the whole critical region (-G) and with one lock per shop, one for the workshop and one for
+# the log (-S). The figures are only meaningful on a host with several processors.
+#
+# Usage: ./scaling.sh [-r runs] [-s "shops ..."] [launcher options]
+#   e.g. ./scaling.sh                          (1, 2 and 4 shops, 10 runs each)
+#        ./scaling.sh -r 20 -s "1 2 3 4" -A fair
+#
+# The mean simulation time (as reported in the run summary) per run is printed for both settings, together with
+# the number of pieces produced per second of simulation time. The programs are rebuilt with the default number of
+# shops at the end.
+
+RUNS=10
+SHOPS="1 2 4"
+while [ "$1" == "-r" ] || [ "$1" == "-s" ]; do
+  case "$1" in
+    -r) RUNS=$2 ;;
+    -s) SHOPS=$2 ;;
+  esac
+  shift 2
+done
+
+printf "%-6s %-8s %14s %16s\n" "shops" "locks" "simulation" "pieces/s"
+for S in $SHOPS
+do
+  make -C ../src SHOPS=$S >/dev/null 2>&1 || { echo "build with $S shops failed"; exit 1; }
+  for L in single split
+  do
+    OPT="-S"
+    [ $L == "single" ] && OPT="-G"
+    rm -f scaling.out
+    for i in $(seq 1 $RUNS)
+    do
+      echo -e "scaling\ny" | ./probSemSharedMemAvHandicraft $OPT "$@" >>scaling.out 2>&1
+      bash apagaipcs.sh >/dev/null 2>&1
+      tail -1 scaling | awk '{ print "pieces:", $NF }' >>scaling.out
+    done
+    awk -v runs=$RUNS -v shops=$S -v locks=$L '
+      /^simulation:/ { sim += $2 }
+      /^pieces:/ { pieces += $2 }
+      END { printf "%-6d %-8s %11.3f ms %16.1f\n", shops, locks, sim / runs, (sim == 0) ? 0 : 1000 * pieces / sim }
+    ' scaling.out
+  done
+done
+rm -f scaling scaling.out
+make -C ../src >/dev/null 2>&1
@@ -0,0 +1,522 @@
+/**
+ *  \file actorEngine.c (implementation file)
+ *
+ *  \brief Problem name: Aveiro Handicraft SARL.
+ *
+ *  \brief Concept: Pedro Mariano.
+ *
+ *  Actor engine: the simulation carried out by message passing, with no shared state and no global lock.
+ *
+ *  The shop and the workshop are actors, each one a process which alone owns its state. The shop actor plays the
+ *  part of the entrepreneur: it lets the customers in, services them by the counter and, when the craftsmen phone,
+ *  closes the door and goes to the workshop to deliver prime materials or to collect a batch of products. The
+ *  workshop actor keeps the prime materials and the products stored and the list of craftsmen waiting for prime
+ *  materials. Customers and craftsmen are processes which send messages to the actors ("is the door open", "I want
+ *  these goods", "collect materials", "store this piece") and wait for the reply, when there is one.
+ *
+ *  Every actor and every customer and craftsman has a bounded lock-free mailbox in a shared region (see mailbox.h).
+ *  An actor takes out the messages in batches: it blocks only when its mailbox is empty and there is nothing else
+ *  for it to do, and handles every message present before going on with its own task, so under load the cost of
+ *  waking it up is paid once per batch rather than once per message.
+ *
+ *  The model is the one carried out by the intervening entities in their default settings (one piece per visit to
+ *  the store, no door gate and fixed priority scheduling), with the same random delays. The end of operations of
+ *  the customers and the entrepreneur depends on the state of both the shop and the workshop, which no actor sees as
+ *  a whole: the workshop tells the shop when the last craftsman has come to the end of his life cycle, and the
+ *  customers are let go only once the shop has collected the products left in the workshop after that.
+ *
+ *  No log file is written: with no global lock there is no consistent snapshot of the whole state to be saved. The
+ *  figures are meant to be compared with the run summary of the launcher, which is based on the lock: simulation
+ *  time, throughput and the checkout latency of the customers, from joining the queue by the counter until being
+ *  addressed (queueing) and until being released (service).
+ *
+ *  Upon execution, the following options are accepted:
+ *    \li <tt>-r runs</tt> - number of runs, one after the other, whose figures are pooled (by default, 1)
+ *    \li <tt>-b batch</tt> - maximum number of messages an actor takes out at a time (by default, 16)
+ *    \li <tt>-s seed</tt> - seed of the random generators (by default, 1).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "histogram.h"
+#include "mailbox.h"
+
+/** \brief shop actor */
+#define  SHOP            0
+/** \brief workshop actor */
+#define  WORKSHOP        (N+M+1)
+/** \brief number of processes (0 - shop, 1 to N - customers, N+1 to N+M - craftsmen, N+M+1 - workshop) */
+#define  NACT            (N+M+2)
+
+#if MBOX_SIZE < M + 2
+#error "the mailbox of the workshop must hold a request of every craftsman and one of the shop"
+#endif
+
+/** \brief reply to a request */
+#define  REPLY           0
+
+/* messages to the shop */
+
+#define  MS_END          1                                                       /* customer end of operations check */
+#define  MS_ENTER        2                                                       /* is door open, and enter the shop */
+#define  MS_PICK         3                                                 /* perusing around (val is a random draw) */
+#define  MS_BUY          4                                                   /* I want this (val is number of goods) */
+#define  MS_EXIT         5                                                                   /* exit shop (no reply) */
+#define  MS_PMAT         6                                                      /* prime materials needed (no reply) */
+#define  MS_BATCH        7                                                    /* batch ready for transfer (no reply) */
+#define  MS_OVER         8                                        /* workshop: the last craftsman has come to an end */
+#define  MS_DONE         9                         /* workshop: trip completed (val is number of products collected) */
+
+/* messages to the workshop */
+
+#define  MW_END          1                                                      /* craftsman end of operations check */
+#define  MW_TAKE         2                            /* collect materials (the reply is delayed while none is left) */
+#define  MW_STORE        3                                                                            /* go to store */
+#define  MW_DELIVER      4                                                          /* shop: deliver prime materials */
+#define  MW_COLLECT      5                                                      /* shop: collect a batch of products */
+#define  MW_CLOSE        6                                                     /* shop: end of operations (no reply) */
+
+/**
+ *  \brief Definition of <em>actors</em> data type.
+ *
+ *  The shared region mapped by all the processes.
+ */
+
+typedef struct
+        { /** \brief mailboxes, indexed by process */
+          MAILBOX mb[NACT];
+          /** \brief amount of prime materials supplied each time */
+          unsigned int primeMat[NP];
+          /** \brief pieces bought by each customer, or produced by each craftsman (indexed by process) */
+          unsigned int pieces[NACT];
+          /** \brief messages handled and batches taken out by the shop and by the workshop */
+          uint64_t nMsg[2], nBatch[2];
+          /** \brief checkout latency of each customer and of all of them (updated by the shop actor only) */
+          HISTOGRAM queueLat[N+1], serviceLat[N+1];
+        } ACTORS;
+
+/** \brief maximum number of messages an actor takes out at a time */
+static unsigned int batch = 16;
+
+/**
+ *  \brief Random delay of an entity, as drawn by the process based simulation (internal operation).
+ *
+ *  \param max maximum length of the delay
+ */
+
+static void delay (double max)
+{
+  usleep ((unsigned int) floor (max * random () / RAND_MAX + 1.5));
+}
+
+/**
+ *  \brief Request to an actor, waiting for the reply (internal operation).
+ *
+ *  \param p pointer to the shared region
+ *  \param e process issuing the request
+ *  \param a actor
+ *  \param kind kind of message
+ *  \param arg argument
+ *
+ *  \return value replied
+ */
+
+static uint32_t call (ACTORS *p, unsigned int e, unsigned int a, unsigned int kind, uint32_t arg)
+{
+  MESSAGE reply;                                                                                            /* reply */
+
+  mboxPost (&p->mb[a], e, kind, arg);
+  mboxTake (&p->mb[e], &reply, 1, true);
+  return reply.val;
+}
+
+/**
+ *  \brief Life cycle of a customer (internal operation).
+ *
+ *  \param p pointer to the shared region
+ *  \param e process
+ */
+
+static void customer (ACTORS *p, unsigned int e)
+{
+  unsigned int ng;                                                                       /* number of goods selected */
+
+  while (!call (p, e, SHOP, MS_END, 0))
+  { delay (40.0);                                                                              /* living normal life */
+    if (call (p, e, SHOP, MS_ENTER, 0))
+       { if ((ng = call (p, e, SHOP, MS_PICK, (uint32_t) random ())) != 0)
+            { call (p, e, SHOP, MS_BUY, ng);
+              p->pieces[e] += ng;
+            }
+         mboxPost (&p->mb[SHOP], e, MS_EXIT, 0);
+       }
+  }
+}
+
+/**
+ *  \brief Life cycle of a craftsman (internal operation).
+ *
+ *  \param p pointer to the shared region
+ *  \param e process
+ */
+
+static void craftsman (ACTORS *p, unsigned int e)
+{
+  while (!call (p, e, WORKSHOP, MW_END, 0))
+  { if (call (p, e, WORKSHOP, MW_TAKE, 0))                                            /* prime materials running low */
+       mboxPost (&p->mb[SHOP], e, MS_PMAT, 0);
+    delay (30.0);                                                                                   /* shaping it up */
+    p->pieces[e] += 1;
+    if (call (p, e, WORKSHOP, MW_STORE, 0))                                              /* batch ready for transfer */
+       mboxPost (&p->mb[SHOP], e, MS_BATCH, 0);
+  }
+}
+
+/**
+ *  \brief Shop actor (internal operation).
+ *
+ *  Between batches of messages, it carries out a single task, chosen by fixed priority: servicing the customer at
+ *  the head of the queue, delivering prime materials and collecting a batch of products.
+ *
+ *  \param p pointer to the shared region
+ */
+
+static void shopActor (ACTORS *p)
+{
+  MESSAGE msg[MBOX_SIZE];                                                                         /* batch taken out */
+  unsigned int stat = SOPEN,                                                                          /* shop status */
+               nCustIn = 0,                                                            /* number of customers inside */
+               nProdIn = 0,                                                         /* number of products on display */
+               nOpCust = N,                                                   /* number of customers still operative */
+               queue[N], qHead = 0, qLen = 0,                                    /* customers waiting by the counter */
+               trip = 0;                                               /* errand at the workshop (0, if in the shop) */
+  uint64_t qStamp[N];                                                      /* instant each customer joined the queue */
+  bool primeMatReq = false, prodTransfer = false,                                       /* requests of the craftsmen */
+       over = false,                                                        /* the last craftsman has come to an end */
+       lastTrip = false,                                   /* the errand is the collection of the products left over */
+       drained = false,                                                /* the products left over have been collected */
+       idle = false;                                                      /* nothing to do but waiting for a message */
+  unsigned int n, k, c;                                                          /* counting and auxiliary variables */
+  uint32_t u;                                                                                         /* random draw */
+  uint64_t t;                                                   /* instant being addressed, and then service latency */
+
+  for (;;)
+  { if ((n = mboxTake (&p->mb[SHOP], msg, batch, idle)) != 0)
+       { p->nMsg[0] += n;
+         p->nBatch[0] += 1;
+       }
+    for (k = 0; k < n; k++)
+      switch (msg[k].kind)
+      { case MS_END:   c = drained && (((nProdIn < 2 * nOpCust) && (nOpCust != 1)) || (nProdIn == 0));
+                       if (c) nOpCust -= 1;
+                       mboxPost (&p->mb[msg[k].from], SHOP, REPLY, c);
+                       break;
+        case MS_ENTER: c = (stat == SOPEN);
+                       if (c) nCustIn += 1;
+                       mboxPost (&p->mb[msg[k].from], SHOP, REPLY, c);
+                       break;
+        case MS_PICK:  u = msg[k].val;
+                       if ((u < (uint32_t) floor (0.3 * RAND_MAX)) || (nProdIn == 0))
+                          c = 0;
+                          else if ((u < (uint32_t) floor (0.7 * RAND_MAX)) || (nProdIn == 1))
+                                  c = 1;
+                                  else c = 2;
+                       nProdIn -= c;
+                       mboxPost (&p->mb[msg[k].from], SHOP, REPLY, c);
+                       break;
+        case MS_BUY:   c = msg[k].from - 1;
+                       queue[(qHead + qLen) % N] = c;
+                       qLen += 1;
+                       qStamp[c] = msg[k].stamp;
+                       break;
+        case MS_EXIT:  nCustIn -= 1;
+                       break;
+        case MS_PMAT:  primeMatReq = true;
+                       break;
+        case MS_BATCH: prodTransfer = true;
+                       break;
+        case MS_OVER:  over = prodTransfer = true;
+                       break;
+        case MS_DONE:  nProdIn += msg[k].val;                                                      /* return to shop */
+                       if (lastTrip) drained = true;
+                       trip = 0;
+                       stat = SOPEN;
+                       break;
+      }
+
+    /* a single task, by fixed priority */
+
+    idle = false;
+    if (trip != 0)
+       idle = true;
+       else if (qLen != 0)
+               { c = queue[qHead];
+                 qHead = (qHead + 1) % N;
+                 qLen -= 1;
+                 t = histClock ();
+                 histAdd (&p->queueLat[c], t - qStamp[c]);
+                 histAdd (&p->queueLat[N], t - qStamp[c]);
+                 delay (20.0);                                                                      /* servicing him */
+                 t = histClock () - t;
+                 histAdd (&p->serviceLat[c], t);
+                 histAdd (&p->serviceLat[N], t);
+                 mboxPost (&p->mb[c+1], SHOP, REPLY, 0);
+               }
+               else if (primeMatReq || prodTransfer)
+                       { if (nCustIn != 0)
+                            { stat = SDCLOSED;                                                     /* close the door */
+                              idle = true;
+                            }
+                            else { stat = SCLOSED;                                               /* prepare to leave */
+                                   if (primeMatReq)
+                                      { primeMatReq = false;
+                                        trip = MW_DELIVER;
+                                      }
+                                      else { prodTransfer = false;
+                                             trip = MW_COLLECT;
+                                             lastTrip = over;
+                                           }
+                                   mboxPost (&p->mb[WORKSHOP], SHOP, trip, 0);
+                                   idle = true;
+                                 }
+                       }
+                       else if (drained && (nOpCust == 0) && (nCustIn == 0))
+                               { mboxPost (&p->mb[WORKSHOP], SHOP, MW_CLOSE, 0);
+                                 return;
+                               }
+                               else idle = true;
+  }
+}
+
+/**
+ *  \brief Workshop actor (internal operation).
+ *
+ *  \param p pointer to the shared region
+ */
+
+static void workshopActor (ACTORS *p)
+{
+  MESSAGE msg[MBOX_SIZE];                                                                         /* batch taken out */
+  unsigned int nPMatIn = p->primeMat[0],                                         /* amount of prime materials stored */
+               wsProdIn = 0,                                                            /* number of products stored */
+               NSPMat = 1,                                                  /* number of supplies of prime materials */
+               nOpCraft = M,                                                  /* number of craftsmen still operative */
+               waiting[M], nWait = 0;                                       /* craftsmen waiting for prime materials */
+  bool closed = false;                                                                          /* end of operations */
+  unsigned int n, k, i, c;                                                       /* counting and auxiliary variables */
+
+  while (!closed)
+  { n = mboxTake (&p->mb[WORKSHOP], msg, batch, true);
+    p->nMsg[1] += n;
+    p->nBatch[1] += 1;
+    for (k = 0; k < n; k++)
+      switch (msg[k].kind)
+      { case MW_END:     c = (NSPMat == NP) && (nPMatIn < nOpCraft * PP);
+                         if (c && (--nOpCraft == 0))
+                            mboxPost (&p->mb[SHOP], WORKSHOP, MS_OVER, 0);
+                         mboxPost (&p->mb[msg[k].from], WORKSHOP, REPLY, c);
+                         break;
+        case MW_TAKE:    if (nPMatIn < PP)                                               /* wait for prime materials */
+                            waiting[nWait++] = msg[k].from;
+                            else { nPMatIn -= PP;
+                                   mboxPost (&p->mb[msg[k].from], WORKSHOP, REPLY, nPMatIn < PMIN);
+                                 }
+                         break;
+        case MW_STORE:   wsProdIn += 1;
+                         mboxPost (&p->mb[msg[k].from], WORKSHOP, REPLY, wsProdIn >= MAX);
+                         break;
+        case MW_DELIVER: if (NSPMat < NP)
+                            nPMatIn += p->primeMat[NSPMat++];
+                         for (i = 0; (i < nWait) && (nPMatIn >= PP); i++)
+                         { nPMatIn -= PP;
+                           mboxPost (&p->mb[waiting[i]], WORKSHOP, REPLY, nPMatIn < PMIN);
+                         }
+                         memmove (waiting, waiting + i, (nWait - i) * sizeof (unsigned int));
+                         nWait -= i;
+                         mboxPost (&p->mb[SHOP], WORKSHOP, MS_DONE, 0);
+                         break;
+        case MW_COLLECT: mboxPost (&p->mb[SHOP], WORKSHOP, MS_DONE, wsProdIn);
+                         wsProdIn = 0;
+                         break;
+        case MW_CLOSE:   closed = true;
+                         break;
+      }
+  }
+}
+
+/**
+ *  \brief Printing of a line of the checkout latency table, as in the run summary of the launcher (internal
+ *         operation).
+ *
+ *  \param kind kind of latency
+ *  \param n customer identification (N for all of them)
+ *  \param p_h pointer to the histogram
+ */
+
+static void printLatency (const char *kind, unsigned int n, HISTOGRAM *p_h)
+{
+  char who[16];                                                                                    /* customer label */
+
+  if (n == N)
+     strcpy (who, "all");
+     else sprintf (who, "customer %u", n);
+  printf ("  %-9s %-13s %12llu %8.1f %8.1f %8.1f %8.1f %8.1f\n", kind, who, (unsigned long long) p_h->count,
+          histPercentile (p_h, 0.5) / 1e3, histPercentile (p_h, 0.9) / 1e3, histPercentile (p_h, 0.99) / 1e3,
+          histPercentile (p_h, 0.999) / 1e3, p_h->max / 1e3);
+}
+
+/**
+ *  \brief Main program.
+ *
+ *  Its role is running the simulation the number of times requested, by generating the processes of the actors,
+ *  the customers and the craftsmen, and printing the pooled figures.
+ */
+
+int main (int argc, char *argv[])
+{
+  ACTORS *p;                                                                             /* pointer to shared region */
+  unsigned int runs = 1,                                                                           /* number of runs */
+               total,                                                    /* total amount of prime materials supplied */
+               sold = 0, made = 0,                                                       /* pieces sold and produced */
+               r, e, i;                                                                        /* counting variables */
+  uint32_t seed = 1;                                                                /* seed of the random generators */
+  double ms, sum = 0.0, min = INFINITY, max = 0.0;                                        /* simulation time (in ms) */
+  uint64_t t0;                                                                            /* instant the run started */
+  int go[2];                                                                      /* pipe whose closing starts a run */
+  char dummy;                                                                                     /* byte never read */
+  pid_t pid[NACT];                                                                                    /* process ids */
+  int status;                                                                                    /* execution status */
+  int c;                                                                                      /* command line option */
+  char *tinp;                                                                      /* numerical parameters test flag */
+
+  while ((c = getopt (argc, argv, "r:b:s:")) != -1)
+    switch (c)
+    { case 'r': runs = (unsigned int) strtoul (optarg, &tinp, 0);
+                if ((*tinp != '\0') || (runs == 0))
+                   { fprintf (stderr, "Invalid number of runs: %s\n", optarg);
+                     exit (EXIT_FAILURE);
+                   }
+                break;
+      case 'b': batch = (unsigned int) strtoul (optarg, &tinp, 0);
+                if ((*tinp != '\0') || (batch == 0) || (batch > MBOX_SIZE))
+                   { fprintf (stderr, "Invalid batch size (1 to %d): %s\n", MBOX_SIZE, optarg);
+                     exit (EXIT_FAILURE);
+                   }
+                break;
+      case 's': seed = (uint32_t) strtoul (optarg, &tinp, 0);
+                if (*tinp != '\0')
+                   { fprintf (stderr, "Invalid seed: %s\n", optarg);
+                     exit (EXIT_FAILURE);
+                   }
+                break;
+      default:  fprintf (stderr, "Usage: %s [-r runs] [-b batch] [-s seed]\n", argv[0]);
+                exit (EXIT_FAILURE);
+    }
+
+  if ((p = mmap (NULL, sizeof (ACTORS), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+     { perror ("error on mapping the shared region");
+       exit (EXIT_FAILURE);
+     }
+  memset (p, 0, sizeof (ACTORS));
+  for (i = 0; i <= N; i++)
+  { histInit (&p->queueLat[i]);
+    histInit (&p->serviceLat[i]);
+  }
+
+  for (r = 0; r < runs; r++)
+  { /* initialization of the run: the amounts of prime materials are drawn as in the launcher */
+
+    srandom (seed + r * NACT);
+    for (total = 0, i = 0; i < NP; i++)
+    { p->primeMat[i] = (unsigned int) floor (10.0*PP*random ()/RAND_MAX+PP+0.5);
+      total += p->primeMat[i];
+    }
+    if (p->primeMat[NP-1] < 2*PP*M)
+       { total += 2*PP*M - p->primeMat[NP-1];
+         p->primeMat[NP-1] = 2*PP*M;
+       }
+    if (total % PP != 0) p->primeMat[NP-1] += PP - total % PP;
+    for (e = 0; e < NACT; e++)
+    { mboxInit (&p->mb[e]);
+      p->pieces[e] = 0;
+    }
+
+    /* generation of the processes, which wait for the pipe to be closed */
+
+    if (pipe (go) == -1)
+       { perror ("error on creating the starting pipe");
+         exit (EXIT_FAILURE);
+       }
+    for (e = 0; e < NACT; e++)
+      if ((pid[e] = fork ()) == -1)
+         { perror ("error on the fork operation");
+           exit (EXIT_FAILURE);
+         }
+         else if (pid[e] == 0)
+                 { close (go[1]);
+                   if (read (go[0], &dummy, 1) == -1)
+                      { perror ("error on waiting for the start");
+                        exit (EXIT_FAILURE);
+                      }
+                   srandom (seed + r * NACT + e + 1);
+                   if (e == SHOP)
+                      shopActor (p);
+                      else if (e == WORKSHOP)
+                              workshopActor (p);
+                              else if (e <= N)
+                                      customer (p, e);
+                                      else craftsman (p, e);
+                   exit (EXIT_SUCCESS);
+                 }
+    close (go[0]);
+    t0 = histClock ();
+    close (go[1]);
+
+    /* waiting for the termination of the processes */
+
+    for (e = 0; e < NACT; e++)
+    { if (waitpid (pid[e], &status, 0) == -1)
+         { perror ("error on waiting for a process");
+           exit (EXIT_FAILURE);
+         }
+      if (!WIFEXITED (status) || (WEXITSTATUS (status) != EXIT_SUCCESS))
+         { fprintf (stderr, "Process %u has terminated abnormally!\n", e);
+           exit (EXIT_FAILURE);
+         }
+    }
+    ms = (histClock () - t0) / 1e6;
+    sum += ms;
+    if (ms < min) min = ms;
+    if (ms > max) max = ms;
+    for (e = 1; e <= N; e++)
+      sold += p->pieces[e];
+    for (e = N+1; e <= N+M; e++)
+      made += p->pieces[e];
+  }
+
+  printf ("Actor engine: %u run%s, seed %u, batches of up to %u messages, %u customers, %u craftsmen\n", runs,
+          (runs == 1) ? "" : "s", (unsigned int) seed, batch, N, M);
+  printf ("simulation: %.3f ms (mean), %.3f ms (min), %.3f ms (max)\n", sum / runs, min, max);
+  printf ("pieces sold: %u, produced: %u, throughput: %.3f pieces sold per ms\n", sold, made, sold / sum);
+  printf ("shop: %llu messages in %llu batches; workshop: %llu messages in %llu batches\n",
+          (unsigned long long) p->nMsg[0], (unsigned long long) p->nBatch[0], (unsigned long long) p->nMsg[1],
+          (unsigned long long) p->nBatch[1]);
+  printf ("checkout latency (us)            count      p50      p90      p99     p999      max\n");
+  for (i = 0; i <= N; i++)
+  { printLatency ("queueing", i, &p->queueLat[i]);
+    printLatency ("service", i, &p->serviceLat[i]);
+  }
+
+  return EXIT_SUCCESS;
+}
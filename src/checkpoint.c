@@ -0,0 +1,198 @@
+/**
+ *  \file checkpoint.c (implementation file)
+ *
+ *  Problem name: Aveiro Handicraft SARL
+ *
+ *  Concept: Pedro Mariano
+ *
+ *  \brief Checkpoint and warm start of a running simulation.
+ *
+ *  Defined operations:
+ *     \li taking of a checkpoint of the running simulation and saving it to a file
+ *     \li loading of a checkpoint from a file
+ *     \li initialization of the full state of the problem from a checkpoint.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "queue.h"
+#include "sharedDataSync.h"
+#include "semaphore.h"
+#include "schedPolicy.h"
+#include "checkpoint.h"
+
+/**
+ *  \brief Taking of a checkpoint of the running simulation and saving it to a file.
+ *
+ *  The snapshot is taken within the critical region and written afterwards to a temporary file, which is renamed
+ *  upon completion, so the file always holds a whole checkpoint. The function fails with <tt>EBUSY</tt> if an
+ *  intervening entity has already finished its life cycle, as the simulation is then winding down, and with
+ *  <tt>EINTR</tt> if the entrance to the critical region was interrupted by a signal.
+ *
+ *  \param fName name of the checkpoint file
+ *  \param semgid semaphore set access identifier
+ *  \param sh pointer to the shared memory region
+ *  \param simNs time simulated so far (in ns)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int ckptSave (char *fName, int semgid, SHARED_DATA *sh, uint64_t simNs)
+{
+  CHECKPOINT ck;                                                                                       /* checkpoint */
+  char tmp[FILENAME_MAX];                                                              /* name of the temporary file */
+  FILE *fic;                                                                                      /* file descriptor */
+  bool done = false;                                                      /* some entity has finished its life cycle */
+  int err = 0;                                                                           /* error reading semaphores */
+  unsigned int i;                                                                               /* counting variable */
+
+  memset (&ck, 0, sizeof (CHECKPOINT));
+  ck.dim[0] = N;
+  ck.dim[1] = M;
+  ck.dim[2] = NP;
+  ck.dim[3] = PP;
+  ck.simNs = simNs;
+
+  if (crLock (&(sh->cr), semgid, sh->lockSem) == -1)                                        /* enter critical region */
+     return -1;
+  ck.fSt = sh->fSt;
+  ck.nCraftsmenBlk = sh->nCraftsmenBlk;
+  for (i = 0; i < NS; i++)
+  { ck.nCustomersBlk += sh->nCustomersBlk[i];
+    done = done || !sh->inBusiness[i];
+  }
+  if (semGetAll (semgid, ck.sem) == -1)
+     err = errno;
+  if (crUnlock (&(sh->cr), semgid, sh->lockSem) == -1)                                       /* exit critical region */
+     return -1;
+  if (err != 0)
+     { errno = err;
+       return -1;
+     }
+
+  for (i = 0; i < N; i++)
+    done = done || !ck.fSt.st.custStat[i].readyToWork;
+  for (i = 0; i < M; i++)
+    done = done || !ck.fSt.st.craftStat[i].readyToWork;
+  if (done)
+     { errno = EBUSY;
+       return -1;
+     }
+
+  if (snprintf (tmp, FILENAME_MAX, "%s.tmp", fName) >= FILENAME_MAX)
+     { errno = ENAMETOOLONG;
+       return -1;
+     }
+  if ((fic = fopen (tmp, "w")) == NULL)
+     return -1;
+  if ((fwrite (CKPT_MAGIC, 1, CKPT_MAGICSZ, fic) != CKPT_MAGICSZ) || (fwrite (&ck, sizeof (CHECKPOINT), 1, fic) != 1))
+     { err = errno;
+       fclose (fic);
+       remove (tmp);
+       errno = err;
+       return -1;
+     }
+  if (fclose (fic) == EOF)
+     return -1;
+  return rename (tmp, fName);
+}
+
+/**
+ *  \brief Loading of a checkpoint from a file.
+ *
+ *  The function fails with <tt>EINVAL</tt> if the file is not a checkpoint or was taken with different problem
+ *  constants or number of shops, which shows up as a record of a different size.
+ *
+ *  \param fName name of the checkpoint file
+ *  \param p_ck pointer to the location where the checkpoint is to be stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int ckptLoad (char *fName, CHECKPOINT *p_ck)
+{
+  FILE *fic;                                                                                      /* file descriptor */
+  char magic[CKPT_MAGICSZ];                                                          /* start of the checkpoint file */
+  bool valid;                                                                                /* checkpoint is usable */
+
+  if ((fic = fopen (fName, "r")) == NULL)
+     return -1;
+  valid = (fread (magic, 1, CKPT_MAGICSZ, fic) == CKPT_MAGICSZ) && (memcmp (magic, CKPT_MAGIC, CKPT_MAGICSZ) == 0) &&
+          (fread (p_ck, sizeof (CHECKPOINT), 1, fic) == 1) && (fgetc (fic) == EOF) &&
+          (p_ck->dim[0] == N) && (p_ck->dim[1] == M) && (p_ck->dim[2] == NP) && (p_ck->dim[3] == PP);
+  fclose (fic);
+  if (!valid)
+     { errno = EINVAL;
+       return -1;
+     }
+  return 0;
+}
+
+/**
+ *  \brief Initialization of the full state of the problem from a checkpoint.
+ *
+ *  The state is normalized as described above, no entity is blocked and the pending phone calls of the craftsmen are
+ *  registered anew with the scheduling policy, which must have been initialized. It must be called by the launcher
+ *  before the initial state is saved.
+ *
+ *  \param p_ck pointer to the location where the checkpoint is stored
+ *  \param sh pointer to the shared memory region
+ *  \param owed pointer to the location where the number of pending requests of each shop, the <em>up</em>
+ *         operations its <tt>proceed</tt> semaphore is owed, is to be stored
+ */
+
+void ckptWarm (CHECKPOINT *p_ck, SHARED_DATA *sh, unsigned int owed[])
+{
+  FULL_STAT *p_fSt = &(sh->fSt);                                         /* pointer to the full state of the problem */
+  unsigned int sold = 0,                                                                   /* pieces paid for so far */
+               inDisplay = 0,                                                  /* pieces in display in all the shops */
+               i, s;                                                                           /* counting variables */
+
+  *p_fSt = p_ck->fSt;
+
+  /* every entity starts at the top of its life cycle */
+
+  for (s = 0; s < NS; s++)
+    p_fSt->st.entrepStat[s] = OPENING_THE_SHOP;
+  for (i = 0; i < N; i++)
+  { p_fSt->st.custStat[i].stat = CARRYING_OUT_DAILY_CHORES;
+    sold += p_fSt->st.custStat[i].boughtPieces;
+  }
+  for (i = 0; i < M; i++)
+    p_fSt->st.craftStat[i].stat = FETCHING_PRIME_MATERIALS;
+  for (s = 0; s < NS; s++)
+  { p_fSt->shop[s].stat = SCLOSED;
+    p_fSt->shop[s].nCustIn = 0;
+    queueInit (&(p_fSt->shop[s].queue));
+    inDisplay += p_fSt->shop[s].nProdIn;
+  }
+
+  /* work in progress is given back: prime materials not yet turned into pieces and pieces picked, but not paid for */
+
+  p_fSt->workShop.nPMatIn = p_fSt->workShop.NTPMat - PP * p_fSt->workShop.NTProd;
+  p_fSt->shop[0].nProdIn += p_fSt->workShop.NTProd - p_fSt->workShop.nProdIn - sold - inDisplay;
+
+  /* no entity is blocked and the pending phone calls are registered anew */
+
+  sh->nCraftsmenBlk = 0;
+  for (s = 0; s < NS; s++)
+  { sh->nCustomersBlk[s] = 0;
+    p_fSt->shop[s].primeMatReq = p_fSt->shop[s].prodTransfer = false;
+    if (p_ck->fSt.shop[s].primeMatReq)
+       schedRequest (&(sh->sched[s]), &(p_fSt->shop[s]), SCHED_P, 0);
+    if (p_ck->fSt.shop[s].prodTransfer)
+       schedRequest (&(sh->sched[s]), &(p_fSt->shop[s]), SCHED_G, 0);
+    p_fSt->shop[s].primeMatReq = p_ck->fSt.shop[s].primeMatReq;
+    p_fSt->shop[s].prodTransfer = p_ck->fSt.shop[s].prodTransfer;
+    owed[s] = (p_fSt->shop[s].primeMatReq ? 1 : 0) + (p_fSt->shop[s].prodTransfer ? 1 : 0);
+  }
+}
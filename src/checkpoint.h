@@ -0,0 +1,111 @@
+/**
+ *  \file checkpoint.h (interface file)
+ *
+ *  Problem name: Aveiro Handicraft SARL
+ *
+ *  Concept: Pedro Mariano
+ *
+ *  \brief Checkpoint and warm start of a running simulation.
+ *
+ *  A checkpoint is a snapshot of the full state of the problem (waiting queue included), of the number of entities
+ *  blocked and of the values of the semaphores, taken by the launcher within the critical region, so that all of
+ *  them are consistent with one another. It is written to a file which starts with the magic string
+ *  <tt>CKPT_MAGIC</tt>, followed by the record, and it is only accepted by a launcher built with the same problem
+ *  constants and number of shops.
+ *
+ *  A later run may warm start from a checkpoint. The intervening entities are spawned anew and start at the top of
+ *  their life cycles, so the state recorded is normalized first: the stock, the pieces produced and bought, the
+ *  deliveries made and the pending phone calls of the craftsmen are kept, whereas work in progress is given back:
+ *  prime materials being turned into pieces return to the store room of the workshop and goods picked by customers
+ *  who have not yet paid return to the display of the shop (the first one, when there are several shops).
+ *
+ *  Defined operations:
+ *     \li taking of a checkpoint of the running simulation and saving it to a file
+ *     \li loading of a checkpoint from a file
+ *     \li initialization of the full state of the problem from a checkpoint.
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <stdint.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "sharedDataSync.h"
+
+/** \brief magic string at the beginning of a checkpoint file */
+#define  CKPT_MAGIC      "AHCKPT01"
+
+/** \brief size of the magic string at the beginning of a checkpoint file (in bytes) */
+#define  CKPT_MAGICSZ    8
+
+/**
+ *  \brief Definition of <em>checkpoint</em> data type.
+ */
+
+typedef struct
+        { /** \brief problem constants the checkpoint was taken with: N, M, NP and PP */
+          uint32_t dim[4];
+          /** \brief time simulated until the checkpoint was taken (in ns) */
+          uint64_t simNs;
+          /** \brief full state of the problem */
+          FULL_STAT fSt;
+          /** \brief number of craftsmen who were blocked waiting for the availability of prime materials */
+          uint32_t nCraftsmenBlk;
+          /** \brief number of customers who were blocked waiting for the door of some shop to open */
+          uint32_t nCustomersBlk;
+          /** \brief values of the semaphores (index 0 included) */
+          unsigned short sem[SEM_NU+1];
+        } CHECKPOINT;
+
+/**
+ *  \brief Taking of a checkpoint of the running simulation and saving it to a file.
+ *
+ *  The snapshot is taken within the critical region and written afterwards to a temporary file, which is renamed
+ *  upon completion, so the file always holds a whole checkpoint. The function fails with <tt>EBUSY</tt> if an
+ *  intervening entity has already finished its life cycle, as the simulation is then winding down, and with
+ *  <tt>EINTR</tt> if the entrance to the critical region was interrupted by a signal.
+ *
+ *  \param fName name of the checkpoint file
+ *  \param semgid semaphore set access identifier
+ *  \param sh pointer to the shared memory region
+ *  \param simNs time simulated so far (in ns)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int ckptSave (char *fName, int semgid, SHARED_DATA *sh, uint64_t simNs);
+
+/**
+ *  \brief Loading of a checkpoint from a file.
+ *
+ *  The function fails with <tt>EINVAL</tt> if the file is not a checkpoint or was taken with different problem
+ *  constants or number of shops.
+ *
+ *  \param fName name of the checkpoint file
+ *  \param p_ck pointer to the location where the checkpoint is to be stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int ckptLoad (char *fName, CHECKPOINT *p_ck);
+
+/**
+ *  \brief Initialization of the full state of the problem from a checkpoint.
+ *
+ *  The state is normalized as described above, no entity is blocked and the pending phone calls of the craftsmen are
+ *  registered anew with the scheduling policy, which must have been initialized. It must be called by the launcher
+ *  before the initial state is saved.
+ *
+ *  \param p_ck pointer to the location where the checkpoint is stored
+ *  \param sh pointer to the shared memory region
+ *  \param owed pointer to the location where the number of pending requests of each shop, the <em>up</em>
+ *         operations its <tt>proceed</tt> semaphore is owed, is to be stored
+ */
+
+extern void ckptWarm (CHECKPOINT *p_ck, SHARED_DATA *sh, unsigned int owed[]);
+
+#endif /* CHECKPOINT_H_ */
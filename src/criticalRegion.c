@@ -0,0 +1,917 @@
+/**
+ *  \file criticalRegion.c (implementation file)
+ *
+ *  Problem name: Aveiro Handicraft SARL
+ *
+ *  Concept: Pedro Mariano
+ *
+ *  \brief Access to the critical region, with record and replay of the interleaving.
+ *
+ *  The adaptive lock follows the usual three state futex mutex: a process parking marks the lock word as having
+ *  processes parked, so the one releasing it only enters the kernel to wake one of them up when there may be some.
+ *  The time each lock is held is measured on release, by the holder, and a process finding the lock held spins for
+ *  up to twice its moving average, converted to iterations by timing the spin loop once per process.
+ *
+ *  The queues of the fair lock are kept under a guard, a spin lock only held while a process joins a queue or the
+ *  next holder is picked out, which is waited for by yielding the processor, as its holder may have been preempted.
+ *  The launcher waits in a slot of its own, after the ones of the intervening entities.
+ *
+ *  The set of locks held is kept per entity, so the order they are taken in can be checked and they are all released
+ *  on exit. The entity is the one the calling thread acts for: the coordinator, which binds every entity run by an
+ *  entity host, carries out their operations from a pool of threads, an operation possibly being left within the
+ *  critical region and the next one of the same entity carried out by another thread.
+ *
+ *  With a single lock, only the first one is used, whose semaphore is <tt>access</tt>, the one the precompiled
+ *  entities down and up, and the entries are numbered, recorded and replayed as a total order.
+ *
+ *  Defined operations:
+ *     \li initialization of the critical region information and of the replay file
+ *     \li binding of an intervening entity to the critical region information
+ *     \li acting for an entity bound
+ *     \li handing the first turn in replay mode
+ *     \li taking all the locks
+ *     \li releasing all the locks
+ *     \li entering the critical region
+ *     \li exiting the critical region
+ *     \li locks held by the entity acted for
+ *     \li entity bound
+ *     \li taking the lock of the log
+ *     \li releasing the lock of the log
+ *     \li blocking on a semaphore shared by several entities
+ *     \li outcome of a random choice
+ *     \li random delay
+ *     \li writing of the records still buffered.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "probConst.h"
+#include "semaphore.h"
+#include "histogram.h"
+#include "criticalRegion.h"
+
+/** \brief hint to the processor that the caller is spinning */
+#if defined(__x86_64__) || defined(__i386__)
+#define  CPU_RELAX()     __builtin_ia32_pause ()
+#elif defined(__aarch64__)
+#define  CPU_RELAX()     __asm__ __volatile__ ("yield" ::: "memory")
+#else
+#define  CPU_RELAX()     __asm__ __volatile__ ("" ::: "memory")
+#endif
+
+/** \brief number of spin iterations timed to find out their cost */
+#define  CR_CALIBRATE    1000
+
+/** \brief number of spin iterations on the guard of the fair lock before yielding the processor */
+#define  CR_GUARDSPIN    64
+
+/** \brief number of records gathered by a process before they are written to the file */
+#define  CR_BUFSZ        512
+
+/** \brief critical region information the process is bound to */
+static CRINFO *p_crInfo = NULL;
+
+/** \brief mode, copied upon binding (the records are written upon termination, when the shared region may be no
+ *         longer mapped) */
+static unsigned int crMode = CR_FREE;
+
+/** \brief name of the replay file, copied upon binding */
+static char crFile[CR_NAMESZ];
+
+/** \brief semaphore set access identifier */
+static int crSemgid;
+
+/** \brief identification of the lock semaphores */
+static unsigned int crAccess[CR_NLOCK];
+
+/** \brief identification of the turn semaphores */
+static unsigned int crTurn[N+M+NS];
+
+/** \brief identification of the entity the calling thread acts for */
+static __thread unsigned int crEnt = N+M+NS;
+
+/** \brief each entity is within the critical region (the last element stands for no entity) */
+static bool crIn[N+M+NS+1];
+
+/** \brief set of locks held by each entity (the last element stands for no entity) */
+static unsigned int crSet[N+M+NS+1];
+
+/** \brief file descriptor of the replay file */
+static int crFd = -1;
+
+/** \brief records gathered by the process (record mode) */
+static CRREC crBuf[CR_BUFSZ];
+
+/** \brief number of records gathered by the process (record mode) */
+static unsigned int nBuf = 0;
+
+/** \brief process the records gathered belong to (records inherited through fork are discarded) */
+static pid_t bufPid = 0;
+
+/** \brief entity which entered the critical region, for every entry recorded (replay mode) */
+static uint16_t *seq = NULL;
+
+/** \brief outcomes of the random choices recorded for each entity bound (replay mode) */
+static uint32_t *val[N+M+NS+1];
+
+/** \brief number of outcomes recorded for each entity bound (replay mode) */
+static unsigned int nVal[N+M+NS+1];
+
+/** \brief number of outcomes already used by each entity bound (replay mode) */
+static unsigned int vPos[N+M+NS+1];
+
+/** \brief cost of a spin iteration (in ns; 0 - not yet timed, -1 - no spinning, on a single processor) */
+static double spinNs = 0.0;
+
+/**
+ *  \brief Gathering of a record (internal operation).
+ *
+ *  \param kind kind of record
+ *  \param v number of the entry, outcome of the choice, or delay
+ */
+
+static void putRecord (unsigned int kind, uint32_t v)
+{
+  if (bufPid != getpid ())
+     { nBuf = 0;
+       bufPid = getpid ();
+     }
+  crBuf[nBuf].kind = (uint16_t) kind;
+  crBuf[nBuf].ent = (uint16_t) crEnt;
+  crBuf[nBuf].val = v;
+  if (++nBuf == CR_BUFSZ) crFlush ();
+}
+
+/**
+ *  \brief Loading of a replay file (internal operation).
+ *
+ *  The entries into the critical region are put in the order they took place and the outcomes of the random choices
+ *  made by the given entity are kept in the order they were drawn.
+ *
+ *  \param fName name of the replay file
+ *  \param p_hd pointer to the location where the header is to be stored
+ *  \param ent entity identification (<tt>N+M+NS</tt> if no outcome is to be kept)
+ *  \param p_nRec pointer to the location where the number of entries is to be stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+static int loadFile (char *fName, CRHEADER *p_hd, unsigned int ent, uint32_t *p_nRec)
+{
+  FILE *fic;                                                                                      /* file descriptor */
+  CRREC *rec,                                                                                        /* records read */
+        *more;                                                                              /* record array enlarged */
+  unsigned int nRead = 0,                                                                       /* number of records */
+               cap = 4096,                                                               /* capacity of record array */
+               nEnt = 0,                                                                        /* number of entries */
+               nv = 0,                                                                         /* number of outcomes */
+               i;                                                                               /* counting variable */
+  bool valid;                                                                               /* replay file is usable */
+
+  if ((fic = fopen (fName, "r")) == NULL)
+     return -1;
+  valid = (fread (p_hd, sizeof (CRHEADER), 1, fic) == 1) && (memcmp (p_hd->magic, CR_MAGIC, CR_MAGICSZ) == 0) &&
+          (p_hd->dim[0] == N) && (p_hd->dim[1] == M) && (p_hd->dim[2] == NP) && (p_hd->dim[3] == PP);
+  if (!valid)
+     { fclose (fic);
+       errno = EINVAL;
+       return -1;
+     }
+  if ((rec = malloc (cap * sizeof (CRREC))) == NULL)
+     { fclose (fic);
+       return -1;
+     }
+  while (fread (&rec[nRead], sizeof (CRREC), 1, fic) == 1)
+    if (++nRead == cap)
+       { if ((more = realloc (rec, (cap *= 2) * sizeof (CRREC))) == NULL)
+            { free (rec);
+              fclose (fic);
+              return -1;
+            }
+         rec = more;
+       }
+  fclose (fic);
+
+  for (i = 0; i < nRead; i++)
+    if (rec[i].kind == CR_ENTER)
+       nEnt += 1;
+       else if ((rec[i].kind == CR_VALUE) && (rec[i].ent == ent))
+               nv += 1;
+  free (seq);
+  free (val[ent]);
+  if (((seq = malloc ((nEnt + 1) * sizeof (uint16_t))) == NULL) ||
+      ((val[ent] = malloc ((nv + 1) * sizeof (uint32_t))) == NULL))
+     { free (rec);
+       return -1;
+     }
+  for (i = 0; i < nEnt; i++)
+    seq[i] = N+M+NS;
+  for (nv = 0, i = 0; i < nRead; i++)
+    if (rec[i].kind == CR_ENTER)
+       { if ((rec[i].val >= nEnt) || (rec[i].ent >= N+M+NS) || (seq[rec[i].val] != N+M+NS))
+            valid = false;                                                           /* every entry is recorded once */
+            else seq[rec[i].val] = rec[i].ent;
+       }
+       else if ((rec[i].kind == CR_VALUE) && (rec[i].ent == ent))
+               val[ent][nv++] = rec[i].val;
+  free (rec);
+  if (!valid)
+     { errno = EINVAL;
+       return -1;
+     }
+  nVal[ent] = nv;
+  *p_nRec = nEnt;
+  return 0;
+}
+
+/**
+ *  \brief Initialization of the critical region information and of the replay file.
+ *
+ *  The function must be called by the process that creates the shared memory region. In record mode, the replay
+ *  file is created and the settings of the run and the amounts of prime materials are written to it; in replay mode,
+ *  the settings are checked against the ones recorded, as the runs would diverge otherwise, and the amounts recorded
+ *  are read from it into <tt>primeMat</tt>.
+ *
+ *  \param p_cr pointer to the location where the critical region information is stored
+ *  \param mode mode of operation
+ *  \param lock kind of lock
+ *  \param single a single lock is to be used, instead of one per part of the state (it always is, in record and
+ *         replay modes)
+ *  \param fName name of the replay file (ignored in free mode)
+ *  \param conf settings which change the behaviour of the intervening entities (<tt>CR_NCONF</tt> elements)
+ *  \param primeMat amounts of prime materials supplied each time
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>; <tt>EINVAL</tt>, if
+ *          the file is not a replay file or was recorded with different problem constants or settings)
+ */
+
+int crInit (CRINFO *p_cr, unsigned int mode, unsigned int lock, bool single, char *fName,
+            unsigned int *conf, unsigned int *primeMat)
+{
+  CRHEADER hd;                                                                                 /* replay file header */
+  FILE *fic;                                                                                      /* file descriptor */
+  CRLOCK *p_lk;                                                                                      /* lock at hand */
+  unsigned int i;                                                                               /* counting variable */
+
+  p_cr->mode = mode;
+  p_cr->file[0] = '\0';
+  p_cr->nEntry = p_cr->nRec = p_cr->first = 0;
+  p_cr->lock = lock;
+  p_cr->nLock = (single || (mode != CR_FREE)) ? 1 : CR_NLOCK;
+  for (i = 0; i < CR_NLOCK; i++)
+  { p_lk = &(p_cr->lk[i]);
+    p_lk->word = p_lk->held = 1;                                      /* taken, until the critical region is enabled */
+    p_lk->guard = 0;
+    p_lk->qHead[0] = p_lk->qHead[1] = p_lk->qLen[0] = p_lk->qLen[1] = 0;
+    memset (p_lk->grant, 0, sizeof (p_lk->grant));
+    p_lk->enterNs = p_lk->holdNs = 0;
+    p_lk->nFree = p_lk->nSpin = p_lk->nPark = p_lk->nPrio = 0;
+    p_lk->qMax = 0;
+  }
+  if (mode == CR_FREE) return 0;
+  strncpy (p_cr->file, fName, CR_NAMESZ - 1);
+  p_cr->file[CR_NAMESZ-1] = '\0';
+
+  if (mode == CR_RECORD)
+     { memset (&hd, 0, sizeof (CRHEADER));
+       memcpy (hd.magic, CR_MAGIC, CR_MAGICSZ);
+       hd.dim[0] = N;
+       hd.dim[1] = M;
+       hd.dim[2] = NP;
+       hd.dim[3] = PP;
+       for (i = 0; i < CR_NCONF; i++)
+         hd.conf[i] = conf[i];
+       for (i = 0; i < NP; i++)
+         hd.primeMaterials[i] = primeMat[i];
+       if ((fic = fopen (p_cr->file, "w")) == NULL)
+          return -1;
+       if (fwrite (&hd, sizeof (CRHEADER), 1, fic) != 1)
+          { fclose (fic);
+            return -1;
+          }
+       return (fclose (fic) == EOF) ? -1 : 0;
+     }
+
+  if (loadFile (p_cr->file, &hd, N+M+NS, &(p_cr->nRec)) == -1)
+     return -1;
+  for (i = 0; i < CR_NCONF; i++)
+    if (hd.conf[i] != conf[i])
+       { errno = EINVAL;
+         return -1;
+       }
+  for (i = 0; i < NP; i++)
+    primeMat[i] = hd.primeMaterials[i];
+  p_cr->first = (p_cr->nRec == 0) ? 0 : seq[0];
+  return 0;
+}
+
+/**
+ *  \brief Binding of an intervening entity to the critical region information.
+ *
+ *  The function must be called by every intervening entity upon mapping the shared memory region on its address space.
+ *  In replay mode, the records are loaded from the replay file.
+ *
+ *  \param p_cr pointer to the location where the critical region information is stored
+ *  \param semgid semaphore set access identifier
+ *  \param access identification of the lock semaphores (<tt>CR_NLOCK</tt> elements)
+ *  \param turn identification of the turn semaphores (one per entity)
+ *  \param ent entity identification
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int crBind (CRINFO *p_cr, int semgid, unsigned int *access, unsigned int *turn, unsigned int ent)
+{
+  static bool registered = false;                                          /* writing upon termination is registered */
+  CRHEADER hd;                                                                                 /* replay file header */
+  uint32_t nRec;                                                                                /* number of entries */
+  unsigned int i;                                                                               /* counting variable */
+
+  p_crInfo = p_cr;
+  crMode = p_cr->mode;
+  strcpy (crFile, p_cr->file);
+  crSemgid = semgid;
+  for (i = 0; i < CR_NLOCK; i++)
+    crAccess[i] = access[i];
+  for (i = 0; i < N+M+NS; i++)
+    crTurn[i] = turn[i];
+  crEnt = ent;
+  crIn[ent] = false;
+  crSet[ent] = 0;
+  if ((crMode == CR_RECORD) && !registered)
+     { atexit (crFlush);
+       registered = true;
+     }
+     else if (crMode == CR_REPLAY)
+             { nVal[ent] = vPos[ent] = 0;
+               if (loadFile (crFile, &hd, ent, &nRec) == -1)
+                  return -1;
+               if (nRec != p_cr->nRec)                            /* the file was changed after the launcher read it */
+                  { errno = EINVAL;
+                    return -1;
+                  }
+             }
+  return 0;
+}
+
+/**
+ *  \brief Acting for an entity bound.
+ *
+ *  The calling thread acts for the given entity, which must have been bound by the process, from then on. It is used
+ *  by the coordinator, before carrying out an operation of an entity run by an entity host.
+ *
+ *  \param ent entity identification
+ */
+
+void crAdopt (unsigned int ent)
+{
+  crEnt = ent;
+}
+
+/**
+ *  \brief Handing the first turn in replay mode.
+ *
+ *  The function must be called by the process that creates the shared memory region, once the critical region is
+ *  enabled. It does nothing in the other modes.
+ *
+ *  \param p_cr pointer to the location where the critical region information is stored
+ *  \param semgid semaphore set access identifier
+ *  \param turn identification of the turn semaphores (one per entity)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int crStart (CRINFO *p_cr, int semgid, unsigned int *turn)
+{
+  if ((p_cr->mode != CR_REPLAY) || (p_cr->nRec == 0)) return 0;
+  return semUp (semgid, turn[p_cr->first]);
+}
+
+/**
+ *  \brief Timing of a spin iteration, once per process (internal operation).
+ */
+
+static void calibrate (void)
+{
+  uint64_t t0;                                                                            /* start of the timed loop */
+  unsigned int i;                                                                               /* counting variable */
+
+  if (spinNs != 0.0) return;
+  if (sysconf (_SC_NPROCESSORS_ONLN) < 2)                           /* the holder can not run while the caller spins */
+     spinNs = -1.0;
+     else { t0 = histClock ();
+            for (i = 0; i < CR_CALIBRATE; i++)
+              CPU_RELAX ();
+            spinNs = (double) (histClock () - t0) / CR_CALIBRATE;
+            if (spinNs < 1.0) spinNs = 1.0;
+          }
+}
+
+/**
+ *  \brief Number of spin iterations before parking (internal operation).
+ *
+ *  \param p_lk pointer to the location where the lock is stored
+ *
+ *  \return twice the mean time the lock is held, in spin iterations, up to <tt>CR_SPINMAX</tt>
+ */
+
+static unsigned int spinLimit (CRLOCK *p_lk)
+{
+  double n;                                                                             /* number of spin iterations */
+
+  calibrate ();
+  if (spinNs < 0.0) return 0;
+  n = 2.0 * (double) __atomic_load_n (&p_lk->holdNs, __ATOMIC_RELAXED) / spinNs;
+  return (n > CR_SPINMAX) ? CR_SPINMAX : (unsigned int) n;
+}
+
+/**
+ *  \brief Taking the adaptive lock (internal operation).
+ *
+ *  \param p_lk pointer to the location where the lock is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+static int spinTake (CRLOCK *p_lk)
+{
+  uint32_t c = 0;                                                                         /* lock word, as last seen */
+  unsigned int lim, i;                                                      /* number of spin iterations and counter */
+
+  if (__atomic_compare_exchange_n (&p_lk->word, &c, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+     { p_lk->nFree += 1;
+       return 0;
+     }
+  for (lim = spinLimit (p_lk), i = 0; i < lim; i++)
+  { CPU_RELAX ();
+    if ((c = __atomic_load_n (&p_lk->word, __ATOMIC_RELAXED)) == 0)
+       { if (__atomic_compare_exchange_n (&p_lk->word, &c, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            { p_lk->nSpin += 1;
+              return 0;
+            }
+       }
+  }
+  while (__atomic_exchange_n (&p_lk->word, 2, __ATOMIC_ACQUIRE) != 0)
+    if ((syscall (SYS_futex, &p_lk->word, FUTEX_WAIT, 2, NULL, NULL, 0) == -1) && (errno != EAGAIN) &&
+        (errno != EINTR))
+       return -1;
+  p_lk->nPark += 1;
+  return 0;
+}
+
+/**
+ *  \brief Releasing the adaptive lock (internal operation).
+ *
+ *  \param p_lk pointer to the location where the lock is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+static int spinGive (CRLOCK *p_lk)
+{
+  if ((__atomic_exchange_n (&p_lk->word, 0, __ATOMIC_RELEASE) == 2) &&
+      (syscall (SYS_futex, &p_lk->word, FUTEX_WAKE, 1, NULL, NULL, 0) == -1))
+     return -1;
+  return 0;
+}
+
+/**
+ *  \brief Taking the guard of the queues of the fair lock (internal operation).
+ *
+ *  \param p_lk pointer to the location where the lock is stored
+ */
+
+static void guardTake (CRLOCK *p_lk)
+{
+  unsigned int n = 0;                                                                   /* number of spin iterations */
+
+  calibrate ();
+  while (__atomic_exchange_n (&p_lk->guard, 1, __ATOMIC_ACQUIRE) != 0)
+    while (__atomic_load_n (&p_lk->guard, __ATOMIC_RELAXED) != 0)
+      if ((spinNs < 0.0) || (++n % CR_GUARDSPIN == 0))                         /* the holder may have been preempted */
+         sched_yield ();
+         else CPU_RELAX ();
+}
+
+/**
+ *  \brief Taking the fair lock (internal operation).
+ *
+ *  \param p_lk pointer to the location where the lock is stored
+ *  \param prio the entrepreneurs wait in the priority lane
+ *  \param who slot of the calling process
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+static int fairTake (CRLOCK *p_lk, bool prio, unsigned int who)
+{
+  unsigned int lane,                                                              /* 0 - ordinary, 1 - priority lane */
+               lim, i;                                                      /* number of spin iterations and counter */
+  uint32_t g = 0;                                                                        /* grant word, as last seen */
+
+  guardTake (p_lk);
+  if (!p_lk->held)
+     { p_lk->held = 1;
+       __atomic_store_n (&p_lk->guard, 0, __ATOMIC_RELEASE);
+       p_lk->nFree += 1;
+       return 0;
+     }
+  lane = (prio && ((who == 0) || ((who > N+M) && (who < N+M+NS)))) ? 1 : 0;
+  __atomic_store_n (&p_lk->grant[who], 0, __ATOMIC_RELAXED);
+  p_lk->queue[lane][(p_lk->qHead[lane] + p_lk->qLen[lane]) % CR_NWAIT] = (uint16_t) who;
+  p_lk->qLen[lane] += 1;
+  if (p_lk->qLen[0] + p_lk->qLen[1] > p_lk->qMax)
+     p_lk->qMax = p_lk->qLen[0] + p_lk->qLen[1];
+  __atomic_store_n (&p_lk->guard, 0, __ATOMIC_RELEASE);
+
+  for (lim = spinLimit (p_lk), i = 0; i < lim; i++)
+  { CPU_RELAX ();
+    if (__atomic_load_n (&p_lk->grant[who], __ATOMIC_ACQUIRE) == 1)
+       { p_lk->nSpin += 1;
+         return 0;
+       }
+  }
+  if (__atomic_compare_exchange_n (&p_lk->grant[who], &g, 2, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+     while (__atomic_load_n (&p_lk->grant[who], __ATOMIC_ACQUIRE) != 1)
+       if ((syscall (SYS_futex, &p_lk->grant[who], FUTEX_WAIT, 2, NULL, NULL, 0) == -1) && (errno != EAGAIN) &&
+           (errno != EINTR))
+          return -1;
+  p_lk->nPark += 1;
+  return 0;
+}
+
+/**
+ *  \brief Releasing the fair lock (internal operation).
+ *
+ *  The lock is handed over to the process at the head of the priority lane or, if it is empty, of the ordinary queue,
+ *  so it is never free while there is someone waiting for it.
+ *
+ *  \param p_lk pointer to the location where the lock is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+static int fairGive (CRLOCK *p_lk)
+{
+  unsigned int lane,                                                              /* 0 - ordinary, 1 - priority lane */
+               who;                                                                  /* slot of the next lock holder */
+
+  guardTake (p_lk);
+  lane = (p_lk->qLen[1] != 0) ? 1 : 0;
+  if (p_lk->qLen[lane] == 0)
+     { p_lk->held = 0;
+       __atomic_store_n (&p_lk->guard, 0, __ATOMIC_RELEASE);
+       return 0;
+     }
+  who = p_lk->queue[lane][p_lk->qHead[lane]];
+  p_lk->qHead[lane] = (p_lk->qHead[lane] + 1) % CR_NWAIT;
+  p_lk->qLen[lane] -= 1;
+  if ((lane == 1) && (p_lk->qLen[0] != 0))
+     p_lk->nPrio += 1;
+  __atomic_store_n (&p_lk->guard, 0, __ATOMIC_RELEASE);
+  if ((__atomic_exchange_n (&p_lk->grant[who], 1, __ATOMIC_RELEASE) == 2) &&
+      (syscall (SYS_futex, &p_lk->grant[who], FUTEX_WAKE, 1, NULL, NULL, 0) == -1))
+     return -1;
+  return 0;
+}
+
+/**
+ *  \brief Taking a lock on behalf of a given process (internal operation).
+ *
+ *  \param p_cr pointer to the location where the critical region information is stored
+ *  \param l lock identification
+ *  \param semgid semaphore set access identifier
+ *  \param access identification of the lock semaphore
+ *  \param who slot of the calling process (fair lock)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+static int lockTake (CRINFO *p_cr, unsigned int l, int semgid, unsigned int access, unsigned int who)
+{
+  CRLOCK *p_lk = &(p_cr->lk[l]);                                                                     /* lock at hand */
+
+  if (p_cr->lock == CR_LOCK_SEM)
+     return semDown (semgid, access);
+  if (((p_cr->lock == CR_LOCK_SPIN) ? spinTake (p_lk) : fairTake (p_lk, p_cr->lock == CR_LOCK_PRIO, who)) == -1)
+     return -1;
+  p_lk->enterNs = histClock ();
+  return 0;
+}
+
+/**
+ *  \brief Releasing a lock (internal operation).
+ *
+ *  \param p_cr pointer to the location where the critical region information is stored
+ *  \param l lock identification
+ *  \param semgid semaphore set access identifier
+ *  \param access identification of the lock semaphore
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+static int lockGive (CRINFO *p_cr, unsigned int l, int semgid, unsigned int access)
+{
+  CRLOCK *p_lk = &(p_cr->lk[l]);                                                                     /* lock at hand */
+  uint64_t t;                                                                              /* time the lock was held */
+
+  if (p_cr->lock == CR_LOCK_SEM)
+     return semUp (semgid, access);
+
+  if (p_lk->enterNs != 0)                                                   /* not upon enabling the critical region */
+     { t = histClock () - p_lk->enterNs;
+       __atomic_store_n (&p_lk->holdNs, p_lk->holdNs - p_lk->holdNs / 8 + t / 8, __ATOMIC_RELAXED);
+     }
+  return (p_cr->lock == CR_LOCK_SPIN) ? spinGive (p_lk) : fairGive (p_lk);
+}
+
+/**
+ *  \brief Taking all the locks.
+ *
+ *  It is meant for processes which are not bound to the critical region information: the intervening entities enter
+ *  the critical region through <tt>crEnter</tt>. Upon failure, none of the locks is held.
+ *
+ *  \param p_cr pointer to the location where the critical region information is stored
+ *  \param semgid semaphore set access identifier
+ *  \param access identification of the lock semaphores (<tt>CR_NLOCK</tt> elements)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int crLock (CRINFO *p_cr, int semgid, unsigned int *access)
+{
+  unsigned int l;                                                                               /* counting variable */
+  int err;                                                                                    /* error taking a lock */
+
+  for (l = 0; l < p_cr->nLock; l++)
+    if (lockTake (p_cr, l, semgid, access[l], CR_NWAIT - 1) == -1)
+       { err = errno;
+         while (l > 0)                                                        /* the ones already taken are released */
+         { l -= 1;
+           lockGive (p_cr, l, semgid, access[l]);
+         }
+         errno = err;
+         return -1;
+       }
+  return 0;
+}
+
+/**
+ *  \brief Releasing all the locks.
+ *
+ *  \param p_cr pointer to the location where the critical region information is stored
+ *  \param semgid semaphore set access identifier
+ *  \param access identification of the lock semaphores (<tt>CR_NLOCK</tt> elements)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int crUnlock (CRINFO *p_cr, int semgid, unsigned int *access)
+{
+  unsigned int l;                                                                               /* counting variable */
+
+  for (l = p_cr->nLock; l > 0; l--)
+    if (lockGive (p_cr, l - 1, semgid, access[l-1]) == -1)
+       return -1;
+  return 0;
+}
+
+/**
+ *  \brief Entering the critical region.
+ *
+ *  The locks of the given set are taken in order. The function may be called again within the critical region to
+ *  take further locks, as long as they all come after the ones already held, and fails with <tt>EDEADLK</tt>
+ *  otherwise; with a single lock, it then does nothing. In replay mode, the function fails with <tt>EPROTO</tt> if
+ *  the entity is not the one which entered next in the run recorded, which means the runs have diverged.
+ *
+ *  \param set set of locks to be taken (<tt>CR_SHOP(s)</tt>, <tt>CR_WORKSHOP</tt>, or several of them or'ed, or
+ *         <tt>CR_SELF</tt>)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int crEnter (unsigned int set)
+{
+  unsigned int l;                                                                               /* counting variable */
+
+  if (p_crInfo->nLock == 1)
+     { if (crIn[crEnt]) return 0;                                                 /* the single lock is already held */
+       set = 1;
+     }
+     else { set &= ~crSet[crEnt];
+            if ((set != 0) && (crSet[crEnt] >= (set & -set)))                     /* not after the ones already held */
+               { errno = EDEADLK;
+                 return -1;
+               }
+          }
+  if (!crIn[crEnt] && (crMode == CR_REPLAY))
+     if (semDown (crSemgid, crTurn[crEnt]) == -1)                                      /* wait for the entity's turn */
+        return -1;
+  for (l = 0; l < p_crInfo->nLock; l++)
+    if ((set & (1u << l)) != 0)
+       { if (lockTake (p_crInfo, l, crSemgid, crAccess[l], crEnt) == -1)
+            return -1;
+         crSet[crEnt] |= 1u << l;
+       }
+  if (!crIn[crEnt] && (p_crInfo->nLock == 1))                           /* the entries are numbered in a total order */
+     { if (crMode == CR_RECORD)
+          putRecord (CR_ENTER, p_crInfo->nEntry);
+          else if ((crMode == CR_REPLAY) &&
+                   ((p_crInfo->nEntry >= p_crInfo->nRec) || (seq[p_crInfo->nEntry] != crEnt)))
+                  { lockGive (p_crInfo, 0, crSemgid, crAccess[0]);
+                    crSet[crEnt] = 0;
+                    errno = EPROTO;
+                    return -1;
+                  }
+       p_crInfo->nEntry += 1;
+     }
+  crIn[crEnt] = true;
+  return 0;
+}
+
+/**
+ *  \brief Exiting the critical region.
+ *
+ *  All the locks held are released, in reverse order. In replay mode, the turn is handed to the entity which entered
+ *  next in the run recorded.
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int crExit (void)
+{
+  uint32_t next = 0;                                                                         /* number of next entry */
+  unsigned int l, i;                                                                           /* counting variables */
+
+  if (crMode == CR_REPLAY)
+     next = p_crInfo->nEntry;
+  for (l = p_crInfo->nLock; l > 0; l--)
+    if ((crSet[crEnt] & (1u << (l - 1))) != 0)
+       { if (lockGive (p_crInfo, l - 1, crSemgid, crAccess[l-1]) == -1)
+            return -1;
+         crSet[crEnt] &= ~(1u << (l - 1));
+       }
+  crIn[crEnt] = false;
+  if (crMode != CR_REPLAY)
+     return 0;
+  if (next < p_crInfo->nRec)
+     return semUp (crSemgid, crTurn[seq[next]]);
+  for (i = 0; i < N+M+NS; i++)                        /* the run recorded is over: whoever is still trying must fail */
+    if (semUp (crSemgid, crTurn[i]) == -1)
+       return -1;
+  return 0;
+}
+
+/**
+ *  \brief Locks held by the entity the calling thread acts for.
+ *
+ *  \return the set of locks held, or <tt>CR_ALL</tt>, if a single lock is used or the process is not bound to the
+ *          critical region information (it then owns the whole state)
+ */
+
+unsigned int crHeld (void)
+{
+  if ((p_crInfo == NULL) || (p_crInfo->nLock == 1)) return CR_ALL;
+  return crSet[crEnt];
+}
+
+/**
+ *  \brief Entity bound.
+ *
+ *  \return the identification of the entity the calling thread acts for, or <tt>N+M+NS</tt>, if the calling process
+ *          is not bound to the critical region information
+ */
+
+unsigned int crEntity (void)
+{
+  return crEnt;
+}
+
+/**
+ *  \brief Taking the lock of the log.
+ *
+ *  It does nothing if a single lock is used, as it is then already held, or if the calling process is not bound to
+ *  the critical region information.
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int crLogLock (void)
+{
+  if ((p_crInfo == NULL) || (p_crInfo->nLock == 1)) return 0;
+  return lockTake (p_crInfo, CR_LOGLOCK, crSemgid, crAccess[CR_LOGLOCK], crEnt);
+}
+
+/**
+ *  \brief Releasing the lock of the log.
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int crLogUnlock (void)
+{
+  if ((p_crInfo == NULL) || (p_crInfo->nLock == 1)) return 0;
+  return lockGive (p_crInfo, CR_LOGLOCK, crSemgid, crAccess[CR_LOGLOCK]);
+}
+
+/**
+ *  \brief Blocking on a semaphore shared by several entities.
+ *
+ *  Which of the entities blocked on the semaphore an up operation wakes up is up to the kernel, so the run could
+ *  diverge from the one recorded. In replay mode, the down operation is skipped: the entity just waits for its next
+ *  turn to enter the critical region, which is only handed to it after it was waken up in the run recorded.
+ *
+ *  \param semgid semaphore set access identifier
+ *  \param sem identification of the semaphore
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int crWait (int semgid, unsigned int sem)
+{
+  if (crMode == CR_REPLAY) return 0;
+  return semDown (semgid, sem);
+}
+
+/**
+ *  \brief Outcome of a random choice.
+ *
+ *  \param v value drawn by the entity
+ *
+ *  \return the value recorded, in replay mode, while there is one
+ *  \return <tt>v</tt>, otherwise
+ */
+
+unsigned int crValue (unsigned int v)
+{
+  if (crMode == CR_RECORD)
+     putRecord (CR_VALUE, v);
+     else if ((crMode == CR_REPLAY) && (vPos[crEnt] < nVal[crEnt]))
+             return val[crEnt][vPos[crEnt]++];
+  return v;
+}
+
+/**
+ *  \brief Random delay.
+ *
+ *  The calling process is suspended for the given time, except in replay mode, where the delay is skipped.
+ *
+ *  \param us delay drawn by the entity (in us)
+ */
+
+void crDelay (unsigned int us)
+{
+  if (crMode == CR_REPLAY) return;
+  if (crMode == CR_RECORD)
+     putRecord (CR_DELAY, us);
+  usleep (us);
+}
+
+/**
+ *  \brief Writing of the records still buffered by the calling process.
+ *
+ *  It is called automatically upon process termination. A failure is reported, but does not stop the simulation:
+ *  the records are lost.
+ */
+
+void crFlush (void)
+{
+  size_t len = nBuf * sizeof (CRREC);                                                    /* number of bytes to write */
+
+  if ((nBuf == 0) || (bufPid != getpid ()) || (crMode != CR_RECORD)) return;
+  nBuf = 0;
+  if ((crFd == -1) && ((crFd = open (crFile, O_WRONLY | O_APPEND)) == -1))
+     { perror ("error on opening the replay file");
+       return;
+     }
+  if (write (crFd, crBuf, len) != (ssize_t) len)            /* a single append, so it is not interleaved with others */
+     perror ("error on writing to replay file");
+}
@@ -0,0 +1,440 @@
+/**
+ *  \file criticalRegion.h (interface file)
+ *
+ *  Problem name: Aveiro Handicraft SARL
+ *
+ *  Concept: Pedro Mariano
+ *
+ *  \brief Access to the critical region, with record and replay of the interleaving.
+ *
+ *  The intervening entities enter and exit the critical region through this module, which works in one of three
+ *  modes:
+ *     \li <em>free</em> - the critical region is just protected by a lock
+ *     \li <em>record</em> - besides, the order in which the entities enter the critical region and the outcomes of
+ *         the random choices they make are recorded in a replay file
+ *     \li <em>replay</em> - the entities enter the critical region in the order recorded, one at a time, with the
+ *         random choices recorded, and the random delays are skipped, so the run is an exact copy of the one
+ *         recorded, carried out at full speed.
+ *
+ *  In replay mode, an entity only tries to enter the critical region when given its turn, which is passed on by the
+ *  entity leaving the critical region to the next one in the recorded order, through a semaphore per entity.
+ *
+ *  The entries are numbered in the order they take place. Each process gathers its records in a private buffer and
+ *  appends it to the replay file whenever it fills up and upon termination. A replay file starts with a header,
+ *  which holds the magic string <tt>CR_MAGIC</tt>, the problem constants and the amounts of prime materials
+ *  supplied, and is followed by a sequence of records.
+ *
+ *  The critical region is protected by one of three kinds of lock:
+ *     \li <em>semaphore</em> - the semaphore <tt>access</tt>, so every entry goes into the kernel
+ *     \li <em>adaptive</em> - a lock word kept in the critical region information: a process finding it held spins
+ *         on it for a while, as the holder is likely to release it shortly, and only then parks on a futex; the
+ *         number of spin iterations is bounded by twice the mean time the critical region has been held lately, so
+ *         it tunes itself to the load (no spinning takes place on a single processor)
+ *     \li <em>fair</em> - the processes finding the lock held join a queue kept in the critical region information
+ *         and the lock is handed over directly to the one at its head upon release, so it is taken in the order it
+ *         was requested and no process can take it ahead of those waiting; they spin for a while, as with the
+ *         adaptive lock, before parking on a futex of their own, so only the next holder is waken up. Optionally,
+ *         the entrepreneurs wait in a priority lane, which is served ahead of the queue.
+ *
+ *  Unless a single lock is requested, the critical region is split into several locks, each one protecting a part
+ *  of the state: one per shop, one for the workshop and one for the log. An operation only takes the locks of the
+ *  parts it changes, or whose state it must see consistently, so the entities of different shops proceed in parallel.
+ *  The locks are always taken in a fixed order, the shops by increasing identification, then the workshop and, last,
+ *  the log, which is held just while a line is written, and all of them are released upon exit. The state of an
+ *  entity is only changed by the entity itself. The figures read by the routing of the customers and by the choice of
+ *  the shop phoned by a craftsman are only hints and are read without the lock of the shops. In record and replay
+ *  modes, and with precompiled entities, a single lock is used, so the interleaving is a total order. The launcher
+ *  also requests a single lock by default when there is a single shop, as splitting then brings no parallelism and
+ *  every line logged is a snapshot of the whole state.
+ *
+ *  The locks are taken upon initialization and are released by the process that creates the shared memory region
+ *  once everything is set up.
+ *
+ *  A process may bind several entities and have each thread act for one of them at a time: the set of locks held
+ *  belongs to the entity, not to the thread, so an operation left within the critical region may be completed by
+ *  another thread acting for the same entity.
+ *
+ *  Defined operations:
+ *     \li initialization of the critical region information and of the replay file
+ *     \li binding of an intervening entity to the critical region information
+ *     \li acting for an entity bound
+ *     \li handing the first turn in replay mode
+ *     \li taking all the locks
+ *     \li releasing all the locks
+ *     \li entering the critical region
+ *     \li exiting the critical region
+ *     \li locks held by the entity acted for
+ *     \li entity bound
+ *     \li taking the lock of the log
+ *     \li releasing the lock of the log
+ *     \li blocking on a semaphore shared by several entities
+ *     \li outcome of a random choice
+ *     \li random delay
+ *     \li writing of the records still buffered.
+ */
+
+#ifndef CRITICALREGION_H_
+#define CRITICALREGION_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "probConst.h"
+
+/** \brief free mode */
+#define  CR_FREE         0
+/** \brief record mode */
+#define  CR_RECORD       1
+/** \brief replay mode */
+#define  CR_REPLAY       2
+
+/** \brief lock: semaphore access */
+#define  CR_LOCK_SEM     0
+/** \brief lock: adaptive, spin then park */
+#define  CR_LOCK_SPIN    1
+
+/** \brief lock: fair, handed over in the order it was requested */
+#define  CR_LOCK_FAIR    2
+/** \brief lock: fair, with a priority lane for the entrepreneurs */
+#define  CR_LOCK_PRIO    3
+
+/** \brief number of processes which may wait for the fair lock: the intervening entities and the launcher */
+#define  CR_NWAIT        (N+M+NS+1)
+
+/** \brief maximum number of spin iterations before parking (adaptive and fair locks) */
+#define  CR_SPINMAX      4096
+
+/** \brief number of locks the critical region is split into: one per shop, the workshop and the log */
+#define  CR_NLOCK        (NS+2)
+
+/** \brief lock of the workshop */
+#define  CR_WSLOCK       NS
+/** \brief lock of the log */
+#define  CR_LOGLOCK      (NS+1)
+
+/** \brief set of locks: the one of shop s */
+#define  CR_SHOP(s)      (1u << (s))
+/** \brief set of locks: the one of the workshop */
+#define  CR_WORKSHOP     (1u << CR_WSLOCK)
+/** \brief set of locks: the ones of all the shops and of the workshop */
+#define  CR_ALL          ((1u << CR_LOGLOCK) - 1)
+/** \brief set of locks: none, only the state of the calling entity is changed */
+#define  CR_SELF         0
+
+/** \brief record of an entry into the critical region */
+#define  CR_ENTER        0
+/** \brief record of the outcome of a random choice */
+#define  CR_VALUE        1
+/** \brief record of a random delay */
+#define  CR_DELAY        2
+
+/** \brief maximum length of the name of the replay file (including the terminating null character) */
+#define  CR_NAMESZ       64
+
+/** \brief magic string at the beginning of a replay file */
+#define  CR_MAGIC        "AHREPLY1"
+
+/** \brief size of the magic string at the beginning of a replay file (in bytes) */
+#define  CR_MAGICSZ      8
+
+/** \brief number of settings of the run recorded in a replay file */
+#define  CR_NCONF        8
+
+/**
+ *  \brief Definition of <em>replay file header</em> data type.
+ */
+
+typedef struct
+        { /** \brief magic string */
+          char magic[CR_MAGICSZ];
+          /** \brief problem constants the run was recorded with: N, M, NP and PP */
+          uint32_t dim[4];
+          /** \brief settings which change the behaviour of the intervening entities (unused ones are zero) */
+          uint32_t conf[CR_NCONF];
+          /** \brief amount of prime materials supplied each time */
+          uint32_t primeMaterials[NP];
+        } CRHEADER;
+
+/**
+ *  \brief Definition of <em>replay record</em> data type.
+ */
+
+typedef struct
+        { /** \brief kind of record: either CR_ENTER, CR_VALUE, or CR_DELAY */
+          uint16_t kind;
+          /** \brief entity identification (0 - entrepreneur, 1 to N - customers, N+1 to N+M - craftsmen, N+M+1 to
+           *         N+M+NS-1 - entrepreneurs of the other shops) */
+          uint16_t ent;
+          /** \brief number of the entry into the critical region, outcome of the choice, or delay (in us) */
+          uint32_t val;
+        } CRREC;
+
+/**
+ *  \brief Definition of <em>lock</em> data type.
+ *
+ *  The statistics must only be accessed by the lock holder.
+ */
+
+typedef struct
+        { /** \brief lock word (adaptive lock): 0 - free, 1 - held, 2 - held, with processes parked */
+          uint32_t word __attribute__ ((aligned (64)));
+          /** \brief guard of the queues and flag of the lock being held (fair lock) */
+          uint32_t guard __attribute__ ((aligned (64)));
+          uint32_t held;
+          /** \brief queues of the processes waiting for the lock, the ordinary one and the priority lane: slots,
+           *         positions of the heads and lengths (fair lock) */
+          uint16_t queue[2][CR_NWAIT];
+          uint32_t qHead[2], qLen[2];
+          /** \brief words the waiting processes park on, one per slot: 0 - waiting, 1 - lock handed over, 2 -
+           *         parked (fair lock) */
+          uint32_t grant[CR_NWAIT];
+          /** \brief instant the lock was last taken and moving average of the time it is held (in ns; adaptive and
+           *         fair locks) */
+          uint64_t enterNs, holdNs;
+          /** \brief number of times the lock was taken free, while spinning and after parking (adaptive and fair
+           *         locks) */
+          uint64_t nFree, nSpin, nPark;
+          /** \brief number of times the lock was handed to an entrepreneur ahead of the queue and maximum number of
+           *         processes waiting for it (fair lock) */
+          uint64_t nPrio;
+          uint32_t qMax;
+        } CRLOCK;
+
+/**
+ *  \brief Definition of <em>critical region information</em> data type.
+ *
+ *  It is kept in shared memory. The number of entries must only be accessed within the critical region.
+ */
+
+typedef struct
+        { /** \brief mode: CR_FREE, CR_RECORD or CR_REPLAY */
+          unsigned int mode;
+          /** \brief name of the replay file */
+          char file[CR_NAMESZ];
+          /** \brief number of entries into the critical region so far (single lock) */
+          uint32_t nEntry;
+          /** \brief number of entries recorded (replay mode) */
+          uint32_t nRec;
+          /** \brief entity which entered the critical region first (replay mode) */
+          uint32_t first;
+          /** \brief kind of lock: CR_LOCK_SEM, CR_LOCK_SPIN, CR_LOCK_FAIR or CR_LOCK_PRIO */
+          unsigned int lock;
+          /** \brief number of locks in use: either 1, a single lock, or CR_NLOCK */
+          unsigned int nLock;
+          /** \brief locks: the shops, the workshop and the log */
+          CRLOCK lk[CR_NLOCK];
+        } CRINFO;
+
+/**
+ *  \brief Initialization of the critical region information and of the replay file.
+ *
+ *  The function must be called by the process that creates the shared memory region. In record mode, the replay
+ *  file is created and the settings of the run and the amounts of prime materials are written to it; in replay mode,
+ *  the settings are checked against the ones recorded, as the runs would diverge otherwise, and the amounts recorded
+ *  are read from it into <tt>primeMat</tt>.
+ *
+ *  \param p_cr pointer to the location where the critical region information is stored
+ *  \param mode mode of operation
+ *  \param lock kind of lock
+ *  \param single a single lock is to be used, instead of one per part of the state (it always is, in record and
+ *         replay modes)
+ *  \param fName name of the replay file (ignored in free mode)
+ *  \param conf settings which change the behaviour of the intervening entities (<tt>CR_NCONF</tt> elements)
+ *  \param primeMat amounts of prime materials supplied each time
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>; <tt>EINVAL</tt>, if
+ *          the file is not a replay file or was recorded with different problem constants or settings)
+ */
+
+extern int crInit (CRINFO *p_cr, unsigned int mode, unsigned int lock, bool single, char *fName,
+                   unsigned int *conf, unsigned int *primeMat);
+
+/**
+ *  \brief Binding of an intervening entity to the critical region information.
+ *
+ *  The function must be called by every intervening entity upon mapping the shared memory region on its address space.
+ *  In replay mode, the records are loaded from the replay file.
+ *
+ *  \param p_cr pointer to the location where the critical region information is stored
+ *  \param semgid semaphore set access identifier
+ *  \param access identification of the lock semaphores (<tt>CR_NLOCK</tt> elements)
+ *  \param turn identification of the turn semaphores (one per entity)
+ *  \param ent entity identification
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int crBind (CRINFO *p_cr, int semgid, unsigned int *access, unsigned int *turn, unsigned int ent);
+
+/**
+ *  \brief Acting for an entity bound.
+ *
+ *  The calling thread acts for the given entity from then on. Binding an entity makes the calling thread act for it.
+ *
+ *  \param ent entity identification (it must have been bound by the process)
+ */
+
+extern void crAdopt (unsigned int ent);
+
+/**
+ *  \brief Handing the first turn in replay mode.
+ *
+ *  The function must be called by the process that creates the shared memory region, once the critical region is
+ *  enabled. It does nothing in the other modes.
+ *
+ *  \param p_cr pointer to the location where the critical region information is stored
+ *  \param semgid semaphore set access identifier
+ *  \param turn identification of the turn semaphores (one per entity)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int crStart (CRINFO *p_cr, int semgid, unsigned int *turn);
+
+/**
+ *  \brief Taking all the locks.
+ *
+ *  It is meant for processes which are not bound to the critical region information: the intervening entities enter
+ *  the critical region through <tt>crEnter</tt>. Upon failure, none of the locks is held.
+ *
+ *  \param p_cr pointer to the location where the critical region information is stored
+ *  \param semgid semaphore set access identifier
+ *  \param access identification of the lock semaphores (<tt>CR_NLOCK</tt> elements)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int crLock (CRINFO *p_cr, int semgid, unsigned int *access);
+
+/**
+ *  \brief Releasing all the locks.
+ *
+ *  \param p_cr pointer to the location where the critical region information is stored
+ *  \param semgid semaphore set access identifier
+ *  \param access identification of the lock semaphores (<tt>CR_NLOCK</tt> elements)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int crUnlock (CRINFO *p_cr, int semgid, unsigned int *access);
+
+/**
+ *  \brief Entering the critical region.
+ *
+ *  The locks of the given set are taken in order. The function may be called again within the critical region to
+ *  take further locks, as long as they all come after the ones already held, and fails with <tt>EDEADLK</tt>
+ *  otherwise; with a single lock, it then does nothing. In replay mode, the function fails with <tt>EPROTO</tt> if
+ *  the entity is not the one which entered next in the run recorded, which means the runs have diverged.
+ *
+ *  \param set set of locks to be taken (<tt>CR_SHOP(s)</tt>, <tt>CR_WORKSHOP</tt>, or several of them or'ed, or
+ *         <tt>CR_SELF</tt>)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int crEnter (unsigned int set);
+
+/**
+ *  \brief Exiting the critical region.
+ *
+ *  All the locks held are released, in reverse order. In replay mode, the turn is handed to the entity which entered
+ *  next in the run recorded.
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int crExit (void);
+
+/**
+ *  \brief Locks held by the entity the calling thread acts for.
+ *
+ *  \return the set of locks held, or <tt>CR_ALL</tt>, if a single lock is used or the process is not bound to the
+ *          critical region information (it then owns the whole state)
+ */
+
+extern unsigned int crHeld (void);
+
+/**
+ *  \brief Entity bound.
+ *
+ *  \return the identification of the entity the calling thread acts for, or <tt>N+M+NS</tt>, if the calling process
+ *          is not bound to the critical region information
+ */
+
+extern unsigned int crEntity (void);
+
+/**
+ *  \brief Taking the lock of the log.
+ *
+ *  It does nothing if a single lock is used, as it is then already held, or if the calling process is not bound to
+ *  the critical region information.
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int crLogLock (void);
+
+/**
+ *  \brief Releasing the lock of the log.
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int crLogUnlock (void);
+
+/**
+ *  \brief Blocking on a semaphore shared by several entities.
+ *
+ *  Which of the entities blocked on the semaphore an up operation wakes up is up to the kernel, so the run could
+ *  diverge from the one recorded. In replay mode, the down operation is skipped: the entity just waits for its next
+ *  turn to enter the critical region, which is only handed to it after it was waken up in the run recorded.
+ *
+ *  \param semgid semaphore set access identifier
+ *  \param sem identification of the semaphore
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int crWait (int semgid, unsigned int sem);
+
+/**
+ *  \brief Outcome of a random choice.
+ *
+ *  \param v value drawn by the entity
+ *
+ *  \return the value recorded, in replay mode, while there is one
+ *  \return <tt>v</tt>, otherwise
+ */
+
+extern unsigned int crValue (unsigned int v);
+
+/**
+ *  \brief Random delay.
+ *
+ *  The calling process is suspended for the given time, except in replay mode, where the delay is skipped.
+ *
+ *  \param us delay drawn by the entity (in us)
+ */
+
+extern void crDelay (unsigned int us);
+
+/**
+ *  \brief Writing of the records still buffered by the calling process.
+ *
+ *  It is called automatically upon process termination. A failure is reported, but does not stop the simulation:
+ *  the records are lost.
+ */
+
+extern void crFlush (void);
+
+#endif /* CRITICALREGION_H_ */
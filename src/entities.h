@@ -0,0 +1,116 @@
+/**
+ *  \file entities.h (interface file)
+ *
+ *  \brief Problem name: Aveiro Handicraft SARL.
+ *
+ *  \brief Concept: Pedro Mariano.
+ *
+ *  Synchronization based on semaphores and shared memory.
+ *  Implementation with SVIPC.
+ *
+ *  Life cycles of the intervening entities.
+ *
+ *  They are run by the main program of each entity or, in zygote mode, by the children of the launcher, which
+ *  inherit the mapping of the shared region and are linked together with the three entities in a single executable.
+ *
+ *  In distributed mode, the life cycles of the customers and the craftsmen are run by the entity hosts, whose
+ *  operations are carried out by the coordinator itself, which binds every one of those entities to the shared region.
+ */
+
+#ifndef ENTITIES_H_
+#define ENTITIES_H_
+
+#include "sharedDataSync.h"
+#include "remote.h"
+
+/**
+ *  \brief Life cycle of the entrepreneur.
+ *
+ *  \param s shop identification
+ *  \param fic logging file name
+ *  \param sgid semaphore set access identifier
+ *  \param shr pointer to shared memory region
+ */
+
+extern void entrepreneurRun (unsigned int s, char *fic, int sgid, SHARED_DATA *shr);
+
+/**
+ *  \brief Life cycle of a customer.
+ *
+ *  \param n customer identification
+ *  \param fic logging file name
+ *  \param sgid semaphore set access identifier
+ *  \param shr pointer to shared memory region
+ */
+
+extern void customerRun (unsigned int n, char *fic, int sgid, SHARED_DATA *shr);
+
+/**
+ *  \brief Life cycle of a craftsman.
+ *
+ *  \param m craftsman identification
+ *  \param fic logging file name
+ *  \param sgid semaphore set access identifier
+ *  \param shr pointer to shared memory region
+ */
+
+extern void craftsmanRun (unsigned int m, char *fic, int sgid, SHARED_DATA *shr);
+
+/**
+ *  \brief Binding of a customer run by an entity host, at the coordinator.
+ *
+ *  \param n customer identification
+ *  \param fic logging file name
+ *  \param sgid semaphore set access identifier
+ *  \param shr pointer to shared memory region
+ */
+
+extern void customerAttach (unsigned int n, char *fic, int sgid, SHARED_DATA *shr);
+
+/**
+ *  \brief Binding of a craftsman run by an entity host, at the coordinator.
+ *
+ *  \param m craftsman identification
+ *  \param fic logging file name
+ *  \param sgid semaphore set access identifier
+ *  \param shr pointer to shared memory region
+ */
+
+extern void craftsmanAttach (unsigned int m, char *fic, int sgid, SHARED_DATA *shr);
+
+/**
+ *  \brief Carrying out of an operation of a customer run by an entity host, at the coordinator.
+ *
+ *  \param n customer identification
+ *  \param p_rq pointer to the location where the request is stored, and where the reply is to be stored
+ */
+
+extern void customerServe (unsigned int n, REMREC *p_rq);
+
+/**
+ *  \brief Carrying out of an operation of a craftsman run by an entity host, at the coordinator.
+ *
+ *  \param m craftsman identification
+ *  \param p_rq pointer to the location where the request is stored, and where the reply is to be stored
+ */
+
+extern void craftsmanServe (unsigned int m, REMREC *p_rq);
+
+/**
+ *  \brief Life cycle of a customer run by an entity host.
+ *
+ *  \param n customer identification
+ */
+
+extern void customerRemote (unsigned int n);
+
+/**
+ *  \brief Life cycle of a craftsman run by an entity host.
+ *
+ *  \param m craftsman identification
+ *  \param batchSize number of pieces produced per visit to the store
+ */
+
+extern void craftsmanRemote (unsigned int m, unsigned int batchSize);
+
+#endif /* ENTITIES_H_ */
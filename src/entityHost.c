@@ -0,0 +1,145 @@
+/**
+ *  \file entityHost.c (implementation file)
+ *
+ *  \brief Problem name: Aveiro Handicraft SARL.
+ *
+ *  \brief Concept: Pedro Mariano.
+ *
+ *  Entity host of a simulation spread over several hosts.
+ *
+ *  It runs the life cycles of a range of customers and craftsmen, one thread per entity, whose operations are
+ *  carried out by the coordinator, the launcher run in distributed mode, from a pool of threads. The coordinator may
+ *  spawn the entity hosts itself on its own machine or wait for them to be started by hand, on any machine.
+ *
+ *  Usage: <tt>entityhost address first count</tt>, where
+ *    \li <tt>address</tt> is the address the coordinator listens at: the path name of a Unix-domain socket or
+ *        <tt>host:port</tt>
+ *    \li <tt>first</tt> is the first entity run by the host (1 to N - customers, N+1 to N+M - craftsmen)
+ *    \li <tt>count</tt> is the number of entities run by the host.
+ *
+ *  The connection is retried for a while, so the entity host may be started before the coordinator.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "probConst.h"
+#include "remote.h"
+#include "entities.h"
+
+/** \brief number of attempts to connect to the coordinator */
+#define  NTRIES          100
+
+/** \brief interval between attempts to connect to the coordinator (in us) */
+#define  RETRY_US        100000
+
+/** \brief number of pieces a craftsman produces per visit to the store, as set at the coordinator */
+static unsigned int batchSize;
+
+/**
+ *  \brief Life cycle of an entity (run by a thread of its own).
+ *
+ *  \param arg entity identification
+ *
+ *  \return \c NULL
+ */
+
+static void *entityLife (void *arg)
+{
+  unsigned int i = (unsigned int) (uintptr_t) arg;                                          /* entity identification */
+
+  if (i <= N)
+     customerRemote (i-1);
+     else craftsmanRemote (i-N-1, batchSize);
+  return NULL;
+}
+
+/**
+ *  \brief Main program.
+ *
+ *  Its role is connecting to the coordinator, claiming the range of entities and running their life cycles.
+ */
+
+int main (int argc, char *argv[])
+{
+  unsigned int first, count;                                                                /* range of entities run */
+  char *tinp;                                                                      /* numerical parameters test flag */
+  int fd = -1;                                                                /* socket descriptor of the connection */
+  unsigned int n, i;                                                                /* number and counting variables */
+  REMREC rec[REM_MAXREC];                                                                      /* records of a frame */
+  pthread_t thr[N+M];                                                                              /* entity threads */
+  int status;                                                                                    /* execution status */
+
+  /* validation of command line parameters */
+
+  if (argc != 4)
+     { fprintf (stderr, "Usage: %s address first count\n", argv[0]);
+       exit (EXIT_FAILURE);
+     }
+  first = (unsigned int) strtol (argv[2], &tinp, 0);
+  if ((*tinp != '\0') || (first == 0) || (first > N+M))
+     { fprintf (stderr, "First entity is invalid: %s\n", argv[2]);
+       exit (EXIT_FAILURE);
+     }
+  count = (unsigned int) strtol (argv[3], &tinp, 0);
+  if ((*tinp != '\0') || (count == 0) || (first + count - 1 > N+M))
+     { fprintf (stderr, "Number of entities is invalid: %s\n", argv[3]);
+       exit (EXIT_FAILURE);
+     }
+
+  /* connecting to the coordinator and claiming the range of entities */
+
+  for (i = 0; i < NTRIES; i++)
+  { if ((fd = remConnect (argv[1])) != -1) break;
+    if ((errno != ECONNREFUSED) && (errno != ENOENT)) break;             /* the coordinator may not be listening yet */
+    usleep (RETRY_US);
+  }
+  if (fd == -1)
+     { perror ("error on connecting to the coordinator");
+       exit (EXIT_FAILURE);
+     }
+  rec[0].ent = (uint16_t) first;
+  rec[0].op = REM_HELLO;
+  rec[0].val = count;
+  if (remSend (fd, rec, 1) == -1)
+     { perror ("error on greeting the coordinator");
+       exit (EXIT_FAILURE);
+     }
+  if (remRecv (fd, rec, &n) == -1)
+     { perror ("error on receiving the settings of the run");
+       exit (EXIT_FAILURE);
+     }
+  if ((n != 1) || (rec[0].op != REM_HELLO))
+     { fprintf (stderr, "The coordinator refused entities %u to %u!\n", first, first + count - 1);
+       exit (EXIT_FAILURE);
+     }
+  batchSize = rec[0].val;
+
+  /* running the life cycles of the entities */
+
+  if (remStart (fd) == -1)
+     { perror ("error on starting the remote calls");
+       exit (EXIT_FAILURE);
+     }
+  for (i = 0; i < count; i++)
+    if ((status = pthread_create (&thr[i], NULL, entityLife, (void *) (uintptr_t) (first + i))) != 0)
+       { errno = status;
+         perror ("error on creating an entity thread");
+         exit (EXIT_FAILURE);
+       }
+  for (i = 0; i < count; i++)
+    if ((status = pthread_join (thr[i], NULL)) != 0)
+       { errno = status;
+         perror ("error on waiting for an entity thread");
+         exit (EXIT_FAILURE);
+       }
+  close (fd);
+
+  exit (EXIT_SUCCESS);
+}
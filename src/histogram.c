@@ -0,0 +1,145 @@
+/**
+ *  \file histogram.c (implementation file)
+ *
+ *  Problem name: Aveiro Handicraft SARL
+ *
+ *  Concept: Pedro Mariano
+ *
+ *  \brief Log-bucketed latency histograms.
+ *
+ *  Defined operations:
+ *     \li reading of the clock used to take timestamps
+ *     \li initialization of a histogram
+ *     \li recording of a value
+ *     \li merging of a histogram into another
+ *     \li percentile of the values recorded.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "histogram.h"
+
+/**
+ *  \brief Bucket of a value (internal operation).
+ *
+ *  Values below <tt>HIST_SUB</tt> have a bucket each; the remaining ones are selected by the position of their most
+ *  significant bit and by the <tt>HIST_SUBBITS</tt> bits next to it.
+ *
+ *  \param val value
+ *
+ *  \return bucket index
+ */
+
+static unsigned int bucketOf (uint64_t val)
+{
+  unsigned int e;                                                            /* position of the most significant bit */
+
+  if (val < HIST_SUB) return (unsigned int) val;
+  e = 63 - (unsigned int) __builtin_clzll (val);
+  return (e - HIST_SUBBITS + 1) * HIST_SUB + (unsigned int) ((val >> (e - HIST_SUBBITS)) & (HIST_SUB - 1));
+}
+
+/**
+ *  \brief Upper bound of a bucket (internal operation).
+ *
+ *  \param b bucket index
+ *
+ *  \return largest value recorded in the bucket
+ */
+
+static uint64_t bucketTop (unsigned int b)
+{
+  unsigned int e;                                                            /* position of the most significant bit */
+
+  if (b < HIST_SUB) return b;
+  e = b / HIST_SUB + HIST_SUBBITS - 1;
+  return ((uint64_t) (HIST_SUB + b % HIST_SUB) << (e - HIST_SUBBITS)) + ((uint64_t) 1 << (e - HIST_SUBBITS)) - 1;
+}
+
+/**
+ *  \brief Reading of the clock used to take timestamps.
+ *
+ *  The clock is monotonic and common to all processes.
+ *
+ *  \return present instant (in ns)
+ */
+
+uint64_t histClock (void)
+{
+  struct timespec ts;                                                                               /* clock reading */
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+/**
+ *  \brief Initialization of a histogram.
+ *
+ *  \param p_h pointer to the location where the histogram is stored
+ */
+
+void histInit (HISTOGRAM *p_h)
+{
+  memset (p_h, 0, sizeof (HISTOGRAM));
+}
+
+/**
+ *  \brief Recording of a value.
+ *
+ *  \param p_h pointer to the location where the histogram is stored
+ *  \param val value to be recorded
+ */
+
+void histAdd (HISTOGRAM *p_h, uint64_t val)
+{
+  p_h->bucket[bucketOf (val)] += 1;
+  p_h->count += 1;
+  if (val > p_h->max) p_h->max = val;
+}
+
+/**
+ *  \brief Merging of a histogram into another.
+ *
+ *  \param p_dst pointer to the location where the histogram the values are added to is stored
+ *  \param p_src pointer to the location where the histogram whose values are added is stored
+ */
+
+void histMerge (HISTOGRAM *p_dst, HISTOGRAM *p_src)
+{
+  unsigned int b;                                                                                    /* bucket index */
+
+  for (b = 0; b < HIST_NBUCKET; b++)
+    p_dst->bucket[b] += p_src->bucket[b];
+  p_dst->count += p_src->count;
+  if (p_src->max > p_dst->max) p_dst->max = p_src->max;
+}
+
+/**
+ *  \brief Percentile of the values recorded.
+ *
+ *  The upper bound of the bucket holding the percentile is returned, so the actual value is never underestimated.
+ *
+ *  \param p_h pointer to the location where the histogram is stored
+ *  \param q fraction of the values which are not greater than the percentile (0.5 for the median)
+ *
+ *  \return the percentile (\c 0, if no value was recorded)
+ */
+
+uint64_t histPercentile (HISTOGRAM *p_h, double q)
+{
+  uint64_t rank,                                                          /* rank of the percentile among the values */
+           sum = 0;                                                                              /* cumulative count */
+  unsigned int b;                                                                                    /* bucket index */
+
+  if (p_h->count == 0) return 0;
+  rank = (uint64_t) ceil (q * p_h->count);
+  if (rank == 0) rank = 1;
+  for (b = 0; b < HIST_NBUCKET; b++)
+  { sum += p_h->bucket[b];
+    if (sum >= rank) break;
+  }
+  return (bucketTop (b) < p_h->max) ? bucketTop (b) : p_h->max;
+}
@@ -0,0 +1,98 @@
+/**
+ *  \file histogram.h (interface file)
+ *
+ *  Problem name: Aveiro Handicraft SARL
+ *
+ *  Concept: Pedro Mariano
+ *
+ *  \brief Log-bucketed latency histograms.
+ *
+ *  Each power of two is split into <tt>HIST_SUB</tt> buckets, so any value is recorded with a relative error below
+ *  1 / <tt>HIST_SUB</tt>, over the whole range of 64-bit values, in a fixed amount of memory. Histograms are plain
+ *  data and may be kept in shared memory; they must then only be updated by one process at a time.
+ *
+ *  Defined operations:
+ *     \li reading of the clock used to take timestamps
+ *     \li initialization of a histogram
+ *     \li recording of a value
+ *     \li merging of a histogram into another
+ *     \li percentile of the values recorded.
+ */
+
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+#include <stdint.h>
+
+/** \brief number of bits of the value, next to the most significant one, used to select a bucket */
+#define  HIST_SUBBITS      3
+
+/** \brief number of buckets per power of two */
+#define  HIST_SUB          (1 << HIST_SUBBITS)
+
+/** \brief number of buckets */
+#define  HIST_NBUCKET      (64 * HIST_SUB)
+
+/**
+ *  \brief Definition of <em>histogram</em> data type.
+ */
+
+typedef struct
+        { /** \brief number of values recorded */
+          uint64_t count;
+          /** \brief largest value recorded */
+          uint64_t max;
+          /** \brief number of values recorded in each bucket */
+          uint64_t bucket[HIST_NBUCKET];
+        } HISTOGRAM;
+
+/**
+ *  \brief Reading of the clock used to take timestamps.
+ *
+ *  The clock is monotonic and common to all processes.
+ *
+ *  \return present instant (in ns)
+ */
+
+extern uint64_t histClock (void);
+
+/**
+ *  \brief Initialization of a histogram.
+ *
+ *  \param p_h pointer to the location where the histogram is stored
+ */
+
+extern void histInit (HISTOGRAM *p_h);
+
+/**
+ *  \brief Recording of a value.
+ *
+ *  \param p_h pointer to the location where the histogram is stored
+ *  \param val value to be recorded
+ */
+
+extern void histAdd (HISTOGRAM *p_h, uint64_t val);
+
+/**
+ *  \brief Merging of a histogram into another.
+ *
+ *  \param p_dst pointer to the location where the histogram the values are added to is stored
+ *  \param p_src pointer to the location where the histogram whose values are added is stored
+ */
+
+extern void histMerge (HISTOGRAM *p_dst, HISTOGRAM *p_src);
+
+/**
+ *  \brief Percentile of the values recorded.
+ *
+ *  The upper bound of the bucket holding the percentile is returned, so the actual value is never underestimated.
+ *
+ *  \param p_h pointer to the location where the histogram is stored
+ *  \param q fraction of the values which are not greater than the percentile (0.5 for the median)
+ *
+ *  \return the percentile (\c 0, if no value was recorded)
+ */
+
+extern uint64_t histPercentile (HISTOGRAM *p_h, double q);
+
+#endif /* HISTOGRAM_H_ */
@@ -0,0 +1,831 @@
+/**
+ *  \file logAnalyze.c (implementation file)
+ *
+ *  \brief Problem name: Aveiro Handicraft SARL.
+ *
+ *  \brief Concept: Pedro Mariano.
+ *
+ *  Analysis of log files.
+ *
+ *  The log file is mapped on the process address space and its lines are scanned by several threads, each one
+ *  dealing with a contiguous chunk of the file (or with a subset of the blocks of a compressed log file). Lines
+ *  which obey the fixed column layout emitted by <em>saveState</em> are decoded directly from the known column
+ *  positions; any other line is split into fields separated by spaces.
+ *
+ *  The numbers of customers, craftsmen and shops are taken from the header of the file, so logs produced by
+ *  simulations with different parameters can be analyzed. Since lines carry no time stamps, time is measured in log
+ *  lines: each line is one step of the simulation.
+ *
+ *  The report comprises
+ *    \li the time spent by every intervening entity in each of its states
+ *    \li the time every shop spent in each of its states
+ *    \li the purchases of every customer and the production of every craftsman
+ *    \li the distribution of the length of the queue by the counter
+ *    \li global throughput and utilization figures.
+ *
+ *  Upon execution, the following parameters are expected:
+ *    \li (optional) <tt>-t n</tt> - number of threads (by default, the number of online processors)
+ *    \li name of the logging file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "logging.h"
+#include "lzBlock.h"
+
+/** \brief number of header lines of a log file */
+#define  HEADERLINES     4
+
+/** \brief minimum number of bytes dealt with by each thread */
+#define  MINCHUNK        (1 << 20)
+
+/** \brief maximum number of threads */
+#define  MAXTHREADS      64
+
+/** \brief number of entrepreneur states */
+#define  NSTE            6
+/** \brief number of customer states */
+#define  NSTC            4
+/** \brief number of craftsman states */
+#define  NSTF            4
+/** \brief number of shop states */
+#define  NSTS            3
+
+/** \brief entrepreneur state codes */
+static const char *entrepCode[NSTE] = { "OPTS", "WFNT", "ATAC", "CLTS", "CBOP", "DLPM" };
+/** \brief customer state codes */
+static const char *custCode[NSTC] = { "CODC", "CSDO", "AOID", "BYSG" };
+/** \brief craftsman state codes */
+static const char *craftCode[NSTF] = { "FTPM", "PANP", "SIFT", "CTTE" };
+/** \brief shop state codes */
+static const char *shopCode[NSTS] = { "SPOP", "SDCL", "SPCL" };
+
+/**
+ *  \brief Definition of <em>decoded line</em> data type.
+ */
+typedef struct
+        { /** \brief entrepreneurs state (index into the code table, or the table size if unknown) */
+          unsigned int *entrep;
+          /** \brief customers state */
+          unsigned int *cust;
+          /** \brief pieces bought so far by each customer */
+          unsigned int *bp;
+          /** \brief craftsmen state */
+          unsigned int *craft;
+          /** \brief pieces produced so far by each craftsman */
+          unsigned int *pp;
+          /** \brief shops state */
+          unsigned int *shop;
+          /** \brief number of customers in each shop */
+          unsigned int *nci;
+          /** \brief number of products in each shop */
+          unsigned int *npi;
+          /** \brief workshop figures: prime materials in, products in, number of supplies, total supplied,
+           *         total produced */
+          unsigned int ws[5];
+        } ROW;
+
+/**
+ *  \brief Definition of <em>partial statistics</em> data type (one per thread).
+ */
+typedef struct
+        { /** \brief number of lines decoded */
+          uint64_t rows;
+          /** \brief number of lines which could not be decoded */
+          uint64_t bad;
+          /** \brief time spent by each entrepreneur in each state */
+          uint64_t *entrep;
+          /** \brief time spent by each customer in each state */
+          uint64_t *cust;
+          /** \brief time spent by each craftsman in each state */
+          uint64_t *craft;
+          /** \brief time spent by each shop in each state */
+          uint64_t *shop;
+          /** \brief distribution of the length of the queue by the counter */
+          uint64_t *queue;
+          /** \brief number of visits to the shop (entries into the appraising offer state) */
+          uint64_t visits;
+          /** \brief number of lines where each entrepreneur was busy outside the waiting for next task state,
+           *         summed over the entrepreneurs */
+          uint64_t entrepBusy;
+          /** \brief last line decoded */
+          ROW last;
+          /** \brief previous line decoded (for transitions) */
+          ROW prev;
+          /** \brief flag signaling a previous line is available */
+          bool hasPrev;
+        } STATS;
+
+/**
+ *  \brief Definition of <em>work unit</em> data type (one per thread).
+ */
+typedef struct
+        { /** \brief start of the region to be scanned */
+          const char *start;
+          /** \brief end of the region to be scanned */
+          const char *end;
+          /** \brief start of the line preceding the region (or NULL) */
+          const char *before;
+          /** \brief compressed blocks assigned to the thread (compressed log files) */
+          const unsigned char **blk;
+          /** \brief number of compressed blocks assigned to the thread */
+          unsigned int nBlk;
+          /** \brief compressed block preceding the ones assigned to the thread (or NULL) */
+          const unsigned char *blkBefore;
+          /** \brief partial statistics */
+          STATS st;
+        } WORK;
+
+/** \brief number of customers of the simulation which produced the log */
+static unsigned int nCust;
+
+/** \brief number of craftsmen of the simulation which produced the log */
+static unsigned int nCraft;
+
+/** \brief number of shops of the simulation which produced the log */
+static unsigned int nShop;
+
+/** \brief length of a line obeying the fixed column layout (newline included) */
+static unsigned int rowLen;
+
+/**
+ *  \brief Allocation of memory, exiting on failure (internal operation).
+ *
+ *  \param n number of bytes
+ *
+ *  \return pointer to the allocated region, which is cleared
+ */
+
+static void *alloc (size_t n)
+{
+  void *p;                                                                                       /* allocated region */
+
+  if ((p = calloc (1, (n == 0) ? 1 : n)) == NULL)
+     { perror ("error on allocating memory");
+       exit (EXIT_FAILURE);
+     }
+  return p;
+}
+
+/**
+ *  \brief Row allocation (internal operation).
+ *
+ *  \param r pointer to the row
+ */
+
+static void rowAlloc (ROW *r)
+{
+  r->entrep = alloc (nShop * sizeof (unsigned int));
+  r->cust = alloc (nCust * sizeof (unsigned int));
+  r->bp = alloc (nCust * sizeof (unsigned int));
+  r->craft = alloc (nCraft * sizeof (unsigned int));
+  r->pp = alloc (nCraft * sizeof (unsigned int));
+  r->shop = alloc (nShop * sizeof (unsigned int));
+  r->nci = alloc (nShop * sizeof (unsigned int));
+  r->npi = alloc (nShop * sizeof (unsigned int));
+}
+
+/**
+ *  \brief Row copy (internal operation).
+ *
+ *  \param d pointer to the destination row
+ *  \param s pointer to the source row
+ */
+
+static void rowCopy (ROW *d, const ROW *s)
+{
+  memcpy (d->entrep, s->entrep, nShop * sizeof (unsigned int));
+  memcpy (d->cust, s->cust, nCust * sizeof (unsigned int));
+  memcpy (d->bp, s->bp, nCust * sizeof (unsigned int));
+  memcpy (d->craft, s->craft, nCraft * sizeof (unsigned int));
+  memcpy (d->pp, s->pp, nCraft * sizeof (unsigned int));
+  memcpy (d->shop, s->shop, nShop * sizeof (unsigned int));
+  memcpy (d->nci, s->nci, nShop * sizeof (unsigned int));
+  memcpy (d->npi, s->npi, nShop * sizeof (unsigned int));
+  memcpy (d->ws, s->ws, sizeof (d->ws));
+}
+
+/**
+ *  \brief Statistics allocation (internal operation).
+ *
+ *  \param st pointer to the statistics
+ */
+
+static void statsAlloc (STATS *st)
+{
+  memset (st, 0, sizeof (STATS));
+  st->entrep = alloc (nShop * (NSTE + 1) * sizeof (uint64_t));
+  st->shop = alloc (nShop * (NSTS + 1) * sizeof (uint64_t));
+  st->cust = alloc (nCust * (NSTC + 1) * sizeof (uint64_t));
+  st->craft = alloc (nCraft * (NSTF + 1) * sizeof (uint64_t));
+  st->queue = alloc ((nCust + 1) * sizeof (uint64_t));
+  rowAlloc (&st->last);
+  rowAlloc (&st->prev);
+}
+
+/**
+ *  \brief Decoding of a state code (internal operation).
+ *
+ *  \param p pointer to the location where the code is stored (four characters)
+ *  \param code code table
+ *  \param n code table size
+ *
+ *  \return index into the code table, or <tt>n</tt> if the code is unknown
+ */
+
+static unsigned int decode (const char *p, const char **code, unsigned int n)
+{
+  unsigned int i;                                                                               /* counting variable */
+
+  for (i = 0; i < n; i++)
+    if (memcmp (p, code[i], 4) == 0) break;
+  return i;
+}
+
+/**
+ *  \brief Decoding of a right aligned number within a fixed width field (internal operation).
+ *
+ *  \param p pointer to the location where the field is stored
+ *  \param w field width
+ *  \param val pointer to the location where the value is to be stored
+ *
+ *  \return \c true, if the field holds a valid number
+ *  \return \c false, otherwise
+ */
+
+static bool fixedNum (const char *p, unsigned int w, unsigned int *val)
+{
+  unsigned int i, v = 0;                                                                 /* counting variable, value */
+
+  for (i = 0; (i < w) && (p[i] == ' '); i++) ;
+  if (i == w) return false;
+  for (; i < w; i++)
+    if ((p[i] < '0') || (p[i] > '9'))
+       return false;
+       else v = 10 * v + (unsigned int) (p[i] - '0');
+  *val = v;
+  return true;
+}
+
+/**
+ *  \brief Decoding of a line obeying the fixed column layout (internal operation).
+ *
+ *  \param p pointer to the start of the line
+ *  \param r pointer to the row where the decoded values are to be stored
+ *
+ *  \return \c true, if the line was decoded
+ *  \return \c false, otherwise
+ */
+
+static bool parseFixed (const char *p, ROW *r)
+{
+  unsigned int i, c;                                                                    /* counting variable, column */
+  bool ok = true;                                                                                   /* decoding flag */
+
+  for (c = 0, i = 0; i < nShop; i++, c += 9)
+    r->entrep[i] = decode (p + c + 2, entrepCode, NSTE);
+  for (i = 0; i < nCust; i++, c += 8)
+  { r->cust[i] = decode (p + c, custCode, NSTC);
+    ok = ok && fixedNum (p + c + 5, 2, &r->bp[i]);
+  }
+  for (c += 2, i = 0; i < nCraft; i++, c += 8)
+  { r->craft[i] = decode (p + c, craftCode, NSTF);
+    ok = ok && fixedNum (p + c + 5, 2, &r->pp[i]);
+  }
+  for (c += 1, i = 0; i < nShop; i++, c += 22)
+  { r->shop[i] = decode (p + c, shopCode, NSTS);
+    ok = ok && fixedNum (p + c + 5, 3, &r->nci[i]) && fixedNum (p + c + 9, 3, &r->npi[i]);
+  }
+  ok = ok && fixedNum (p + c, 3, &r->ws[0]) && fixedNum (p + c + 5, 3, &r->ws[1]) &&
+             fixedNum (p + c + 9, 3, &r->ws[2]) && fixedNum (p + c + 14, 3, &r->ws[3]) &&
+             fixedNum (p + c + 19, 3, &r->ws[4]);
+  return ok;
+}
+
+/**
+ *  \brief Fetching the next field of a line separated by spaces (internal operation).
+ *
+ *  \param pp pointer to the scanning position, which is advanced past the field
+ *  \param end end of the line
+ *  \param len pointer to the location where the field length is to be stored
+ *
+ *  \return pointer to the start of the field, or NULL if there are no more fields
+ */
+
+static const char *nextField (const char **pp, const char *end, unsigned int *len)
+{
+  const char *p = *pp, *f;                                                               /* scanning position, field */
+
+  while ((p < end) && (*p == ' ')) p++;
+  if (p == end) return NULL;
+  f = p;
+  while ((p < end) && (*p != ' ')) p++;
+  *len = (unsigned int) (p - f);
+  *pp = p;
+  return f;
+}
+
+/**
+ *  \brief Decoding of a number field (internal operation).
+ *
+ *  \param pp pointer to the scanning position, which is advanced past the field
+ *  \param end end of the line
+ *  \param val pointer to the location where the value is to be stored
+ *
+ *  \return \c true, if a valid number was found
+ *  \return \c false, otherwise
+ */
+
+static bool fieldNum (const char **pp, const char *end, unsigned int *val)
+{
+  const char *f;                                                                                            /* field */
+  unsigned int len;                                                                                  /* field length */
+
+  return ((f = nextField (pp, end, &len)) != NULL) && fixedNum (f, len, val);
+}
+
+/**
+ *  \brief Decoding of a state code field (internal operation).
+ *
+ *  \param pp pointer to the scanning position, which is advanced past the field
+ *  \param end end of the line
+ *  \param code code table
+ *  \param n code table size
+ *  \param val pointer to the location where the index into the code table is to be stored
+ *
+ *  \return \c true, if a four character field was found
+ *  \return \c false, otherwise
+ */
+
+static bool fieldCode (const char **pp, const char *end, const char **code, unsigned int n, unsigned int *val)
+{
+  const char *f;                                                                                            /* field */
+  unsigned int len;                                                                                  /* field length */
+
+  if (((f = nextField (pp, end, &len)) == NULL) || (len != 4)) return false;
+  *val = decode (f, code, n);
+  return true;
+}
+
+/**
+ *  \brief Decoding of a line split into fields separated by spaces (internal operation).
+ *
+ *  \param p pointer to the start of the line
+ *  \param end end of the line (newline excluded)
+ *  \param r pointer to the row where the decoded values are to be stored
+ *
+ *  \return \c true, if the line was decoded
+ *  \return \c false, otherwise
+ */
+
+static bool parseFields (const char *p, const char *end, ROW *r)
+{
+  unsigned int i, s, len;                                                        /* counting variables, field length */
+  const char *f;                                                                                            /* field */
+
+  for (i = 0; i < nShop; i++)
+    if (!fieldCode (&p, end, entrepCode, NSTE, &r->entrep[i])) return false;
+  for (i = 0; i < nCust; i++)
+    if (!fieldCode (&p, end, custCode, NSTC, &r->cust[i]) || !fieldNum (&p, end, &r->bp[i])) return false;
+  for (i = 0; i < nCraft; i++)
+    if (!fieldCode (&p, end, craftCode, NSTF, &r->craft[i]) || !fieldNum (&p, end, &r->pp[i])) return false;
+  for (s = 0; s < nShop; s++)
+  { if (!fieldCode (&p, end, shopCode, NSTS, &r->shop[s]) || !fieldNum (&p, end, &r->nci[s]) ||
+        !fieldNum (&p, end, &r->npi[s])) return false;
+    for (i = 0; i < 2; i++)                                                                     /* PCR and PMR flags */
+      if (((f = nextField (&p, end, &len)) == NULL) || (len != 1)) return false;
+  }
+  for (i = 0; i < 5; i++)
+    if (!fieldNum (&p, end, &r->ws[i])) return false;
+  return nextField (&p, end, &len) == NULL;
+}
+
+/**
+ *  \brief Decoding of a line (internal operation).
+ *
+ *  \param p pointer to the start of the line
+ *  \param end end of the line (newline excluded)
+ *  \param r pointer to the row where the decoded values are to be stored
+ *
+ *  \return \c true, if the line was decoded
+ *  \return \c false, otherwise
+ */
+
+static bool parseLine (const char *p, const char *end, ROW *r)
+{
+  if ((unsigned int) (end - p) + 1 == rowLen)
+     return parseFixed (p, r);
+  return parseFields (p, end, r);
+}
+
+/**
+ *  \brief Accounting of a decoded row (internal operation).
+ *
+ *  \param st pointer to the partial statistics
+ *  \param r pointer to the decoded row
+ */
+
+static void account (STATS *st, ROW *r)
+{
+  unsigned int i, q;                                                              /* counting variable, queue length */
+
+  st->rows += 1;
+  for (i = 0; i < nShop; i++)
+  { st->entrep[i*(NSTE+1)+r->entrep[i]] += 1;
+    if ((r->entrep[i] != WAITING_FOR_NEXT_TASK) && (r->entrep[i] < NSTE)) st->entrepBusy += 1;
+    st->shop[i*(NSTS+1)+r->shop[i]] += 1;
+  }
+  for (q = 0, i = 0; i < nCust; i++)
+  { st->cust[i*(NSTC+1)+r->cust[i]] += 1;
+    if (r->cust[i] == BUYING_SOME_GOODS) q += 1;
+    if (st->hasPrev && (r->cust[i] == APPRAISING_OFFER_IN_DISPLAY) &&
+        (st->prev.cust[i] != APPRAISING_OFFER_IN_DISPLAY)) st->visits += 1;
+  }
+  st->queue[q] += 1;
+  for (i = 0; i < nCraft; i++)
+    st->craft[i*(NSTF+1)+r->craft[i]] += 1;
+  rowCopy (&st->prev, r);
+  st->hasPrev = true;
+}
+
+/**
+ *  \brief Scanning of a region made of whole lines (internal operation).
+ *
+ *  \param st pointer to the partial statistics
+ *  \param p start of the region
+ *  \param end end of the region
+ *  \param r pointer to a scratch row
+ */
+
+static void scan (STATS *st, const char *p, const char *end, ROW *r)
+{
+  const char *nl;                                                                                 /* end of the line */
+
+  while (p < end)
+  { if ((nl = memchr (p, '\n', (size_t) (end - p))) == NULL) nl = end;
+    if (nl > p)
+       { if (parseLine (p, nl, r))
+            account (st, r);
+            else st->bad += 1;
+       }
+    p = nl + 1;
+  }
+}
+
+/**
+ *  \brief Thread body: scanning of the work unit (internal operation).
+ *
+ *  \param arg pointer to the work unit
+ *
+ *  \return NULL
+ */
+
+static void *worker (void *arg)
+{
+  WORK *w = arg;                                                                                    /* the work unit */
+  ROW r;                                                                                              /* scratch row */
+  const char *nl;                                                                                 /* end of the line */
+  unsigned char *raw;                                                                          /* uncompressed block */
+  uint32_t len[2];                                                        /* uncompressed and compressed block sizes */
+  unsigned int b;                                                                               /* counting variable */
+
+  rowAlloc (&r);
+  if (w->before != NULL)                                                /* last line of the preceding region, if any */
+     { nl = memchr (w->before, '\n', (size_t) (w->start - w->before));
+       if ((nl != NULL) && parseLine (w->before, nl, &w->st.prev)) w->st.hasPrev = true;
+     }
+  if (w->blk == NULL)
+     scan (&w->st, w->start, w->end, &r);
+     else { raw = alloc (LOG_BLOCK);
+            if (w->blkBefore != NULL)                                    /* last line of the preceding block, if any */
+               { memcpy (len, w->blkBefore, sizeof (len));
+                 if (len[1] == len[0])
+                    memcpy (raw, w->blkBefore + sizeof (len), len[0]);
+                    else if (lzDecompress (w->blkBefore + sizeof (len), len[1], raw, LOG_BLOCK) != (int) len[0])
+                            len[0] = 0;
+                 if ((len[0] > 0) && (raw[len[0]-1] == '\n'))
+                    { for (nl = (char *) raw + len[0] - 1; (nl > (char *) raw) && (nl[-1] != '\n'); nl--)
+                        ;
+                      if (parseLine (nl, (char *) raw + len[0] - 1, &w->st.prev)) w->st.hasPrev = true;
+                    }
+               }
+            for (b = 0; b < w->nBlk; b++)
+            { memcpy (len, w->blk[b], sizeof (len));
+              if (len[1] == len[0])
+                 scan (&w->st, (const char *) w->blk[b] + sizeof (len),
+                       (const char *) w->blk[b] + sizeof (len) + len[0], &r);
+                 else if (lzDecompress (w->blk[b] + sizeof (len), len[1], raw, LOG_BLOCK) == (int) len[0])
+                         scan (&w->st, (char *) raw, (char *) raw + len[0], &r);
+                         else w->st.bad += 1;
+            }
+            free (raw);
+          }
+  if (w->st.hasPrev) rowCopy (&w->st.last, &w->st.prev);
+  return NULL;
+}
+
+/**
+ *  \brief Getting the simulation parameters from the header of the log file (internal operation).
+ *
+ *  \param p start of the header
+ *  \param end end of the region where the header is stored
+ *
+ *  \return pointer to the first line after the header, or NULL if the header is malformed
+ */
+
+static const char *parseHeader (const char *p, const char *end)
+{
+  const char *nl, *q;                                                                   /* end of the line, scanning */
+  unsigned int l;                                                                               /* counting variable */
+
+  nCust = nCraft = nShop = 0;
+  for (l = 0; l < HEADERLINES; l++)
+  { if ((nl = memchr (p, '\n', (size_t) (end - p))) == NULL) return NULL;
+    if (l == 2)                                                                   /* first line of field description */
+       { for (q = p; q + 6 < nl; q++)
+           if (memcmp (q, "CUST_", 5) == 0)
+              nCust += 1;
+              else if (memcmp (q, "CRAFT_", 6) == 0)
+                      nCraft += 1;
+                      else if (memcmp (q, "ENTREP_", 7) == 0) nShop += 1;
+       }
+    p = nl + 1;
+  }
+  if (nShop == 0) nShop = 1;                                                 /* a single shop has no numbered fields */
+  rowLen = 57 + 8 * (nCust + nCraft) + 31 * (nShop - 1);
+  return ((nCust == 0) || (nCraft == 0)) ? NULL : p;
+}
+
+/**
+ *  \brief Printing of a state occupancy line (internal operation).
+ *
+ *  \param name entity name
+ *  \param cnt time spent in each state
+ *  \param code code table
+ *  \param n code table size
+ *  \param rows total time
+ */
+
+static void printOccupancy (const char *name, const uint64_t *cnt, const char **code, unsigned int n, uint64_t rows)
+{
+  unsigned int i;                                                                               /* counting variable */
+
+  printf ("  %-10s", name);
+  for (i = 0; i < n; i++)
+    printf ("  %s %6.2f%%", code[i], (rows == 0) ? 0.0 : 100.0 * cnt[i] / rows);
+  if (cnt[n] != 0) printf ("  **** %6.2f%%", 100.0 * cnt[n] / rows);
+  printf ("\n");
+}
+
+/**
+ *  \brief Main program.
+ */
+
+int main (int argc, char *argv[])
+{
+  int fd;                                                                                         /* file descriptor */
+  struct stat fs;                                                                                     /* file status */
+  const char *base, *end, *body, *p;                                              /* mapped file and scanning limits */
+  const unsigned char **blk = NULL;                                                     /* compressed blocks, if any */
+  size_t nBlk = 0,                                                                    /* number of compressed blocks */
+         maxBlk = 0;                                                           /* room for compressed block pointers */
+  char *hdr = NULL;                                                                           /* uncompressed header */
+  uint32_t len[2];                                                        /* uncompressed and compressed block sizes */
+  long nThr;                                                                                    /* number of threads */
+  WORK *w;                                                                                             /* work units */
+  pthread_t thr[MAXTHREADS];                                                                   /* thread identifiers */
+  STATS tot;                                                                                    /* global statistics */
+  unsigned int t, i, j, totBP, totPP;                                               /* counting variables and totals */
+  char name[24];                                                                                      /* entity name */
+  uint64_t qSum;                                                                        /* queue length weighted sum */
+  int c;                                                                                      /* command line option */
+  char *tinp;                                                                      /* numerical parameters test flag */
+  bool lz;                                                                               /* compressed log file flag */
+  ROW r;                                                                                              /* scratch row */
+
+  /* processing command line */
+
+  nThr = sysconf (_SC_NPROCESSORS_ONLN);
+  while ((c = getopt (argc, argv, "t:")) != -1)
+    switch (c)
+    { case 't': nThr = strtol (optarg, &tinp, 0);
+                if ((*tinp != '\0') || (nThr < 1))
+                   { fprintf (stderr, "Number of threads is invalid!\n");
+                     exit (EXIT_FAILURE);
+                   }
+                break;
+      default:  fprintf (stderr, "Usage: %s [-t threads] log_file\n", argv[0]);
+                exit (EXIT_FAILURE);
+    }
+  if (optind != argc - 1)
+     { fprintf (stderr, "Usage: %s [-t threads] log_file\n", argv[0]);
+       exit (EXIT_FAILURE);
+     }
+  if (nThr > MAXTHREADS) nThr = MAXTHREADS;
+
+  /* mapping the log file */
+
+  if ((fd = open (argv[optind], O_RDONLY)) == -1)
+     { perror ("error on opening the log file");
+       exit (EXIT_FAILURE);
+     }
+  if (fstat (fd, &fs) == -1)
+     { perror ("error on getting the log file status");
+       exit (EXIT_FAILURE);
+     }
+  if (fs.st_size == 0)
+     { fprintf (stderr, "The log file is empty!\n");
+       exit (EXIT_FAILURE);
+     }
+  if ((base = mmap (NULL, (size_t) fs.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+     { perror ("error on mapping the log file");
+       exit (EXIT_FAILURE);
+     }
+  madvise ((void *) base, (size_t) fs.st_size, MADV_SEQUENTIAL);
+  end = base + fs.st_size;
+
+  /* splitting the work among the threads */
+
+  lz = (fs.st_size >= LOG_LZMAGICSZ) && (memcmp (base, LOG_LZMAGIC, LOG_LZMAGICSZ) == 0);
+  if (lz)
+     { for (p = base + LOG_LZMAGICSZ; p + sizeof (len) <= end; p += sizeof (len) + len[1])
+       { memcpy (len, p, sizeof (len));
+         if ((len[0] > LOG_BLOCK) || (len[1] > len[0]) || (p + sizeof (len) + len[1] > end))
+            { fprintf (stderr, "The compressed log file is corrupted!\n");
+              exit (EXIT_FAILURE);
+            }
+         if (nBlk == maxBlk)
+            { maxBlk = (maxBlk == 0) ? 1024 : 2 * maxBlk;
+              if ((blk = realloc (blk, maxBlk * sizeof (blk[0]))) == NULL)
+                 { perror ("error on allocating memory");
+                   exit (EXIT_FAILURE);
+                 }
+            }
+         blk[nBlk++] = (const unsigned char *) p;
+       }
+       if (nBlk == 0)
+          { fprintf (stderr, "The compressed log file has no blocks!\n");
+            exit (EXIT_FAILURE);
+          }
+       hdr = alloc (LOG_BLOCK + 1);                             /* the header is at the beginning of the first block */
+       memcpy (len, blk[0], sizeof (len));
+       if (len[1] == len[0])
+          memcpy (hdr, blk[0] + sizeof (len), len[0]);
+          else if (lzDecompress (blk[0] + sizeof (len), len[1], (unsigned char *) hdr, LOG_BLOCK) != (int) len[0])
+                  { fprintf (stderr, "The compressed log file is corrupted!\n");
+                    exit (EXIT_FAILURE);
+                  }
+       if ((body = parseHeader (hdr, hdr + len[0])) == NULL)
+          { fprintf (stderr, "The log file header is malformed!\n");
+            exit (EXIT_FAILURE);
+          }
+       if (nThr > (long) nBlk) nThr = (long) nBlk;
+     }
+     else { if ((body = parseHeader (base, end)) == NULL)
+               { fprintf (stderr, "The log file header is malformed!\n");
+                 exit (EXIT_FAILURE);
+               }
+            if (nThr > (end - body) / MINCHUNK) nThr = (end - body) / MINCHUNK;
+            if (nThr < 1) nThr = 1;
+          }
+
+  w = alloc (nThr * sizeof (WORK));
+  for (t = 0; t < nThr; t++)
+  { statsAlloc (&w[t].st);
+    if (lz)
+       { w[t].blk = blk + nBlk * t / nThr;
+         w[t].nBlk = (unsigned int) (nBlk * (t + 1) / nThr - nBlk * t / nThr);
+         w[t].blkBefore = (t == 0) ? NULL : w[t].blk[-1];
+       }
+       else { w[t].start = (t == 0) ? body : w[t-1].end;
+              if (t == nThr - 1)
+                 w[t].end = end;
+                 else { p = body + (end - body) * (t + 1) / nThr;                      /* split just after a newline */
+                        if (p < w[t].start) p = w[t].start;
+                        p = memchr (p, '\n', (size_t) (end - p));
+                        w[t].end = (p == NULL) ? end : p + 1;
+                      }
+              if (t != 0)                                                           /* the line preceding the region */
+                 { for (p = w[t].start - 1; (p > body) && (p[-1] != '\n'); p--)
+                     ;
+                   w[t].before = (w[t].start > body) ? p : NULL;
+                 }
+            }
+  }
+  if (lz)                                                    /* the rest of the first block is dealt with right away */
+     { rowAlloc (&r);
+       scan (&w[0].st, body, hdr + len[0], &r);
+       w[0].blk += 1;
+       w[0].nBlk -= 1;
+     }
+
+  /* scanning */
+
+  for (t = 0; t < nThr; t++)
+    if (pthread_create (&thr[t], NULL, worker, &w[t]) != 0)
+       { perror ("error on creating a thread");
+         exit (EXIT_FAILURE);
+       }
+  for (t = 0; t < nThr; t++)
+    pthread_join (thr[t], NULL);
+
+  /* merging the partial statistics */
+
+  statsAlloc (&tot);
+  for (t = 0; t < nThr; t++)
+  { tot.rows += w[t].st.rows;
+    tot.bad += w[t].st.bad;
+    tot.visits += w[t].st.visits;
+    tot.entrepBusy += w[t].st.entrepBusy;
+    for (i = 0; i < nShop * (NSTE + 1); i++) tot.entrep[i] += w[t].st.entrep[i];
+    for (i = 0; i < nShop * (NSTS + 1); i++) tot.shop[i] += w[t].st.shop[i];
+    for (i = 0; i < nCust * (NSTC + 1); i++) tot.cust[i] += w[t].st.cust[i];
+    for (i = 0; i < nCraft * (NSTF + 1); i++) tot.craft[i] += w[t].st.craft[i];
+    for (i = 0; i <= nCust; i++) tot.queue[i] += w[t].st.queue[i];
+    if (w[t].st.rows != 0)
+       { rowCopy (&tot.last, &w[t].st.last);
+         tot.hasPrev = true;
+       }
+  }
+  if (!tot.hasPrev)
+     { fprintf (stderr, "The log file has no state lines!\n");
+       exit (EXIT_FAILURE);
+     }
+
+  /* report */
+
+  printf ("Log file: %s (%s, %lld bytes, %ld thread%s)\n", argv[optind], lz ? "compressed" : "plain text",
+          (long long) fs.st_size, nThr, (nThr == 1) ? "" : "s");
+  printf ("Customers: %u  Craftsmen: %u", nCust, nCraft);
+  if (nShop > 1) printf ("  Shops: %u", nShop);
+  printf ("  Steps (log lines): %llu", (unsigned long long) tot.rows);
+  if (tot.bad != 0) printf ("  Malformed lines: %llu", (unsigned long long) tot.bad);
+  printf ("\n\nTime spent in each state (percentage of steps)\n");
+  for (i = 0; i < nShop; i++)
+  { if (nShop == 1)
+       strcpy (name, "entrepren.");
+       else sprintf (name, "entrep. %u", i);
+    printOccupancy (name, tot.entrep + i * (NSTE + 1), entrepCode, NSTE, tot.rows);
+  }
+  for (i = 0; i < nCust; i++)
+  { sprintf (name, "customer %u", i);
+    printOccupancy (name, tot.cust + i * (NSTC + 1), custCode, NSTC, tot.rows);
+  }
+  for (i = 0; i < nCraft; i++)
+  { sprintf (name, "craftsm. %u", i);
+    printOccupancy (name, tot.craft + i * (NSTF + 1), craftCode, NSTF, tot.rows);
+  }
+  for (i = 0; i < nShop; i++)
+  { if (nShop == 1)
+       strcpy (name, "shop");
+       else sprintf (name, "shop %u", i);
+    printOccupancy (name, tot.shop + i * (NSTS + 1), shopCode, NSTS, tot.rows);
+  }
+
+  printf ("\nPurchases\n");
+  for (totBP = 0, i = 0; i < nCust; i++)
+  { printf ("  customer %u: %u pieces\n", i, tot.last.bp[i]);
+    totBP += tot.last.bp[i];
+  }
+  printf ("  total: %u pieces in %llu visits\n", totBP, (unsigned long long) tot.visits);
+  printf ("\nProduction\n");
+  for (totPP = 0, i = 0; i < nCraft; i++)
+  { printf ("  craftsman %u: %u pieces\n", i, tot.last.pp[i]);
+    totPP += tot.last.pp[i];
+  }
+  printf ("  total: %u pieces out of %u portions of prime materials in %u supplies\n", totPP, tot.last.ws[3],
+          tot.last.ws[2]);
+
+  printf ("\nQueue by the counter (customers buying some goods)\n");
+  for (qSum = 0, i = 0; i <= nCust; i++)
+  { qSum += i * tot.queue[i];
+    if (tot.queue[i] != 0)
+       printf ("  length %2u: %6.2f%%\n", i, 100.0 * tot.queue[i] / tot.rows);
+  }
+  printf ("  mean length: %.3f\n", (double) qSum / tot.rows);
+
+  printf ("\nThroughput and utilization\n");
+  printf ("  pieces produced per 1000 steps: %.2f\n", 1000.0 * totPP / tot.rows);
+  printf ("  pieces sold per 1000 steps: %.2f\n", 1000.0 * totBP / tot.rows);
+  printf ("  entrepreneur%s utilization (not waiting for next task): %.2f%%\n", (nShop == 1) ? "" : "s",
+          100.0 * tot.entrepBusy / tot.rows / nShop);
+  for (j = 0, i = 0; i < nCraft; i++) j += (unsigned int) tot.craft[i*(NSTF+1)+PRODUCING_A_NEW_PIECE];
+  printf ("  craftsmen utilization (producing a new piece): %.2f%%\n", 100.0 * j / tot.rows / nCraft);
+
+  munmap ((void *) base, (size_t) fs.st_size);
+  close (fd);
+
+  return EXIT_SUCCESS;
+}
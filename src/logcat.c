@@ -0,0 +1,109 @@
+/**
+ *  \file logcat.c (implementation file)
+ *
+ *  \brief Problem name: Aveiro Handicraft SARL.
+ *
+ *  \brief Concept: Pedro Mariano.
+ *
+ *  Reading of log files.
+ *
+ *  The log file is written to the standard output as plain text. Compressed log files are decompressed one block at
+ *  a time; plain text log files are copied as they are.
+ *
+ *  Upon execution, the following parameters are expected:
+ *    \li name of the logging file
+ *    \li (optional) number of the single block to be decompressed (the first block is number 0).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "logging.h"
+#include "lzBlock.h"
+
+/**
+ *  \brief Main program.
+ */
+
+int main (int argc, char *argv[])
+{
+  FILE *fic;                                                                                      /* file descriptor */
+  char magic[LOG_LZMAGICSZ];                                                            /* start of the log file */
+  static unsigned char comp[LZ_BOUND(LOG_BLOCK)],                                                /* compressed block */
+                       raw[LOG_BLOCK];                                                         /* uncompressed block */
+  uint32_t len[2];                                                       /* uncompressed and compressed block sizes */
+  size_t n;                                                                                  /* number of bytes read */
+  long sel = -1,                                                                            /* selected block number */
+       nb;                                                                                   /* present block number */
+  char *tinp;                                                                      /* numerical parameters test flag */
+
+  if ((argc < 2) || (argc > 3))
+     { fprintf (stderr, "Usage: %s log_file [block_number]\n", argv[0]);
+       exit (EXIT_FAILURE);
+     }
+  if (argc == 3)
+     { sel = strtol (argv[2], &tinp, 0);
+       if ((*tinp != '\0') || (sel < 0))
+          { fprintf (stderr, "Block number is invalid!\n");
+            exit (EXIT_FAILURE);
+          }
+     }
+  if ((fic = fopen (argv[1], "r")) == NULL)
+     { perror ("error on opening the log file");
+       exit (EXIT_FAILURE);
+     }
+
+  /* plain text log file */
+
+  n = fread (magic, 1, LOG_LZMAGICSZ, fic);
+  if ((n != LOG_LZMAGICSZ) || (memcmp (magic, LOG_LZMAGIC, LOG_LZMAGICSZ) != 0))
+     { if (sel != -1)
+          { fprintf (stderr, "The log file is not compressed!\n");
+            exit (EXIT_FAILURE);
+          }
+       fwrite (magic, 1, n, stdout);
+       while ((n = fread (raw, 1, sizeof (raw), fic)) > 0)
+         fwrite (raw, 1, n, stdout);
+       fclose (fic);
+       return EXIT_SUCCESS;
+     }
+
+  /* compressed log file */
+
+  for (nb = 0; fread (len, sizeof (uint32_t), 2, fic) == 2; nb++)
+  { if ((len[0] > LOG_BLOCK) || (len[1] > len[0]))
+       { fprintf (stderr, "Block %ld is corrupted!\n", nb);
+         exit (EXIT_FAILURE);
+       }
+    if ((sel != -1) && (nb != sel))                                       /* skip blocks which were not selected */
+       { if (fseek (fic, len[1], SEEK_CUR) != 0)
+            { perror ("error on skipping a block");
+              exit (EXIT_FAILURE);
+            }
+         continue;
+       }
+    if (fread (comp, 1, len[1], fic) != len[1])
+       { fprintf (stderr, "Block %ld is truncated!\n", nb);
+         exit (EXIT_FAILURE);
+       }
+    if (len[1] == len[0])                                                          /* block stored uncompressed */
+       fwrite (comp, 1, len[0], stdout);
+       else if (lzDecompress (comp, len[1], raw, sizeof (raw)) != (int) len[0])
+               { fprintf (stderr, "Block %ld is corrupted!\n", nb);
+                 exit (EXIT_FAILURE);
+               }
+               else fwrite (raw, 1, len[0], stdout);
+    if (nb == sel) break;
+  }
+  if ((sel != -1) && (nb != sel))
+     { fprintf (stderr, "There is no block %ld!\n", sel);
+       exit (EXIT_FAILURE);
+     }
+
+  fclose (fic);
+  return EXIT_SUCCESS;
+}
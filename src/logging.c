@@ -8,18 +8,600 @@
  *  \brief Logging the internal state of the problem into a file.
  *
  *  Defined operations:
+ *     \li binding of the logging information shared by all processes
  *     \li file initialization
- *     \li writing the present state as a single line at the end of the file.
+ *     \li writing the present state as a single line at the end of the file
+ *     \li file completion.
  *
  *  \author António Rui Borges - October 2014
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/types.h>
 
 #include "probConst.h"
 #include "probDataStruct.h"
+#include "logging.h"
+#include "lzBlock.h"
+#include "trace.h"
+#include "uring.h"
+#include "criticalRegion.h"
+
+/** \brief maximum size of a line describing the full state (or of the header) */
+#define  LINESZ          (256 + 16 * (N + M) + 32 * NS)
+
+/** \brief size by which the log file grows in memory-mapped mode (in bytes) */
+#define  LOG_EXTENT      (64 << 20)
+
+/** \brief logging information the process is bound to */
+static LOGINFO *p_logInfo = NULL;
+
+/** \brief file descriptor of the memory-mapped log file */
+static int mapFd = -1;
+
+/** \brief local address of the memory-mapped log file */
+static char *mapAdd = NULL;
+
+/** \brief number of bytes of the log file presently mapped */
+static uint64_t mapLen = 0;
+
+/** \brief number of lines held in the registered buffer of the io_uring (a power of two) */
+#define  LOG_URING_DEPTH 64
+
+/** \brief number of lines gathered in a single submission */
+#define  LOG_URING_BATCH 16
+
+/** \brief io_uring of the process */
+static URING ring;
+
+/** \brief process which set up the io_uring, or the fallback to buffered writes (0, if none) */
+static pid_t ringPid = 0;
+
+/** \brief the io_uring is in use (otherwise, lines are written by <tt>pwrite</tt>) */
+static bool ringOk = false;
+
+/** \brief thread which set up the io_uring, the only one allowed to submit to it */
+static pthread_t ringThr;
+
+/** \brief file descriptor of the log file, in io_uring mode */
+static int ringFd = -1;
+
+/** \brief completion of the writes still outstanding is to be waited for upon process termination */
+static bool ringAtExit = false;
+
+/** \brief registered buffer: a slot per line */
+static char ringBuf[LOG_URING_DEPTH][LINESZ];
+
+/** \brief slot whose write is outstanding */
+static bool ringBusy[LOG_URING_DEPTH];
+
+/** \brief next slot to be filled */
+static unsigned int ringNext = 0;
+
+/**
+ *  \brief Initialization of the logging information.
+ *
+ *  The function must be called by the process that creates the shared memory region before the log file is created.
+ *  The calling process is bound to the logging information.
+ *
+ *  \param p_log pointer to the location where the logging information is stored
+ *  \param mode logging mode: either LOG_TEXT, or LOG_LZ, or LOG_MMAP, or LOG_URING
+ */
+
+void logInit (LOGINFO *p_log, unsigned int mode)
+{
+  p_log->mode = mode;
+  p_log->nStaged = 0;
+  p_log->used = p_log->size = 0;
+  p_log->nFallback = 0;
+  p_logInfo = p_log;
+}
+
+/**
+ *  \brief Binding to the logging information.
+ *
+ *  The function must be called by every intervening entity upon mapping the shared memory region on its address space.
+ *  If it is not called, lines are appended as plain text.
+ *
+ *  \param p_log pointer to the location where the logging information is stored
+ */
+
+void logBind (LOGINFO *p_log)
+{
+  p_logInfo = p_log;
+}
+
+/**
+ *  \brief Present logging mode (internal operation).
+ *
+ *  \return the logging mode of the logging information the process is bound to, or LOG_TEXT if it is not bound
+ */
+
+static unsigned int logMode (void)
+{
+  return (p_logInfo == NULL) ? LOG_TEXT : p_logInfo->mode;
+}
+
+/**
+ *  \brief Mapping of the log file on the process address space (internal operation).
+ *
+ *  The file is extended by whole extents of LOG_EXTENT bytes whenever it is smaller than required. Since
+ *  <tt>posix_fallocate</tt> never shrinks a file, concurrent extensions by different processes are harmless.
+ *  The present mapping is replaced if it does not cover the required size.
+ *
+ *  \param fName name of the logging file
+ *  \param need number of bytes that must be mapped
+ */
+
+static void mapFile (char *fName, uint64_t need)
+{
+  uint64_t size,                                                                                /* present file size */
+           newSize;                                                                            /* extended file size */
+
+  if ((mapFd == -1) && ((mapFd = open (fName, O_RDWR)) == -1))
+     { perror ("error on opening the log file for mapping");
+       exit (EXIT_FAILURE);
+     }
+  while ((size = __atomic_load_n (&p_logInfo->size, __ATOMIC_ACQUIRE)) < need)
+  { newSize = (need + LOG_EXTENT - 1) / LOG_EXTENT * LOG_EXTENT;
+    if ((errno = posix_fallocate (mapFd, 0, (off_t) newSize)) != 0)
+       { perror ("error on extending the log file");
+         exit (EXIT_FAILURE);
+       }
+    __atomic_compare_exchange_n (&p_logInfo->size, &size, newSize, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+  }
+  if (mapLen < need)
+     { if ((mapAdd != NULL) && (munmap (mapAdd, mapLen) == -1))
+          { perror ("error on unmapping the log file");
+            exit (EXIT_FAILURE);
+          }
+       if ((mapAdd = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, mapFd, 0)) == MAP_FAILED)
+          { perror ("error on mapping the log file");
+            exit (EXIT_FAILURE);
+          }
+       mapLen = size;
+     }
+}
+
+/**
+ *  \brief Storing a line in the next free slot of the memory-mapped file (internal operation).
+ *
+ *  The slot is reserved by atomically advancing the shared offset, so no system call is issued unless the file has
+ *  to grow or the local mapping has to be extended.
+ *
+ *  \param fName name of the logging file
+ *  \param line pointer to the region where the line is stored
+ *  \param len line length
+ */
+
+static void putRecord (char *fName, char *line, unsigned int len)
+{
+  uint64_t off;                                                                                     /* slot location */
+
+  off = __atomic_fetch_add (&p_logInfo->used, len, __ATOMIC_RELAXED);
+  if (off + len > mapLen)
+     mapFile (fName, off + len);
+  memcpy (mapAdd + off, line, len);
+}
+
+/**
+ *  \brief Reaping the completions of the writes of the io_uring (internal operation).
+ *
+ *  \param wait number of completions to wait for (\c 0, if the caller is not to be blocked)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when a write has failed (the actual situation is reported in <tt>errno</tt>)
+ */
+
+static int ringReap (unsigned int wait)
+{
+  uint32_t tag[LOG_URING_DEPTH];                                                        /* slots whose write is over */
+  int n, k;                                                                          /* number of slots and counting */
+
+  if ((n = uringReap (&ring, wait, tag, LOG_URING_DEPTH)) == -1)
+     return -1;
+  for (k = 0; k < n; k++)
+    ringBusy[tag[k]] = false;
+  return 0;
+}
+
+/**
+ *  \brief Waiting for the writes of the io_uring still outstanding (internal operation).
+ *
+ *  It is called upon process termination as well, so a failure is reported, but does not stop the process.
+ */
+
+static void ringFlush (void)
+{
+  if ((ringPid != getpid ()) || !ringOk || !pthread_equal (pthread_self (), ringThr)) return;
+  if (uringSubmit (&ring) == -1)
+     { perror ("error on submitting writes to the log file");
+       return;
+     }
+  while (ring.inFlight != 0)
+    if (ringReap (ring.inFlight) == -1)
+       { perror ("error on writing to log file");
+         return;
+       }
+}
+
+/**
+ *  \brief Set up of the io_uring of the process, or of the fallback to buffered writes (internal operation).
+ *
+ *  A child which inherited the io_uring of its parent upon <tt>fork</tt> sets up one of its own, leaving the writes
+ *  of the parent to it.
+ *
+ *  \param fName name of the logging file
+ */
+
+static void ringOpen (char *fName)
+{
+  if (ringPid == getpid ()) return;
+  if (ringPid != 0)                                                             /* inherited from the parent process */
+     { if (ringOk) uringExit (&ring);
+       close (ringFd);
+       memset (ringBusy, 0, sizeof (ringBusy));
+       ringNext = 0;
+     }
+  if ((ringFd = open (fName, O_WRONLY)) == -1)
+     { perror ("error on opening the log file for io_uring writes");
+       exit (EXIT_FAILURE);
+     }
+  ringOk = (uringSetup (&ring, LOG_URING_DEPTH, ringFd, ringBuf, sizeof (ringBuf)) == 0);
+  if (!ringOk)
+     __atomic_fetch_add (&p_logInfo->nFallback, 1, __ATOMIC_RELAXED);
+  ringPid = getpid ();
+  ringThr = pthread_self ();
+  if (!ringAtExit)
+     { atexit (ringFlush);
+       ringAtExit = true;
+     }
+}
+
+/**
+ *  \brief Writing a line at its place in the file through the io_uring (internal operation).
+ *
+ *  The place is reserved by atomically advancing the shared offset. The line is copied into the next slot of the
+ *  registered buffer and its write is queued, the writes being submitted in batches of LOG_URING_BATCH; completions
+ *  are only waited for when the slot is still in use, which happens if the kernel lags a whole buffer behind.
+ *  The io_uring only accepts submissions from the thread which set it up, so the other threads of the coordinator,
+ *  which carry out the operations of the entity hosts, write their lines by <tt>pwrite</tt>.
+ *
+ *  \param fName name of the logging file
+ *  \param line pointer to the region where the line is stored
+ *  \param len line length
+ */
+
+static void putUring (char *fName, char *line, unsigned int len)
+{
+  uint64_t off;                                                                                     /* line location */
+  unsigned int slot;                                                                            /* slot to be filled */
+
+  ringOpen (fName);
+  off = __atomic_fetch_add (&p_logInfo->used, len, __ATOMIC_RELAXED);
+  if (!ringOk || !pthread_equal (pthread_self (), ringThr))       /* buffered fallback, or another thread's io_uring */
+     { if (pwrite (ringFd, line, len, (off_t) off) != (ssize_t) len)
+          { perror ("error on writing to log file");
+            exit (EXIT_FAILURE);
+          }
+       return;
+     }
+  slot = ringNext;
+  if (ringBusy[slot] && ((ringReap (0) == -1) || (ringBusy[slot] && (uringSubmit (&ring) == -1))))
+     { perror ("error on writing to log file");
+       exit (EXIT_FAILURE);
+     }
+  while (ringBusy[slot])
+    if (ringReap (1) == -1)
+       { perror ("error on writing to log file");
+         exit (EXIT_FAILURE);
+       }
+  memcpy (ringBuf[slot], line, len);
+  uringWrite (&ring, ringBuf[slot], len, off, slot);
+  ringBusy[slot] = true;
+  ringNext = (slot + 1) % LOG_URING_DEPTH;
+  if ((ring.pending >= LOG_URING_BATCH) && ((uringSubmit (&ring) == -1) || (ringReap (0) == -1)))
+     { perror ("error on writing to log file");
+       exit (EXIT_FAILURE);
+     }
+}
+
+/**
+ *  \brief Appending a region of bytes at the end of the file (internal operation).
+ *
+ *  The region is emitted with a single <tt>write</tt>, so it is never interleaved with the writings of other
+ *  processes.
+ *
+ *  \param fName name of the logging file
+ *  \param buf pointer to the region where the bytes are stored
+ *  \param len number of bytes
+ */
+
+static void appendToFile (char *fName, void *buf, size_t len)
+{
+  int fd;                                                                                         /* file descriptor */
+
+  if ((fd = open (fName, O_WRONLY | O_APPEND)) == -1)
+     { perror ("error on opening for appending of log file");
+       exit (EXIT_FAILURE);
+     }
+  if (write (fd, buf, len) != (ssize_t) len)
+     { perror ("error on writing to log file");
+       exit (EXIT_FAILURE);
+     }
+  if (close (fd) == -1)
+     { perror ("error on closing of log file");
+       exit (EXIT_FAILURE);
+     }
+}
+
+/**
+ *  \brief Compressing the staging area and appending it as a block at the end of the file (internal operation).
+ *
+ *  \param fName name of the logging file
+ */
+
+static void flushBlock (char *fName)
+{
+  static unsigned char out[2*sizeof (uint32_t)+LZ_BOUND(LOG_BLOCK)];                       /* block header + payload */
+  uint32_t rawLen,                                                                              /* uncompressed size */
+           compLen;                                                                               /* compressed size */
+  int n;                                                                                       /* compression result */
+
+  if (p_logInfo->nStaged == 0) return;
+  rawLen = p_logInfo->nStaged;
+  n = lzCompress ((unsigned char *) p_logInfo->staged, rawLen, out + 2*sizeof (uint32_t));
+  if ((n < 0) || ((uint32_t) n >= rawLen))                                  /* not worth it: store the data as it is */
+     { memcpy (out + 2*sizeof (uint32_t), p_logInfo->staged, rawLen);
+       compLen = rawLen;
+     }
+     else compLen = (uint32_t) n;
+  memcpy (out, &rawLen, sizeof (uint32_t));
+  memcpy (out + sizeof (uint32_t), &compLen, sizeof (uint32_t));
+  appendToFile (fName, out, 2*sizeof (uint32_t) + compLen);
+  p_logInfo->nStaged = 0;
+}
+
+/**
+ *  \brief Gathering a line in the staging area (internal operation).
+ *
+ *  If there is not enough room left, the staging area is flushed to the file first.
+ *
+ *  \param fName name of the logging file
+ *  \param line pointer to the region where the line is stored
+ *  \param len line length
+ */
+
+static void stageLine (char *fName, char *line, unsigned int len)
+{
+  if (p_logInfo->nStaged + len > LOG_BLOCK)
+     flushBlock (fName);
+  memcpy (p_logInfo->staged + p_logInfo->nStaged, line, len);
+  p_logInfo->nStaged += len;
+}
+
+/**
+ *  \brief Writing the header of the file into a buffer (internal operation).
+ *
+ *  \param buf pointer to the region where the header is to be stored (at least LINESZ bytes)
+ *
+ *  \return header length
+ */
+
+static unsigned int formatHeader (char *buf)
+{
+  char *p = buf;                                                                                 /* writing position */
+  unsigned int i;                                                                               /* counting variable */
+
+  /* title line + blank line */
+
+  p += sprintf (p, "%21cAveiro Handicraft SARL - Description of the internal state\n\n", ' ');
+
+  /* first line of field description */
+
+  if (NS == 1)
+     p += sprintf (p, "ENTREPRE ");
+     else for (i = 0; i < NS; i++)
+            p += sprintf (p, "ENTREP_%u ", i);
+  for (i = 0; i < N; i++)
+    p += sprintf (p, " CUST_%u ", i);
+  p += sprintf (p, " ");
+  for (i = 0; i < M; i++)
+    p += sprintf (p, " CRAFT_%u", i);
+  if (NS == 1)
+     p += sprintf (p, "%10cSHOP%8c", ' ', ' ');
+     else for (i = 0; i < NS; i++)
+            p += sprintf (p, "%8cSHOP_%u%8c", ' ', i, ' ');
+  p += sprintf (p, "%9cWORKSHOP\n", ' ');
+
+  /* second line of field description */
+
+  for (i = 0; i < NS; i++)
+    p += sprintf (p, "  Stat   ");
+  for (i = 0; i < N; i++)
+    p += sprintf (p, "Stat BP ");
+  p += sprintf (p, "  ");
+  for (i = 0; i < M; i++)
+    p += sprintf (p, "Stat PP ");
+  p += sprintf (p, " ");
+  for (i = 0; i < NS; i++)
+    p += sprintf (p, "Stat NCI NPI PCR PMR  ");
+  p += sprintf (p, "APMI NPI NSPM TAPM TNP\n");
+
+  return (unsigned int) (p - buf);
+}
+
+/** \brief codes of the states of the entrepreneur, as printed in the log file */
+static const char entrepCode[][4] = { "OPTS", "WFNT", "ATAC", "CLTS", "CBOP", "DLPM" };
+
+/** \brief codes of the states of the customers */
+static const char custCode[][4] = { "CODC", "CSDO", "AOID", "BYSG" };
+
+/** \brief codes of the states of the craftsmen */
+static const char craftCode[][4] = { "FTPM", "PANP", "SIFT", "CTTE" };
+
+/** \brief codes of the states of the shop */
+static const char shopCode[][4] = { "SPOP", "SDCL", "SPCL" };
+
+/**
+ *  \brief Copying the code of a state into a buffer (internal operation).
+ *
+ *  \param p writing position
+ *  \param code table of codes
+ *  \param n number of codes in the table
+ *  \param stat state
+ *
+ *  \return writing position past the code
+ */
+
+static char *putCode (char *p, const char (*code)[4], unsigned int n, unsigned int stat)
+{
+  memcpy (p, (stat < n) ? code[stat] : "****", 4);
+  return p + 4;
+}
+
+/**
+ *  \brief Conversion of an unsigned integer, right aligned in a field of a given width, into a buffer (internal
+ *         operation).
+ *
+ *  The field is widened, as it is by <tt>printf</tt>, if the number does not fit.
+ *
+ *  \param p writing position
+ *  \param val value
+ *  \param width width of the field
+ *
+ *  \return writing position past the field
+ */
+
+static char *putUns (char *p, unsigned int val, unsigned int width)
+{
+  char dig[10];                                                                          /* digits, in reverse order */
+  unsigned int n = 0;                                                                            /* number of digits */
+
+  do
+  { dig[n++] = (char) ('0' + val % 10);
+    val /= 10;
+  } while (val != 0);
+  for (; width > n; width--)
+    *p++ = ' ';
+  while (n > 0)
+    *p++ = dig[--n];
+  return p;
+}
+
+/**
+ *  \brief Writing the present full state as a single line into a buffer (internal operation).
+ *
+ *  The codes of the states are taken from tables and the numbers are converted directly, so the line is built with
+ *  no parsing of format strings.
+ *
+ *  \param buf pointer to the region where the line is to be stored (at least LINESZ bytes)
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *
+ *  \return line length
+ */
+
+static unsigned int formatState (char *buf, FULL_STAT *p_fSt)
+{
+  char *p = buf;                                                                                 /* writing position */
+  unsigned int i;                                                                               /* counting variable */
+
+  for (i = 0; i < NS; i++)
+  { memcpy (p, "  ", 2);
+    p = putCode (p + 2, entrepCode, 6, p_fSt->st.entrepStat[i]);
+    memcpy (p, "   ", 3);
+    p += 3;
+  }
+  for (i = 0; i < N; i++)
+  { p = putCode (p, custCode, 4, p_fSt->st.custStat[i].stat);
+    *p++ = ' ';
+    p = putUns (p, p_fSt->st.custStat[i].boughtPieces, 2);
+    *p++ = ' ';
+  }
+  memcpy (p, "  ", 2);
+  p += 2;
+  for (i = 0; i < M; i++)
+  { p = putCode (p, craftCode, 4, p_fSt->st.craftStat[i].stat);
+    *p++ = ' ';
+    p = putUns (p, p_fSt->st.craftStat[i].prodPieces, 2);
+    *p++ = ' ';
+  }
+  *p++ = ' ';
+  for (i = 0; i < NS; i++)
+  { p = putCode (p, shopCode, 3, p_fSt->shop[i].stat);
+    *p++ = ' ';
+    p = putUns (p, p_fSt->shop[i].nCustIn, 3);
+    *p++ = ' ';
+    p = putUns (p, p_fSt->shop[i].nProdIn, 3);
+    memcpy (p, "  T   T   ", 10);
+    if (!p_fSt->shop[i].prodTransfer) p[2] = 'F';
+    if (!p_fSt->shop[i].primeMatReq) p[6] = 'F';
+    p += 10;
+  }
+  p = putUns (p, p_fSt->workShop.nPMatIn, 3);
+  memcpy (p, "  ", 2);
+  p = putUns (p + 2, p_fSt->workShop.nProdIn, 3);
+  *p++ = ' ';
+  p = putUns (p, p_fSt->workShop.NSPMat, 3);
+  memcpy (p, "  ", 2);
+  p = putUns (p + 2, p_fSt->workShop.NTPMat, 3);
+  memcpy (p, "  ", 2);
+  p = putUns (p + 2, p_fSt->workShop.NTProd, 3);
+  *p++ = '\n';
+
+  return (unsigned int) (p - buf);
+}
+
+/**
+ *  \brief Bringing the parts of the state owned by the calling process up to date in the copy the lines are made of
+ *  (internal operation).
+ *
+ *  The calling process owns the parts of the state whose locks it holds and the state of the entity it is. The other
+ *  parts are kept as their owners last logged them, as they may be halfway through being changed, so every line shows
+ *  each part in a consistent state. The function must be called with the lock of the log held.
+ *
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *
+ *  \return pointer to the location where the state the line is to be made of is stored
+ */
+
+static FULL_STAT *publish (FULL_STAT *p_fSt)
+{
+  FULL_STAT *p_pub;                                                                    /* copy the lines are made of */
+  unsigned int held = crHeld (),                                                /* locks held by the calling process */
+               ent = crEntity (),                                                           /* entity identification */
+               s;                                                                               /* counting variable */
+
+  if (p_logInfo == NULL) return p_fSt;
+  p_pub = &(p_logInfo->pub);
+  if (held == CR_ALL)                                                                    /* the whole state is owned */
+     { *p_pub = *p_fSt;
+       return p_pub;
+     }
+  for (s = 0; s < NS; s++)
+    if ((held & CR_SHOP(s)) != 0)
+       p_pub->shop[s] = p_fSt->shop[s];
+  if ((held & CR_WORKSHOP) != 0)
+     p_pub->workShop = p_fSt->workShop;
+  if (ent == 0)
+     p_pub->st.entrepStat[0] = p_fSt->st.entrepStat[0];
+     else if (ent <= N)
+             p_pub->st.custStat[ent-1] = p_fSt->st.custStat[ent-1];
+             else if (ent <= N+M)
+                     p_pub->st.craftStat[ent-N-1] = p_fSt->st.craftStat[ent-N-1];
+                     else if (ent < N+M+NS)
+                             p_pub->st.entrepStat[ent-N-M] = p_fSt->st.entrepStat[ent-N-M];
+  return p_pub;
+}
 
 /**
  *  \brief File initialization.
@@ -40,7 +622,8 @@ void createLog (char nFic[])
   FILE *fic;                                                                                      /* file descriptor */
   char *dName = "log",                                                                      /* default log file name */
        *fName;                                                                                      /* log file name */
-  unsigned int i;                                                                               /* counting variable */
+  char header[LINESZ];                                                                                /* file header */
+  unsigned int len;                                                                                 /* header length */
 
   if ((nFic == NULL) || (strlen (nFic) == 0))
      fName = dName;
@@ -50,36 +633,37 @@ void createLog (char nFic[])
        exit (EXIT_FAILURE);
      }
 
-  /* title line + blank line */
-
-  fprintf (fic, "%21cAveiro Handicraft SARL - Description of the internal state\n\n", ' ');
-
-  /* first line of field description */
-
-  fprintf (fic, "ENTREPRE ");
-  for (i = 0; i < N; i++)
-    fprintf (fic, " CUST_%u ", i);
-  fprintf (fic, " ");
-  for (i = 0; i < M; i++)
-    fprintf (fic, " CRAFT_%u", i);
-  fprintf (fic, "%10cSHOP%8c", ' ', ' ');
-  fprintf (fic, "%9cWORKSHOP\n", ' ');
-
-  /* second line of field description */
+  /* title line + blank line + double line of field description */
 
-  fprintf (fic, "  Stat   ");
-  for (i = 0; i < N; i++)
-    fprintf (fic, "Stat BP ");
-  fprintf (fic, "  ");
-  for (i = 0; i < M; i++)
-    fprintf (fic, "Stat PP ");
-  fprintf (fic, " Stat NCI NPI PCR PMR  ");
-  fprintf (fic, "APMI NPI NSPM TAPM TNP\n");
+  len = formatHeader (header);
+  if (logMode () == LOG_LZ)
+     { if (fwrite (LOG_LZMAGIC, 1, LOG_LZMAGICSZ, fic) != LOG_LZMAGICSZ)
+          { perror ("error on writing to log file");
+            exit (EXIT_FAILURE);
+          }
+     }
+     else if (logMode () == LOG_TEXT)
+             fputs (header, fic);
 
   if (fclose (fic) == EOF)
      { perror ("error on closing of log file");
        exit (EXIT_FAILURE);
      }
+
+  switch (logMode ())
+  { case LOG_LZ:   p_logInfo->nStaged = 0;
+                   stageLine (fName, header, len);
+                   break;
+    case LOG_MMAP: p_logInfo->used = p_logInfo->size = 0;
+                   mapFile (fName, LOG_EXTENT);                                      /* preallocate the first extent */
+                   putRecord (fName, header, len);
+                   break;
+    case LOG_URING: p_logInfo->used = 0;
+                    p_logInfo->nFallback = 0;
+                    putUring (fName, header, len);
+                    ringFlush ();
+                    break;
+  }
 }
 
 /**
@@ -89,99 +673,101 @@ void createLog (char nFic[])
  *  name <em>log</em>.
  *
  *  The following layout is obeyed for the full state in a single line
- *    \li entrepreneur state
+ *    \li entrepreneurs state (s = 0,..., NS-1)
  *    \li customers state (n = 0,...,N-1)
  *    \li craftsmen state (m = 0,..., M-1)
- *    \li shop state
+ *    \li shops state (s = 0,..., NS-1)
  *    \li work shop state.
  *
+ *  In compressed mode, the line is gathered in the staging area instead. In memory-mapped mode, it is copied into
+ *  the next free slot of the mapped file. In io_uring mode, its write is queued on the io_uring of the process. When
+ *  tracing is on, the changes of state are recorded as well.
+ *  The line is written with the lock of the log held. With a single lock for the whole critical region, the calling
+ *  process owns the whole state and the line is a snapshot of it. With split locks, the parts of the state the calling
+ *  process does not own, as it does not hold their locks, are shown as they were last logged.
+ *
  *  \param nFic name of the logging file
  *  \param p_fSt pointer to the location where the full internal state of the problem is stored
  */
 
 void saveState (char nFic[], FULL_STAT *p_fSt)
 {
-  FILE *fic;                                                                                      /* file descriptor */
   char *dName = "log",                                                                      /* default log file name */
        *fName;                                                                                      /* log file name */
-  unsigned int i;                                                                               /* counting variable */
+  char line[LINESZ];                                                                       /* full state description */
+  unsigned int len;                                                                                   /* line length */
+  FULL_STAT *p_row;                                                                     /* state the line is made of */
 
   if ((nFic == NULL) || (strlen (nFic) == 0))
      fName = dName;
      else fName = nFic;
-  if ((fic = fopen (fName, "a")) == NULL)
-     { perror ("error on opening for appending of log file");
+
+  if (crLogLock () == -1)
+     { perror ("error on taking the lock of the log");
        exit (EXIT_FAILURE);
      }
+  p_row = publish (p_fSt);
+
+  traceState (p_row);                                                           /* timestamped changes, when tracing */
 
   /* present full state description */
 
-  switch (p_fSt->st.entrepStat)
-  { case OPENING_THE_SHOP:               fprintf (fic, "  OPTS   ");
-                                         break;
-    case WAITING_FOR_NEXT_TASK:          fprintf (fic, "  WFNT   ");
-                                         break;
-    case ATTENDING_A_CUSTOMER:           fprintf (fic, "  ATAC   ");
-                                         break;
-    case CLOSING_THE_SHOP:               fprintf (fic, "  CLTS   ");
-                                         break;
-    case COLLECTING_A_BATCH_OF_PRODUCTS: fprintf (fic, "  CBOP   ");
-                                         break;
-    case DELIVERING_PRIME_MATERIALS:     fprintf (fic, "  DLPM   ");
-                                         break;
-    default:                             fprintf (fic, "  ****   ");
-  }
-  for (i = 0; i < N; i++)
-  { switch (p_fSt->st.custStat[i].stat)
-    { case CARRYING_OUT_DAILY_CHORES:   fprintf (fic, "CODC ");
-                                        break;
-      case CHECKING_SHOP_DOOR_OPEN:     fprintf (fic, "CSDO ");
-                                        break;
-      case APPRAISING_OFFER_IN_DISPLAY: fprintf (fic, "AOID ");
-                                        break;
-      case BUYING_SOME_GOODS:           fprintf (fic, "BYSG ");
-                                        break;
-      default:                          fprintf (fic, "**** ");
-    }
-    fprintf (fic, "%2u ", p_fSt->st.custStat[i].boughtPieces);
-  }
-  fprintf (fic, "  ");
-  for (i = 0; i < M; i++)
-  { switch (p_fSt->st.craftStat[i].stat)
-    { case FETCHING_PRIME_MATERIALS:    fprintf (fic, "FTPM ");
-                                        break;
-      case PRODUCING_A_NEW_PIECE:       fprintf (fic, "PANP ");
-                                        break;
-      case STORING_IT_FOR_TRANSFER:     fprintf (fic, "SIFT ");
-                                        break;
-      case CONTACTING_THE_ENTREPRENEUR: fprintf (fic, "CTTE ");
-                                        break;
-      default:                          fprintf (fic, "**** ");
-    }
-    fprintf (fic, "%2u ", p_fSt->st.craftStat[i].prodPieces);
-  }
-  fprintf (fic, " ");
-  switch (p_fSt->shop.stat)
-  { case SOPEN:    fprintf (fic, "SPOP ");
+  len = formatState (line, p_row);
+  switch (logMode ())
+  { case LOG_LZ:   stageLine (fName, line, len);
                    break;
-    case SDCLOSED: fprintf (fic, "SDCL ");
+    case LOG_MMAP: putRecord (fName, line, len);
                    break;
-    case SCLOSED:  fprintf (fic, "SPCL ");
-                   break;
-    default:       fprintf (fic, "**** ");
+    case LOG_URING: putUring (fName, line, len);
+                    break;
+    default:       appendToFile (fName, line, len);
   }
-  fprintf (fic, "%3u %3u ", p_fSt->shop.nCustIn, p_fSt->shop.nProdIn);
-  if (p_fSt->shop.prodTransfer)
-     fprintf (fic, " %c  ", 'T');
-     else fprintf (fic, " %c  ", 'F');
-  if (p_fSt->shop.primeMatReq)
-     fprintf (fic, " %c   ", 'T');
-     else fprintf (fic, " %c   ", 'F');
-  fprintf (fic, "%3u  %3u %3u  %3u  %3u\n", p_fSt->workShop.nPMatIn, p_fSt->workShop.nProdIn,
-                                            p_fSt->workShop.NSPMat, p_fSt->workShop.NTPMat, p_fSt->workShop.NTProd);
-
-  if (fclose (fic) == EOF)
-     { perror ("error on closing of log file");
+  if (crLogUnlock () == -1)
+     { perror ("error on releasing the lock of the log");
        exit (EXIT_FAILURE);
      }
 }
+
+/**
+ *  \brief File completion.
+ *
+ *  Any lines still gathered in the staging area are written to the file. A memory-mapped file is unmapped and
+ *  truncated to the length actually used. In io_uring mode, the writes of the calling process are waited for (the
+ *  other processes wait for theirs upon termination).
+ *  The function must be called once all the intervening entities have terminated.
+ *
+ *  \param nFic name of the logging file
+ */
+
+void closeLog (char nFic[])
+{
+  char *dName = "log",                                                                      /* default log file name */
+       *fName;                                                                                      /* log file name */
+
+  if ((nFic == NULL) || (strlen (nFic) == 0))
+     fName = dName;
+     else fName = nFic;
+  switch (logMode ())
+  { case LOG_LZ:   flushBlock (fName);
+                   break;
+    case LOG_MMAP: if ((mapAdd != NULL) && (munmap (mapAdd, mapLen) == -1))
+                      { perror ("error on unmapping the log file");
+                        exit (EXIT_FAILURE);
+                      }
+                   mapAdd = NULL;
+                   mapLen = 0;
+                   if ((mapFd == -1) && ((mapFd = open (fName, O_RDWR)) == -1))
+                      { perror ("error on opening the log file for truncation");
+                        exit (EXIT_FAILURE);
+                      }
+                   if (ftruncate (mapFd, (off_t) p_logInfo->used) == -1)
+                      { perror ("error on truncating the log file");
+                        exit (EXIT_FAILURE);
+                      }
+                   close (mapFd);
+                   mapFd = -1;
+                   break;
+    case LOG_URING: ringFlush ();
+                    break;
+  }
+}
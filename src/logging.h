@@ -8,8 +8,29 @@
  *  \brief Logging the internal state of the problem into a file.
  *
  *  Defined operations:
+ *     \li binding of the logging information shared by all processes
  *     \li file initialization
- *     \li writing the present state as a single line at the end of the file.
+ *     \li writing the present state as a single line at the end of the file
+ *     \li file completion.
+ *
+ *  Four logging modes are supported:
+ *     \li <tt>LOG_TEXT</tt> - each line is appended to the file as plain text
+ *     \li <tt>LOG_LZ</tt> - lines are gathered in a staging area kept in shared memory and, whenever it fills up,
+ *         its contents are compressed as an independent block and appended to the file; the <em>logcat</em> tool
+ *         restores the plain text
+ *     \li <tt>LOG_MMAP</tt> - the file is preallocated and mapped on the address space of every process; each line is
+ *         copied into the next free slot, which is reserved by atomically advancing an offset kept in shared memory,
+ *         so no system call is needed per line; the file grows by large extents and is truncated to the length
+ *         actually used upon completion
+ *     \li <tt>LOG_URING</tt> - each line is given its place in the file by atomically advancing the same offset and
+ *         is written there through an io_uring of the process, from a registered buffer to a registered file; the
+ *         writes are submitted in batches and reaped when their buffer slots are needed again, so no line waits for
+ *         the file to be written while the critical region is held; a process which fails to set up its ring (no
+ *         io_uring support, or a kernel older than 6.1) falls back to a buffered <tt>pwrite</tt> per line.
+ *
+ *  A compressed log file starts with the magic string <tt>LOG_LZMAGIC</tt> and is followed by a sequence of blocks,
+ *  each one consisting of its uncompressed size and its compressed size, both stored as 32-bit unsigned integers,
+ *  followed by the compressed data. When both sizes are equal, the data is stored uncompressed.
  *
  *  \author António Rui Borges - October 2014
  */
@@ -17,8 +38,75 @@
 #ifndef LOGGING_H_
 #define LOGGING_H_
 
+#include <stdint.h>
+
 #include "probDataStruct.h"
 
+/** \brief plain text logging mode */
+#define  LOG_TEXT        0
+/** \brief compressed logging mode */
+#define  LOG_LZ          1
+/** \brief memory-mapped logging mode */
+#define  LOG_MMAP        2
+/** \brief io_uring logging mode */
+#define  LOG_URING       3
+
+/** \brief size of the staging area where lines are gathered before compression (in bytes) */
+#define  LOG_BLOCK       65536
+
+/** \brief magic string at the beginning of a compressed log file */
+#define  LOG_LZMAGIC     "AHLZLOG1"
+
+/** \brief size of the magic string at the beginning of a compressed log file (in bytes) */
+#define  LOG_LZMAGICSZ   8
+
+/**
+ *  \brief Definition of <em>logging information</em> data type.
+ *
+ *  It is kept in shared memory, so that all intervening entities append their lines to the same staging area or
+ *  reserve their slots in the same memory-mapped file. The staging area and the copy of the state the lines are made
+ *  of must only be accessed with the lock of the log held.
+ */
+typedef struct
+        { /** \brief logging mode: either LOG_TEXT, or LOG_LZ, or LOG_MMAP, or LOG_URING */
+          unsigned int mode;
+          /** \brief number of bytes of the file already reserved (memory-mapped and io_uring modes) */
+          uint64_t used;
+          /** \brief present size of the file (memory-mapped mode) */
+          uint64_t size;
+          /** \brief number of processes which fell back to buffered writes (io_uring mode) */
+          unsigned int nFallback;
+          /** \brief number of bytes presently gathered in the staging area */
+          unsigned int nStaged;
+          /** \brief staging area */
+          char staged[LOG_BLOCK];
+          /** \brief copy of the state the lines are made of, each part as its owner last logged it */
+          FULL_STAT pub;
+        } LOGINFO;
+
+/**
+ *  \brief Initialization of the logging information.
+ *
+ *  The function must be called by the process that creates the shared memory region before the log file is created.
+ *  The calling process is bound to the logging information.
+ *
+ *  \param p_log pointer to the location where the logging information is stored
+ *  \param mode logging mode: either LOG_TEXT, or LOG_LZ, or LOG_MMAP, or LOG_URING
+ */
+
+extern void logInit (LOGINFO *p_log, unsigned int mode);
+
+/**
+ *  \brief Binding to the logging information.
+ *
+ *  The function must be called by every intervening entity upon mapping the shared memory region on its address space.
+ *  If it is not called, lines are appended as plain text.
+ *
+ *  \param p_log pointer to the location where the logging information is stored
+ */
+
+extern void logBind (LOGINFO *p_log);
+
 /**
  *  \brief File initialization.
  *
@@ -42,16 +130,33 @@ extern void createLog (char nFic[]);
  *  name <em>log</em>.
  *
  *  The following layout is obeyed for the full state in a single line
- *    \li entrepreneur state
+ *    \li entrepreneurs state (s = 0,..., NS-1)
  *    \li customers state (n = 0,...,N-1)
  *    \li craftsmen state (m = 0,..., M-1)
- *    \li shop state
+ *    \li shops state (s = 0,..., NS-1)
  *    \li work shop state.
  *
+ *  The line is written with the lock of the log held. With a single lock for the whole critical region, the calling
+ *  process owns the whole state and the line is a snapshot of it. With split locks, the parts of the state the calling
+ *  process does not own, as it does not hold their locks, are shown as they were last logged.
+ *
  *  \param nFic name of the logging file
  *  \param p_fSt pointer to the location where the full internal state of the problem is stored
  */
 
 extern void saveState (char nFic[], FULL_STAT *p_fSt);
 
+/**
+ *  \brief File completion.
+ *
+ *  Any lines still gathered in the staging area are written to the file. A memory-mapped file is unmapped and
+ *  truncated to the length actually used. In io_uring mode, the writes of the calling process are waited for (the
+ *  other processes wait for theirs upon termination).
+ *  The function must be called once all the intervening entities have terminated.
+ *
+ *  \param nFic name of the logging file
+ */
+
+extern void closeLog (char nFic[]);
+
 #endif /* LOGGING_H_ */
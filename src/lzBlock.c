@@ -0,0 +1,207 @@
+/**
+ *  \file lzBlock.c (implementation file)
+ *
+ *  \brief Block compression.
+ *
+ *  A small LZ77-style compressor operating on independent blocks of up to <tt>LZ_MAXBLOCK</tt> bytes.
+ *  Each compressed block is self-contained: no dictionary is carried over from one block to the next, so any block
+ *  may be decompressed on its own.
+ *
+ *  Operations defined:
+ *     \li compression of a block
+ *     \li decompression of a block.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "lzBlock.h"
+
+/** \brief number of bits of the hash used to index the match finder table */
+#define  HASHBITS        12
+
+/** \brief number of literals which are always left at the end of the block */
+#define  LASTLITERALS    5
+
+/**
+ *  \brief Reading of four bytes as an unsigned integer (internal operation).
+ *
+ *  \param p pointer to the location where the bytes are stored
+ *
+ *  \return the value read
+ */
+
+static uint32_t read32 (const unsigned char *p)
+{
+  uint32_t val;                                                                                    /* value read */
+
+  memcpy (&val, p, sizeof (val));
+  return val;
+}
+
+/**
+ *  \brief Hashing of four bytes (internal operation).
+ *
+ *  \param val four bytes read as an unsigned integer
+ *
+ *  \return index into the match finder table
+ */
+
+static unsigned int hash4 (uint32_t val)
+{
+  return (unsigned int) ((val * 2654435761U) >> (32 - HASHBITS));
+}
+
+/**
+ *  \brief Storing of a length extension (internal operation).
+ *
+ *  \param p pointer to the location where the extension is to be stored
+ *  \param len remaining length (already reduced by 15)
+ *
+ *  \return pointer to the location next to the extension
+ */
+
+static unsigned char *putLength (unsigned char *p, unsigned int len)
+{
+  while (len >= 255)
+  { *p++ = 255;
+    len -= 255;
+  }
+  *p++ = (unsigned char) len;
+  return p;
+}
+
+/**
+ *  \brief Storing of a group (internal operation).
+ *
+ *  \param p pointer to the location where the group is to be stored
+ *  \param lit pointer to the location where the literals are stored
+ *  \param nLit number of literals
+ *  \param off match offset (ignored if <tt>mLen</tt> is zero)
+ *  \param mLen match length (zero for the last group)
+ *
+ *  \return pointer to the location next to the group
+ */
+
+static unsigned char *putGroup (unsigned char *p, const unsigned char *lit, unsigned int nLit,
+                                unsigned int off, unsigned int mLen)
+{
+  unsigned char *token = p++;                                                               /* token location */
+  unsigned int ml = (mLen == 0) ? 0 : mLen - LZ_MINMATCH;                                /* coded match length */
+
+  *token = (unsigned char) (((nLit < 15) ? nLit : 15) << 4);
+  if (nLit >= 15) p = putLength (p, nLit - 15);
+  memcpy (p, lit, nLit);
+  p += nLit;
+  if (mLen != 0)
+     { *p++ = (unsigned char) (off & 0xFF);
+       *p++ = (unsigned char) (off >> 8);
+       *token |= (unsigned char) ((ml < 15) ? ml : 15);
+       if (ml >= 15) p = putLength (p, ml - 15);
+     }
+  return p;
+}
+
+/**
+ *  \brief Compression of a block.
+ *
+ *  The function fails if <tt>len</tt> is greater than <tt>LZ_MAXBLOCK</tt>.
+ *  The destination region must be able to hold at least <tt>LZ_BOUND(len)</tt> bytes.
+ *
+ *  \param src pointer to the region where the block is stored
+ *  \param len block size (in bytes)
+ *  \param dst pointer to the region where the compressed block is to be stored
+ *
+ *  \return size of the compressed block (in bytes), upon success
+ *  \return -\c 1, when an error occurs
+ */
+
+int lzCompress (const unsigned char *src, unsigned int len, unsigned char *dst)
+{
+  unsigned int table[1 << HASHBITS];                         /* last position where each hash was seen (plus one) */
+  unsigned int ip = 0,                                                                       /* scanning position */
+               anchor = 0,                                                          /* start of pending literals */
+               ref, mLen, h;                                                                /* match description */
+  unsigned char *op = dst;                                                                    /* output position */
+
+  if ((src == NULL) || (dst == NULL) || (len > LZ_MAXBLOCK)) return -1;
+  memset (table, 0, sizeof (table));
+
+  while (ip + LZ_MINMATCH + LASTLITERALS <= len)
+  { h = hash4 (read32 (src + ip));
+    ref = table[h];
+    table[h] = ip + 1;
+    if ((ref == 0) || (read32 (src + ref - 1) != read32 (src + ip)))
+       { ip += 1;
+         continue;
+       }
+    ref -= 1;
+    mLen = LZ_MINMATCH;
+    while ((ip + mLen + LASTLITERALS < len) && (src[ref+mLen] == src[ip+mLen]))
+      mLen += 1;
+    op = putGroup (op, src + anchor, ip - anchor, ip - ref, mLen);
+    ip += mLen;
+    anchor = ip;
+  }
+  op = putGroup (op, src + anchor, len - anchor, 0, 0);                                          /* last literals */
+
+  return (int) (op - dst);
+}
+
+/**
+ *  \brief Decompression of a block.
+ *
+ *  The function fails if the compressed block is malformed or if its uncompressed form does not fit in
+ *  <tt>cap</tt> bytes.
+ *
+ *  \param src pointer to the region where the compressed block is stored
+ *  \param len compressed block size (in bytes)
+ *  \param dst pointer to the region where the uncompressed block is to be stored
+ *  \param cap size of the destination region (in bytes)
+ *
+ *  \return size of the uncompressed block (in bytes), upon success
+ *  \return -\c 1, when an error occurs
+ */
+
+int lzDecompress (const unsigned char *src, unsigned int len, unsigned char *dst, unsigned int cap)
+{
+  const unsigned char *ip = src,                                                               /* input position */
+                      *iend = src + len;                                                         /* end of input */
+  unsigned int op = 0,                                                                        /* output position */
+               nLit, mLen, off, i;                                                          /* group description */
+  unsigned char token;                                                                            /* group token */
+
+  if ((src == NULL) || (dst == NULL)) return -1;
+
+  while (ip < iend)
+  { token = *ip++;
+    nLit = token >> 4;
+    if (nLit == 15)
+       do
+       { if (ip >= iend) return -1;
+         nLit += *ip;
+       } while (*ip++ == 255);
+    if ((nLit > (unsigned int) (iend - ip)) || (nLit > cap - op)) return -1;
+    memcpy (dst + op, ip, nLit);
+    ip += nLit;
+    op += nLit;
+    if (ip == iend) break;                                                                     /* last group */
+
+    if (iend - ip < 2) return -1;
+    off = ip[0] | ((unsigned int) ip[1] << 8);
+    ip += 2;
+    mLen = (token & 0x0F) + LZ_MINMATCH;
+    if ((token & 0x0F) == 15)
+       do
+       { if (ip >= iend) return -1;
+         mLen += *ip;
+       } while (*ip++ == 255);
+    if ((off == 0) || (off > op) || (mLen > cap - op)) return -1;
+    for (i = 0; i < mLen; i++)                                      /* byte by byte, since matches may overlap */
+      dst[op+i] = dst[op-off+i];
+    op += mLen;
+  }
+
+  return (int) op;
+}
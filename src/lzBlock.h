@@ -0,0 +1,65 @@
+/**
+ *  \file lzBlock.h (interface file)
+ *
+ *  \brief Block compression.
+ *
+ *  A small LZ77-style compressor operating on independent blocks of up to <tt>LZ_MAXBLOCK</tt> bytes.
+ *  Each compressed block is self-contained: no dictionary is carried over from one block to the next, so any block
+ *  may be decompressed on its own.
+ *
+ *  Operations defined:
+ *     \li compression of a block
+ *     \li decompression of a block.
+ *
+ *  Compressed format: a sequence of <em>token - literals - offset - match</em> groups, where the token holds the
+ *  number of literals in its upper nibble and the match length minus <tt>LZ_MINMATCH</tt> in its lower nibble
+ *  (both extended by additional bytes of value 255 when equal to 15) and the offset is a 16-bit little endian value.
+ *  The last group carries only literals.
+ */
+
+#ifndef LZBLOCK_H_
+#define LZBLOCK_H_
+
+/** \brief maximum size of an uncompressed block (in bytes) */
+#define  LZ_MAXBLOCK     65536
+
+/** \brief minimum length of a match */
+#define  LZ_MINMATCH     4
+
+/** \brief worst case size of the compressed form of a block of <tt>n</tt> bytes */
+#define  LZ_BOUND(n)     ((n) + (n) / 255 + 16)
+
+/**
+ *  \brief Compression of a block.
+ *
+ *  The function fails if <tt>len</tt> is greater than <tt>LZ_MAXBLOCK</tt>.
+ *  The destination region must be able to hold at least <tt>LZ_BOUND(len)</tt> bytes.
+ *
+ *  \param src pointer to the region where the block is stored
+ *  \param len block size (in bytes)
+ *  \param dst pointer to the region where the compressed block is to be stored
+ *
+ *  \return size of the compressed block (in bytes), upon success
+ *  \return -\c 1, when an error occurs
+ */
+
+extern int lzCompress (const unsigned char *src, unsigned int len, unsigned char *dst);
+
+/**
+ *  \brief Decompression of a block.
+ *
+ *  The function fails if the compressed block is malformed or if its uncompressed form does not fit in
+ *  <tt>cap</tt> bytes.
+ *
+ *  \param src pointer to the region where the compressed block is stored
+ *  \param len compressed block size (in bytes)
+ *  \param dst pointer to the region where the uncompressed block is to be stored
+ *  \param cap size of the destination region (in bytes)
+ *
+ *  \return size of the uncompressed block (in bytes), upon success
+ *  \return -\c 1, when an error occurs
+ */
+
+extern int lzDecompress (const unsigned char *src, unsigned int len, unsigned char *dst, unsigned int cap);
+
+#endif /* LZBLOCK_H_ */
@@ -0,0 +1,146 @@
+/**
+ *  \file mailbox.c (implementation file)
+ *
+ *  Problem name: Aveiro Handicraft SARL
+ *
+ *  Concept: Pedro Mariano
+ *
+ *  \brief Bounded lock-free mailboxes, for actors run by different processes.
+ *
+ *  The slot at position <tt>pos</tt> is free to be filled when its sequence number is <tt>pos</tt> and holds a
+ *  message when it is <tt>pos + 1</tt>; taking the message out sets it to <tt>pos + MBOX_SIZE</tt>, the position the
+ *  slot is filled at next time round.
+ *
+ *  Defined operations:
+ *     \li initialization of a mailbox
+ *     \li posting a message
+ *     \li taking out a batch of messages.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "mailbox.h"
+#include "histogram.h"
+
+/**
+ *  \brief Initialization of a mailbox.
+ *
+ *  The mailbox will be empty after it.
+ *
+ *  \param p_mb pointer to the location where the mailbox is stored
+ */
+
+void mboxInit (MAILBOX *p_mb)
+{
+  unsigned int i;                                                                               /* counting variable */
+
+  p_mb->tail = p_mb->head = 0;
+  p_mb->event = p_mb->sleeping = 0;
+  for (i = 0; i < MBOX_SIZE; i++)
+    p_mb->seq[i] = i;
+}
+
+/**
+ *  \brief Posting a message.
+ *
+ *  The message is stamped with the present instant. The caller yields the processor while the mailbox is full and
+ *  the owner is waken up, if it is blocked.
+ *
+ *  \param p_mb pointer to the location where the mailbox is stored
+ *  \param from sender identification
+ *  \param kind kind of message
+ *  \param val argument or returned value
+ */
+
+void mboxPost (MAILBOX *p_mb, unsigned int from, unsigned int kind, uint32_t val)
+{
+  uint32_t pos, seq;                                                            /* position claimed and its sequence */
+  int32_t dif;                                                                  /* sequence ahead of the position by */
+  MESSAGE *p_msg;                                                                               /* slot being filled */
+
+  pos = __atomic_load_n (&p_mb->tail, __ATOMIC_RELAXED);
+  for (;;)
+  { seq = __atomic_load_n (&p_mb->seq[pos % MBOX_SIZE], __ATOMIC_ACQUIRE);
+    dif = (int32_t) (seq - pos);
+    if (dif == 0)
+       { if (__atomic_compare_exchange_n (&p_mb->tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;                                                                     /* otherwise, pos is reloaded */
+       }
+       else if (dif < 0)
+               { sched_yield ();                                                                     /* mailbox full */
+                 pos = __atomic_load_n (&p_mb->tail, __ATOMIC_RELAXED);
+               }
+               else pos = __atomic_load_n (&p_mb->tail, __ATOMIC_RELAXED);              /* claimed by another sender */
+  }
+  p_msg = &p_mb->slot[pos % MBOX_SIZE];
+  p_msg->from = (uint16_t) from;
+  p_msg->kind = (uint16_t) kind;
+  p_msg->val = val;
+  p_msg->stamp = histClock ();
+  __atomic_store_n (&p_mb->seq[pos % MBOX_SIZE], pos + 1, __ATOMIC_RELEASE);
+
+  /* the owner announces it is about to block before looking at the mailbox a last time */
+
+  __atomic_thread_fence (__ATOMIC_SEQ_CST);
+  if (__atomic_load_n (&p_mb->sleeping, __ATOMIC_RELAXED))
+     { __atomic_fetch_add (&p_mb->event, 1, __ATOMIC_RELEASE);
+       syscall (SYS_futex, &p_mb->event, FUTEX_WAKE, 1, NULL, NULL, 0);
+     }
+}
+
+/**
+ *  \brief Taking out the messages present in a mailbox (internal operation).
+ *
+ *  \param p_mb pointer to the location where the mailbox is stored
+ *  \param msg pointer to the location where the messages are to be stored
+ *  \param max maximum number of messages to be taken out
+ *
+ *  \return number of messages taken out
+ */
+
+static unsigned int drain (MAILBOX *p_mb, MESSAGE *msg, unsigned int max)
+{
+  unsigned int n;                                                                    /* number of messages taken out */
+  uint32_t pos = p_mb->head;                                                             /* position being taken out */
+
+  for (n = 0; n < max; n++, pos++)
+  { if ((int32_t) (__atomic_load_n (&p_mb->seq[pos % MBOX_SIZE], __ATOMIC_ACQUIRE) - (pos + 1)) < 0) break;
+    msg[n] = p_mb->slot[pos % MBOX_SIZE];
+    __atomic_store_n (&p_mb->seq[pos % MBOX_SIZE], pos + MBOX_SIZE, __ATOMIC_RELEASE);
+  }
+  p_mb->head = pos;
+  return n;
+}
+
+/**
+ *  \brief Taking out a batch of messages (owner only).
+ *
+ *  \param p_mb pointer to the location where the mailbox is stored
+ *  \param msg pointer to the location where the messages are to be stored
+ *  \param max maximum number of messages to be taken out
+ *  \param wait \c true, if the caller is to be blocked while the mailbox is empty
+ *
+ *  \return number of messages taken out (\c 0, only if the caller is not to be blocked)
+ */
+
+unsigned int mboxTake (MAILBOX *p_mb, MESSAGE *msg, unsigned int max, bool wait)
+{
+  unsigned int n;                                                                    /* number of messages taken out */
+  uint32_t ev;                                                                           /* futex word, as last seen */
+
+  for (;;)
+  { if (((n = drain (p_mb, msg, max)) != 0) || !wait) return n;
+    ev = __atomic_load_n (&p_mb->event, __ATOMIC_ACQUIRE);
+    __atomic_store_n (&p_mb->sleeping, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+    if ((n = drain (p_mb, msg, max)) == 0)                                            /* a last look before blocking */
+       syscall (SYS_futex, &p_mb->event, FUTEX_WAIT, ev, NULL, NULL, 0);
+    __atomic_store_n (&p_mb->sleeping, 0, __ATOMIC_RELAXED);
+    if (n != 0) return n;
+  }
+}
@@ -0,0 +1,103 @@
+/**
+ *  \file mailbox.h (interface file)
+ *
+ *  Problem name: Aveiro Handicraft SARL
+ *
+ *  Concept: Pedro Mariano
+ *
+ *  \brief Bounded lock-free mailboxes, for actors run by different processes.
+ *
+ *  A mailbox is a ring of slots, each one tagged with a sequence number which tells whether it is free to be filled
+ *  or holds a message to be taken out. Any number of processes may post messages at the same time, claiming a slot
+ *  by a compare-and-swap on the position of the tail, but only its owner takes them out, so no lock is ever held.
+ *  Messages posted by the same process are taken out in the order they were posted.
+ *
+ *  The owner blocks on a futex when its mailbox is empty; a sender only enters the kernel to wake it up when it has
+ *  announced it is about to block. A sender finding the mailbox full yields the processor until a slot is freed.
+ *  Mailboxes are plain data and may be kept in a shared region mapped by all the processes involved.
+ *
+ *  Defined operations:
+ *     \li initialization of a mailbox
+ *     \li posting a message
+ *     \li taking out a batch of messages.
+ */
+
+#ifndef MAILBOX_H_
+#define MAILBOX_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** \brief number of slots of a mailbox (a power of two) */
+#define  MBOX_SIZE       64
+
+/**
+ *  \brief Definition of <em>message</em> data type.
+ */
+
+typedef struct
+        { /** \brief sender identification */
+          uint16_t from;
+          /** \brief kind of message */
+          uint16_t kind;
+          /** \brief argument or returned value */
+          uint32_t val;
+          /** \brief instant the message was posted (in ns) */
+          uint64_t stamp;
+        } MESSAGE;
+
+/**
+ *  \brief Definition of <em>mailbox</em> data type.
+ */
+
+typedef struct
+        { /** \brief position of the next slot to be filled (shared by the senders) */
+          uint32_t tail __attribute__ ((aligned (64)));
+          /** \brief position of the next slot to be taken out (owner only) */
+          uint32_t head __attribute__ ((aligned (64)));
+          /** \brief futex word the owner blocks on, and flag of the owner being about to block */
+          uint32_t event, sleeping;
+          /** \brief sequence numbers of the slots */
+          uint32_t seq[MBOX_SIZE] __attribute__ ((aligned (64)));
+          /** \brief messages held */
+          MESSAGE slot[MBOX_SIZE];
+        } MAILBOX;
+
+/**
+ *  \brief Initialization of a mailbox.
+ *
+ *  The mailbox will be empty after it.
+ *
+ *  \param p_mb pointer to the location where the mailbox is stored
+ */
+
+extern void mboxInit (MAILBOX *p_mb);
+
+/**
+ *  \brief Posting a message.
+ *
+ *  The message is stamped with the present instant. The caller yields the processor while the mailbox is full and
+ *  the owner is waken up, if it is blocked.
+ *
+ *  \param p_mb pointer to the location where the mailbox is stored
+ *  \param from sender identification
+ *  \param kind kind of message
+ *  \param val argument or returned value
+ */
+
+extern void mboxPost (MAILBOX *p_mb, unsigned int from, unsigned int kind, uint32_t val);
+
+/**
+ *  \brief Taking out a batch of messages (owner only).
+ *
+ *  \param p_mb pointer to the location where the mailbox is stored
+ *  \param msg pointer to the location where the messages are to be stored
+ *  \param max maximum number of messages to be taken out
+ *  \param wait \c true, if the caller is to be blocked while the mailbox is empty
+ *
+ *  \return number of messages taken out (\c 0, only if the caller is not to be blocked)
+ */
+
+extern unsigned int mboxTake (MAILBOX *p_mb, MESSAGE *msg, unsigned int max, bool wait);
+
+#endif /* MAILBOX_H_ */
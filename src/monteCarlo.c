@@ -0,0 +1,857 @@
+/**
+ *  \file monteCarlo.c (implementation file)
+ *
+ *  \brief Problem name: Aveiro Handicraft SARL.
+ *
+ *  \brief Concept: Pedro Mariano.
+ *
+ *  Monte Carlo engine: many independent replicas of the simulation, run side by side in a single process.
+ *
+ *  The model is the one carried out by the intervening entities, operation by operation, in its default settings
+ *  (one piece per visit to the store, no door gate and fixed priority scheduling): each operation within the
+ *  critical region is one step, and each step which the entities log is one row of the log file. Time is virtual:
+ *  every step costs a random amount of time around the given step cost, to which the random delays of the entities
+ *  (living normal life, shaping it up, servicing a customer) are added, and the entity which is due first is the one
+ *  to take the next step. Blocking on a semaphore is modelled by the entity not being due until it is waken up.
+ *
+ *  The state of all the replicas is kept in structure-of-arrays form, one array per variable, indexed by replica,
+ *  and every replica takes a step in each round. The random draws and the choice of the entity due first are plain
+ *  loops over the replicas, with no branches, so they are vectorized by the compiler; only the state transitions,
+ *  which differ from replica to replica, are taken one replica at a time.
+ *
+ *  The cost of a step stands for the overhead of the process based simulation (entering the critical region and
+ *  saving the state), which is large compared to the delays of the entities. Its default is the value picked by
+ *  <tt>run/mccheck.sh</tt>, which calibrates it on a set of runs of the launcher and then checks the figures of the
+ *  engine against a separate set of runs, within a stated tolerance.
+ *
+ *  The file is built with <tt>MCFLAGS</tt> (<tt>-O3</tt> by default). <tt>make MCFLAGS="-O3 -march=native"</tt>
+ *  lets the compiler use the widest vector instructions of the build machine, but the binary may then not run on
+ *  other machines.
+ *
+ *  Upon completion, the distribution over the replicas of the completion time, the throughput and the figures
+ *  reported by the <em>loganalyze</em> tool is printed, so it may be compared with the analysis of the logs of the
+ *  process based simulation. Replicas which stall, with some entity still alive and none of them able to proceed,
+ *  are counted apart.
+ *
+ *  Upon execution, the following options are accepted:
+ *    \li <tt>-r replicas</tt> - number of replicas (by default, 4096)
+ *    \li <tt>-s seed</tt> - seed of the random generators (by default, 1)
+ *    \li <tt>-c us</tt> - mean cost of a step within the critical region (in us; by default, 6)
+ *    \li <tt>-m steps</tt> - maximum number of steps of each replica (by default, 1000000).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+
+/** \brief number of intervening entities (0 - entrepreneur, 1 to N - customers, N+1 to N+M - craftsmen) */
+#define  NENT            (N+M+1)
+
+/** \brief semaphore proceed */
+#define  S_PROCEED       0
+/** \brief semaphore waitForMaterials */
+#define  S_WAITFORMAT    1
+/** \brief base of the waitForService semaphore array */
+#define  S_WAITFORSERV   2
+/** \brief number of semaphores */
+#define  NSEM            (N+2)
+/** \brief not blocked on any semaphore */
+#define  S_NONE          NSEM
+
+/** \brief replica still running */
+#define  RUNNING         0
+/** \brief replica completed: every entity has come to the end of its life cycle */
+#define  DONE            1
+/** \brief replica stalled: some entity is still alive, but none of them is able to proceed */
+#define  STALLED         2
+/** \brief replica stopped upon reaching the maximum number of steps */
+#define  CUTOFF          3
+
+/* entrepreneur program: the operations in the order of her life cycle */
+
+#define  EP_END          0                                                                /* end of operations check */
+#define  EP_PREP         1                                                                        /* prepare to work */
+#define  EP_WAIT         2                                                    /* wait for service requests (proceed) */
+#define  EP_EVAL         3                                                                     /* appraise situation */
+#define  EP_ADDR         4                                                                     /* address a customer */
+#define  EP_BYE          5                                                                /* say goodbye to customer */
+#define  EP_CUSTIN       6                                                                  /* customers in the shop */
+#define  EP_CLOSE        7                                                                         /* close the door */
+#define  EP_LEAVE        8                                                                       /* prepare to leave */
+#define  EP_GOWS         9                                                                         /* go to workshop */
+#define  EP_VISIT        10                                                                       /* visit suppliers */
+#define  EP_RETURN       11                                                                        /* return to shop */
+
+/* customer program */
+
+#define  CU_END          0                                                                /* end of operations check */
+#define  CU_LIVE         1                                                                     /* living normal life */
+#define  CU_GO           2                                                                            /* go shopping */
+#define  CU_DOOR         3                                                       /* is door open, and enter the shop */
+#define  CU_PERUSE       4                                                                        /* perusing around */
+#define  CU_WANT         5                                                                            /* I want this */
+#define  CU_EXIT         6                                                                              /* exit shop */
+
+/* craftsman program */
+
+#define  CF_END          0                                                                /* end of operations check */
+#define  CF_COLLECT      1                                                                      /* collect materials */
+#define  CF_PHONE        2                                                                 /* prime materials needed */
+#define  CF_BACKP        3                                                             /* back to work, upon phoning */
+#define  CF_PREP         4                                                                     /* prepare to produce */
+#define  CF_STORE        5                                                                            /* go to store */
+#define  CF_BATCH        6                                                               /* batch ready for transfer */
+#define  CF_BACKS        7                                                             /* back to work, upon storing */
+
+/** \brief task chosen by the entrepreneur: attend a customer */
+#define  T_CUST          0
+/** \brief task chosen by the entrepreneur: buy prime materials */
+#define  T_PMAT          1
+/** \brief task chosen by the entrepreneur: collect a batch of products */
+#define  T_GOODS         2
+/** \brief task chosen by the entrepreneur: end of operations */
+#define  T_END           3
+
+/**
+ *  \brief Definition of <em>replicas</em> data type.
+ *
+ *  Every field is an array indexed by replica, or an array of such arrays.
+ */
+
+typedef struct
+        { /** \brief virtual clock (in us) */
+          double *t;
+          /** \brief state of the random generator */
+          uint32_t *rng;
+          /** \brief random draws of the present round, in [0, 1): cost of the step and outcome of the operation */
+          float *u1, *u2;
+          /** \brief instant the entity is due to take its next step (INFINITY, if blocked or terminated) */
+          double *wake[NENT];
+          /** \brief entity due first, and the instant it is due */
+          uint32_t *sel;
+          double *best;
+          /** \brief next operation of the entity */
+          uint8_t *pc[NENT];
+          /** \brief semaphore the entity is blocked on */
+          uint8_t *blk[NENT];
+          /** \brief state of the entity, as logged */
+          uint8_t *stat[NENT];
+          /** \brief entity is operative */
+          uint8_t *ready[NENT];
+          /** \brief pieces bought by each customer, or produced by each craftsman */
+          uint32_t *pieces[NENT];
+          /** \brief auxiliary value: task chosen by the entrepreneur, goods selected by a customer */
+          uint8_t *aux[NENT];
+          /** \brief customer attended by the entrepreneur */
+          uint8_t *cur;
+          /** \brief values of the semaphores */
+          uint32_t *sem[NSEM];
+          /** \brief number of craftsmen blocked waiting for prime materials */
+          uint32_t *nCraftsmenBlk;
+          /** \brief shop */
+          uint8_t *shopStat;
+          uint32_t *nCustIn, *nProdIn;
+          uint8_t *prodTransfer, *primeMatReq;
+          /** \brief waiting queue by the counter: contents, index of the head and length */
+          uint8_t *queue[N];
+          uint8_t *qHead, *qLen;
+          /** \brief workshop */
+          uint32_t *nPMatIn, *wsProdIn, *NSPMat, *NTPMat, *NTProd;
+          /** \brief amount of prime materials supplied each time */
+          uint32_t *primeMat[NP];
+          /** \brief number of entities still alive */
+          uint8_t *alive;
+          /** \brief state of the replica */
+          uint8_t *state;
+          /** \brief number of steps taken, log rows, rows with the entrepreneur busy, and craftsmen producing over
+           *         all rows */
+          uint32_t *steps, *rows, *busyE, *prodC;
+        } REPLICAS;
+
+/** \brief mean cost of a step (in us) */
+static double stepCost = 6.0;
+
+/**
+ *  \brief Allocation of an array of replica values (internal operation).
+ *
+ *  \param nR number of replicas
+ *  \param size size of a value (in bytes)
+ *
+ *  \return pointer to the array, set to zero
+ */
+
+static void *newArray (unsigned int nR, size_t size)
+{
+  void *p;                                                                                       /* pointer to array */
+
+  if ((p = calloc (nR, size)) == NULL)
+     { perror ("error on allocating the replicas");
+       exit (EXIT_FAILURE);
+     }
+  return p;
+}
+
+/**
+ *  \brief Draw of a random value for every replica (vectorized kernel).
+ *
+ *  Each replica has its own xorshift generator.
+ *
+ *  \param rng states of the generators
+ *  \param u pointer to the region where the values, in [0, 1), are to be stored
+ *  \param nR number of replicas
+ */
+
+static void drawAll (uint32_t *restrict rng, float *restrict u, unsigned int nR)
+{
+  unsigned int r;                                                                               /* counting variable */
+
+  for (r = 0; r < nR; r++)
+  { uint32_t x = rng[r];
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rng[r] = x;
+    u[r] = (float) (x >> 8) * (1.0f / 16777216.0f);
+  }
+}
+
+/**
+ *  \brief Choice of the entity due first in every replica (vectorized kernel).
+ *
+ *  Ties are broken in favour of the entity with the lowest identification.
+ *
+ *  \param p pointer to the replicas
+ *  \param nR number of replicas
+ */
+
+static void dueFirst (REPLICAS *p, unsigned int nR)
+{
+  double *restrict best = p->best;                                                           /* earliest instant due */
+  uint32_t *restrict sel = p->sel;                                                               /* entity due first */
+  unsigned int e, r;                                                                           /* counting variables */
+
+  for (r = 0; r < nR; r++)
+  { best[r] = p->wake[0][r];
+    sel[r] = 0;
+  }
+  for (e = 1; e < NENT; e++)
+  { const double *restrict w = p->wake[e];
+
+    for (r = 0; r < nR; r++)
+    { bool m = w[r] < best[r];
+
+      best[r] = m ? w[r] : best[r];
+      sel[r] = m ? e : sel[r];
+    }
+  }
+}
+
+/**
+ *  \brief Random delay of an entity, as drawn by the process based simulation (internal operation).
+ *
+ *  \param max maximum length of the delay
+ *  \param u random value in [0, 1)
+ *
+ *  \return delay (in us)
+ */
+
+static double delay (double max, float u)
+{
+  return floor (max * u + 1.5);
+}
+
+/**
+ *  \brief Logging of the present state of a replica (internal operation).
+ *
+ *  Only the figures reported by the analysis of a log file are kept.
+ *
+ *  \param p pointer to the replicas
+ *  \param r replica
+ */
+
+static void saveRow (REPLICAS *p, unsigned int r)
+{
+  unsigned int k;                                                                               /* counting variable */
+
+  p->rows[r] += 1;
+  if (p->stat[0][r] != WAITING_FOR_NEXT_TASK) p->busyE[r] += 1;
+  for (k = 0; k < M; k++)
+    if (p->stat[N+1+k][r] == PRODUCING_A_NEW_PIECE) p->prodC[r] += 1;
+}
+
+/**
+ *  \brief <em>Up</em> of a semaphore of a replica (internal operation).
+ *
+ *  The entities blocked on it are waken up first, by increasing order of identification.
+ *
+ *  \param p pointer to the replicas
+ *  \param r replica
+ *  \param s semaphore
+ *  \param n number of units
+ */
+
+static void upR (REPLICAS *p, unsigned int r, unsigned int s, unsigned int n)
+{
+  unsigned int e;                                                                               /* counting variable */
+
+  for (e = 0; (e < NENT) && (n > 0); e++)
+    if (p->blk[e][r] == s)
+       { p->blk[e][r] = S_NONE;
+         p->wake[e][r] = p->t[r] + stepCost;
+         n -= 1;
+       }
+  p->sem[s][r] += n;
+}
+
+/**
+ *  \brief <em>Down</em> of a semaphore of a replica (internal operation).
+ *
+ *  \param p pointer to the replicas
+ *  \param r replica
+ *  \param e entity
+ *  \param s semaphore
+ *
+ *  \return \c true, if the entity is blocked
+ *  \return \c false, otherwise
+ */
+
+static bool downR (REPLICAS *p, unsigned int r, unsigned int e, unsigned int s)
+{
+  if (p->sem[s][r] > 0)
+     { p->sem[s][r] -= 1;
+       return false;
+     }
+  p->blk[e][r] = s;
+  p->wake[e][r] = INFINITY;
+  return true;
+}
+
+/**
+ *  \brief End of operations condition of the entrepreneur (internal operation).
+ *
+ *  \param p pointer to the replicas
+ *  \param r replica
+ *
+ *  \return \c true, if the life cycle of the entrepreneur has come to an end
+ */
+
+static bool entrepDone (REPLICAS *p, unsigned int r)
+{
+  return (p->nCustIn[r] == 0) && (p->nProdIn[r] == 0) && !p->primeMatReq[r] && !p->prodTransfer[r] &&
+         (p->wsProdIn[r] == 0) && (p->nPMatIn[r] == 0) && (p->NSPMat[r] == NP) &&
+         (p->NTPMat[r] == PP * p->NTProd[r]);
+}
+
+/**
+ *  \brief Termination of an entity (internal operation).
+ *
+ *  \param p pointer to the replicas
+ *  \param r replica
+ *  \param e entity
+ */
+
+static void terminate (REPLICAS *p, unsigned int r, unsigned int e)
+{
+  p->wake[e][r] = INFINITY;
+  p->alive[r] -= 1;
+}
+
+/**
+ *  \brief Step of the entrepreneur (internal operation).
+ *
+ *  \param p pointer to the replicas
+ *  \param r replica
+ *
+ *  \return additional delay before her next step (in us), or -1, if she is blocked or has terminated
+ */
+
+static double stepEntrep (REPLICAS *p, unsigned int r)
+{
+  unsigned int c;                                                                                        /* customer */
+  uint32_t nWake;                                                            /* number of blocked craftsmen waken up */
+
+  switch (p->pc[0][r])
+  { case EP_END:    if (entrepDone (p, r))
+                       { terminate (p, r, 0);
+                         return -1;
+                       }
+                    p->pc[0][r] = EP_PREP;
+                    return 0;
+    case EP_PREP:   p->stat[0][r] = WAITING_FOR_NEXT_TASK;
+                    p->shopStat[r] = SOPEN;
+                    saveRow (p, r);
+                    p->pc[0][r] = EP_WAIT;
+                    return 0;
+    case EP_WAIT:   p->pc[0][r] = EP_EVAL;
+                    return downR (p, r, 0, S_PROCEED) ? -1 : 0;
+    case EP_EVAL:   if (p->qLen[r] != 0)                                                           /* fixed priority */
+                       p->aux[0][r] = T_CUST;
+                       else if (p->primeMatReq[r])
+                               p->aux[0][r] = T_PMAT;
+                               else if (p->prodTransfer[r])
+                                       p->aux[0][r] = T_GOODS;
+                                       else if (entrepDone (p, r))
+                                               p->aux[0][r] = T_END;
+                                               else { p->pc[0][r] = EP_WAIT;
+                                                      return 0;
+                                                    }
+                    p->pc[0][r] = (p->aux[0][r] == T_CUST) ? EP_ADDR
+                                                           : ((p->aux[0][r] == T_END) ? EP_LEAVE : EP_CUSTIN);
+                    return 0;
+    case EP_ADDR:   p->stat[0][r] = ATTENDING_A_CUSTOMER;
+                    c = p->queue[p->qHead[r]][r];
+                    p->qHead[r] = (p->qHead[r] + 1) % N;
+                    p->qLen[r] -= 1;
+                    p->cur[r] = (uint8_t) c;
+                    saveRow (p, r);
+                    p->pc[0][r] = EP_BYE;
+                    return delay (20.0, p->u2[r]);                                                  /* servicing him */
+    case EP_BYE:    p->stat[0][r] = WAITING_FOR_NEXT_TASK;
+                    upR (p, r, S_WAITFORSERV + p->cur[r], 1);
+                    saveRow (p, r);
+                    p->pc[0][r] = EP_WAIT;
+                    return 0;
+    case EP_CUSTIN: p->pc[0][r] = (p->nCustIn[r] != 0) ? EP_CLOSE : EP_LEAVE;
+                    return 0;
+    case EP_CLOSE:  p->shopStat[r] = SDCLOSED;
+                    saveRow (p, r);
+                    p->pc[0][r] = EP_WAIT;
+                    return 0;
+    case EP_LEAVE:  p->shopStat[r] = SCLOSED;
+                    p->stat[0][r] = CLOSING_THE_SHOP;
+                    saveRow (p, r);
+                    p->pc[0][r] = (p->aux[0][r] == T_GOODS) ? EP_GOWS
+                                                            : ((p->aux[0][r] == T_PMAT) ? EP_VISIT : EP_RETURN);
+                    return 0;
+    case EP_GOWS:   p->stat[0][r] = COLLECTING_A_BATCH_OF_PRODUCTS;
+                    p->nProdIn[r] += p->wsProdIn[r];
+                    p->wsProdIn[r] = 0;
+                    p->prodTransfer[r] = false;
+                    saveRow (p, r);
+                    p->pc[0][r] = EP_RETURN;
+                    return 0;
+    case EP_VISIT:  p->stat[0][r] = DELIVERING_PRIME_MATERIALS;
+                    p->primeMatReq[r] = false;
+                    if (p->NSPMat[r] < NP)
+                       { p->nPMatIn[r] += p->primeMat[p->NSPMat[r]][r];
+                         p->NTPMat[r] += p->primeMat[p->NSPMat[r]][r];
+                         p->NSPMat[r] += 1;
+                       }
+                    nWake = p->nPMatIn[r] / PP;
+                    if (nWake > p->nCraftsmenBlk[r]) nWake = p->nCraftsmenBlk[r];
+                    upR (p, r, S_WAITFORMAT, nWake);
+                    p->nCraftsmenBlk[r] -= nWake;
+                    saveRow (p, r);
+                    p->pc[0][r] = EP_RETURN;
+                    return 0;
+    default:        p->stat[0][r] = OPENING_THE_SHOP;                                                   /* EP_RETURN */
+                    saveRow (p, r);
+                    p->pc[0][r] = EP_END;
+                    return 0;
+  }
+}
+
+/**
+ *  \brief Step of a customer (internal operation).
+ *
+ *  \param p pointer to the replicas
+ *  \param r replica
+ *  \param e entity
+ *
+ *  \return additional delay before his next step (in us), or -1, if he is blocked or has terminated
+ */
+
+static double stepCust (REPLICAS *p, unsigned int r, unsigned int e)
+{
+  unsigned int c = e - 1,                                                                 /* customer identification */
+               nOp,                                                           /* number of customers still operative */
+               ng,                                                                       /* number of goods selected */
+               k;                                                                               /* counting variable */
+  bool stop;                                                                                      /* customer status */
+
+  switch (p->pc[e][r])
+  { case CU_END:    stop = (p->nPMatIn[r] == 0) && (p->NSPMat[r] == NP);
+                    if (stop)
+                       { for (nOp = 0, k = 0; k < N; k++)
+                           nOp += p->ready[1+k][r];
+                         stop = (((p->nProdIn[r] + p->wsProdIn[r]) < 2 * nOp) && (nOp != 1)) ||
+                                ((p->nProdIn[r] + p->wsProdIn[r] + p->NTPMat[r] - PP * p->NTProd[r]) == 0);
+                       }
+                    if (stop)
+                       { p->ready[e][r] = false;
+                         terminate (p, r, e);
+                         return -1;
+                       }
+                    p->pc[e][r] = CU_LIVE;
+                    return 0;
+    case CU_LIVE:   p->pc[e][r] = CU_GO;
+                    return delay (40.0, p->u2[r]) - stepCost;                       /* no critical region is entered */
+    case CU_GO:     p->stat[e][r] = CHECKING_SHOP_DOOR_OPEN;
+                    saveRow (p, r);
+                    p->pc[e][r] = CU_DOOR;
+                    return 0;
+    case CU_DOOR:   if (p->shopStat[r] == SOPEN)
+                       { p->stat[e][r] = APPRAISING_OFFER_IN_DISPLAY;
+                         p->nCustIn[r] += 1;
+                         p->pc[e][r] = CU_PERUSE;
+                       }
+                       else { p->stat[e][r] = CARRYING_OUT_DAILY_CHORES;
+                              p->pc[e][r] = CU_LIVE;
+                            }
+                    saveRow (p, r);
+                    return 0;
+    case CU_PERUSE: ng = 0;
+                    if (p->nProdIn[r] > 0)                                                                /* pick up */
+                       { if ((p->u2[r] < 0.3f) || (p->nProdIn[r] == 0))
+                            ng = 0;
+                            else if ((p->u2[r] < 0.7f) || (p->nProdIn[r] == 1))
+                                    ng = 1;
+                                    else ng = 2;
+                       }
+                    if (ng != 0)
+                       { p->nProdIn[r] -= ng;
+                         saveRow (p, r);
+                       }
+                    p->aux[e][r] = (uint8_t) ng;
+                    p->pc[e][r] = (ng != 0) ? CU_WANT : CU_EXIT;
+                    return 0;
+    case CU_WANT:   p->stat[e][r] = BUYING_SOME_GOODS;
+                    p->pieces[e][r] += p->aux[e][r];
+                    p->queue[(p->qHead[r] + p->qLen[r]) % N][r] = (uint8_t) c;
+                    p->qLen[r] += 1;
+                    upR (p, r, S_PROCEED, 1);
+                    saveRow (p, r);
+                    p->pc[e][r] = CU_EXIT;
+                    return downR (p, r, e, S_WAITFORSERV + c) ? -1 : 0;
+    default:        p->stat[e][r] = CARRYING_OUT_DAILY_CHORES;                                            /* CU_EXIT */
+                    p->nCustIn[r] -= 1;
+                    upR (p, r, S_PROCEED, 1);
+                    saveRow (p, r);
+                    p->pc[e][r] = CU_END;
+                    return 0;
+  }
+}
+
+/**
+ *  \brief Step of a craftsman (internal operation).
+ *
+ *  \param p pointer to the replicas
+ *  \param r replica
+ *  \param e entity
+ *
+ *  \return additional delay before his next step (in us), or -1, if he is blocked or has terminated
+ */
+
+static double stepCraft (REPLICAS *p, unsigned int r, unsigned int e)
+{
+  unsigned int nOp,                                                           /* number of craftsmen still operative */
+               k;                                                                               /* counting variable */
+
+  switch (p->pc[e][r])
+  { case CF_END:     if (p->NSPMat[r] == NP)
+                        { for (nOp = 0, k = 0; k < M; k++)
+                            nOp += p->ready[N+1+k][r];
+                          if (p->nPMatIn[r] < nOp * PP)
+                             { p->ready[e][r] = false;
+                               if (nOp == 1)                                   /* the last craftsman is about to die */
+                                  { p->prodTransfer[r] = true;
+                                    upR (p, r, S_PROCEED, 1);
+                                    saveRow (p, r);
+                                  }
+                               terminate (p, r, e);
+                               return -1;
+                             }
+                        }
+                     p->pc[e][r] = CF_COLLECT;
+                     return 0;
+    case CF_COLLECT: if (p->nPMatIn[r] == 0)                                             /* wait for prime materials */
+                        { p->nCraftsmenBlk[r] += 1;
+                          return downR (p, r, e, S_WAITFORMAT) ? -1 : 0;
+                        }
+                     p->nPMatIn[r] -= PP;
+                     saveRow (p, r);
+                     p->pc[e][r] = (p->nPMatIn[r] < PMIN) ? CF_PHONE : CF_PREP;
+                     return 0;
+    case CF_PHONE:   p->stat[e][r] = CONTACTING_THE_ENTREPRENEUR;
+                     p->primeMatReq[r] = true;
+                     upR (p, r, S_PROCEED, 1);
+                     saveRow (p, r);
+                     p->pc[e][r] = CF_BACKP;
+                     return 0;
+    case CF_BACKP:   p->stat[e][r] = FETCHING_PRIME_MATERIALS;
+                     saveRow (p, r);
+                     p->pc[e][r] = CF_PREP;
+                     return 0;
+    case CF_PREP:    p->stat[e][r] = PRODUCING_A_NEW_PIECE;
+                     saveRow (p, r);
+                     p->pc[e][r] = CF_STORE;
+                     return delay (30.0, p->u2[r]);                                                 /* shaping it up */
+    case CF_STORE:   p->stat[e][r] = STORING_IT_FOR_TRANSFER;
+                     p->pieces[e][r] += 1;
+                     p->wsProdIn[r] += 1;
+                     p->NTProd[r] += 1;
+                     saveRow (p, r);
+                     p->pc[e][r] = (p->wsProdIn[r] >= MAX) ? CF_BATCH : CF_BACKS;
+                     return 0;
+    case CF_BATCH:   p->stat[e][r] = CONTACTING_THE_ENTREPRENEUR;
+                     p->prodTransfer[r] = true;
+                     upR (p, r, S_PROCEED, 1);
+                     saveRow (p, r);
+                     p->pc[e][r] = CF_BACKS;
+                     return 0;
+    default:         p->stat[e][r] = FETCHING_PRIME_MATERIALS;                                           /* CF_BACKS */
+                     saveRow (p, r);
+                     p->pc[e][r] = CF_END;
+                     return 0;
+  }
+}
+
+/**
+ *  \brief Initialization of the replicas.
+ *
+ *  The amounts of prime materials supplied are drawn as in the launcher of the process based simulation.
+ *
+ *  \param p pointer to the replicas
+ *  \param nR number of replicas
+ *  \param seed seed of the random generators
+ */
+
+static void initReplicas (REPLICAS *p, unsigned int nR, uint32_t seed)
+{
+  unsigned int r, e, i;                                                                        /* counting variables */
+  unsigned int total;                                                    /* total amount of prime materials supplied */
+
+#define  ALLOC(f)  (f) = newArray (nR, sizeof (*(f)))
+  ALLOC (p->t); ALLOC (p->rng); ALLOC (p->u1); ALLOC (p->u2); ALLOC (p->sel); ALLOC (p->best); ALLOC (p->cur);
+  ALLOC (p->nCraftsmenBlk); ALLOC (p->shopStat); ALLOC (p->nCustIn); ALLOC (p->nProdIn); ALLOC (p->prodTransfer);
+  ALLOC (p->primeMatReq); ALLOC (p->qHead); ALLOC (p->qLen); ALLOC (p->nPMatIn); ALLOC (p->wsProdIn);
+  ALLOC (p->NSPMat); ALLOC (p->NTPMat); ALLOC (p->NTProd); ALLOC (p->alive); ALLOC (p->state); ALLOC (p->steps);
+  ALLOC (p->rows); ALLOC (p->busyE); ALLOC (p->prodC);
+  for (e = 0; e < NENT; e++)
+  { ALLOC (p->wake[e]); ALLOC (p->pc[e]); ALLOC (p->blk[e]); ALLOC (p->stat[e]); ALLOC (p->ready[e]);
+    ALLOC (p->pieces[e]); ALLOC (p->aux[e]);
+  }
+  for (i = 0; i < NSEM; i++)
+    ALLOC (p->sem[i]);
+  for (i = 0; i < N; i++)
+    ALLOC (p->queue[i]);
+  for (i = 0; i < NP; i++)
+    ALLOC (p->primeMat[i]);
+#undef   ALLOC
+
+  for (r = 0; r < nR; r++)
+  { uint32_t x = seed * 0x9E3779B9u ^ (r + 1) * 0x85EBCA6Bu;                        /* a distinct stream per replica */
+
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    p->rng[r] = (x == 0) ? 1 : x;
+  }
+  for (i = 0; i < NP; i++)
+  { drawAll (p->rng, p->u1, nR);
+    for (r = 0; r < nR; r++)
+      p->primeMat[i][r] = (uint32_t) floor (10.0 * PP * p->u1[r] + PP + 0.5);
+  }
+  for (r = 0; r < nR; r++)
+  { for (total = 0, i = 0; i < NP; i++)
+      total += p->primeMat[i][r];
+    if (p->primeMat[NP-1][r] < 2*PP*M)
+       { total += 2*PP*M - p->primeMat[NP-1][r];
+         p->primeMat[NP-1][r] = 2*PP*M;
+       }
+    if (total % PP != 0) p->primeMat[NP-1][r] += PP - total % PP;
+
+    p->stat[0][r] = OPENING_THE_SHOP;
+    for (e = 1; e <= N; e++)
+      p->stat[e][r] = CARRYING_OUT_DAILY_CHORES;
+    for (e = N+1; e < NENT; e++)
+      p->stat[e][r] = FETCHING_PRIME_MATERIALS;
+    for (e = 0; e < NENT; e++)
+    { p->ready[e][r] = true;
+      p->blk[e][r] = S_NONE;
+      p->wake[e][r] = 0.0;
+    }
+    p->shopStat[r] = SCLOSED;
+    p->nPMatIn[r] = p->primeMat[0][r];
+    p->NSPMat[r] = 1;
+    p->NTPMat[r] = p->primeMat[0][r];
+    p->alive[r] = NENT;
+    p->state[r] = RUNNING;
+    saveRow (p, r);                                                                                 /* initial state */
+  }
+}
+
+/**
+ *  \brief Comparison of two values, for sorting (internal operation).
+ *
+ *  \param a pointer to the first value
+ *  \param b pointer to the second value
+ *
+ *  \return negative, zero or positive, as the first value is less than, equal to or greater than the second one
+ */
+
+static int byValue (const void *a, const void *b)
+{
+  double x = *(const double *) a,                                                                     /* first value */
+         y = *(const double *) b;                                                                    /* second value */
+
+  return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+/**
+ *  \brief Printing of the distribution of a figure over the replicas which completed (internal operation).
+ *
+ *  \param name name of the figure
+ *  \param v values (they are sorted)
+ *  \param n number of values
+ */
+
+static void printDist (const char *name, double *v, unsigned int n)
+{
+  double sum = 0.0,                                                                                 /* sum of values */
+         sq = 0.0,                                                                      /* sum of squared deviations */
+         mean;                                                                                               /* mean */
+  unsigned int i;                                                                               /* counting variable */
+
+  if (n == 0) return;
+  qsort (v, n, sizeof (double), byValue);
+  for (i = 0; i < n; i++)
+    sum += v[i];
+  mean = sum / n;
+  for (i = 0; i < n; i++)
+    sq += (v[i] - mean) * (v[i] - mean);
+  printf ("  %-38s %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n", name, mean, sqrt (sq / n), v[0],
+          v[n/20], v[n/2], v[n - 1 - n/20], v[n-1]);
+}
+
+/**
+ *  \brief Main program.
+ */
+
+int main (int argc, char *argv[])
+{
+  REPLICAS rp;                                                                                           /* replicas */
+  unsigned int nR = 4096,                                                                      /* number of replicas */
+               maxSteps = 1000000,                                            /* maximum number of steps per replica */
+               nRun,                                                             /* number of replicas still running */
+               nDone = 0, nStall = 0, nCut = 0,                                 /* number of replicas by final state */
+               r, e, s, k;                                                                     /* counting variables */
+  uint32_t seed = 1;                                                                /* seed of the random generators */
+  unsigned int sold, made;                                                               /* pieces sold and produced */
+  double d;                                                                                /* delay before next step */
+  double *v[8];                                                                     /* figures of completed replicas */
+  int c;                                                                                      /* command line option */
+  char *tinp;                                                                      /* numerical parameters test flag */
+
+  memset (&rp, 0, sizeof (REPLICAS));
+  while ((c = getopt (argc, argv, "r:s:c:m:")) != -1)
+    switch (c)
+    { case 'r': nR = (unsigned int) strtoul (optarg, &tinp, 0);
+                if ((*tinp != '\0') || (nR == 0))
+                   { fprintf (stderr, "Invalid number of replicas: %s\n", optarg);
+                     exit (EXIT_FAILURE);
+                   }
+                break;
+      case 's': seed = (uint32_t) strtoul (optarg, &tinp, 0);
+                if (*tinp != '\0')
+                   { fprintf (stderr, "Invalid seed: %s\n", optarg);
+                     exit (EXIT_FAILURE);
+                   }
+                break;
+      case 'c': stepCost = strtod (optarg, &tinp);
+                if ((*tinp != '\0') || (stepCost <= 0.0))
+                   { fprintf (stderr, "Invalid step cost: %s\n", optarg);
+                     exit (EXIT_FAILURE);
+                   }
+                break;
+      case 'm': maxSteps = (unsigned int) strtoul (optarg, &tinp, 0);
+                if ((*tinp != '\0') || (maxSteps == 0))
+                   { fprintf (stderr, "Invalid maximum number of steps: %s\n", optarg);
+                     exit (EXIT_FAILURE);
+                   }
+                break;
+      default:  fprintf (stderr, "Usage: %s [-r replicas] [-s seed] [-c step_cost_us] [-m max_steps]\n", argv[0]);
+                exit (EXIT_FAILURE);
+    }
+  initReplicas (&rp, nR, seed);
+
+  /* every replica running takes a step per round */
+
+  for (nRun = nR, s = 0; (nRun > 0) && (s < maxSteps); s++)
+  { drawAll (rp.rng, rp.u1, nR);
+    drawAll (rp.rng, rp.u2, nR);
+    dueFirst (&rp, nR);
+    for (r = 0; r < nR; r++)
+    { if (rp.state[r] != RUNNING) continue;
+      if (rp.best[r] == INFINITY)
+         { rp.state[r] = (rp.alive[r] == 0) ? DONE : STALLED;
+           nRun -= 1;
+           continue;
+         }
+      e = rp.sel[r];
+      rp.t[r] = rp.best[r];
+      rp.steps[r] += 1;
+      if (e == 0)
+         d = stepEntrep (&rp, r);
+         else if (e <= N)
+                 d = stepCust (&rp, r, e);
+                 else d = stepCraft (&rp, r, e);
+      if (d >= 0.0)
+         rp.wake[e][r] = rp.t[r] + stepCost * (0.5 + rp.u1[r]) + d;
+    }
+  }
+  for (r = 0; r < nR; r++)
+    if (rp.state[r] == RUNNING)
+       { rp.state[r] = CUTOFF;
+         nCut += 1;
+       }
+       else if (rp.state[r] == DONE)
+               nDone += 1;
+               else nStall += 1;
+
+  /* distribution of the figures over the replicas which completed */
+
+  for (k = 0; k < 8; k++)
+    v[k] = newArray ((nDone == 0) ? 1 : nDone, sizeof (double));
+  for (k = 0, r = 0; r < nR; r++)
+  { if (rp.state[r] != DONE) continue;
+    for (sold = 0, e = 1; e <= N; e++)
+      sold += rp.pieces[e][r];
+    for (made = 0, e = N+1; e < NENT; e++)
+      made += rp.pieces[e][r];
+    v[0][k] = rp.t[r];
+    v[1][k] = 1000.0 * sold / rp.t[r];
+    v[2][k] = rp.rows[r];
+    v[3][k] = sold;
+    v[4][k] = 1000.0 * made / rp.rows[r];
+    v[5][k] = 1000.0 * sold / rp.rows[r];
+    v[6][k] = 100.0 * rp.busyE[r] / rp.rows[r];
+    v[7][k] = 100.0 * rp.prodC[r] / rp.rows[r] / M;
+    k += 1;
+  }
+
+  printf ("Monte Carlo simulation: %u replicas, seed %u, step cost %.2f us, %u customers, %u craftsmen\n", nR,
+          (unsigned int) seed, stepCost, N, M);
+  printf ("  completed: %u, stalled: %u, stopped after %u steps: %u\n\n", nDone, nStall, maxSteps, nCut);
+  printf ("  %-38s %10s %10s %10s %10s %10s %10s %10s\n", "", "mean", "sd", "min", "p5", "p50", "p95", "max");
+  printDist ("completion time (us)", v[0], nDone);
+  printDist ("throughput (pieces sold per ms)", v[1], nDone);
+  printDist ("log rows (steps)", v[2], nDone);
+  printDist ("pieces sold", v[3], nDone);
+  printDist ("pieces produced per 1000 steps", v[4], nDone);
+  printDist ("pieces sold per 1000 steps", v[5], nDone);
+  printDist ("entrepreneur utilization (%)", v[6], nDone);
+  printDist ("craftsmen utilization (%)", v[7], nDone);
+
+  return EXIT_SUCCESS;
+}
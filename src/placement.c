@@ -0,0 +1,237 @@
+/**
+ *  \file placement.c (implementation file)
+ *
+ *  \brief Placement of the intervening entities processes.
+ *
+ *  The processes are pinned to processors according to a placement policy and the shared region may be bound to
+ *  the memory of a single NUMA node.
+ *  Entities are numbered as follows: \c 0 is the entrepreneur, \c 1 to <tt>N</tt> are the customers and <tt>N+1</tt>
+ *  to <tt>N+M</tt> are the craftsmen.
+ *
+ *  Operations defined:
+ *     \li discovery of the processors and NUMA nodes available
+ *     \li processor assigned to an entity
+ *     \li NUMA node of a processor
+ *     \li pinning of an entity process
+ *     \li binding of a memory region to the NUMA node of the entrepreneur.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+
+#include "placement.h"
+
+/** \brief maximum number of NUMA nodes taken into account */
+#define  MAXNODES        64
+
+/** \brief memory policy mode: allocation restricted to the given nodes (as in <tt>numaif.h</tt>) */
+#define  MPOL_BIND       2
+
+/** \brief memory policy flag: pages already allocated are moved to the given nodes (as in <tt>numaif.h</tt>) */
+#define  MPOL_MF_MOVE    (1 << 1)
+
+/** \brief placement policy */
+static unsigned int policy = PLACE_NONE;
+
+/** \brief processor of the entrepreneur */
+static int entCpu = -1;
+
+/** \brief processors of the remaining entities, in the order they are assigned */
+static int order[CPU_SETSIZE];
+
+/** \brief number of processors in <tt>order</tt> */
+static unsigned int nOrder = 0;
+
+/** \brief NUMA node of each processor */
+static int nodeOf[CPU_SETSIZE];
+
+/**
+ *  \brief Reading of the NUMA nodes of the processors (internal operation).
+ *
+ *  The processor lists of the nodes are read from <tt>sysfs</tt>. Processors not listed are assumed to belong to
+ *  node \c 0.
+ */
+
+static void readNodes (void)
+{
+  FILE *fic;                                                                                      /* file descriptor */
+  char name[64];                                                                         /* name of the cpulist file */
+  int node, lo, hi, c;                                                                         /* processor interval */
+
+  for (c = 0; c < CPU_SETSIZE; c++)
+    nodeOf[c] = 0;
+  for (node = 0; node < MAXNODES; node++)
+  { sprintf (name, "/sys/devices/system/node/node%d/cpulist", node);
+    if ((fic = fopen (name, "r")) == NULL) continue;
+    while (fscanf (fic, "%d", &lo) == 1)                                                  /* list such as "0-3,8-11" */
+    { hi = lo;
+      if ((c = fgetc (fic)) == '-')
+         { if (fscanf (fic, "%d", &hi) != 1) break;
+           c = fgetc (fic);
+         }
+      for (; (lo <= hi) && (lo < CPU_SETSIZE); lo++)
+        nodeOf[lo] = node;
+      if (c != ',') break;
+    }
+    fclose (fic);
+  }
+}
+
+/**
+ *  \brief Discovery of the processors and NUMA nodes available.
+ *
+ *  Only the processors in the affinity mask of the calling process are taken into account.
+ *
+ *  \param pol placement policy
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int placeInit (unsigned int pol)
+{
+  cpu_set_t set;                                                                             /* processors available */
+  int avail[CPU_SETSIZE];                                              /* processors available, other than the first */
+  unsigned int nAvail = 0,                                                          /* number of processors in avail */
+               k;                                                                               /* counting variable */
+  int c, node, maxNode;                                                                   /* processor and node scan */
+  int taken[CPU_SETSIZE];                                                       /* processor already placed in order */
+
+  if (pol > PLACE_COMPACT)
+     { errno = EINVAL;
+       return -1;
+     }
+  policy = pol;
+  if (policy == PLACE_NONE) return 0;
+  if (sched_getaffinity (0, sizeof (set), &set) == -1) return -1;
+  readNodes ();
+
+  entCpu = -1;
+  for (c = 0; c < CPU_SETSIZE; c++)
+    if (CPU_ISSET (c, &set))
+       { if (entCpu == -1)
+            entCpu = c;                                                 /* the entrepreneur gets the first processor */
+            else avail[nAvail++] = c;
+       }
+  nOrder = 0;
+  if (nAvail == 0)                                                 /* a single processor: it has to be shared by all */
+     { order[nOrder++] = entCpu;
+       return 0;
+     }
+
+  for (k = 0; k < nAvail; k++)
+    taken[k] = 0;
+  if (policy == PLACE_COMPACT)                                /* the node of the entrepreneur first, then the others */
+     { for (k = 0; k < nAvail; k++)
+         if (nodeOf[avail[k]] == nodeOf[entCpu])
+            { order[nOrder++] = avail[k];
+              taken[k] = 1;
+            }
+       for (k = 0; k < nAvail; k++)
+         if (!taken[k]) order[nOrder++] = avail[k];
+     }
+     else { maxNode = 0;                    /* one processor of each node in turn, starting after the entrepreneur's */
+            for (k = 0; k < nAvail; k++)
+              if (nodeOf[avail[k]] > maxNode) maxNode = nodeOf[avail[k]];
+            node = nodeOf[entCpu];
+            while (nOrder < nAvail)
+            { node = (node + 1) % (maxNode + 1);
+              for (k = 0; k < nAvail; k++)
+                if (!taken[k] && (nodeOf[avail[k]] == node))
+                   { order[nOrder++] = avail[k];
+                     taken[k] = 1;
+                     break;
+                   }
+            }
+          }
+
+  return 0;
+}
+
+/**
+ *  \brief Processor assigned to an entity.
+ *
+ *  \param ent entity number
+ *
+ *  \return processor number, if the entity is to be pinned
+ *  \return -\c 1, otherwise
+ */
+
+int placeCpu (unsigned int ent)
+{
+  if ((policy == PLACE_NONE) || (entCpu == -1)) return -1;
+  if (ent == 0) return entCpu;
+  return order[(ent - 1) % nOrder];
+}
+
+/**
+ *  \brief NUMA node of a processor.
+ *
+ *  \param cpu processor number
+ *
+ *  \return NUMA node number (\c 0 when the system has no NUMA information)
+ */
+
+int placeNode (int cpu)
+{
+  if ((cpu < 0) || (cpu >= CPU_SETSIZE) || (policy == PLACE_NONE)) return 0;
+  return nodeOf[cpu];
+}
+
+/**
+ *  \brief Pinning of an entity process.
+ *
+ *  Nothing is done if the entity is not to be pinned.
+ *
+ *  \param pid process identifier
+ *  \param ent entity number
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int placeProcess (pid_t pid, unsigned int ent)
+{
+  cpu_set_t set;                                                                           /* processor to be pinned */
+  int cpu;                                                                                       /* processor number */
+
+  if ((cpu = placeCpu (ent)) == -1) return 0;
+  CPU_ZERO (&set);
+  CPU_SET (cpu, &set);
+  return sched_setaffinity (pid, sizeof (set), &set);
+}
+
+/**
+ *  \brief Binding of a memory region to the NUMA node of the entrepreneur.
+ *
+ *  The region should be bound before it is first touched, so that its pages are allocated on that node. Pages
+ *  already allocated, as those of a POSIX shared memory object prefaulted on mapping, are moved there, as long as
+ *  the calling process is the only one to have them mapped. The function fails if the entrepreneur is not pinned.
+ *
+ *  \param addr region start address (page aligned)
+ *  \param len region size (in bytes)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int placeMemory (void *addr, size_t len)
+{
+  unsigned long mask[(MAXNODES + 8 * sizeof (unsigned long) - 1) / (8 * sizeof (unsigned long))] = { 0 };
+  int node;                                                                              /* node of the entrepreneur */
+
+  if (placeCpu (0) == -1)
+     { errno = EINVAL;
+       return -1;
+     }
+  node = placeNode (entCpu);
+  mask[node / (8 * sizeof (unsigned long))] |= 1UL << (node % (8 * sizeof (unsigned long)));
+  return (int) syscall (SYS_mbind, addr, len, MPOL_BIND, mask, (unsigned long) MAXNODES + 1, MPOL_MF_MOVE);
+}
@@ -0,0 +1,104 @@
+/**
+ *  \file placement.h (interface file)
+ *
+ *  \brief Placement of the intervening entities processes.
+ *
+ *  The processes are pinned to processors according to a placement policy and the shared region may be bound to
+ *  the memory of a single NUMA node.
+ *  Entities are numbered as follows: \c 0 is the entrepreneur, \c 1 to <tt>N</tt> are the customers and <tt>N+1</tt>
+ *  to <tt>N+M</tt> are the craftsmen.
+ *
+ *  Placement policies:
+ *     \li <tt>PLACE_NONE</tt> - the processes are not pinned and the scheduler migrates them freely
+ *     \li <tt>PLACE_SPREAD</tt> - the entrepreneur is pinned to a dedicated processor and the remaining entities
+ *         are spread one per processor, alternating among NUMA nodes
+ *     \li <tt>PLACE_COMPACT</tt> - the entrepreneur is pinned to a dedicated processor and the remaining entities
+ *         are packed on the processors next to it, filling its NUMA node first.
+ *
+ *  Operations defined:
+ *     \li discovery of the processors and NUMA nodes available
+ *     \li processor assigned to an entity
+ *     \li NUMA node of a processor
+ *     \li pinning of an entity process
+ *     \li binding of a memory region to the NUMA node of the entrepreneur.
+ */
+
+#ifndef PLACEMENT_H_
+#define PLACEMENT_H_
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/** \brief placement policy: no pinning */
+#define  PLACE_NONE      0
+
+/** \brief placement policy: entities spread over the processors and NUMA nodes */
+#define  PLACE_SPREAD    1
+
+/** \brief placement policy: entities packed next to the entrepreneur */
+#define  PLACE_COMPACT   2
+
+/**
+ *  \brief Discovery of the processors and NUMA nodes available.
+ *
+ *  Only the processors in the affinity mask of the calling process are taken into account.
+ *
+ *  \param pol placement policy
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int placeInit (unsigned int pol);
+
+/**
+ *  \brief Processor assigned to an entity.
+ *
+ *  \param ent entity number
+ *
+ *  \return processor number, if the entity is to be pinned
+ *  \return -\c 1, otherwise
+ */
+
+extern int placeCpu (unsigned int ent);
+
+/**
+ *  \brief NUMA node of a processor.
+ *
+ *  \param cpu processor number
+ *
+ *  \return NUMA node number (\c 0 when the system has no NUMA information)
+ */
+
+extern int placeNode (int cpu);
+
+/**
+ *  \brief Pinning of an entity process.
+ *
+ *  Nothing is done if the entity is not to be pinned.
+ *
+ *  \param pid process identifier
+ *  \param ent entity number
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int placeProcess (pid_t pid, unsigned int ent);
+
+/**
+ *  \brief Binding of a memory region to the NUMA node of the entrepreneur.
+ *
+ *  The region must be bound before it is first touched, so that its pages are allocated on that node.
+ *  The function fails if the entrepreneur is not pinned.
+ *
+ *  \param addr region start address (page aligned)
+ *  \param len region size (in bytes)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int placeMemory (void *addr, size_t len);
+
+#endif /* PLACEMENT_H_ */
@@ -27,6 +27,14 @@
 #define  PP          1
 /** \brief number of times prime materials are supplied */
 #define  NP          4
+/** \brief number of shops, each one run by its own entrepreneur (it may be set on building, as in make SHOPS=4) */
+#ifndef  NS
+#define  NS          1
+#endif
+
+/** \brief identification of the entrepreneur of a shop: 0 for the first one and, since the customers and the craftsmen
+ *         keep theirs, following the craftsmen for the others */
+#define  ENTREP(s)   (((s) == 0) ? 0 : N+M+(s))
 
 /* Constants defining entrepreneur state */
 
@@ -51,8 +51,8 @@ typedef struct
  *  \brief Definition of <em>state of the intervening entities</em> data type.
  */
 typedef struct
-        { /** \brief entrepreneur state */
-          unsigned int entrepStat;
+        { /** \brief entrepreneurs state array (one per shop) */
+          unsigned int entrepStat[NS];
           /** \brief customers state array */
           STAT_CUST custStat[N];
           /** \brief craftsmen state array */
@@ -123,8 +123,8 @@ typedef struct
 typedef struct
         { /** \brief state of all intervening entities */
           STAT st;
-          /** \brief state of the shop */
-          SHOPINFO shop;
+          /** \brief state of the shops */
+          SHOPINFO shop[NS];
           /** \brief state of the workshop */
           WORKSHOPINFO workShop;
           /** \brief amount of prime materials supplied each time */
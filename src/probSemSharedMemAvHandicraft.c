@@ -13,6 +13,63 @@
  *  Upon execution, one parameter is requested:
  *    \li name of the logging file.
  *
+ *  Command line options:
+ *    \li <tt>-l text|lz|mmap|uring</tt> - logging mode: plain text (default), compressed in independent blocks (use
+ *        the <em>logcat</em> tool to read it), plain text written through a shared memory mapping of the file or
+ *        plain text written asynchronously through an io_uring of each process (buffered writes, if unavailable)
+ *    \li <tt>-H</tt> - back the shared region with huge pages, whenever they are available
+ *    \li <tt>-p none|spread|compact</tt> - placement policy: processes not pinned (default), or the entrepreneur
+ *        pinned to a dedicated processor and the remaining entities spread over the NUMA nodes or packed next to it
+ *    \li <tt>-b</tt> - bind the shared region to the NUMA node of the entrepreneur (requires a placement policy)
+ *    \li <tt>-j threads</tt> - number of threads spawning the intervening entities in parallel batches (default 1)
+ *    \li <tt>-L</tt> - the intervening entities do not take part in the start barrier (precompiled entities); it is
+ *        implied when the build has left the marker <tt>LEGACYMARK</tt> by copying any precompiled entity, unless
+ *        the entities are forked without exec
+ *    \li <tt>-Z</tt> - zygote mode: the intervening entities are forked without exec, inheriting the mapping of the
+ *        shared region, and run the life cycles linked into the launcher
+ *    \li <tt>-k pieces</tt> - batched production: each craftsman collects the prime materials for, produces and
+ *        stores up to the given number of pieces per visit to the store (default 1)
+ *    \li <tt>-D</tt> - door gate: customers who find the door closed block until the entrepreneur opens the shop
+ *        again, instead of polling the door
+ *    \li <tt>-s fixed|oldest|weighted[:c,p,g]|throughput</tt> - scheduling policy of the entrepreneur next task:
+ *        fixed priority (default), oldest request first, weighted fair or throughput maximizing
+ *    \li <tt>-r random|shortest|sticky</tt> - routing policy of the customers, when there are several shops: a shop
+ *        picked at random (default), the one with the shortest queue by the counter, or the one visited last time
+ *    \li <tt>-T trace_file</tt> - record the changes of state of the intervening entities and their waits on
+ *        semaphores, with timestamps, in the given file (use the <em>tracejson</em> tool to view it in Perfetto)
+ *    \li <tt>-c ckpt_file</tt> - take a checkpoint of the running simulation into the given file whenever the
+ *        launcher receives <tt>SIGUSR1</tt>
+ *    \li <tt>-C ms</tt> - take a checkpoint, besides, every given number of milliseconds (requires <tt>-c</tt>)
+ *    \li <tt>-w ckpt_file</tt> - warm start: the simulation resumes from the checkpoint in the given file, with the
+ *        intervening entities starting anew at the top of their life cycles
+ *    \li <tt>-R replay_file</tt> - record the order the intervening entities enter the critical region in and the
+ *        outcomes of their random choices in the given file
+ *    \li <tt>-P replay_file</tt> - replay a run recorded in the given file, at full speed, with no random delays
+ *        (the log file is identical to the one of the run recorded)
+ *    \li <tt>-N address</tt> - distributed mode: the launcher is the coordinator, listening at the given address (the
+ *        path name of a Unix-domain socket, or <tt>host:port</tt>), and the customers and the craftsmen are run by
+ *        entity hosts, which connect to it and whose operations are carried out by the coordinator itself, from a
+ *        pool of threads
+ *    \li <tt>-n hosts</tt> - number of entity hosts spawned by the launcher itself, sharing the customers and the
+ *        craftsmen evenly (default 1; with 0, the entity hosts are started by hand with <tt>entityhost</tt>)
+ *    \li <tt>-A sem|spin|fair[:prio]</tt> - kind of the locks of the critical region: a semaphore (default), a
+ *        lock word in the shared region which is spun on for a self-tuned while before parking (adaptive), or a queue
+ *        in the shared region the lock is handed over in order through (fair), with the entrepreneurs ahead of the
+ *        other entities, if so requested
+ *    \li <tt>-S</tt> - split locks: one lock per shop, one for the workshop and one for the log, instead of a single
+ *        lock for the whole critical region (the default when there are several shops; not when recording or
+ *        replaying and with precompiled entities, which always use a single lock); the lines logged then show each
+ *        part of the state as it was last logged by its owner, rather than a snapshot of the whole state
+ *    \li <tt>-G</tt> - a single lock for the whole critical region (the default with a single shop), so every line
+ *        logged is a snapshot of the whole state.
+ *
+ *  The entities are spawned with <tt>posix_spawn</tt> and do not start operating until all of them have attached
+ *  the shared region. The startup time is reported apart from the simulation time.
+ *
+ *  The number of shops, <tt>NS</tt>, is set on building. Each shop is run by its own entrepreneur and all of them are
+ *  supplied by the same workshop. With several shops, the state of each shop is protected by a lock of its own, so the
+ *  shops operate in parallel.
+ *
  *  \author António Rui Borges - October 2014
  */
 
@@ -24,7 +81,15 @@
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <string.h>
+#include <errno.h>
 #include <math.h>
+#include <time.h>
+#include <spawn.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <fcntl.h>
 
 #include "probConst.h"
 #include "probDataStruct.h"
@@ -33,6 +98,10 @@
 #include "sharedDataSync.h"
 #include "semaphore.h"
 #include "sharedMemory.h"
+#include "placement.h"
+#include "entities.h"
+#include "checkpoint.h"
+#include "remote.h"
 
 /** \brief name of entrepreneur process */
 #define   ENTREPRENEUR   "./entrepreneur"
@@ -43,6 +112,394 @@
 /** \brief name of craftsman process */
 #define   CRAFTSMAN      "./craftsman"
 
+/** \brief marker left in the run directory by the builds which copy precompiled entities */
+#define   LEGACYMARK     "./legacy"
+
+/** \brief name of entity host process */
+#define   ENTITYHOST     "./entityhost"
+
+/** \brief kind of shared region */
+#ifdef SHMEM_POSIX
+#define   SHMEM_KIND     "POSIX shared memory object, prefaulted"
+#else
+#define   SHMEM_KIND     "SysV shared memory segment"
+#endif
+
+/**
+ *  \brief Definition of <em>intervening entity</em> data type.
+ */
+
+typedef struct
+        { /** \brief name of the program */
+          char *path;
+          /** \brief entity id, as a command line argument */
+          char id[12];
+          /** \brief name of the error file */
+          char errFile[12];
+          /** \brief command line */
+          char *argv[6];
+          /** \brief process identifier */
+          pid_t pid;
+          /** \brief spawning outcome (0 or an error number) */
+          int err;
+        } ENTITY;
+
+/**
+ *  \brief Definition of <em>batch of entities</em> data type.
+ */
+
+typedef struct
+        { /** \brief number of the first entity in the batch */
+          unsigned int first;
+          /** \brief number next to the last entity in the batch */
+          unsigned int last;
+        } BATCH;
+
+/** \brief intervening entities (0 - entrepreneur, 1 to N - customers, N+1 to N+M - craftsmen, N+M+1 to N+M+NS-1 -
+ *         entrepreneurs of the other shops) */
+static ENTITY ent[N+M+NS];
+
+/** \brief environment of the launcher, inherited by the intervening entities */
+extern char **environ;
+
+/** \brief zygote mode: entities are forked without exec */
+static bool zygote = false;
+
+/** \brief names of the routing policies of the customers */
+static const char *routeName[] = { "random", "shortest", "sticky" };
+
+/** \brief names of the kinds of lock of the critical region */
+static const char *lockName[] = { "semaphore", "adaptive", "fair", "fair with a priority lane for the entrepreneurs" };
+
+/** \brief semaphore set access identifier, inherited by the entities in zygote mode and used by the coordinator */
+static int zSemgid;
+
+/** \brief pointer to shared memory region, inherited by the entities in zygote mode and used by the coordinator */
+static SHARED_DATA *zSh;
+
+/** \brief distributed mode: customers and craftsmen are run by entity hosts */
+static bool distributed = false;
+
+/** \brief listening socket of the coordinator, in distributed mode */
+static int lsFd = -1;
+
+/** \brief number of entity hosts connected, in distributed mode */
+static unsigned int nHost = 0;
+
+/** \brief connection of each entity host, in distributed mode */
+static int hostFd[N+M];
+
+/** \brief entity host running each customer and craftsman, in distributed mode */
+static unsigned int owner[N+M+1];
+
+/** \brief the life cycle of each customer and craftsman has come to an end, in distributed mode */
+static bool ended[N+M+1];
+
+/** \brief entity hosts spawned, in distributed mode */
+static pid_t helper[N+M];
+
+/** \brief number of entity hosts spawned */
+static unsigned int nHelper = 0;
+
+/** \brief a checkpoint has been requested */
+static volatile sig_atomic_t ckptReq = 0;
+
+/**
+ *  \brief Request of a checkpoint, upon the reception of <tt>SIGUSR1</tt> or <tt>SIGALRM</tt>.
+ *
+ *  \param sig signal number
+ */
+
+static void ckptSignal (int sig)
+{
+  ckptReq = 1;
+}
+
+/**
+ *  \brief Closing of the descriptors of distributed mode, by a child of the launcher.
+ */
+
+static void closeChannels (void)
+{
+  unsigned int h;                                                                               /* counting variable */
+
+  if (lsFd != -1) close (lsFd);
+  for (h = 0; h < nHost; h++)
+    close (hostFd[h]);
+}
+
+/**
+ *  \brief Accepting the entity hosts, in distributed mode.
+ *
+ *  The local entity hosts are spawned and the connections are accepted until every customer and craftsman has been
+ *  claimed by some entity host. A claim of entities already claimed, or out of range, is refused.
+ *
+ *  \param addr address the coordinator listens at
+ *  \param nLocal number of entity hosts to be spawned
+ *  \param batchSize number of pieces a craftsman produces per visit to the store
+ */
+
+static void acceptHosts (char *addr, unsigned int nLocal, unsigned int batchSize)
+{
+  char first[12], count[12];                                         /* range of entities, as command line arguments */
+  char *argv[5];                                                                         /* command line of the host */
+  REMREC rec[REM_MAXREC];                                                                      /* records of a frame */
+  unsigned int nClaimed = 0,                                                    /* number of entities claimed so far */
+               n, h, j;                                                             /* number and counting variables */
+  int fd, err;                                                                    /* connection and spawning outcome */
+  pid_t pid;                                                                                   /* process identifier */
+
+  if ((lsFd = remListen (addr)) == -1)
+     { perror ("error on listening for the entity hosts");
+       exit (EXIT_FAILURE);
+     }
+  fcntl (lsFd, F_SETFD, FD_CLOEXEC);                                    /* the processes spawned do not inherit them */
+  for (h = 0; h < nLocal; h++)                                  /* the customers and craftsmen are shared out evenly */
+  { sprintf (first, "%u", 1 + h * (N+M) / nLocal);
+    sprintf (count, "%u", (h + 1) * (N+M) / nLocal - h * (N+M) / nLocal);
+    argv[0] = ENTITYHOST;
+    argv[1] = addr;
+    argv[2] = first;
+    argv[3] = count;
+    argv[4] = NULL;
+    if ((err = posix_spawn (&pid, ENTITYHOST, NULL, NULL, argv, environ)) != 0)
+       { errno = err;
+         perror ("error on the generation of the entityhost process");
+         exit (EXIT_FAILURE);
+       }
+    helper[nHelper++] = pid;
+  }
+
+  for (j = 1; j <= N+M; j++)
+    owner[j] = N+M;
+  while (nClaimed < N+M)
+  { if ((fd = accept (lsFd, NULL, NULL)) == -1)
+       { if (errno == EINTR) continue;
+         perror ("error on accepting an entity host");
+         exit (EXIT_FAILURE);
+       }
+    fcntl (fd, F_SETFD, FD_CLOEXEC);
+    if ((remRecv (fd, rec, &n) == -1) || (n != 1) || (rec[0].op != REM_HELLO) || (rec[0].val == 0) ||
+        (rec[0].ent + rec[0].val - 1 > N+M))
+       { fprintf (stderr, "An entity host did not greet the coordinator properly!\n");
+         close (fd);
+         continue;
+       }
+    for (j = rec[0].ent; j < rec[0].ent + rec[0].val; j++)
+      if (owner[j] != N+M) break;
+    if (j != rec[0].ent + rec[0].val)
+       { fprintf (stderr, "Entity %u is already run by another entity host!\n", j);
+         close (fd);
+         continue;
+       }
+    for (j = rec[0].ent; j < rec[0].ent + rec[0].val; j++)
+      owner[j] = nHost;
+    nClaimed += rec[0].val;
+    rec[0].val = batchSize;                                     /* the settings of the run the life cycles depend on */
+    if (remSend (fd, rec, 1) == -1)
+       { perror ("error on replying to an entity host");
+         exit (EXIT_FAILURE);
+       }
+    hostFd[nHost++] = fd;
+  }
+  close (lsFd);
+  lsFd = -1;
+  if ((strchr (addr, ':') == NULL) || (strchr (addr, '/') != NULL))  /* the Unix-domain socket is not needed anymore */
+     unlink (addr);
+}
+
+/**
+ *  \brief Carrying out of a request of an entity host, in distributed mode.
+ *
+ *  It is called by the workers serving the remote calls, several at a time, for different entities.
+ *
+ *  \param p_rq pointer to the location where the request is stored, and where the reply is to be stored
+ */
+
+static void serveCall (REMREC *p_rq)
+{
+  unsigned int op = p_rq->op;                                                                 /* operation requested */
+
+  if (p_rq->ent <= N)
+     customerServe (p_rq->ent - 1, p_rq);
+     else craftsmanServe (p_rq->ent - N - 1, p_rq);
+  if (((op == REM_END_OPER_CUST) || (op == REM_END_OPER_CRAFT)) && (p_rq->val != 0))
+     ended[p_rq->ent] = true;                                                   /* the life cycle has come to an end */
+}
+
+/**
+ *  \brief Serving the remote calls of the entity hosts, in distributed mode.
+ *
+ *  Every customer and craftsman is bound to the shared region at the coordinator, which then carries out their
+ *  operations until every entity host has closed its connection.
+ *
+ *  \param arg not used
+ *
+ *  \return \c NULL
+ */
+
+static void *serveHosts (void *arg)
+{
+  unsigned int i, h;                                                                           /* counting variables */
+
+  for (i = 1; i <= N; i++)
+    customerAttach (i-1, ent[i].argv[2], zSemgid, zSh);
+  for (i = N+1; i <= N+M; i++)
+    craftsmanAttach (i-N-1, ent[i].argv[2], zSemgid, zSh);
+  if (remServe (hostFd, nHost, owner, serveCall) == -1)
+     { perror ("error on serving the remote calls of the entity hosts");
+       exit (EXIT_FAILURE);
+     }
+  for (h = 0; h < nHost; h++)
+    close (hostFd[h]);
+  return NULL;
+}
+
+/**
+ *  \brief Checking whether a child process which has terminated is an entity host.
+ *
+ *  A failure is reported.
+ *
+ *  \param pid process identifier
+ *  \param status termination status
+ *
+ *  \return \c true, if it is
+ *  \return \c false, otherwise
+ */
+
+static bool helperEnded (pid_t pid, int status)
+{
+  unsigned int j;                                                                               /* counting variable */
+
+  for (j = 0; j < nHelper; j++)
+    if (helper[j] == pid) break;
+  if (j == nHelper) return false;
+  if (!WIFEXITED (status) || (WEXITSTATUS (status) != 0))
+     fprintf (stderr, "the entityhost process, with pid %d, has failed\n", (int) pid);
+  return true;
+}
+
+/**
+ *  \brief Life cycle of an intervening entity forked in zygote mode.
+ *
+ *  The child inherits the semaphore set and the mapping of the shared region and jumps straight into the life cycle
+ *  of the entity, as if it had been executed anew: the standard error is redirected to its own error file and the
+ *  random generator is reset to its default seed.
+ *
+ *  \param i entity number
+ */
+
+static void zygoteChild (unsigned int i)
+{
+  if (freopen (ent[i].errFile, "w", stderr) == NULL)
+     exit (EXIT_FAILURE);
+  srandom (1);
+  if (distributed)
+     closeChannels ();
+  if (i == 0)
+     entrepreneurRun (0, ent[i].argv[1], zSemgid, zSh);
+     else if (i <= N)
+             customerRun (i-1, ent[i].argv[2], zSemgid, zSh);
+             else if (i <= N+M)
+                     craftsmanRun (i-N-1, ent[i].argv[2], zSemgid, zSh);
+                     else if (i < N+M+NS)                            /* the entrepreneurs of the other shops, if any */
+                             entrepreneurRun (i-N-M, ent[i].argv[2], zSemgid, zSh);
+  exit (EXIT_SUCCESS);
+}
+
+/**
+ *  \brief Spawning of a batch of intervening entities.
+ *
+ *  Several batches may be spawned at the same time by different threads, except in zygote mode.
+ *
+ *  \param arg pointer to the batch description
+ *
+ *  \return \c NULL
+ */
+
+static void *spawnBatch (void *arg)
+{
+  BATCH *b = (BATCH *) arg;                                                                     /* batch description */
+  unsigned int i;                                                                               /* counting variable */
+
+  for (i = b->first; i < b->last; i++)
+    if (distributed && (i >= 1) && (i <= N+M))
+       ent[i].pid = -1;                                                       /* the entity is run by an entity host */
+       else if (zygote)
+               { if ((ent[i].pid = fork ()) == 0)
+                    zygoteChild (i);
+                 ent[i].err = (ent[i].pid == -1) ? errno : 0;
+               }
+               else ent[i].err = posix_spawn (&ent[i].pid, ent[i].path, NULL, NULL, ent[i].argv, environ);
+  return NULL;
+}
+
+/**
+ *  \brief Time elapsed between two instants.
+ *
+ *  \param t0 earlier instant
+ *  \param t1 later instant
+ *
+ *  \return elapsed time (in ms)
+ */
+
+static double elapsed (struct timespec *t0, struct timespec *t1)
+{
+  return (t1->tv_sec - t0->tv_sec) * 1e3 + (t1->tv_nsec - t0->tv_nsec) / 1e6;
+}
+
+/**
+ *  \brief Printing of the percentiles of a checkout latency histogram.
+ *
+ *  \param kind kind of latency
+ *  \param n customer identification (<tt>N</tt> for all the customers)
+ *  \param p_h pointer to the location where the histogram is stored
+ */
+
+static void printLatency (const char *kind, unsigned int n, HISTOGRAM *p_h)
+{
+  char who[16];                                                                                    /* customer label */
+
+  if (n == N)
+     strcpy (who, "all");
+     else sprintf (who, "customer %u", n);
+  printf ("  %-9s %-13s %12llu %8.1f %8.1f %8.1f %8.1f %8.1f\n", kind, who, (unsigned long long) p_h->count,
+          histPercentile (p_h, 0.5) / 1e3, histPercentile (p_h, 0.9) / 1e3, histPercentile (p_h, 0.99) / 1e3,
+          histPercentile (p_h, 0.999) / 1e3, p_h->max / 1e3);
+}
+
+/**
+ *  \brief Printing of the statistics of a lock of the critical region.
+ *
+ *  \param kind kind of lock
+ *  \param l lock identification
+ *  \param nLock number of locks in use
+ *  \param p_lk pointer to the location where the lock is stored
+ */
+
+static void printLock (unsigned int kind, unsigned int l, unsigned int nLock, CRLOCK *p_lk)
+{
+  char what[16];                                                                                       /* lock label */
+
+  if (nLock == 1)
+     strcpy (what, "lock");
+     else if (l < NS)
+             sprintf (what, "shop %u", l);
+             else strcpy (what, (l == CR_WSLOCK) ? "workshop" : "log");
+  if (kind == CR_LOCK_SPIN)
+     printf ("  %s: mean hold %.3f us; %lu entries with the lock free, %lu after spinning, %lu after parking (spin "
+             "success rate %.1f%%)\n", what, p_lk->holdNs / 1e3, (unsigned long) p_lk->nFree,
+             (unsigned long) p_lk->nSpin, (unsigned long) p_lk->nPark,
+             (p_lk->nSpin + p_lk->nPark == 0) ? 0.0 : 100.0 * p_lk->nSpin / (p_lk->nSpin + p_lk->nPark));
+     else { printf ("  %s: mean hold %.3f us; %lu entries with the lock free, %lu after spinning, %lu after parking; "
+                    "up to %u processes waiting", what, p_lk->holdNs / 1e3, (unsigned long) p_lk->nFree,
+                    (unsigned long) p_lk->nSpin, (unsigned long) p_lk->nPark, p_lk->qMax);
+            if (kind == CR_LOCK_PRIO)
+               printf (", %lu handed to an entrepreneur ahead of the queue", (unsigned long) p_lk->nPrio);
+            printf ("\n");
+          }
+}
+
 /**
  *  \brief Main program.
  *
@@ -53,7 +510,6 @@
 int main (int argc, char *argv[])
 {
   char nFic[21];                                                                              /*name of logging file */
-  char nFicErr[] = "error____";                                                          /* base name of error files */
   FILE *fic;                                                                                      /* file descriptor */
   int shmid,                                                                      /* shared memory access identifier */
       semgid;                                                                     /* semaphore set access identifier */
@@ -61,14 +517,238 @@ int main (int argc, char *argv[])
   char opt;                                                                                                /* answer */
   unsigned int i, n;                                                                           /* counting variables */
   SHARED_DATA *sh;                                                                /* pointer to shared memory region */
-  int pidE,                                                                       /* entrepreneur process identifier */
-      pidCT[N],                                                                    /* customer processes identifiers */
-      pidCF[M];                                                                   /* craftsman processes identifiers */
   int key;                                                           /*access key to shared memory and semaphore set */
-  char num[2][12];                                                     /* numeric value conversion (up to 10 digits) */
+  char num[12];                                             /* numeric value conversion of the key (up to 10 digits) */
   int status,                                                                                    /* execution status */
       info;                                                                                               /* info id */
-  bool term;                                                                             /* process termination flag */
+  unsigned int logMode = LOG_TEXT;                                                                   /* logging mode */
+  int c;                                                                                      /* command line option */
+  bool hugeReq = false,                                                                      /* huge pages requested */
+       huge = false;                                                           /* shared region backed by huge pages */
+  unsigned int place = PLACE_NONE;                                                               /* placement policy */
+  bool bindReq = false;                                                    /* binding of the shared region requested */
+  int bindErr = -1;                                                         /* binding outcome (errno, 0 when bound) */
+  unsigned int nThr = 1;                                                               /* number of spawning threads */
+  bool legacy = false;                                       /* entities which do not take part in the start barrier */
+  BATCH batch[N+M+NS];                                                          /* batches of entities to be spawned */
+  pthread_t thr[N+M+NS];                                                                         /* spawning threads */
+  struct timespec tStart, tReady, tEnd;                          /* start of generation, start and end of operations */
+  char *tinp;                                                                      /* numerical parameters test flag */
+  unsigned int batchSize = 1;                        /* number of pieces a craftsman produces per visit to the store */
+  int policy = SCHED_FIXED;                                                                     /* scheduling policy */
+  unsigned int weight[SCHED_NREQ] = SCHED_WEIGHTS;                            /* weights of the weighted fair policy */
+  bool doorGateOn = false;                                                                         /* door gate mode */
+  unsigned int routing = ROUTE_RANDOM;                                                /* routing policy of customers */
+  char *traceFile = NULL;                                                            /* trace file name (no tracing) */
+  char *ckptFile = NULL,                                                    /* checkpoint file name (no checkpoints) */
+       *warmFile = NULL;                                          /* checkpoint file to warm start from (cold start) */
+  unsigned int ckptMs = 0;                                       /* interval between checkpoints (only upon request) */
+  unsigned int nCkpt = 0;                                                             /* number of checkpoints taken */
+  CHECKPOINT ck;                                                                    /* checkpoint to warm start from */
+  unsigned int owed[NS] = { 0 };                         /* up operations owed to the semaphore proceed of each shop */
+  uint64_t simBase = 0;                                                 /* time simulated before the warm start (ns) */
+  uint64_t simNs;                                                             /* time simulated at a checkpoint (ns) */
+  struct sigaction sa;                                                                   /* checkpoint signal action */
+  unsigned int crMode = CR_FREE;                                               /* mode of the critical region access */
+  unsigned int crLockKind = CR_LOCK_SEM;                                              /* lock of the critical region */
+  bool crSingle = false,                                    /* a single lock for the whole critical region requested */
+       crSplit = false;                                                                     /* split locks requested */
+  char *crFile = NULL;                                                                           /* replay file name */
+  unsigned int crConf[CR_NCONF] = { 0 };                      /* settings which change the behaviour of the entities */
+  struct itimerval itv;                                                                 /* checkpoint interval timer */
+  char *remAddr = NULL;                                              /* address of the coordinator (not distributed) */
+  unsigned int nLocal = 1;                                                 /* number of entity hosts spawned locally */
+  unsigned int nProc;                                     /* number of intervening processes spawned by the launcher */
+  pthread_t srvThr;                                                       /* thread serving the remote calls, if any */
+  sigset_t sigMask, sigOld;                                     /* checkpoint signals, blocked in the serving thread */
+
+  /* processing command line options */
+
+  while ((c = getopt (argc, argv, "l:Hp:bj:LZk:Ds:r:T:c:C:w:R:P:N:n:A:GS")) != -1)
+    switch (c)
+    { case 'l': if (strcmp (optarg, "text") == 0)
+                   logMode = LOG_TEXT;
+                   else if (strcmp (optarg, "lz") == 0)
+                           logMode = LOG_LZ;
+                           else if (strcmp (optarg, "mmap") == 0)
+                                   logMode = LOG_MMAP;
+                                   else if (strcmp (optarg, "uring") == 0)
+                                           logMode = LOG_URING;
+                                           else { fprintf (stderr, "Invalid logging mode: %s\n", optarg);
+                                                  exit (EXIT_FAILURE);
+                                                }
+                break;
+      case 'H': hugeReq = true;
+                break;
+      case 'p': if (strcmp (optarg, "none") == 0)
+                   place = PLACE_NONE;
+                   else if (strcmp (optarg, "spread") == 0)
+                           place = PLACE_SPREAD;
+                           else if (strcmp (optarg, "compact") == 0)
+                                   place = PLACE_COMPACT;
+                                   else { fprintf (stderr, "Invalid placement policy: %s\n", optarg);
+                                          exit (EXIT_FAILURE);
+                                        }
+                break;
+      case 'b': bindReq = true;
+                break;
+      case 'j': nThr = (unsigned int) strtol (optarg, &tinp, 0);
+                if ((*tinp != '\0') || (nThr == 0))
+                   { fprintf (stderr, "Invalid number of spawning threads: %s\n", optarg);
+                     exit (EXIT_FAILURE);
+                   }
+                break;
+      case 'L': legacy = true;
+                break;
+      case 'Z': zygote = true;
+                break;
+      case 'k': batchSize = (unsigned int) strtol (optarg, &tinp, 0);
+                if ((*tinp != '\0') || (batchSize == 0))
+                   { fprintf (stderr, "Invalid production batch size: %s\n", optarg);
+                     exit (EXIT_FAILURE);
+                   }
+                break;
+      case 'D': doorGateOn = true;
+                break;
+      case 's': if ((policy = schedParse (optarg, weight)) == -1)
+                   { fprintf (stderr, "Invalid scheduling policy: %s\n", optarg);
+                     exit (EXIT_FAILURE);
+                   }
+                break;
+      case 'r': for (routing = ROUTE_RANDOM; routing <= ROUTE_STICKY; routing++)
+                  if (strcmp (optarg, routeName[routing]) == 0) break;
+                if (routing > ROUTE_STICKY)
+                   { fprintf (stderr, "Invalid routing policy: %s\n", optarg);
+                     exit (EXIT_FAILURE);
+                   }
+                break;
+      case 'T': if (strlen (optarg) >= TRACE_NAMESZ)
+                   { fprintf (stderr, "Trace file name is too long: %s\n", optarg);
+                     exit (EXIT_FAILURE);
+                   }
+                traceFile = optarg;
+                break;
+      case 'c': ckptFile = optarg;
+                break;
+      case 'C': ckptMs = (unsigned int) strtol (optarg, &tinp, 0);
+                if ((*tinp != '\0') || (ckptMs == 0))
+                   { fprintf (stderr, "Invalid checkpoint interval: %s\n", optarg);
+                     exit (EXIT_FAILURE);
+                   }
+                break;
+      case 'w': warmFile = optarg;
+                break;
+      case 'R':
+      case 'P': if (strlen (optarg) >= CR_NAMESZ)
+                   { fprintf (stderr, "Replay file name is too long: %s\n", optarg);
+                     exit (EXIT_FAILURE);
+                   }
+                crMode = (c == 'R') ? CR_RECORD : CR_REPLAY;
+                crFile = optarg;
+                break;
+      case 'N': remAddr = optarg;
+                break;
+      case 'n': nLocal = (unsigned int) strtol (optarg, &tinp, 0);
+                if ((*tinp != '\0') || (nLocal > N+M))
+                   { fprintf (stderr, "Invalid number of entity hosts: %s\n", optarg);
+                     exit (EXIT_FAILURE);
+                   }
+                break;
+      case 'A': if (strcmp (optarg, "sem") == 0)
+                   crLockKind = CR_LOCK_SEM;
+                   else if (strcmp (optarg, "spin") == 0)
+                           crLockKind = CR_LOCK_SPIN;
+                           else if (strcmp (optarg, "fair") == 0)
+                                   crLockKind = CR_LOCK_FAIR;
+                                   else if (strcmp (optarg, "fair:prio") == 0)
+                                           crLockKind = CR_LOCK_PRIO;
+                                           else { fprintf (stderr, "Invalid critical region lock: %s\n", optarg);
+                                                  exit (EXIT_FAILURE);
+                                                }
+                break;
+      case 'G': crSingle = true;
+                break;
+      case 'S': crSplit = true;
+                break;
+      default:  fprintf (stderr, "Usage: %s [-l text|lz|mmap|uring] [-H] [-p none|spread|compact] [-b] [-j threads] "
+                         "[-L] [-Z] [-k pieces] [-D] [-s fixed|oldest|weighted[:c,p,g]|throughput] "
+                         "[-r random|shortest|sticky] [-T trace_file] "
+                         "[-c ckpt_file] [-C ms] [-w ckpt_file] [-R replay_file | -P replay_file] "
+                         "[-N address [-n hosts]] [-A sem|spin|fair[:prio]] [-G | -S]\n", argv[0]);
+                exit (EXIT_FAILURE);
+    }
+  if (!zygote && (remAddr == NULL) && (access (LEGACYMARK, F_OK) == 0))             /* some entities are precompiled */
+     legacy = true;
+  if (legacy && ((batchSize != 1) || doorGateOn || (policy != SCHED_FIXED) || (traceFile != NULL)))
+     { fprintf (stderr, "Batched production, the door gate, scheduling policies and tracing do not apply to "
+                        "precompiled entities!\n");
+       exit (EXIT_FAILURE);
+     }
+  if (legacy && (NS > 1))
+     { fprintf (stderr, "Several shops do not apply to precompiled entities!\n");
+       exit (EXIT_FAILURE);
+     }
+  if (legacy && ((ckptFile != NULL) || (warmFile != NULL)))
+     { fprintf (stderr, "Checkpoints and warm starts do not apply to precompiled entities!\n");
+       exit (EXIT_FAILURE);
+     }
+  if (legacy && (crMode != CR_FREE))
+     { fprintf (stderr, "Recording and replaying do not apply to precompiled entities!\n");
+       exit (EXIT_FAILURE);
+     }
+  if (legacy && (logMode != LOG_TEXT))
+     { fprintf (stderr, "Precompiled entities only append plain text to the log file!\n");
+       exit (EXIT_FAILURE);
+     }
+  if (legacy && (crLockKind != CR_LOCK_SEM))
+     { fprintf (stderr, "Precompiled entities only lock the critical region through the semaphore access!\n");
+       exit (EXIT_FAILURE);
+     }
+  if ((crMode != CR_FREE) && ((ckptFile != NULL) || (warmFile != NULL)))
+     { fprintf (stderr, "Checkpoints and warm starts can not be recorded or replayed!\n");
+       exit (EXIT_FAILURE);
+     }
+  if (crSingle && crSplit)
+     { fprintf (stderr, "A single lock and split locks can not be both requested!\n");
+       exit (EXIT_FAILURE);
+     }
+  if (crSplit && (legacy || (crMode != CR_FREE)))
+     { fprintf (stderr, "Split locks do not apply to precompiled entities, nor when recording or replaying!\n");
+       exit (EXIT_FAILURE);
+     }
+  if ((ckptMs != 0) && (ckptFile == NULL))
+     { fprintf (stderr, "A checkpoint interval requires a checkpoint file!\n");
+       exit (EXIT_FAILURE);
+     }
+  if ((warmFile != NULL) && (ckptLoad (warmFile, &ck) == -1))
+     { fprintf (stderr, "error on loading the checkpoint %s: %s\n", warmFile,
+                (errno == EINVAL) ? "not a checkpoint of this problem" : strerror (errno));
+       exit (EXIT_FAILURE);
+     }
+  if (legacy && (remAddr != NULL))
+     { fprintf (stderr, "The distributed mode does not apply to precompiled entities!\n");
+       exit (EXIT_FAILURE);
+     }
+  if (remAddr != NULL)
+     distributed = true;
+  if (zygote && legacy)
+     { fprintf (stderr, "The zygote mode does not apply to precompiled entities!\n");
+       exit (EXIT_FAILURE);
+     }
+#ifdef SHMEM_POSIX
+  if (legacy)
+     { fprintf (stderr, "Precompiled entities use SysV shared memory: build the launcher without SHMEM_POSIX!\n");
+       exit (EXIT_FAILURE);
+     }
+#endif
+  if (bindReq && (place == PLACE_NONE))
+     { fprintf (stderr, "Binding the shared region requires a placement policy!\n");
+       exit (EXIT_FAILURE);
+     }
+  if (placeInit (place) == -1)
+     { perror ("error on finding out the processors available");
+       exit (EXIT_FAILURE);
+     }
 
   /* getting log file name */
 
@@ -98,16 +778,18 @@ int main (int argc, char *argv[])
 
   /* composing command line */
 
-  sprintf (num[0], "%s", "0");
   if ((key = ftok (".", 'a')) == -1)
      { perror ("error on generating the key");
        exit (EXIT_FAILURE);
      }
-  sprintf (num[1], "%d", key);
+  sprintf (num, "%d", key);
 
   /* creating and initializing the shared memory region and the log file */
 
-  if ((shmid = shmemCreate (key, sizeof (SHARED_DATA))) == -1)
+  if (hugeReq)
+     shmid = shmemCreateHuge (key, sizeof (SHARED_DATA), &huge);
+     else shmid = shmemCreate (key, sizeof (SHARED_DATA));
+  if (shmid == -1)
      { perror ("error on creating the shared memory region");
        exit (EXIT_FAILURE);
      }
@@ -115,6 +797,8 @@ int main (int argc, char *argv[])
      { perror ("error on mapping the shared region on the process address space");
        exit (EXIT_FAILURE);
      }
+  if (bindReq)                               /* before the region is touched; prefaulted pages are moved, if need be */
+     bindErr = (placeMemory (sh, sizeof (SHARED_DATA)) == -1) ? errno : 0;
 
   srandom ((unsigned int) getpid ());                                                 /* initialize random generator */
 
@@ -132,10 +816,25 @@ int main (int argc, char *argv[])
        sh->fSt.primeMaterials[NP-1] = 2*PP*M;
      }
   if (total % PP != 0) sh->fSt.primeMaterials[NP-1] += PP - total % PP;
+  crConf[0] = batchSize;
+  crConf[1] = doorGateOn;
+  crConf[2] = (unsigned int) policy;
+  for (i = 0; i < SCHED_NREQ; i++)
+    crConf[3+i] = (policy == SCHED_WEIGHTED) ? weight[i] : 0;
+  crConf[6] = (NS > 1) ? NS : 0;
+  crConf[7] = (NS > 1) ? routing : 0;
+  if (crInit (&(sh->cr), crMode, crLockKind, crSingle || legacy || ((NS == 1) && !crSplit), crFile, crConf,
+              sh->fSt.primeMaterials) == -1)                                                     /* replayed amounts */
+     { fprintf (stderr, "error on %s the replay file %s: %s\n", (crMode == CR_RECORD) ? "creating" : "loading", crFile,
+                (errno == EINVAL) ? "not a replay file of this problem, or recorded with other settings"
+                                  : strerror (errno));
+       exit (EXIT_FAILURE);
+     }
 
     /* initialize problem internal status */
 
-  sh->fSt.st.entrepStat = OPENING_THE_SHOP;                                  /* the entrepreneur is opening the shop */
+  for (i = 0; i < NS; i++)
+    sh->fSt.st.entrepStat[i] = OPENING_THE_SHOP;                          /* the entrepreneurs are opening the shops */
   for (i = 0; i < N; i++)
   { sh->fSt.st.custStat[i].stat = CARRYING_OUT_DAILY_CHORES;                      /* the customer is living his life */
     sh->fSt.st.custStat[i].boughtPieces = 0;                                          /* no goods were bought so far */
@@ -149,13 +848,20 @@ int main (int argc, char *argv[])
     sh->fSt.st.craftStat[i].readyToWork = true;                     /* the customer is operative - availability flag
                                                                                           required by the simulation */
   }
-  sh->fSt.shop.stat = SCLOSED;                                                                 /* the shop is closed */
-  sh->fSt.shop.nCustIn = 0;                                            /* no customers are presently inside the shop */
-  sh->fSt.shop.nProdIn = 0;                                                      /* the shop has no products to sell */
-  sh->fSt.shop.prodTransfer = false;                 /* no craftsman has phoned yet to request the transfer of a new
+  for (i = 0; i < NS; i++)
+  { sh->fSt.shop[i].stat = SCLOSED;                                                            /* the shop is closed */
+    sh->fSt.shop[i].nCustIn = 0;                                       /* no customers are presently inside the shop */
+    sh->fSt.shop[i].nProdIn = 0;                                                 /* the shop has no products to sell */
+    sh->fSt.shop[i].prodTransfer = false;            /* no craftsman has phoned yet to request the transfer of a new
                                                                                                    batch of products */
-  sh->fSt.shop.primeMatReq = false;    /* no craftsman has phoned yet asking for the deliver of more prime materials */
-  queueInit (&(sh->fSt.shop.queue));                                                /* waiting queue is set to empty */
+    sh->fSt.shop[i].primeMatReq = false;
+                                       /* no craftsman has phoned yet asking for the deliver of more prime materials */
+    queueInit (&(sh->fSt.shop[i].queue));                                           /* waiting queue is set to empty */
+    schedInit (&(sh->sched[i]), (unsigned int) policy, weight);             /* scheduling information initialization */
+    sh->nCustomersBlk[i] = 0;                                     /* no customer is waiting for the door to open yet */
+    sh->inBusiness[i] = true;                                                       /* the entrepreneur is operative */
+  }
+  sh->routing = routing;                                                              /* routing policy of customers */
   sh->fSt.workShop.nPMatIn = sh->fSt.primeMaterials[0];      /* first deliver of prime materials is presently stored
                                                                                                  inside the workshop */
   sh->fSt.workShop.nProdIn = 0;                                                  /* the storeroom is presently empty */
@@ -163,19 +869,41 @@ int main (int argc, char *argv[])
   sh->fSt.workShop.NTPMat = sh->fSt.primeMaterials[0];         /* initial storage of prime materials in the workshop */
   sh->fSt.workShop.NTProd = 0;                                                 /* no products have been produced yet */
   sh->nCraftsmenBlk = 0;                                  /* no craftsman threads is waiting for prime materials yet */
+  sh->batchSize = batchSize;                                     /* number of pieces produced per visit to the store */
+  sh->doorGateOn = doorGateOn;                                                                     /* door gate mode */
+  for (i = 0; i <= N; i++)                                                  /* checkout latency histograms are empty */
+  { histInit (&(sh->queueLat[i]));
+    histInit (&(sh->serviceLat[i]));
+  }
+  if (warmFile != NULL)                                      /* the state recorded in the checkpoint replaces it all */
+     { ckptWarm (&ck, sh, owed);
+       simBase = ck.simNs;
+     }
 
     /* initialize problem internal status */
 
+  logInit (&(sh->log), logMode);                                               /* logging information initialization */
   createLog (nFic);                                                                             /* log file creation */
+  traceInit (&(sh->trace), traceFile);                                                /* trace file creation, if any */
   saveState (nFic, &(sh->fSt));                                                               /* store initial state */
 
     /* initialize semaphore ids */
 
   sh->access = ACCESS;                                                              /* mutual exclusion semaphore id */
-  sh->proceed = PROCEED;                                             /* entrepreneur appraise situation semaphore id */
+  for (i = 0; i < CR_NLOCK; i++)
+    sh->lockSem[i] = (i == 0) ? ACCESS : B_LOCK + i - 1;                       /* critical region lock semaphores id */
+  for (i = 0; i < NS; i++)
+    sh->proceed[i] = (i == 0) ? PROCEED : B_PROCEED + i - 1;       /* entrepreneurs appraise situation semaphores id */
   sh->waitForMaterials = WAITFORMATERIALS;                     /* craftsmen waiting for prime materials semaphore id */
   for (i = 0; i < N; i++)
     sh->waitForService[i] = B_WAITFORSERVICE + i;                      /*customers waiting for service semaphores id */
+  sh->attached = ATTACHED;                                    /* entities attached to the shared region semaphore id */
+  sh->start = START;                                                             /* start of operations semaphore id */
+  for (i = 0; i < NS; i++)
+    sh->doorGate[i] = (i == 0) ? DOORGATE : B_DOORGATE + i - 1;               /* customers waiting for the door to open
+                                                                                                       semaphores id */
+  for (i = 0; i < N+M+NS; i++)
+    sh->turn[i] = B_TURN + i;                                     /* turn to enter the critical region semaphores id */
 
   /* creating and initializing the semaphore set */
 
@@ -183,50 +911,92 @@ int main (int argc, char *argv[])
      { perror ("error on creating the semaphore set");
        exit (EXIT_FAILURE);
      }
-  if (semUp (semgid, sh->access) == -1)                                        /* enabling access to critical region */
+  if (crUnlock (&(sh->cr), semgid, sh->lockSem) == -1)                         /* enabling access to critical region */
      { perror ("error on executing the up operation for semaphore access");
        exit (EXIT_FAILURE);
      }
+  if (crStart (&(sh->cr), semgid, sh->turn) == -1)                            /* first turn to enter, when replaying */
+     { perror ("error on executing the up operation for semaphore turn");
+       exit (EXIT_FAILURE);
+     }
+  for (i = 0; i < NS; i++)
+    if ((owed[i] != 0) && (semUpN (semgid, sh->proceed[i], owed[i]) == -1))   /* pending phone calls of a warm start */
+       { perror ("error on executing the up operation for semaphore proceed");
+         exit (EXIT_FAILURE);
+       }
 
-  /* generation of intervening entities processes */
+  /* composing the command lines of the intervening entities */
 
-  if ((pidE = fork ()) < 0)                                                                  /* entrepreneur process */
-     { perror ("error on the fork operation for the entrepreneur");
-       exit (EXIT_FAILURE);
+  for (i = 0; i < N+M+NS; i++)
+  { if (i == 0)
+       { ent[i].path = ENTREPRENEUR;
+         strcpy (ent[i].errFile, "error_ET");
+       }
+       else if (i <= N)
+               { ent[i].path = CUSTOMER;
+                 sprintf (ent[i].errFile, "error_CT%u", i-1);
+               }
+               else if (i <= N+M)
+                       { ent[i].path = CRAFTSMAN;
+                         sprintf (ent[i].errFile, "error_CF%u", i-N-1);
+                       }
+                       else { ent[i].path = ENTREPRENEUR;
+                              sprintf (ent[i].errFile, "error_ET%u", i-N-M);
+                            }
+    sprintf (ent[i].id, "%u", (i <= N) ? i-1 : ((i <= N+M) ? i-N-1 : i-N-M));
+    n = 0;
+    ent[i].argv[n++] = ent[i].path;
+    if (i != 0) ent[i].argv[n++] = ent[i].id;
+    ent[i].argv[n++] = nFic;
+    ent[i].argv[n++] = num;
+    ent[i].argv[n++] = ent[i].errFile;
+    ent[i].argv[n] = NULL;
+  }
+
+  /* accepting the entity hosts, in distributed mode */
+
+  if (distributed)
+     acceptHosts (remAddr, nLocal, batchSize);
+  nProc = distributed ? NS : N+M+NS;                                  /* the customers and craftsmen are not spawned */
+
+  /* generation of intervening entities processes, in parallel batches */
+
+  clock_gettime (CLOCK_MONOTONIC, &tStart);
+  zSemgid = semgid;
+  zSh = sh;
+  if (zygote)                   /* forking is only safe from a single threaded process; pending output is flushed so
+                                                                                it is not written again by the children */
+     { nThr = 1;
+       fflush (NULL);
      }
-  strcpy (nFicErr + 6, "ET");
-  if (pidE == 0)
-     if (execl (ENTREPRENEUR, ENTREPRENEUR, nFic, num[1], nFicErr, NULL) < 0)
-          { perror ("error on the generation of the entrepreneur process");
-            exit (EXIT_FAILURE);
-          }
-  strcpy (nFicErr + 6, "CT");
-  for (i = 0; i < N; i++)                                                                     /* customers processes */
-  { if ((pidCT[i] = fork ()) < 0)
-       { perror ("error on the fork operation for the customer");
+  if (nThr > N+M+NS) nThr = N+M+NS;
+  for (i = 0; i < nThr; i++)
+  { batch[i].first = i * (N+M+NS) / nThr;
+    batch[i].last = (i + 1) * (N+M+NS) / nThr;
+    if ((i != 0) && ((status = pthread_create (&thr[i], NULL, spawnBatch, &batch[i])) != 0))
+       { errno = status;
+         perror ("error on creating a spawning thread");
          exit (EXIT_FAILURE);
        }
-    num[0][0] = '0' + i;
-    nFicErr[8] = '0' + i;
-    if (pidCT[i] == 0)
-       if (execl (CUSTOMER, CUSTOMER, num[0], nFic, num[1], nFicErr, NULL) < 0)
-          { perror ("error on the generation of the customer process");
-            exit (EXIT_FAILURE);
-          }
   }
-  strcpy (nFicErr + 6, "CF");
-  for (i = 0; i < M; i++)                                                                     /* craftsmen processes */
-  { if ((pidCF[i] = fork ()) < 0)
-       { perror ("error on the fork operation for the craftsman");
+  spawnBatch (&batch[0]);                                                   /* the first batch is spawned right here */
+  for (i = 1; i < nThr; i++)
+    if ((status = pthread_join (thr[i], NULL)) != 0)
+       { errno = status;
+         perror ("error on waiting for a spawning thread");
+         exit (EXIT_FAILURE);
+       }
+  for (i = 0; i < N+M+NS; i++)
+  { if (distributed && (i >= 1) && (i <= N+M)) continue;
+    if (ent[i].err != 0)
+       { errno = ent[i].err;
+         fprintf (stderr, "error on the generation of the %s process: %s\n", ent[i].path + 2, strerror (errno));
+         exit (EXIT_FAILURE);
+       }
+    if (placeProcess (ent[i].pid, i) == -1)
+       { fprintf (stderr, "error on pinning the %s process: %s\n", ent[i].path + 2, strerror (errno));
          exit (EXIT_FAILURE);
        }
-    num[0][0] = '0' + i;
-    nFicErr[8] = '0' + i;
-    if (pidCF[i] == 0)
-       if (execl (CRAFTSMAN, CRAFTSMAN, num[0], nFic, num[1], nFicErr, NULL) < 0)
-          { perror ("error on the generation of the craftsman process");
-            exit (EXIT_FAILURE);
-          }
   }
 
   /* signaling start of operations */
@@ -235,6 +1005,58 @@ int main (int argc, char *argv[])
      { perror ("error on signaling start of operations");
        exit (EXIT_FAILURE);
      }
+  if (!legacy)
+     { if (semDownN (semgid, sh->attached, nProc) == -1)                     /* every intervening entity is attached */
+          { perror ("error on waiting for the intervening entities to attach");
+            exit (EXIT_FAILURE);
+          }
+     }
+  clock_gettime (CLOCK_MONOTONIC, &tReady);
+
+  /* releasing the start barrier: the entities built with the launcher wait at it, even if others are precompiled */
+
+  if (semUpN (semgid, sh->start, nProc) == -1)
+     { perror ("error on releasing the start barrier");
+       exit (EXIT_FAILURE);
+     }
+
+  /* serving the remote calls of the entity hosts, in distributed mode, with the checkpoint signals left to the main
+     thread */
+
+  if (distributed)
+     { sigemptyset (&sigMask);
+       sigaddset (&sigMask, SIGUSR1);
+       sigaddset (&sigMask, SIGALRM);
+       pthread_sigmask (SIG_BLOCK, &sigMask, &sigOld);
+       if ((status = pthread_create (&srvThr, NULL, serveHosts, NULL)) != 0)
+          { errno = status;
+            perror ("error on creating the thread serving the entity hosts");
+            exit (EXIT_FAILURE);
+          }
+       pthread_sigmask (SIG_SETMASK, &sigOld, NULL);
+     }
+
+  /* checkpoints are requested by signals, which interrupt the wait for the intervening entities */
+
+  if (ckptFile != NULL)
+     { memset (&sa, 0, sizeof (sa));
+       sa.sa_handler = ckptSignal;
+       sigemptyset (&sa.sa_mask);
+       sa.sa_flags = 0;                                                     /* no SA_RESTART, so wait is interrupted */
+       if ((sigaction (SIGUSR1, &sa, NULL) == -1) || (sigaction (SIGALRM, &sa, NULL) == -1))
+          { perror ("error on installing the checkpoint signal handler");
+            exit (EXIT_FAILURE);
+          }
+       if (ckptMs != 0)
+          { itv.it_interval.tv_sec = ckptMs / 1000;
+            itv.it_interval.tv_usec = (ckptMs % 1000) * 1000;
+            itv.it_value = itv.it_interval;
+            if (setitimer (ITIMER_REAL, &itv, NULL) == -1)
+               { perror ("error on arming the checkpoint timer");
+                 exit (EXIT_FAILURE);
+               }
+          }
+     }
 
   /* waiting for the termination of the intervening entities processes */
 
@@ -242,33 +1064,152 @@ int main (int argc, char *argv[])
   n = 0;
   do
   { info = wait (&status);
-    term = false;
-    for (i = 0; i < N+M+1; i++)
-      if ((i == 0) && (info == pidE))
-         { term = true;
-           break;
-         }
-	 else if ((i > 0) && (i <= N) && (info == pidCT[i-1]))
-                 { term = true;
-                   break;
-                 }
-		 else if ((i > N) && (i <= N+M) && (info == pidCF[i-N-1]))
-                         { term = true;
-                           break;
-                         }
-    if (!term)
+    if ((info == -1) && (errno == EINTR))
+       { if (ckptReq && (n == 0))                               /* no checkpoint once the simulation is winding down */
+            { ckptReq = 0;
+              clock_gettime (CLOCK_MONOTONIC, &tEnd);
+              simNs = simBase + (uint64_t) (elapsed (&tReady, &tEnd) * 1e6);
+              while (((t = ckptSave (ckptFile, semgid, sh, simNs)) == -1) && (errno == EINTR)) ;
+              if (t == 0)
+                 nCkpt += 1;
+                 else if (errno != EBUSY)
+                         perror ("error on taking a checkpoint");
+            }
+         continue;
+       }
+    if (helperEnded (info, status)) continue;
+    for (i = 0; i < N+M+NS; i++)
+      if (info == ent[i].pid) break;
+    if (i == N+M+NS)
        { perror ("error on waiting for an intervening process");
          exit (EXIT_FAILURE);
        }
-    if (i == 0)
+    if ((i == 0) && (NS == 1))
        printf ("the entrepreneur process has terminated: ");
+       else if ((i == 0) || (i > N+M))
+               printf ("the entrepreneur process, of shop %u, has terminated: ", (i == 0) ? 0 : i-N-M);
        else if (i <= N)
 	       printf ("the customer process, with id %u, has terminated: ", i-1);
                else printf ("the craftsman process, with id %u, has terminated: ", i-N-1);
     if (WIFEXITED (status))
        printf ("its status was %d\n", WEXITSTATUS (status));
     n += 1;
-  } while (n < N+M+1);
+  } while (n < nProc);
+  if (distributed)
+     { if ((status = pthread_join (srvThr, NULL)) != 0)
+          { errno = status;
+            perror ("error on waiting for the thread serving the entity hosts");
+            exit (EXIT_FAILURE);
+          }
+       crFlush ();                              /* the records gathered on behalf of the customers and the craftsmen */
+       traceFlush ();
+       for (i = 1; i <= N+M; i++)
+         printf ("the %s, with id %u, run by an entity host, has %s\n", (i <= N) ? "customer" : "craftsman",
+                 (i <= N) ? i-1 : i-N-1, ended[i] ? "come to the end of its life cycle" : "not finished");
+     }
+
+  clock_gettime (CLOCK_MONOTONIC, &tEnd);
+  if (ckptMs != 0)                                                                 /* disarming the checkpoint timer */
+     { memset (&itv, 0, sizeof (itv));
+       setitimer (ITIMER_REAL, &itv, NULL);
+     }
+  while (((info = wait (&status)) != -1) || (errno == EINTR))                         /* the entity hosts still left */
+    if (info != -1) helperEnded (info, status);
+
+  /* run summary */
+
+  printf ("\nRun summary\n");
+  printf ("startup: %.3f ms (%s, %u spawning thread%s, %s)\n", elapsed (&tStart, &tReady),
+          zygote ? "zygote" : "posix_spawn", nThr, (nThr == 1) ? "" : "s",
+          legacy ? "no start barrier" : "until every entity was attached");
+  printf ("simulation: %.3f ms\n", elapsed (&tReady, &tEnd));
+  if (warmFile != NULL)
+     { printf ("warm start: from %s, taken after %.3f ms of simulation; recorded %u craftsm%s and %u customer%s "
+               "blocked, semaphores", warmFile, simBase / 1e6, ck.nCraftsmenBlk, (ck.nCraftsmenBlk == 1) ? "an" : "en",
+               ck.nCustomersBlk, (ck.nCustomersBlk == 1) ? "" : "s");
+       for (i = 1; i <= SEM_NU; i++)
+         printf (" %u", ck.sem[i]);
+       printf ("\n");
+     }
+  if (ckptFile != NULL)
+     printf ("checkpoints: %u taken into %s\n", nCkpt, ckptFile);
+  if (crMode == CR_RECORD)
+     printf ("critical region: %u entries recorded into %s\n", sh->cr.nEntry, crFile);
+     else if (crMode == CR_REPLAY)
+             printf ("critical region: %u of %u entries replayed from %s\n", sh->cr.nEntry, sh->cr.nRec, crFile);
+  printf ("critical region lock%s: %s", (sh->cr.nLock == 1) ? "" : "s", lockName[crLockKind]);
+  if (sh->cr.nLock == 1)
+     printf (", a single one\n");
+     else printf (", one per shop, one for the workshop and one for the log\n");
+  if (crLockKind != CR_LOCK_SEM)
+     for (i = 0; i < sh->cr.nLock; i++)
+       printLock (crLockKind, i, sh->cr.nLock, &(sh->cr.lk[i]));
+  printf ("craftsmen production: %u piece%s per visit to the store\n", batchSize, (batchSize == 1) ? "" : "s");
+  if (logMode == LOG_URING)
+     { if (sh->log.nFallback == 0)
+          printf ("logging: io_uring in every process\n");
+          else printf ("logging: io_uring, %u process%s fell back to buffered writes\n", sh->log.nFallback,
+                       (sh->log.nFallback == 1) ? "" : "es");
+     }
+  printf ("customers finding the door closed: %s\n", doorGateOn ? "wait for it to open (door gate)" : "try again later");
+  if (NS > 1)
+     printf ("shops: %u, customer routing: %s\n", NS, routeName[routing]);
+  if (distributed)
+     printf ("distributed: customers and craftsmen run by %u entity host%s (%u spawned locally), over %s\n", nHost,
+             (nHost == 1) ? "" : "s", nLocal, remAddr);
+  printf ("entrepreneur scheduling policy: %s", schedName (sh->sched[0].policy));
+  if (sh->sched[0].policy == SCHED_WEIGHTED)
+     printf (" (weights %u,%u,%u)", weight[SCHED_C], weight[SCHED_P], weight[SCHED_G]);
+  printf ("\n");
+  for (n = 0; n < NS; n++)
+  { if (NS > 1)
+       printf ("  shop %u\n", n);
+    for (i = 0; i < SCHED_NREQ; i++)
+      printf ("%s  %s requests: %llu served, mean wait %.1f us\n", (NS == 1) ? "" : "  ",
+              (i == SCHED_C) ? "customer" : ((i == SCHED_P) ? "prime materials" : "batch collection"),
+              (unsigned long long) sh->sched[n].served[i],
+              (sh->sched[n].served[i] == 0) ? 0.0 : sh->sched[n].waitNs[i] / 1e3 / sh->sched[n].served[i]);
+  }
+  for (i = 0; i < N; i++)                                                    /* the global histograms are merged now */
+  { histMerge (&(sh->queueLat[N]), &(sh->queueLat[i]));
+    histMerge (&(sh->serviceLat[N]), &(sh->serviceLat[i]));
+  }
+  printf ("checkout latency (us)            count      p50      p90      p99     p999      max\n");
+  for (i = 0; i <= N; i++)
+  { printLatency ("queueing", i, &(sh->queueLat[i]));
+    printLatency ("service", i, &(sh->serviceLat[i]));
+  }
+  printf ("shared region: %s, %lu bytes, %s\n", SHMEM_KIND, (unsigned long) sizeof (SHARED_DATA),
+          huge ? "backed by huge pages" : (hugeReq ? "huge pages unavailable, ordinary pages" : "ordinary pages"));
+  if (place == PLACE_NONE)
+     printf ("placement: none\n");
+     else { printf ("placement: %s\n", (place == PLACE_SPREAD) ? "spread" : "compact");
+            printf ("entrepreneur: cpu %d (node %d)%s\n", placeCpu (0), placeNode (placeCpu (0)),
+                    (placeCpu (1) == placeCpu (0)) ? ", not dedicated: a single processor is available" : "");
+            printf ("customers: cpus");
+            for (i = 0; i < N; i++)
+              printf (" %d", placeCpu (1+i));
+            printf ("\ncraftsmen: cpus");
+            for (i = 0; i < M; i++)
+              printf (" %d", placeCpu (1+N+i));
+            if (NS > 1)
+               { printf ("\nentrepreneurs of the other shops: cpus");
+                 for (i = 1; i < NS; i++)
+                   printf (" %d", placeCpu (N+M+i));
+               }
+            printf ("\n");
+          }
+  if (traceFile != NULL)
+     printf ("trace: %s (convert it with tracejson)\n", traceFile);
+  if (bindReq)
+     { if (bindErr == 0)
+          printf ("shared region memory: bound to node %d\n", placeNode (placeCpu (0)));
+          else printf ("shared region memory: binding failed (%s)\n", strerror (bindErr));
+     }
+
+  /* completion of the log file */
+
+  closeLog (nFic);
 
   /* destruction of semaphore set and shared region */
 
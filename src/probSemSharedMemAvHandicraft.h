@@ -13,5 +13,26 @@
  *  Upon execution, one parameter is requested:
  *    \li name of the logging file.
  *
+ *  Command line options:
+ *    \li <tt>-l text|lz|mmap</tt> - logging mode: plain text (default), compressed in independent blocks (use the
+ *        <em>logcat</em> tool to read it) or plain text written through a shared memory mapping of the file
+ *    \li <tt>-H</tt> - back the shared region with huge pages, whenever they are available
+ *    \li <tt>-p none|spread|compact</tt> - placement policy: processes not pinned (default), or the entrepreneur
+ *        pinned to a dedicated processor and the remaining entities spread over the NUMA nodes or packed next to it
+ *    \li <tt>-b</tt> - bind the shared region to the NUMA node of the entrepreneur (requires a placement policy)
+ *    \li <tt>-j threads</tt> - number of threads spawning the intervening entities in parallel batches (default 1)
+ *    \li <tt>-L</tt> - the intervening entities do not take part in the start barrier (precompiled entities)
+ *    \li <tt>-Z</tt> - zygote mode: the intervening entities are forked without exec, inheriting the mapping of the
+ *        shared region, and run the life cycles linked into the launcher
+ *    \li <tt>-k pieces</tt> - batched production: each craftsman collects the prime materials for, produces and
+ *        stores up to the given number of pieces per visit to the store (default 1)
+ *    \li <tt>-D</tt> - door gate: customers who find the door closed block until the entrepreneur opens the shop
+ *        again, instead of polling the door
+ *    \li <tt>-s fixed|oldest|weighted[:c,p,g]|throughput</tt> - scheduling policy of the entrepreneur next task:
+ *        fixed priority (default), oldest request first, weighted fair or throughput maximizing.
+ *
+ *  The entities are spawned with <tt>posix_spawn</tt> and do not start operating until all of them have attached
+ *  the shared region. The startup time is reported apart from the simulation time.
+ *
  *  \author António Rui Borges - October 2014
  */
@@ -0,0 +1,88 @@
+/**
+ *  \file probes.h (interface file)
+ *
+ *  Problem name: Aveiro Handicraft SARL
+ *
+ *  Concept: Pedro Mariano
+ *
+ *  \brief Static user-space tracepoints (USDT).
+ *
+ *  Each probe is a single <tt>nop</tt> instruction plus an entry in the <tt>.note.stapsdt</tt> section of the
+ *  executable, laid out as <tt>sys/sdt.h</tt> does, so that <tt>perf</tt>, <tt>bpftrace</tt> or <tt>SystemTap</tt>
+ *  may attach to it by name (<tt>usdt:./entrepreneur:handicraft:prepareToWork_entry</tt>, for instance).
+ *  No header or library is needed either at build or at run time. When not traced, a probe costs one
+ *  <tt>nop</tt>; its arguments are kept in registers (or are constants) and are only described in the note.
+ *
+ *  Probes provided, all in the provider <tt>handicraft</tt>:
+ *     \li <tt>\<operation\>_entry</tt> and <tt>\<operation\>_return</tt>, for every operation of the intervening
+ *         entities, with the entity identification as argument
+ *     \li <tt>sem_down</tt> and <tt>sem_downed</tt>, before and after a <em>down</em>, and <tt>sem_up</tt> and
+ *         <tt>sem_upped</tt>, before and after an <em>up</em>, with the entity identification, the semaphore index and
+ *         the number of units as arguments.
+ *
+ *  Entities are identified as in the launcher: 0 is the entrepreneur, 1 to <tt>N</tt> the customers,
+ *  <tt>N</tt>+1 to <tt>N+M</tt> the craftsmen and, when there are several shops, <tt>N+M</tt>+1 onwards the
+ *  entrepreneurs of the other ones.
+ *
+ *  The probes are only emitted by <tt>gcc</tt> or <tt>clang</tt> on x86 and 64-bit ARM targets; elsewhere, or when
+ *  <tt>NOPROBES</tt> is defined, they compile to nothing.
+ */
+
+#ifndef PROBES_H_
+#define PROBES_H_
+
+#if !defined (NOPROBES) && defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__) || defined (__aarch64__))
+
+#if __SIZEOF_POINTER__ == 8
+#define  PROBE_ADDR_       ".8byte"
+#else
+#define  PROBE_ADDR_       ".4byte"
+#endif
+
+/** \brief probe note: a nop whose address, provider, name and argument description are recorded apart */
+#define  PROBE_NOTE_(name, args, ...)                                                                                \
+         __asm__ __volatile__ ("990: nop\n"                                                                         \
+                               ".pushsection .note.stapsdt,\"?\",\"note\"\n"                                        \
+                               ".balign 4\n"                                                                        \
+                               ".4byte 992f-991f, 994f-993f, 3\n"                                                   \
+                               "991: .asciz \"stapsdt\"\n"                                                          \
+                               "992: .balign 4\n"                                                                   \
+                               "993: " PROBE_ADDR_ " 990b\n"                                                        \
+                               PROBE_ADDR_ " _.stapsdt.base\n"                                                      \
+                               PROBE_ADDR_ " 0\n"                                                                   \
+                               ".asciz \"handicraft\"\n"                                                            \
+                               ".asciz \"" #name "\"\n"                                                             \
+                               ".asciz \"" args "\"\n"                                                              \
+                               "994: .balign 4\n"                                                                   \
+                               ".popsection\n"                                                                      \
+                               ".ifndef _.stapsdt.base\n"                                                           \
+                               ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"              \
+                               ".weak _.stapsdt.base\n"                                                             \
+                               ".hidden _.stapsdt.base\n"                                                           \
+                               "_.stapsdt.base: .space 1\n"                                                         \
+                               ".size _.stapsdt.base, 1\n"                                                          \
+                               ".popsection\n"                                                                      \
+                               ".endif\n"                                                                           \
+                               : : __VA_ARGS__)
+
+/** \brief probe with one unsigned integer argument */
+#define  PROBE1(name, a1)          PROBE_NOTE_(name, "4@%0", "nr" ((unsigned int) (a1)))
+
+/** \brief probe with three unsigned integer arguments */
+#define  PROBE3(name, a1, a2, a3)  PROBE_NOTE_(name, "4@%0 4@%1 4@%2", "nr" ((unsigned int) (a1)),             \
+                                               "nr" ((unsigned int) (a2)), "nr" ((unsigned int) (a3)))
+
+#else
+
+#define  PROBE1(name, a1)          do { } while (0)
+#define  PROBE3(name, a1, a2, a3)  do { } while (0)
+
+#endif
+
+/** \brief entry of an operation carried out by entity <tt>id</tt> */
+#define  PROBE_ENTRY(op, id)       PROBE1(op##_entry, id)
+
+/** \brief return from an operation carried out by entity <tt>id</tt> */
+#define  PROBE_RETURN(op, id)      PROBE1(op##_return, id)
+
+#endif /* PROBES_H_ */
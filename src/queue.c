@@ -12,7 +12,8 @@
  *     \li insertion of a value
  *     \li retrieval of a value
  *     \li test for queue full
- *     \li test for queue empty.
+ *     \li test for queue empty
+ *     \li number of values stored.
  *
  *  \author António Rui Borges - October 2014
  */
@@ -137,3 +138,19 @@ bool queueEmpty (QUEUE *p_q)
   if (p_q == NULL) return false;
   return !(p_q->full) && (p_q->ii == p_q->ri);
 }
+
+/**
+ *  \brief Number of values stored in the queue.
+ *
+ *         The function fails if a null pointer is passed as a parameter.
+ *
+ *  \param p_q pointer to the location where the queue is stored
+ *
+ *  \return the number of values stored
+ */
+
+unsigned int queueLen (QUEUE *p_q)
+{
+  if (p_q == NULL) return 0;
+  return p_q->full ? N : (p_q->ii + N - p_q->ri) % N;
+}
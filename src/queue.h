@@ -12,7 +12,8 @@
  *     \li insertion of a value
  *     \li retrieval of a value
  *     \li test for queue full
- *     \li test for queue empty.
+ *     \li test for queue empty
+ *     \li number of values stored.
  *
  *  \author António Rui Borges - October 2014
  */
@@ -101,4 +102,16 @@ extern bool queueFull (QUEUE *p_q);
 
 extern bool queueEmpty (QUEUE *p_q);
 
+/**
+ *  \brief Number of values stored in the queue.
+ *
+ *         The function fails if a null pointer is passed as a parameter.
+ *
+ *  \param p_q pointer to the location where the queue is stored
+ *
+ *  \return the number of values stored
+ */
+
+extern unsigned int queueLen (QUEUE *p_q);
+
 #endif /* QUEUE_H_ */
@@ -0,0 +1,647 @@
+/**
+ *  \file remote.c (implementation file)
+ *
+ *  Problem name: Aveiro Handicraft SARL
+ *
+ *  Concept: Pedro Mariano
+ *
+ *  \brief Remote operations of the customers and the craftsmen, for a simulation spread over several hosts.
+ *
+ *  Defined operations:
+ *     \li creation of the listening socket of the coordinator
+ *     \li connection of an entity host to the coordinator
+ *     \li sending a frame
+ *     \li receiving a frame
+ *     \li serving the remote calls of the entity hosts (coordinator)
+ *     \li starting the remote calls (entity host)
+ *     \li remote call of an operation (entity host).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "probConst.h"
+#include "remote.h"
+
+/** \brief maximum length of an address (including the terminating null character) */
+#define  REM_ADDRSZ      108
+
+/** \brief size of a record on the wire (in bytes) */
+#define  REM_RECSZ       8
+
+/** \brief socket descriptor of the connection to the coordinator (entity host) */
+static int cliFd = -1;
+
+/** \brief access to the calls in progress (entity host) */
+static pthread_mutex_t cliMtx = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief arrival of the reply, one per entity (entity host) */
+static pthread_cond_t cliReady[N+M+1];
+
+/** \brief requests waiting to be sent (entity host) */
+static REMREC cliOut[REM_MAXREC];
+
+/** \brief number of requests waiting to be sent (entity host) */
+static unsigned int nCliOut = 0;
+
+/** \brief a frame is being sent by one of the calling threads (entity host) */
+static bool cliSending = false;
+
+/** \brief the reply has arrived, one per entity (entity host) */
+static bool cliDone[N+M+1];
+
+/** \brief value returned, one per entity (entity host) */
+static uint32_t cliVal[N+M+1];
+
+/** \brief error which broke the connection (0 while it is sound) (entity host) */
+static int cliErr = 0;
+
+/** \brief function which carries out a request (coordinator) */
+static void (*srvCall) (REMREC *p_rec);
+
+/** \brief connection of each entity host (coordinator) */
+static int srvFd[N+M];
+
+/** \brief entity host running each entity (coordinator) */
+static unsigned int srvOwner[N+M+1];
+
+/** \brief access to the requests and replies queued (coordinator) */
+static pthread_mutex_t srvMtx = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief arrival of a request, or end of the service (coordinator) */
+static pthread_cond_t srvWork = PTHREAD_COND_INITIALIZER;
+
+/** \brief requests waiting for a worker, in order of arrival (coordinator) */
+static REMREC srvQ[REM_MAXREC];
+
+/** \brief position of the first request waiting (coordinator) */
+static unsigned int srvQHead = 0;
+
+/** \brief number of requests waiting (coordinator) */
+static unsigned int nSrvQ = 0;
+
+/** \brief number of workers not carrying out a request (coordinator) */
+static unsigned int nSrvIdle = 0;
+
+/** \brief every entity host has closed its connection (coordinator) */
+static bool srvEnd = false;
+
+/** \brief replies waiting to be sent, per entity host (coordinator) */
+static REMREC srvOut[N+M][REM_MAXREC];
+
+/** \brief number of replies waiting to be sent, per entity host (coordinator) */
+static unsigned int nSrvOut[N+M];
+
+/** \brief a frame is being sent to the entity host by one of the workers (coordinator) */
+static bool srvSending[N+M];
+
+/** \brief error which broke a connection (0 while they are all sound) (coordinator) */
+static int srvErr = 0;
+
+/**
+ *  \brief Writing all the bytes of a buffer (internal operation).
+ *
+ *  \param fd file descriptor
+ *  \param buf buffer
+ *  \param len number of bytes
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+static int writeAll (int fd, const void *buf, size_t len)
+{
+  const char *p = buf;                                                                    /* next byte to be written */
+  ssize_t k;                                                                              /* number of bytes written */
+
+  while (len > 0)
+  { if ((k = write (fd, p, len)) == -1)
+       { if (errno == EINTR) continue;
+         return -1;
+       }
+    p += k;
+    len -= (size_t) k;
+  }
+  return 0;
+}
+
+/**
+ *  \brief Reading all the bytes of a buffer (internal operation).
+ *
+ *  \param fd file descriptor
+ *  \param buf buffer
+ *  \param len number of bytes
+ *
+ *  \return number of bytes read (less than <tt>len</tt> only if the end of file was reached)
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+static ssize_t readAll (int fd, void *buf, size_t len)
+{
+  char *p = buf;                                                                             /* next byte to be read */
+  ssize_t k;                                                                                 /* number of bytes read */
+
+  while (len > 0)
+  { if ((k = read (fd, p, len)) == -1)
+       { if (errno == EINTR) continue;
+         return -1;
+       }
+    if (k == 0) break;
+    p += k;
+    len -= (size_t) k;
+  }
+  return p - (char *) buf;
+}
+
+/**
+ *  \brief Splitting of a TCP address into host and port (internal operation).
+ *
+ *  \param addr address
+ *  \param host pointer to the location where the host is to be stored (<tt>REM_ADDRSZ</tt> bytes)
+ *
+ *  \return pointer to the port, in <tt>addr</tt>
+ *  \return \c NULL, if <tt>addr</tt> is a path name
+ */
+
+static char *splitAddr (char *addr, char *host)
+{
+  char *port;                                                                               /* separator of the port */
+
+  if (((port = strrchr (addr, ':')) == NULL) || (port - addr >= REM_ADDRSZ) || (strchr (addr, '/') != NULL))
+     return NULL;
+  memcpy (host, addr, (size_t) (port - addr));
+  host[port-addr] = '\0';
+  return port + 1;
+}
+
+/**
+ *  \brief Creation of a socket for an address (internal operation).
+ *
+ *  \param addr address
+ *  \param listening the socket is to listen for connections, instead of connecting
+ *
+ *  \return socket descriptor, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+static int openSocket (char *addr, bool listening)
+{
+  char host[REM_ADDRSZ];                                                                      /* host of the address */
+  char *port;                                                                                 /* port of the address */
+  struct sockaddr_un un;                                                                      /* Unix-domain address */
+  struct addrinfo hints, *res, *p;                                                                  /* TCP addresses */
+  int fd = -1,                                                                                  /* socket descriptor */
+      on = 1,                                                                                        /* option value */
+      err;                                                                                       /* resolution error */
+
+  if ((port = splitAddr (addr, host)) == NULL)                                                 /* Unix-domain socket */
+     { if (strlen (addr) >= sizeof (un.sun_path))
+          { errno = ENAMETOOLONG;
+            return -1;
+          }
+       memset (&un, 0, sizeof (un));
+       un.sun_family = AF_UNIX;
+       strcpy (un.sun_path, addr);
+       if ((fd = socket (AF_UNIX, SOCK_STREAM, 0)) == -1)
+          return -1;
+       if (listening)
+          { unlink (addr);
+            if ((bind (fd, (struct sockaddr *) &un, sizeof (un)) == -1) || (listen (fd, SOMAXCONN) == -1))
+               { close (fd);
+                 return -1;
+               }
+          }
+          else if (connect (fd, (struct sockaddr *) &un, sizeof (un)) == -1)
+                  { close (fd);
+                    return -1;
+                  }
+       return fd;
+     }
+
+  memset (&hints, 0, sizeof (hints));                                                              /* TCP connection */
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = listening ? AI_PASSIVE : 0;
+  if ((err = getaddrinfo ((host[0] == '\0') ? NULL : host, port, &hints, &res)) != 0)
+     { errno = (err == EAI_SYSTEM) ? errno : EHOSTUNREACH;
+       return -1;
+     }
+  for (p = res; p != NULL; p = p->ai_next)
+  { if ((fd = socket (p->ai_family, p->ai_socktype, p->ai_protocol)) == -1)
+       continue;
+    setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof (on));               /* the frames are small and pipelined */
+    if (listening)
+       { setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof (on));
+         if ((bind (fd, p->ai_addr, p->ai_addrlen) == 0) && (listen (fd, SOMAXCONN) == 0))
+            break;
+       }
+       else if (connect (fd, p->ai_addr, p->ai_addrlen) == 0)
+               break;
+    err = errno;
+    close (fd);
+    errno = err;
+    fd = -1;
+  }
+  freeaddrinfo (res);
+  return fd;
+}
+
+/**
+ *  \brief Creation of the listening socket of the coordinator.
+ *
+ *  A Unix-domain socket left behind by a previous run is removed.
+ *
+ *  \param addr address: either a path name or <tt>host:port</tt> (the host may be empty)
+ *
+ *  \return socket descriptor, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int remListen (char *addr)
+{
+  return openSocket (addr, true);
+}
+
+/**
+ *  \brief Connection of an entity host to the coordinator.
+ *
+ *  \param addr address: either a path name or <tt>host:port</tt>
+ *
+ *  \return socket descriptor, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int remConnect (char *addr)
+{
+  return openSocket (addr, false);
+}
+
+/**
+ *  \brief Sending a frame.
+ *
+ *  The frame is written at once, so the records are not split over several segments.
+ *
+ *  \param fd socket descriptor
+ *  \param rec records to be sent
+ *  \param n number of records (at most <tt>REM_MAXREC</tt>)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int remSend (int fd, REMREC *rec, unsigned int n)
+{
+  uint8_t buf[4 + REM_MAXREC * REM_RECSZ];                                                            /* wire format */
+  uint16_t h;                                                                                 /* half word to encode */
+  uint32_t w;                                                                                      /* word to encode */
+  unsigned int i;                                                                               /* counting variable */
+
+  w = htonl (n);
+  memcpy (buf, &w, 4);
+  for (i = 0; i < n; i++)
+  { h = htons (rec[i].ent);
+    memcpy (buf + 4 + i * REM_RECSZ, &h, 2);
+    h = htons (rec[i].op);
+    memcpy (buf + 6 + i * REM_RECSZ, &h, 2);
+    w = htonl (rec[i].val);
+    memcpy (buf + 8 + i * REM_RECSZ, &w, 4);
+  }
+  return writeAll (fd, buf, 4 + n * REM_RECSZ);
+}
+
+/**
+ *  \brief Receiving a frame.
+ *
+ *  \param fd socket descriptor
+ *  \param rec pointer to the location where the records are to be stored (<tt>REM_MAXREC</tt> elements)
+ *  \param p_n pointer to the location where the number of records is to be stored (\c 0, if the connection was
+ *         closed by the peer)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>; <tt>EPROTO</tt>, if
+ *          the frame is malformed)
+ */
+
+int remRecv (int fd, REMREC *rec, unsigned int *p_n)
+{
+  uint8_t buf[REM_MAXREC * REM_RECSZ];                                                                /* wire format */
+  uint16_t h;                                                                                   /* half word decoded */
+  uint32_t w;                                                                                        /* word decoded */
+  ssize_t k;                                                                                 /* number of bytes read */
+  unsigned int i;                                                                               /* counting variable */
+
+  *p_n = 0;
+  if ((k = readAll (fd, &w, 4)) == -1)
+     return -1;
+  if (k == 0) return 0;                                                                 /* connection closed by peer */
+  if ((k != 4) || (ntohl (w) == 0) || (ntohl (w) > REM_MAXREC))
+     { errno = EPROTO;
+       return -1;
+     }
+  *p_n = ntohl (w);
+  if ((k = readAll (fd, buf, *p_n * REM_RECSZ)) == -1)
+     return -1;
+  if (k != (ssize_t) (*p_n * REM_RECSZ))
+     { errno = EPROTO;
+       return -1;
+     }
+  for (i = 0; i < *p_n; i++)
+  { memcpy (&h, buf + i * REM_RECSZ, 2);
+    rec[i].ent = ntohs (h);
+    memcpy (&h, buf + 2 + i * REM_RECSZ, 2);
+    rec[i].op = ntohs (h);
+    memcpy (&w, buf + 4 + i * REM_RECSZ, 4);
+    rec[i].val = ntohl (w);
+    if ((rec[i].ent == 0) || (rec[i].ent > N+M))
+       { errno = EPROTO;
+         return -1;
+       }
+  }
+  return 0;
+}
+
+/**
+ *  \brief Sending of the replies queued for an entity host (internal operation, called with the server access taken).
+ *
+ *  The first worker to find no frame being sent to the entity host sends the queue, and keeps on sending what the
+ *  other workers have queued in the meantime, so the replies are batched while the connection is busy.
+ *
+ *  \param h entity host
+ */
+
+static void sendReplies (unsigned int h)
+{
+  REMREC frame[REM_MAXREC];                                                                      /* frame being sent */
+  unsigned int n;                                                                         /* number of records in it */
+
+  while (!srvSending[h] && (nSrvOut[h] != 0) && (srvErr == 0))
+  { srvSending[h] = true;
+    n = nSrvOut[h];
+    memcpy (frame, srvOut[h], n * sizeof (REMREC));
+    nSrvOut[h] = 0;
+    pthread_mutex_unlock (&srvMtx);
+    if (remSend (srvFd[h], frame, n) == -1)
+       { pthread_mutex_lock (&srvMtx);
+         srvErr = errno;
+       }
+       else pthread_mutex_lock (&srvMtx);
+    srvSending[h] = false;
+  }
+}
+
+/**
+ *  \brief Carrying out of the requests (internal operation, run by a worker of the coordinator).
+ *
+ *  \param arg not used
+ *
+ *  \return \c NULL
+ */
+
+static void *worker (void *arg)
+{
+  REMREC rq;                                                                          /* request, and then its reply */
+  unsigned int h;                                                                     /* entity host which issued it */
+
+  pthread_mutex_lock (&srvMtx);
+  while (true)
+  { while ((nSrvQ == 0) && !srvEnd)
+      pthread_cond_wait (&srvWork, &srvMtx);
+    if (nSrvQ == 0) break;
+    rq = srvQ[srvQHead];
+    h = srvOwner[rq.ent];
+    srvQHead = (srvQHead + 1) % REM_MAXREC;
+    nSrvQ -= 1;
+    nSrvIdle -= 1;
+    pthread_mutex_unlock (&srvMtx);
+    srvCall (&rq);                                                             /* it may block, within the operation */
+    pthread_mutex_lock (&srvMtx);
+    srvOut[h][nSrvOut[h]++] = rq;
+    sendReplies (h);
+    nSrvIdle += 1;
+  }
+  pthread_mutex_unlock (&srvMtx);
+  return NULL;
+}
+
+/**
+ *  \brief Serving the remote calls of the entity hosts (coordinator).
+ *
+ *  The calling thread runs the event loop: it polls the connections of the entity hosts and queues the requests as
+ *  they arrive, to be carried out by a pool of worker threads. A worker is only added when a request finds every
+ *  one busy, up to one per entity run remotely, as each of them may be blocked within an operation at the same time
+ *  (waiting to be served, for prime materials or for the door to open). The replies are sent back in batches. The
+ *  function returns once every entity host has closed its connection and the workers are done.
+ *
+ *  \param hfd socket descriptors of the connections to the entity hosts
+ *  \param nHost number of entity hosts
+ *  \param owner entity host running each entity, indexed by entity
+ *  \param call function which carries out a request and stores the value returned by the operation in it
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int remServe (int *hfd, unsigned int nHost, unsigned int *owner, void (*call) (REMREC *p_rec))
+{
+  struct pollfd pl[N+M];                                                          /* connections of the entity hosts */
+  REMREC rec[REM_MAXREC];                                                                      /* records of a frame */
+  pthread_t thr[REM_MAXREC];                                                                              /* workers */
+  unsigned int nLive = nHost,                                                    /* number of entity hosts connected */
+               nThr = 0,                                                                        /* number of workers */
+               n, h, i;                                                             /* number and counting variables */
+  int err = 0,                                                                                    /* serving outcome */
+      status;                                                                                    /* creation outcome */
+
+  srvCall = call;
+  for (i = 1; i <= N+M; i++)
+    srvOwner[i] = owner[i];
+  for (h = 0; h < nHost; h++)
+  { srvFd[h] = pl[h].fd = hfd[h];
+    pl[h].events = POLLIN;
+  }
+
+  while ((nLive > 0) && (err == 0))
+  { if (poll (pl, nHost, -1) == -1)
+       { if (errno == EINTR) continue;
+         err = errno;
+         break;
+       }
+    for (h = 0; (h < nHost) && (err == 0); h++)
+    { if ((pl[h].fd == -1) || (pl[h].revents == 0)) continue;
+      if (remRecv (pl[h].fd, rec, &n) == -1)
+         { err = errno;
+           break;
+         }
+      if (n == 0)                                                           /* the entity host closed the connection */
+         { pl[h].fd = -1;
+           nLive -= 1;
+           continue;
+         }
+      pthread_mutex_lock (&srvMtx);
+      for (i = 0; i < n; i++)
+        if ((srvOwner[rec[i].ent] != h) || (nSrvQ == REM_MAXREC))       /* an entity of another entity host, or
+                                                                                   a second call of the same entity */
+           { err = EPROTO;
+             break;
+           }
+           else { srvQ[(srvQHead + nSrvQ) % REM_MAXREC] = rec[i];
+                  nSrvQ += 1;
+                }
+      if ((nSrvQ > nSrvIdle) && (nThr < REM_MAXREC))                               /* every worker is busy: one more */
+         { if ((status = pthread_create (&thr[nThr], NULL, worker, NULL)) != 0)
+              err = status;
+              else { nThr += 1;
+                     nSrvIdle += 1;
+                   }
+         }
+      pthread_cond_broadcast (&srvWork);
+      if (srvErr != 0) err = srvErr;
+      pthread_mutex_unlock (&srvMtx);
+    }
+  }
+
+  pthread_mutex_lock (&srvMtx);
+  srvEnd = true;
+  pthread_cond_broadcast (&srvWork);
+  pthread_mutex_unlock (&srvMtx);
+  if (err == 0)
+     for (i = 0; i < nThr; i++)
+       pthread_join (thr[i], NULL);
+  if ((err == 0) && (srvErr != 0)) err = srvErr;
+  if (err != 0)
+     { errno = err;
+       return -1;
+     }
+  return 0;
+}
+
+/**
+ *  \brief Reception of the replies (internal operation, run by a thread of the entity host).
+ *
+ *  \param arg not used
+ *
+ *  \return \c NULL
+ */
+
+static void *receiver (void *arg)
+{
+  REMREC rec[REM_MAXREC];                                                                      /* records of a frame */
+  unsigned int n, i;                                                                /* number and counting variables */
+  int err;                                                                                      /* reception outcome */
+
+  while (true)
+  { err = (remRecv (cliFd, rec, &n) == -1) ? errno : ((n == 0) ? ECONNRESET : 0);
+    pthread_mutex_lock (&cliMtx);
+    if (err != 0)                                                        /* every call in progress fails from now on */
+       { cliErr = err;
+         for (i = 1; i <= N+M; i++)
+           pthread_cond_signal (&cliReady[i]);
+         pthread_mutex_unlock (&cliMtx);
+         return NULL;
+       }
+    for (i = 0; i < n; i++)
+    { cliVal[rec[i].ent] = rec[i].val;
+      cliDone[rec[i].ent] = true;
+      pthread_cond_signal (&cliReady[rec[i].ent]);
+    }
+    pthread_mutex_unlock (&cliMtx);
+  }
+}
+
+/**
+ *  \brief Starting the remote calls (entity host).
+ *
+ *  A thread is created which receives the replies on the connection and hands them to the calling threads.
+ *
+ *  \param fd socket descriptor of the connection to the coordinator
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int remStart (int fd)
+{
+  pthread_t thr;                                                                                 /* receiving thread */
+  unsigned int i;                                                                               /* counting variable */
+  int status;                                                                                    /* creation outcome */
+
+  cliFd = fd;
+  for (i = 0; i <= N+M; i++)
+    pthread_cond_init (&cliReady[i], NULL);
+  if ((status = pthread_create (&thr, NULL, receiver, NULL)) != 0)
+     { errno = status;
+       return -1;
+     }
+  pthread_detach (thr);
+  return 0;
+}
+
+/**
+ *  \brief Remote call of an operation (entity host).
+ *
+ *  The request is queued and the first thread to find no frame being sent sends the queue, and keeps on sending
+ *  what the other threads have queued in the meantime, so the requests are batched while the connection is busy.
+ *  The calling thread is blocked until the reply arrives. Several threads may issue calls at the same time, for
+ *  different entities.
+ *
+ *  \param ent entity identification
+ *  \param op operation
+ *  \param arg argument of the operation
+ *  \param p_val pointer to the location where the value returned by the operation is to be stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>; <tt>ECONNRESET</tt>, if
+ *          the connection was closed by the coordinator)
+ */
+
+int remCall (unsigned int ent, unsigned int op, uint32_t arg, uint32_t *p_val)
+{
+  REMREC frame[REM_MAXREC];                                                                      /* frame being sent */
+  unsigned int n;                                                                         /* number of records in it */
+  int err;                                                                                        /* sending outcome */
+
+  if ((ent == 0) || (ent > N+M))
+     { errno = EINVAL;
+       return -1;
+     }
+  pthread_mutex_lock (&cliMtx);
+  cliOut[nCliOut].ent = (uint16_t) ent;
+  cliOut[nCliOut].op = (uint16_t) op;
+  cliOut[nCliOut++].val = arg;
+  cliDone[ent] = false;
+  while (!cliSending && (nCliOut != 0) && (cliErr == 0))
+  { cliSending = true;
+    n = nCliOut;
+    memcpy (frame, cliOut, n * sizeof (REMREC));
+    nCliOut = 0;
+    pthread_mutex_unlock (&cliMtx);
+    err = (remSend (cliFd, frame, n) == -1) ? errno : 0;
+    pthread_mutex_lock (&cliMtx);
+    cliSending = false;
+    if (err != 0) cliErr = err;
+  }
+  while (!cliDone[ent] && (cliErr == 0))
+    pthread_cond_wait (&cliReady[ent], &cliMtx);
+  if (!cliDone[ent])
+     { errno = cliErr;
+       pthread_mutex_unlock (&cliMtx);
+       return -1;
+     }
+  *p_val = cliVal[ent];
+  pthread_mutex_unlock (&cliMtx);
+  return 0;
+}
@@ -0,0 +1,202 @@
+/**
+ *  \file remote.h (interface file)
+ *
+ *  Problem name: Aveiro Handicraft SARL
+ *
+ *  Concept: Pedro Mariano
+ *
+ *  \brief Remote operations of the customers and the craftsmen, for a simulation spread over several hosts.
+ *
+ *  In distributed mode, the shared region and the semaphore set are owned by the coordinator, the launcher, which
+ *  runs the entrepreneurs as usual and carries out the operations of the customers and the craftsmen itself. The life
+ *  cycles of the customers and the craftsmen are run by threads of the entity hosts, which may be on other machines
+ *  and carry out every operation as a remote call to the coordinator, which executes it on the shared region.
+ *
+ *  Each entity host holds a single connection to the coordinator, either a Unix-domain socket (the address is a path
+ *  name) or a TCP connection (the address is <tt>host:port</tt>). The calls of all the entities the host runs are
+ *  pipelined on it: the requests issued while a frame is being sent are batched into the next one and so are the
+ *  replies. At the coordinator, a single thread polls the connections of all the entity hosts and hands the requests
+ *  to a pool of worker threads, as the operations may block.
+ *
+ *  A frame holds the number of records, followed by the records, all of them in network byte order. The first frame
+ *  an entity host sends is its greeting, with the range of entities it runs, and the coordinator replies with the
+ *  settings of the run the life cycles depend on.
+ *
+ *  Defined operations:
+ *     \li creation of the listening socket of the coordinator
+ *     \li connection of an entity host to the coordinator
+ *     \li sending a frame
+ *     \li receiving a frame
+ *     \li serving the remote calls of the entity hosts (coordinator)
+ *     \li starting the remote calls (entity host)
+ *     \li remote call of an operation (entity host).
+ */
+
+#ifndef REMOTE_H_
+#define REMOTE_H_
+
+#include <stdint.h>
+
+#include "probConst.h"
+
+/** \brief greeting of an entity host (the entity is the first one it runs and the value how many) */
+#define  REM_HELLO            0
+
+/** \brief customer operation go shopping */
+#define  REM_GO_SHOPPING      1
+/** \brief customer operation is door open */
+#define  REM_IS_DOOR_OPEN     2
+/** \brief customer operation try again later */
+#define  REM_TRY_AGAIN_LATER  3
+/** \brief customer operation enter the shop */
+#define  REM_ENTER_SHOP       4
+/** \brief customer operation perusing around */
+#define  REM_PERUSING_AROUND  5
+/** \brief customer operation I want this */
+#define  REM_I_WANT_THIS      6
+/** \brief customer operation exit the shop */
+#define  REM_EXIT_SHOP        7
+/** \brief customer operation end of operations */
+#define  REM_END_OPER_CUST    8
+
+/** \brief craftsman operation collect materials */
+#define  REM_COLLECT_MAT      9
+/** \brief craftsman operation prime materials needed */
+#define  REM_PRIME_MAT_NEEDED 10
+/** \brief craftsman operation back to work */
+#define  REM_BACK_TO_WORK     11
+/** \brief craftsman operation prepare to produce */
+#define  REM_PREPARE_PRODUCE  12
+/** \brief craftsman operation go to store */
+#define  REM_GO_TO_STORE      13
+/** \brief craftsman operation batch ready for transfer */
+#define  REM_BATCH_READY      14
+/** \brief craftsman operation collect materials for a batch of pieces */
+#define  REM_COLLECT_MAT_B    15
+/** \brief craftsman operation go to store with a batch of pieces */
+#define  REM_GO_TO_STORE_B    16
+/** \brief craftsman operation end of operations */
+#define  REM_END_OPER_CRAFT   17
+
+/** \brief maximum number of records in a frame (each entity has a single call outstanding at a time) */
+#define  REM_MAXREC           (N+M)
+
+/**
+ *  \brief Definition of <em>remote call record</em> data type.
+ *
+ *  A request carries the argument of the operation and the reply the value it returns.
+ */
+
+typedef struct
+        { /** \brief entity identification (1 to N - customers, N+1 to N+M - craftsmen) */
+          uint16_t ent;
+          /** \brief operation */
+          uint16_t op;
+          /** \brief argument or returned value */
+          uint32_t val;
+        } REMREC;
+
+/**
+ *  \brief Creation of the listening socket of the coordinator.
+ *
+ *  A Unix-domain socket left behind by a previous run is removed.
+ *
+ *  \param addr address: either a path name or <tt>host:port</tt> (the host may be empty)
+ *
+ *  \return socket descriptor, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int remListen (char *addr);
+
+/**
+ *  \brief Connection of an entity host to the coordinator.
+ *
+ *  \param addr address: either a path name or <tt>host:port</tt>
+ *
+ *  \return socket descriptor, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int remConnect (char *addr);
+
+/**
+ *  \brief Sending a frame.
+ *
+ *  \param fd socket descriptor
+ *  \param rec records to be sent
+ *  \param n number of records (at most <tt>REM_MAXREC</tt>)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int remSend (int fd, REMREC *rec, unsigned int n);
+
+/**
+ *  \brief Receiving a frame.
+ *
+ *  \param fd socket descriptor
+ *  \param rec pointer to the location where the records are to be stored (<tt>REM_MAXREC</tt> elements)
+ *  \param p_n pointer to the location where the number of records is to be stored (\c 0, if the connection was
+ *         closed by the peer)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>; <tt>EPROTO</tt>, if
+ *          the frame is malformed)
+ */
+
+extern int remRecv (int fd, REMREC *rec, unsigned int *p_n);
+
+/**
+ *  \brief Serving the remote calls of the entity hosts (coordinator).
+ *
+ *  The calling thread polls the connections and the requests are carried out by a pool of worker threads, which
+ *  grows on demand up to one per entity, so a request never waits behind operations blocked within the simulation.
+ *  The replies are sent back in batches. The function returns once every entity host has closed its connection.
+ *
+ *  \param hfd socket descriptors of the connections to the entity hosts
+ *  \param nHost number of entity hosts
+ *  \param owner entity host running each entity, indexed by entity
+ *  \param call function which carries out a request and stores the value returned by the operation in it; it is
+ *         called by several threads at the same time, for different entities
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>; <tt>EPROTO</tt>, if an
+ *          entity host issued a call for an entity it does not run)
+ */
+
+extern int remServe (int *hfd, unsigned int nHost, unsigned int *owner, void (*call) (REMREC *p_rec));
+
+/**
+ *  \brief Starting the remote calls (entity host).
+ *
+ *  A thread is created which receives the replies on the connection and hands them to the calling threads.
+ *
+ *  \param fd socket descriptor of the connection to the coordinator
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int remStart (int fd);
+
+/**
+ *  \brief Remote call of an operation (entity host).
+ *
+ *  The calling thread is blocked until the reply arrives. Several threads may issue calls at the same time, for
+ *  different entities.
+ *
+ *  \param ent entity identification
+ *  \param op operation
+ *  \param arg argument of the operation
+ *  \param p_val pointer to the location where the value returned by the operation is to be stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>; <tt>ECONNRESET</tt>, if
+ *          the connection was closed by the coordinator)
+ */
+
+extern int remCall (unsigned int ent, unsigned int op, uint32_t arg, uint32_t *p_val);
+
+#endif /* REMOTE_H_ */
@@ -0,0 +1,197 @@
+/**
+ *  \file schedPolicy.c (implementation file)
+ *
+ *  Problem name: Aveiro Handicraft SARL
+ *
+ *  Concept: Pedro Mariano
+ *
+ *  \brief Scheduling policies for the choice of the next task of the entrepreneur.
+ *
+ *  Defined operations:
+ *     \li initialization of the scheduling information
+ *     \li conversion of a policy name into a policy
+ *     \li name of a policy
+ *     \li registration of a new request
+ *     \li choice of the next task.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "queue.h"
+#include "schedPolicy.h"
+
+/** \brief policy names */
+static const char *polName[] = { "fixed", "oldest", "weighted", "throughput" };
+
+/** \brief task associated with each kind of request */
+static const char reqTask[SCHED_NREQ] = { 'C', 'P', 'G' };
+
+/**
+ *  \brief Present instant (internal operation).
+ *
+ *  \return monotonic clock reading (in ns)
+ */
+
+static uint64_t now (void)
+{
+  struct timespec ts;                                                                               /* clock reading */
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+/**
+ *  \brief Initialization of the scheduling information.
+ *
+ *  \param p_si pointer to the location where the scheduling information is stored
+ *  \param policy scheduling policy
+ *  \param weight weights of the kinds of requests (weighted fair policy); the default weights are used if it is
+ *         <tt>NULL</tt>
+ */
+
+void schedInit (SCHEDINFO *p_si, unsigned int policy, unsigned int weight[])
+{
+  unsigned int defWeight[SCHED_NREQ] = SCHED_WEIGHTS;                                             /* default weights */
+  unsigned int r;                                                                               /* counting variable */
+
+  memset (p_si, 0, sizeof (SCHEDINFO));
+  p_si->policy = policy;
+  for (r = 0; r < SCHED_NREQ; r++)
+    p_si->weight[r] = (weight == NULL) ? defWeight[r] : weight[r];
+}
+
+/**
+ *  \brief Conversion of a policy name into a policy.
+ *
+ *  The weighted fair policy name may be followed by its weights, as in <tt>weighted:4,2,1</tt>.
+ *
+ *  \param name policy name
+ *  \param weight pointer to the location where the weights are stored, if they are given
+ *
+ *  \return the policy, upon success
+ *  \return -\c 1, if the name is not valid
+ */
+
+int schedParse (const char *name, unsigned int weight[])
+{
+  unsigned int p;                                                                               /* counting variable */
+  char tail;                                                                        /* trailing characters detection */
+
+  for (p = 0; p < sizeof (polName) / sizeof (polName[0]); p++)
+    if (strcmp (name, polName[p]) == 0) return (int) p;
+  if ((strncmp (name, "weighted:", 9) == 0) &&
+      (sscanf (name + 9, "%u,%u,%u%c", &weight[SCHED_C], &weight[SCHED_P], &weight[SCHED_G], &tail) == 3) &&
+      (weight[SCHED_C] > 0) && (weight[SCHED_P] > 0) && (weight[SCHED_G] > 0))
+     return SCHED_WEIGHTED;
+  return -1;
+}
+
+/**
+ *  \brief Name of a policy.
+ *
+ *  \param policy scheduling policy
+ *
+ *  \return the policy name
+ */
+
+const char *schedName (unsigned int policy)
+{
+  return (policy < sizeof (polName) / sizeof (polName[0])) ? polName[policy] : "unknown";
+}
+
+/**
+ *  \brief Registration of a new request.
+ *
+ *  It must be called before the request is recorded in the state of the shop.
+ *
+ *  \param p_si pointer to the location where the scheduling information is stored
+ *  \param p_shop pointer to the location where the state of the shop the request is made to is stored
+ *  \param req kind of request
+ *  \param custId identification of the customer (kind <tt>SCHED_C</tt> only)
+ */
+
+void schedRequest (SCHEDINFO *p_si, SHOPINFO *p_shop, unsigned int req, unsigned int custId)
+{
+  if (req == SCHED_C)
+     p_si->custStamp[custId] = now ();
+     else if (((req == SCHED_P) && !p_shop->primeMatReq) ||                      /* a repeated request keeps its age */
+              ((req == SCHED_G) && !p_shop->prodTransfer))
+             { p_si->reqStamp[req] = now ();
+               p_si->acct[req] = false;
+             }
+}
+
+/**
+ *  \brief Choice of the next task.
+ *
+ *  \param p_si pointer to the location where the scheduling information is stored
+ *  \param p_shop pointer to the location where the state of the shop is stored
+ *  \param p_ws pointer to the location where the state of the workshop is stored
+ *  \param nCraftsmenBlk number of craftsmen blocked waiting for prime materials
+ *
+ *  \return \c 'C', if a customer is to be attended
+ *  \return \c 'P', if prime materials are to be bought
+ *  \return \c 'G', if a batch of products is to be collected
+ *  \return \c '\\0', if no request is pending
+ */
+
+char schedNext (SCHEDINFO *p_si, SHOPINFO *p_shop, WORKSHOPINFO *p_ws, unsigned int nCraftsmenBlk)
+{
+  bool pend[SCHED_NREQ];                                                                         /* pending requests */
+  uint64_t stamp[SCHED_NREQ];                                                         /* instant of pending requests */
+  int sel = -1;                                                                                  /* selected request */
+  unsigned int r;                                                                               /* counting variable */
+  uint64_t t = now ();                                                                            /* present instant */
+
+  pend[SCHED_C] = !queueEmpty (&(p_shop->queue));
+  pend[SCHED_P] = p_shop->primeMatReq;
+  pend[SCHED_G] = p_shop->prodTransfer;
+  if (!pend[SCHED_C] && !pend[SCHED_P] && !pend[SCHED_G]) return '\0';
+  stamp[SCHED_C] = pend[SCHED_C] ? p_si->custStamp[queuePeek (&(p_shop->queue), 0)] : 0;
+  stamp[SCHED_P] = p_si->reqStamp[SCHED_P];
+  stamp[SCHED_G] = p_si->reqStamp[SCHED_G];
+
+  if (pend[SCHED_C] && (p_shop->stat == SDCLOSED))                  /* the shop must be emptied, whatever the policy */
+     sel = SCHED_C;
+     else switch (p_si->policy)
+          { case SCHED_OLDEST:
+              for (r = 0; r < SCHED_NREQ; r++)
+                if (pend[r] && ((sel == -1) || (stamp[r] < stamp[sel]))) sel = (int) r;
+              break;
+            case SCHED_WEIGHTED:                                /* the smallest ratio of services received to weight */
+              for (r = 0; r < SCHED_NREQ; r++)
+                if (pend[r] && ((sel == -1) ||
+                                (p_si->served[r] * p_si->weight[sel] < p_si->served[sel] * p_si->weight[r])))
+                   sel = (int) r;
+              break;
+            case SCHED_THROUGHPUT:
+              if (pend[SCHED_P] && ((nCraftsmenBlk > 0) || (p_ws->nPMatIn < PMIN)))
+                 sel = SCHED_P;                                           /* craftsmen are, or are about to be, idle */
+                 else if (pend[SCHED_G] && (p_shop->nProdIn == 0))
+                         sel = SCHED_G;                                          /* there is nothing left to be sold */
+                         else if (pend[SCHED_C])
+                                 sel = SCHED_C;
+                                 else sel = pend[SCHED_P] ? SCHED_P : SCHED_G;
+              break;
+            default:                                                                               /* fixed priority */
+              for (r = 0; r < SCHED_NREQ; r++)
+                if (pend[r])
+                   { sel = (int) r;
+                     break;
+                   }
+          }
+
+  if ((sel == SCHED_C) || !p_si->acct[sel])                           /* a request may be chosen again while pending */
+     { p_si->served[sel] += 1;
+       p_si->waitNs[sel] += t - stamp[sel];
+       if (sel != SCHED_C) p_si->acct[sel] = true;
+     }
+  return reqTask[sel];
+}
@@ -0,0 +1,155 @@
+/**
+ *  \file schedPolicy.h (interface file)
+ *
+ *  Problem name: Aveiro Handicraft SARL
+ *
+ *  Concept: Pedro Mariano
+ *
+ *  \brief Scheduling policies for the choice of the next task of the entrepreneur.
+ *
+ *  Three kinds of requests compete for the entrepreneur: a customer waiting by the counter (<tt>'C'</tt>), a request
+ *  for prime materials (<tt>'P'</tt>) and a batch of products ready for collection (<tt>'G'</tt>).
+ *
+ *  Policies available:
+ *     \li <tt>SCHED_FIXED</tt> - fixed priority: customers, then prime materials, then batch collection
+ *     \li <tt>SCHED_OLDEST</tt> - the request pending for the longest time is served first
+ *     \li <tt>SCHED_WEIGHTED</tt> - weighted fair: each kind of request gets a share of the services proportional
+ *         to its weight
+ *     \li <tt>SCHED_THROUGHPUT</tt> - prime materials first whenever craftsmen are idle waiting for them, batch
+ *         collection next whenever there is nothing left to sell in the shop, customers otherwise.
+ *
+ *  Whatever the policy, customers already queued by the counter are always served first when the door is closed, so
+ *  that the shop can be emptied.
+ *
+ *  Defined operations:
+ *     \li initialization of the scheduling information
+ *     \li conversion of a policy name into a policy
+ *     \li name of a policy
+ *     \li registration of a new request
+ *     \li choice of the next task.
+ */
+
+#ifndef SCHEDPOLICY_H_
+#define SCHEDPOLICY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+
+/** \brief fixed priority policy */
+#define  SCHED_FIXED       0
+
+/** \brief oldest request first policy */
+#define  SCHED_OLDEST      1
+
+/** \brief weighted fair policy */
+#define  SCHED_WEIGHTED    2
+
+/** \brief throughput maximizing policy */
+#define  SCHED_THROUGHPUT  3
+
+/** \brief kind of request: customer waiting by the counter */
+#define  SCHED_C           0
+
+/** \brief kind of request: prime materials */
+#define  SCHED_P           1
+
+/** \brief kind of request: batch collection */
+#define  SCHED_G           2
+
+/** \brief number of kinds of requests */
+#define  SCHED_NREQ        3
+
+/** \brief default weights of the weighted fair policy (customers, prime materials, batch collection) */
+#define  SCHED_WEIGHTS     { 4, 2, 1 }
+
+/**
+ *  \brief Definition of <em>scheduling information</em> data type.
+ *
+ *  It is kept in shared memory and must only be accessed inside the critical region.
+ */
+
+typedef struct
+        { /** \brief scheduling policy */
+          unsigned int policy;
+          /** \brief weight of each kind of request (weighted fair policy) */
+          unsigned int weight[SCHED_NREQ];
+          /** \brief instant each customer joined the queue by the counter (in ns) */
+          uint64_t custStamp[N];
+          /** \brief instant the pending request for prime materials and for batch collection was made (in ns) */
+          uint64_t reqStamp[SCHED_NREQ];
+          /** \brief the pending request has already been accounted for */
+          bool acct[SCHED_NREQ];
+          /** \brief number of requests served of each kind */
+          uint64_t served[SCHED_NREQ];
+          /** \brief total time requests of each kind were pending (in ns) */
+          uint64_t waitNs[SCHED_NREQ];
+        } SCHEDINFO;
+
+/**
+ *  \brief Initialization of the scheduling information.
+ *
+ *  \param p_si pointer to the location where the scheduling information is stored
+ *  \param policy scheduling policy
+ *  \param weight weights of the kinds of requests (weighted fair policy); the default weights are used if it is
+ *         <tt>NULL</tt>
+ */
+
+extern void schedInit (SCHEDINFO *p_si, unsigned int policy, unsigned int weight[]);
+
+/**
+ *  \brief Conversion of a policy name into a policy.
+ *
+ *  The weighted fair policy name may be followed by its weights, as in <tt>weighted:4,2,1</tt>.
+ *
+ *  \param name policy name
+ *  \param weight pointer to the location where the weights are stored, if they are given
+ *
+ *  \return the policy, upon success
+ *  \return -\c 1, if the name is not valid
+ */
+
+extern int schedParse (const char *name, unsigned int weight[]);
+
+/**
+ *  \brief Name of a policy.
+ *
+ *  \param policy scheduling policy
+ *
+ *  \return the policy name
+ */
+
+extern const char *schedName (unsigned int policy);
+
+/**
+ *  \brief Registration of a new request.
+ *
+ *  It must be called before the request is recorded in the state of the shop.
+ *
+ *  \param p_si pointer to the location where the scheduling information is stored
+ *  \param p_shop pointer to the location where the state of the shop the request is made to is stored
+ *  \param req kind of request
+ *  \param custId identification of the customer (kind <tt>SCHED_C</tt> only)
+ */
+
+extern void schedRequest (SCHEDINFO *p_si, SHOPINFO *p_shop, unsigned int req, unsigned int custId);
+
+/**
+ *  \brief Choice of the next task.
+ *
+ *  \param p_si pointer to the location where the scheduling information is stored
+ *  \param p_shop pointer to the location where the state of the shop is stored
+ *  \param p_ws pointer to the location where the state of the workshop is stored
+ *  \param nCraftsmenBlk number of craftsmen blocked waiting for prime materials
+ *
+ *  \return \c 'C', if a customer is to be attended
+ *  \return \c 'P', if prime materials are to be bought
+ *  \return \c 'G', if a batch of products is to be collected
+ *  \return \c '\\0', if no request is pending
+ */
+
+extern char schedNext (SCHEDINFO *p_si, SHOPINFO *p_shop, WORKSHOPINFO *p_ws, unsigned int nCraftsmenBlk);
+
+#endif /* SCHEDPOLICY_H_ */
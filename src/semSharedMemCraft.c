@@ -17,6 +17,9 @@
  *     \li batchReadyForTransfer
  *     \li endOperCraftsman.
  *
+ *  Built with <tt>REMOTE</tt> defined, for the entity hosts, the operations are remote calls to the coordinator, which
+ *  carries them out on the shared region.
+ *
  *  \author António Rui Borges - October 2014
  */
 
@@ -35,20 +38,29 @@
 #include "queue.h"
 #include "logging.h"
 #include "semaphore.h"
+#include "probes.h"
+#include "trace.h"
+#include "criticalRegion.h"
 #include "sharedMemory.h"
+#include "remote.h"
+#include "entities.h"
+
+#ifndef REMOTE
 
 /** \brief logging file name */
 static char *nFic;
 
-/** \brief shared memory block access identifier */
-static int shmid;
-
 /** \brief semaphore set access identifier */
 static int semgid;
 
 /** \brief pointer to shared memory region */
 static SHARED_DATA *sh;
 
+#endif /* REMOTE */
+
+/** \brief life cycle of the craftsman [internal] operation */
+static void craftsmanLife (unsigned int m, unsigned int batchSize);
+
 /** \brief collect materials operation */
 static bool collectMaterials (unsigned int craftId);
 
@@ -67,12 +79,35 @@ static unsigned int goToStore (unsigned int craftId);
 /** \brief batch ready for transfer operation */
 static void batchReadyForTransfer (unsigned int craftId);
 
+/** \brief collect materials for a batch of pieces operation */
+static unsigned int collectMaterialsBatch (unsigned int craftId, bool *pAlert);
+
+/** \brief go to store with a batch of pieces operation */
+static unsigned int goToStoreBatch (unsigned int craftId, unsigned int nPieces);
+
 /** \brief end of operations craftsman operation */
 static bool endOperCraftsman (unsigned int craftId);
 
 /** \brief shaping it up [internal] operation */
 static void shapingItUp (void);
 
+#ifndef REMOTE
+
+/** \brief binding to the shared region [internal] operation */
+static void craftsmanBind (unsigned int m, char *fic, int sgid, SHARED_DATA *shr, bool barrier);
+
+/** \brief choose the shop to phone [internal] operation */
+static unsigned int phoneShop (unsigned int req);
+
+#else
+
+/** \brief remote call [internal] operation */
+static uint32_t call (unsigned int craftId, unsigned int op, uint32_t arg);
+
+#endif /* REMOTE */
+
+#if !defined(ZYGOTE) && !defined(REMOTE)
+
 /**
  *  \brief Main program.
  *
@@ -82,6 +117,7 @@ static void shapingItUp (void);
 int main (int argc, char *argv[])
 {
   int key;                                                           /*access key to shared memory and semaphore set */
+  int shmid;                                                                /* shared memory block access identifier */
   char *tinp;                                                                      /* numerical parameters test flag */
   unsigned int m;                                                                         /* craftman identification */
 
@@ -120,12 +156,195 @@ int main (int argc, char *argv[])
      { perror ("error on mapping the shared region on the process address space");
        exit (EXIT_FAILURE);
      }
+  craftsmanRun (m, nFic, semgid, sh);                               /* simulation of the life cycle of the craftsman */
+
+  /* unmapping the shared region off the process address space */
+
+  if (shmemDettach (sh) == -1)
+     { perror ("error on unmapping the shared region off the process address space");
+       exit (EXIT_FAILURE);
+     }
+
+  exit (EXIT_SUCCESS);
+}
+
+#endif /* !ZYGOTE && !REMOTE */
+
+#ifndef REMOTE
+
+/**
+ *  \brief Life cycle of the craftsman.
+ *
+ *  The process must be already connected to the semaphore set and have the shared region mapped on its address
+ *  space. The function is called either by the main program or, in zygote mode, by a child of the launcher.
+ *
+ *  \param m craftsman identification
+ *  \param fic logging file name
+ *  \param sgid semaphore set access identifier
+ *  \param shr pointer to shared memory region
+ */
+
+void craftsmanRun (unsigned int m, char *fic, int sgid, SHARED_DATA *shr)
+{
+  craftsmanBind (m, fic, sgid, shr, true);
+  craftsmanLife (m, sh->batchSize);
+}
+
+#ifdef ZYGOTE
+
+/**
+ *  \brief Binding of a craftsman run by an entity host, at the coordinator.
+ *
+ *  The craftsman is bound to the shared region as it would be, except that it does not wait at the start barrier,
+ *  as its operations are only carried out by the coordinator once the simulation has started.
+ *
+ *  \param m craftsman identification
+ *  \param fic logging file name
+ *  \param sgid semaphore set access identifier
+ *  \param shr pointer to shared memory region
+ */
+
+void craftsmanAttach (unsigned int m, char *fic, int sgid, SHARED_DATA *shr)
+{
+  craftsmanBind (m, fic, sgid, shr, false);
+}
+
+/**
+ *  \brief Carrying out of an operation of a craftsman run by an entity host, at the coordinator.
+ *
+ *  The calling thread acts for the craftsman while the operation lasts. The operations of different craftsmen may be
+ *  carried out at the same time, by different threads, but a craftsman has a single one in progress.
+ *
+ *  \param m craftsman identification
+ *  \param p_rq pointer to the location where the request is stored, and where the reply is to be stored
+ */
+
+void craftsmanServe (unsigned int m, REMREC *p_rq)
+{
+  bool alert;                                                               /* low level of prime materials in store */
+
+  semProbeBind (N + 1 + m);                                                 /* identification reported by the probes */
+  crAdopt (N + 1 + m);                                  /* the critical region is entered on behalf of the craftsman */
+  switch (p_rq->op)
+  { case REM_COLLECT_MAT:      p_rq->val = collectMaterials (m);
+                               break;
+    case REM_PRIME_MAT_NEEDED: primeMaterialsNeeded (m);
+                               break;
+    case REM_BACK_TO_WORK:     backToWork (m);
+                               break;
+    case REM_PREPARE_PRODUCE:  prepareToProduce (m);
+                               break;
+    case REM_GO_TO_STORE:      p_rq->val = goToStore (m);
+                               break;
+    case REM_BATCH_READY:      batchReadyForTransfer (m);
+                               break;
+    case REM_COLLECT_MAT_B:    p_rq->val = collectMaterialsBatch (m, &alert);
+                               p_rq->val = (p_rq->val << 1) | alert;       /* the alert goes in the lowest order bit */
+                               break;
+    case REM_GO_TO_STORE_B:    p_rq->val = goToStoreBatch (m, p_rq->val);
+                               break;
+    case REM_END_OPER_CRAFT:   p_rq->val = endOperCraftsman (m);
+                               break;
+    default:                   fprintf (stderr, "Remote operation %u is not a craftsman operation!\n", p_rq->op);
+                               exit (EXIT_FAILURE);
+  }
+}
+
+#endif /* ZYGOTE */
+
+/**
+ *  \brief Binding to the shared region.
+ *
+ *  The craftsman binds to the shared logging, tracing and critical region information and waits at the start
+ *  barrier, if so requested (internal operation).
+ *
+ *  \param m craftsman identification
+ *  \param fic logging file name
+ *  \param sgid semaphore set access identifier
+ *  \param shr pointer to shared memory region
+ *  \param barrier the craftsman waits at the start barrier (not when its operations are carried out by the
+ *         coordinator)
+ */
+
+static void craftsmanBind (unsigned int m, char *fic, int sgid, SHARED_DATA *shr, bool barrier)
+{
+  nFic = fic;
+  semgid = sgid;
+  sh = shr;
+
+  logBind (&(sh->log));                                                 /* binding to the shared logging information */
+  traceBind (&(sh->trace));                                             /* binding to the shared tracing information */
+  semProbeBind (N + 1 + m);                                                 /* identification reported by the probes */
+  if (crBind (&(sh->cr), semgid, sh->lockSem, sh->turn, N + 1 + m) == -1)   /* binding to the critical region access */
+     { perror ("error on binding to the critical region information");
+       exit (EXIT_FAILURE);
+     }
+
+  /* waiting at the start barrier until every intervening entity is attached */
+
+  if (!barrier)
+     return;
+  if (semUp (semgid, sh->attached) == -1)
+     { perror ("error on executing the up operation for semaphore attached");
+       exit (EXIT_FAILURE);
+     }
+  if (semDown (semgid, sh->start) == -1)
+     { perror ("error on executing the down operation for semaphore start");
+       exit (EXIT_FAILURE);
+     }
+}
 
-  /* simulation of the life cycle of the craftsman */
+#else
 
+/**
+ *  \brief Life cycle of a craftsman run by an entity host.
+ *
+ *  The operations are carried out by the coordinator.
+ *
+ *  \param m craftsman identification
+ *  \param batchSize number of pieces produced per visit to the store
+ */
+
+void craftsmanRemote (unsigned int m, unsigned int batchSize)
+{
+  craftsmanLife (m, batchSize);
+}
+
+#endif /* REMOTE */
+
+/**
+ *  \brief Simulation of the life cycle of the craftsman (internal operation).
+ *
+ *  \param m craftsman identification
+ *  \param batchSize number of pieces produced per visit to the store
+ */
+
+static void craftsmanLife (unsigned int m, unsigned int batchSize)
+{
   unsigned int np;                                                                    /* number of products in store */
   bool alert;                                                               /* low level of prime materials in store */
 
+  unsigned int nb,                                                          /* number of pieces in the present batch */
+               i;                                                                               /* counting variable */
+
+  if (batchSize > 1)                                                                           /* batched production */
+     { while (!endOperCraftsman (m))
+       { nb = collectMaterialsBatch (m, &alert);        /* the craftsman gets the prime materials for several pieces */
+         if (alert)
+            { primeMaterialsNeeded (m);
+              backToWork (m);
+            }
+         prepareToProduce (m);
+         for (i = 0; i < nb; i++)
+           shapingItUp ();
+         np = goToStoreBatch (m, nb);                              /* the craftsman stores all the finished products */
+         if (np >= MAX)
+            batchReadyForTransfer (m);
+         backToWork (m);
+       }
+       return;
+     }
+
   while (!endOperCraftsman (m))
   { alert = collectMaterials (m);        /* the craftsman gets the prime materials he needs to manufacture a product */
     if (alert)
@@ -141,17 +360,10 @@ int main (int argc, char *argv[])
                                                                             come and collect a new batch of products */
     backToWork (m);                                                   /* the craftsman returns to his regular duties */
   }
-
-  /* unmapping the shared region off the process address space */
-
-  if (shmemDettach (sh) == -1)
-     { perror ("error on unmapping the shared region off the process address space");
-       exit (EXIT_FAILURE);
-     }
-
-  exit (EXIT_SUCCESS);
 }
 
+#ifndef REMOTE
+
 /**
  *  Collect materials operation.
  *  The craftsman gets the prime materials he needs to manufacture a product.
@@ -165,7 +377,9 @@ int main (int argc, char *argv[])
  */
 
 static bool collectMaterials(unsigned int craftId) {
-    if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+    PROBE_ENTRY(collectMaterials, N + 1 + craftId);
+
+    if (crEnter(CR_WORKSHOP) == -1) /* enter critical region */ {
         perror("error on executing the down operation for semaphore access");
         exit(EXIT_FAILURE);
     }
@@ -175,18 +389,18 @@ static bool collectMaterials(unsigned int craftId) {
     while (!sh->fSt.workShop.nPMatIn) {
         sh->nCraftsmenBlk++;
 
-        if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+        if (crExit() == -1) /* exit critical region */ {
             perror("error on executing the up operation for semaphore access");
             exit(EXIT_FAILURE);
         }
 
         /* insert your code here */
-        if (semDown(semgid, sh->waitForMaterials) == -1) {
+        if (crWait(semgid, sh->waitForMaterials) == -1) {
             perror("collectMaterials() error during semDown waitformaterials");
             exit(EXIT_FAILURE);
         }
 
-        if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+        if (crEnter(CR_WORKSHOP) == -1) /* enter critical region */ {
             perror("error on executing the down operation for semaphore access");
             exit(EXIT_FAILURE);
         }
@@ -198,11 +412,12 @@ static bool collectMaterials(unsigned int craftId) {
 
     materialsRequired = (sh->fSt.workShop.nPMatIn < PMIN); // check if the number of materials available are too low
 
-    if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+    if (crExit() == -1) /* exit critical region */ {
         perror("error on executing the up operation for semaphore access");
         exit(EXIT_FAILURE);
     }
 
+    PROBE_RETURN(collectMaterials, N + 1 + craftId);
     return materialsRequired;
 }
 
@@ -216,26 +431,34 @@ static bool collectMaterials(unsigned int craftId) {
 
 static void primeMaterialsNeeded (unsigned int craftId)
 {
-  if (semDown (semgid, sh->access) == -1)                                                   /* enter critical region */
+  unsigned int k;                                                               /* shop whose entrepreneur is phoned */
+
+  PROBE_ENTRY (primeMaterialsNeeded, N + 1 + craftId);
+
+  if (crEnter (CR_SELF) == -1)                                                              /* enter critical region */
      { perror ("error on executing the down operation for semaphore access");
        exit (EXIT_FAILURE);
      }
 
   /* insert your code here */
   sh->fSt.st.craftStat[craftId].stat = CONTACTING_THE_ENTREPRENEUR; // state change
-  sh->fSt.shop.primeMatReq = true; // materials are needed
+  k = phoneShop (SCHED_P); // the entrepreneur to be phoned
+  schedRequest (&sh->sched[k], &sh->fSt.shop[k], SCHED_P, 0); // the instant of the request is registered
+  sh->fSt.shop[k].primeMatReq = true; // materials are needed
 
-  if(semUp(semgid,sh->proceed) == -1){
+  if(semUp(semgid,sh->proceed[k]) == -1){
       perror("primeMaterialsNeeded() error during semUp() for proceed");
       exit (EXIT_FAILURE);
   }
 
   saveState(nFic,&(sh->fSt));
 
-  if (semUp (semgid, sh->access) == -1)                                                      /* exit critical region */
+  if (crExit () == -1)                                                                       /* exit critical region */
      { perror ("error on executing the up operation for semaphore access");
        exit (EXIT_FAILURE);
      }
+
+  PROBE_RETURN (primeMaterialsNeeded, N + 1 + craftId);
 }
 
 /**
@@ -248,7 +471,9 @@ static void primeMaterialsNeeded (unsigned int craftId)
 
 static void backToWork (unsigned int craftId)
 {
-  if (semDown (semgid, sh->access) == -1)                                                   /* enter critical region */
+  PROBE_ENTRY (backToWork, N + 1 + craftId);
+
+  if (crEnter (CR_SELF) == -1)                                                              /* enter critical region */
      { perror ("error on executing the down operation for semaphore access");
        exit (EXIT_FAILURE);
      }
@@ -257,10 +482,12 @@ static void backToWork (unsigned int craftId)
   sh->fSt.st.craftStat[craftId].stat = FETCHING_PRIME_MATERIALS; // change state
   saveState(nFic,&(sh->fSt));
 
-  if (semUp (semgid, sh->access) == -1)                                                      /* exit critical region */
+  if (crExit () == -1)                                                                       /* exit critical region */
      { perror ("error on executing the up operation for semaphore access");
        exit (EXIT_FAILURE);
      }
+
+  PROBE_RETURN (backToWork, N + 1 + craftId);
 }
 
 /**
@@ -273,7 +500,9 @@ static void backToWork (unsigned int craftId)
 
 static void prepareToProduce (unsigned int craftId)
 {
-  if (semDown (semgid, sh->access) == -1)                                                   /* enter critical region */
+  PROBE_ENTRY (prepareToProduce, N + 1 + craftId);
+
+  if (crEnter (CR_SELF) == -1)                                                              /* enter critical region */
      { perror ("error on executing the down operation for semaphore access");
        exit (EXIT_FAILURE);
      }
@@ -282,10 +511,12 @@ static void prepareToProduce (unsigned int craftId)
   sh->fSt.st.craftStat[craftId].stat = PRODUCING_A_NEW_PIECE; // state change
   saveState(nFic,&(sh->fSt));
 
-  if (semUp (semgid, sh->access) == -1)                                                      /* exit critical region */
+  if (crExit () == -1)                                                                       /* exit critical region */
      { perror ("error on executing the up operation for semaphore access");
        exit (EXIT_FAILURE);
      }
+
+  PROBE_RETURN (prepareToProduce, N + 1 + craftId);
 }
 
 /**
@@ -300,7 +531,9 @@ static void prepareToProduce (unsigned int craftId)
 
 static unsigned int goToStore (unsigned int craftId)
 {
-  if (semDown (semgid, sh->access) == -1)                                                   /* enter critical region */
+  PROBE_ENTRY (goToStore, N + 1 + craftId);
+
+  if (crEnter (CR_WORKSHOP) == -1)                                                          /* enter critical region */
      { perror ("error on executing the down operation for semaphore access");
        exit (EXIT_FAILURE);
      }
@@ -315,11 +548,12 @@ static unsigned int goToStore (unsigned int craftId)
 
   nProdIn = sh->fSt.workShop.nProdIn; // update return variable
 
-  if (semUp (semgid, sh->access) == -1)                                                      /* exit critical region */
+  if (crExit () == -1)                                                                       /* exit critical region */
      { perror ("error on executing the up operation for semaphore access");
        exit (EXIT_FAILURE);
      }
 
+  PROBE_RETURN (goToStore, N + 1 + craftId);
   return nProdIn;
 }
 
@@ -333,25 +567,141 @@ static unsigned int goToStore (unsigned int craftId)
 
 static void batchReadyForTransfer (unsigned int craftId)
 {
-  if (semDown (semgid, sh->access) == -1)                                                   /* enter critical region */
+  unsigned int k;                                                               /* shop whose entrepreneur is phoned */
+
+  PROBE_ENTRY (batchReadyForTransfer, N + 1 + craftId);
+
+  if (crEnter (CR_SELF) == -1)                                                              /* enter critical region */
      { perror ("error on executing the down operation for semaphore access");
        exit (EXIT_FAILURE);
      }
 
   sh->fSt.st.craftStat[craftId].stat = CONTACTING_THE_ENTREPRENEUR; // state change
-  sh->fSt.shop.prodTransfer = true; // ready for transfer
+  k = phoneShop (SCHED_G); // the entrepreneur to be phoned
+  schedRequest (&sh->sched[k], &sh->fSt.shop[k], SCHED_G, 0); // the instant of the request is registered
+  sh->fSt.shop[k].prodTransfer = true; // ready for transfer
 
-  if(semUp(semgid,sh->proceed) == -1){
+  if(semUp(semgid,sh->proceed[k]) == -1){
       perror("batchReadyForTransfer() error while semUp sh->proceed");
       exit(EXIT_FAILURE);
   }
 
   saveState(nFic,&(sh->fSt));
 
-  if (semUp (semgid, sh->access) == -1)                                                      /* exit critical region */
+  if (crExit () == -1)                                                                       /* exit critical region */
+     { perror ("error on executing the up operation for semaphore access");
+       exit (EXIT_FAILURE);
+     }
+
+  PROBE_RETURN (batchReadyForTransfer, N + 1 + craftId);
+}
+
+/**
+ *  \brief Collect materials for a batch of pieces operation.
+ *
+ *  The craftsman gets, in a single visit to the store, the prime materials he needs to manufacture up to
+ *  <tt>batchSize</tt> pieces. The materials are taken one piece at a time, so the log shows one row per piece.
+ *  When all the delivers of prime materials have been carried out, enough materials are left for each of the
+ *  remaining operative craftsmen to produce one more piece.
+ *
+ *  \param craftId identification of the craftsman
+ *  \param pAlert pointer to the location where it is stored whether it is necessary to phone the entrepreneur to let
+ *         her know the workshop requires more prime materials
+ *
+ *  \return number of pieces whose prime materials were collected
+ */
+
+static unsigned int collectMaterialsBatch (unsigned int craftId, bool *pAlert)
+{
+  unsigned int nb,                                                                /* number of pieces to be produced */
+               nOpCraft,                                                      /* number of craftsmen still operative */
+               i;                                                                               /* counting variable */
+
+  PROBE_ENTRY (collectMaterialsBatch, N + 1 + craftId);
+
+  if (crEnter (CR_WORKSHOP) == -1)                                                          /* enter critical region */
+     { perror ("error on executing the down operation for semaphore access");
+       exit (EXIT_FAILURE);
+     }
+
+  while (sh->fSt.workShop.nPMatIn < PP)                              /* wait for the deliver of more prime materials */
+  { sh->nCraftsmenBlk += 1;
+    if (crExit () == -1)                                                                     /* exit critical region */
+       { perror ("error on executing the up operation for semaphore access");
+         exit (EXIT_FAILURE);
+       }
+    if (crWait (semgid, sh->waitForMaterials) == -1)
+       { perror ("error on executing the down operation for semaphore waitForMaterials");
+         exit (EXIT_FAILURE);
+       }
+    if (crEnter (CR_WORKSHOP) == -1)                                                        /* enter critical region */
+       { perror ("error on executing the down operation for semaphore access");
+         exit (EXIT_FAILURE);
+       }
+  }
+
+  nb = sh->fSt.workShop.nPMatIn / PP;
+  if (sh->fSt.workShop.NSPMat == NP)                                  /* no more prime materials are to be delivered */
+     { for (nOpCraft = 0, i = 0; i < M; i++)
+         if (sh->fSt.st.craftStat[i].readyToWork) nOpCraft += 1;
+       nb = (nb > nOpCraft) ? nb - (nOpCraft - 1) : 1;
+     }
+  if (nb > sh->batchSize) nb = sh->batchSize;
+  for (i = 0; i < nb; i++)                                                                      /* one row per piece */
+  { sh->fSt.workShop.nPMatIn -= PP;
+    saveState (nFic, &(sh->fSt));
+  }
+  *pAlert = (sh->fSt.workShop.nPMatIn < PMIN);
+
+  if (crExit () == -1)                                                                       /* exit critical region */
+     { perror ("error on executing the up operation for semaphore access");
+       exit (EXIT_FAILURE);
+     }
+
+  PROBE_RETURN (collectMaterialsBatch, N + 1 + craftId);
+  return nb;
+}
+
+/**
+ *  \brief Go to store with a batch of pieces operation.
+ *
+ *  The craftsman stores all the finished products of the batch in a single visit to the storeroom. The products are
+ *  stored one at a time, so the log shows one row per piece.
+ *
+ *  \param craftId identification of the craftsman
+ *  \param nPieces number of finished products
+ *
+ *  \return number of products presently stored in the storeroom
+ */
+
+static unsigned int goToStoreBatch (unsigned int craftId, unsigned int nPieces)
+{
+  unsigned int nProdIn,                                             /* number of products presently in the storeroom */
+               i;                                                                               /* counting variable */
+
+  PROBE_ENTRY (goToStoreBatch, N + 1 + craftId);
+
+  if (crEnter (CR_WORKSHOP) == -1)                                                          /* enter critical region */
+     { perror ("error on executing the down operation for semaphore access");
+       exit (EXIT_FAILURE);
+     }
+
+  sh->fSt.st.craftStat[craftId].stat = STORING_IT_FOR_TRANSFER;
+  for (i = 0; i < nPieces; i++)                                                                 /* one row per piece */
+  { sh->fSt.st.craftStat[craftId].prodPieces += 1;
+    sh->fSt.workShop.nProdIn += 1;
+    sh->fSt.workShop.NTProd += 1;
+    saveState (nFic, &(sh->fSt));
+  }
+  nProdIn = sh->fSt.workShop.nProdIn;
+
+  if (crExit () == -1)                                                                       /* exit critical region */
      { perror ("error on executing the up operation for semaphore access");
        exit (EXIT_FAILURE);
      }
+
+  PROBE_RETURN (goToStoreBatch, N + 1 + craftId);
+  return nProdIn;
 }
 
 /**
@@ -372,15 +722,20 @@ static void batchReadyForTransfer (unsigned int craftId)
 
 static bool endOperCraftsman (unsigned int craftId)
 {
-  bool stat;                                                                                     /* craftsman status */
+  bool stat,                                                                                     /* craftsman status */
+       last;                                                                   /* the last craftsman is about to die */
   unsigned int nOpCraft,                                                      /* number of craftsmen still operative */
+               k,                                                               /* shop whose entrepreneur is phoned */
                i;                                                                               /* counting variable */
 
-  if (semDown (semgid, sh->access) == -1)                                                   /* enter critical region */
+  PROBE_ENTRY (endOperCraftsman, N + 1 + craftId);
+
+  if (crEnter (CR_WORKSHOP) == -1)                                                          /* enter critical region */
      { perror ("error on executing the down operation for semaphore access");
        exit (EXIT_FAILURE);
      }
 
+  last = false;
   stat = (sh->fSt.workShop.NSPMat == NP);               /* all the delivers of prime materials have been carried out */
   if (stat)
      { nOpCraft = 0;                                              /* find out how many customers are still operative */
@@ -391,25 +746,184 @@ static bool endOperCraftsman (unsigned int craftId)
                                                                      of prime materials necessary to produce a piece */
        if (stat)
           sh->fSt.st.craftStat[craftId].readyToWork = false;  /* the craftsman is signaled non operative from now on */
-       if (stat && (nOpCraft == 1))                                   /* check if the last craftsman is about to die */
-          { sh->fSt.shop.prodTransfer = true;                    /* signal a batch of products is ready for transfer */
-            if (semUp (semgid, sh->proceed) == -1)                                     /* and alert the entrepreneur */
-               { perror ("error on executing the up operation for semaphore proceed");
-                 exit (EXIT_FAILURE);
-               }
-            saveState (nFic, &(sh->fSt));                                      /* save present state in the log file */
-          }
+       last = stat && (nOpCraft == 1);                                /* check if the last craftsman is about to die */
      }
 
-  if (semUp (semgid, sh->access) == -1)                                                      /* exit critical region */
+  if (crExit () == -1)                                                                       /* exit critical region */
      { perror ("error on executing the up operation for semaphore access");
        exit (EXIT_FAILURE);
      }
 
+  if (last)
+     { if (crEnter (CR_SELF) == -1)                                                         /* enter critical region */
+          { perror ("error on executing the down operation for semaphore access");
+            exit (EXIT_FAILURE);
+          }
+       k = phoneShop (SCHED_G);
+       schedRequest (&sh->sched[k], &sh->fSt.shop[k], SCHED_G, 0);
+       sh->fSt.shop[k].prodTransfer = true;                      /* signal a batch of products is ready for transfer */
+       if (semUp (semgid, sh->proceed[k]) == -1)                                       /* and alert the entrepreneur */
+          { perror ("error on executing the up operation for semaphore proceed");
+            exit (EXIT_FAILURE);
+          }
+       saveState (nFic, &(sh->fSt));                                           /* save present state in the log file */
+       if (crExit () == -1)                                                                  /* exit critical region */
+          { perror ("error on executing the up operation for semaphore access");
+            exit (EXIT_FAILURE);
+          }
+     }
+
   //stat = true;                               /*         <---            remove this instruction for normal operation */
+
+  PROBE_RETURN (endOperCraftsman, N + 1 + craftId);
   return stat;
 }
 
+#else
+
+/**
+ *  \brief Remote call of an operation.
+ *
+ *  The coordinator carries it out (internal operation).
+ *
+ *  \param craftId identification of the craftsman
+ *  \param op operation
+ *  \param arg argument of the operation
+ *
+ *  \return value returned by the operation
+ */
+
+static uint32_t call (unsigned int craftId, unsigned int op, uint32_t arg)
+{
+  uint32_t val;                                                                                    /* value returned */
+
+  if (remCall (N + 1 + craftId, op, arg, &val) == -1)
+     { perror ("error on the remote call of a craftsman operation");
+       exit (EXIT_FAILURE);
+     }
+  return val;
+}
+
+/**
+ *  \brief Collect materials operation (remote call).
+ *
+ *  \param craftId identification of the craftsman
+ *
+ *  \return -c true, if it is necessary to phone the entrepreneur to let her know the workshop requires more prime
+ *          materials
+ *  \return -c false, otherwise
+ */
+
+static bool collectMaterials (unsigned int craftId)
+{
+  return call (craftId, REM_COLLECT_MAT, 0) != 0;
+}
+
+/**
+ *  \brief Prime materials needed operation (remote call).
+ *
+ *  \param craftId identification of the craftsman
+ */
+
+static void primeMaterialsNeeded (unsigned int craftId)
+{
+  call (craftId, REM_PRIME_MAT_NEEDED, 0);
+}
+
+/**
+ *  \brief Back to work operation (remote call).
+ *
+ *  \param craftId identification of the craftsman
+ */
+
+static void backToWork (unsigned int craftId)
+{
+  call (craftId, REM_BACK_TO_WORK, 0);
+}
+
+/**
+ *  \brief Prepare to produce operation (remote call).
+ *
+ *  \param craftId identification of the craftsman
+ */
+
+static void prepareToProduce (unsigned int craftId)
+{
+  call (craftId, REM_PREPARE_PRODUCE, 0);
+}
+
+/**
+ *  \brief Go to store operation (remote call).
+ *
+ *  \param craftId identification of the craftsman
+ *
+ *  \return number of products presently stored in the storeroom
+ */
+
+static unsigned int goToStore (unsigned int craftId)
+{
+  return call (craftId, REM_GO_TO_STORE, 0);
+}
+
+/**
+ *  \brief Batch ready for transfer operation (remote call).
+ *
+ *  \param craftId identification of the craftsman
+ */
+
+static void batchReadyForTransfer (unsigned int craftId)
+{
+  call (craftId, REM_BATCH_READY, 0);
+}
+
+/**
+ *  \brief Collect materials for a batch of pieces operation (remote call).
+ *
+ *  \param craftId identification of the craftsman
+ *  \param pAlert pointer to the location where it is stored whether it is necessary to phone the entrepreneur to let
+ *         her know the workshop requires more prime materials
+ *
+ *  \return number of pieces whose prime materials were collected
+ */
+
+static unsigned int collectMaterialsBatch (unsigned int craftId, bool *pAlert)
+{
+  uint32_t val = call (craftId, REM_COLLECT_MAT_B, 0);                     /* the alert goes in the lowest order bit */
+
+  *pAlert = (val & 1) != 0;
+  return val >> 1;
+}
+
+/**
+ *  \brief Go to store with a batch of pieces operation (remote call).
+ *
+ *  \param craftId identification of the craftsman
+ *  \param nPieces number of finished products
+ *
+ *  \return number of products presently stored in the storeroom
+ */
+
+static unsigned int goToStoreBatch (unsigned int craftId, unsigned int nPieces)
+{
+  return call (craftId, REM_GO_TO_STORE_B, nPieces);
+}
+
+/**
+ *  \brief End of operations for the craftsman (remote call).
+ *
+ *  \param craftId identification of the craftsman
+ *
+ *  \return -c true, if the life cycle of the craftsman has come to an end
+ *  \return -c false, otherwise
+ */
+
+static bool endOperCraftsman (unsigned int craftId)
+{
+  return call (craftId, REM_END_OPER_CRAFT, 0) != 0;
+}
+
+#endif /* REMOTE */
+
 /**
  *  \brief Shaping it up operation.
  *
@@ -418,5 +932,44 @@ static bool endOperCraftsman (unsigned int craftId)
 
 static void shapingItUp (void)
 {
-  usleep((unsigned int) floor (30.0 * random () / RAND_MAX + 1.5));
+  crDelay ((unsigned int) floor (30.0 * random () / RAND_MAX + 1.5));
+}
+
+#ifndef REMOTE
+
+/**
+ *  \brief Choose the shop to phone operation.
+ *
+ *  The craftsman phones the entrepreneur of the shop a request of the same kind is already pending with, if there is
+ *  one, or else the one of the shop still in business with the fewest products in display (internal operation).
+ *  The shops are looked at without taking their locks, so two requests may now and then be phoned to different
+ *  shops, which only brings a deliver or a collection forward. The critical region of the shop chosen is then
+ *  entered, the caller having entered its own one: both are left together on the next exit.
+ *
+ *  \param req kind of request: either SCHED_P or SCHED_G
+ *
+ *  \return identification of the shop
+ */
+
+static unsigned int phoneShop (unsigned int req)
+{
+  unsigned int k = NS,                                                                                /* shop chosen */
+               s;                                                                               /* counting variable */
+
+  for (s = 0; (k == NS) && (s < NS); s++)
+    if ((req == SCHED_P) ? sh->fSt.shop[s].primeMatReq : sh->fSt.shop[s].prodTransfer)
+       k = s;                                                       /* a request of the same kind is already pending */
+  if (k == NS)
+     { for (s = 0; s < NS; s++)
+         if (sh->inBusiness[s] && ((k == NS) || (sh->fSt.shop[s].nProdIn < sh->fSt.shop[k].nProdIn)))
+            k = s;
+       if (k == NS) k = 0;
+     }
+  if (crEnter (CR_SHOP (k)) == -1)                                          /* enter the critical region of the shop */
+     { perror ("error on executing the down operation for semaphore access");
+       exit (EXIT_FAILURE);
+     }
+  return k;
 }
+
+#endif /* REMOTE */
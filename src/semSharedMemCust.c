@@ -18,6 +18,9 @@
  *     \li exitShop
  *     \li endOperCustomer.
  *
+ *  Built with <tt>REMOTE</tt> defined, for the entity hosts, the operations are remote calls to the coordinator, which
+ *  carries them out on the shared region.
+ *
  *  \author António Rui Borges - October 2014
  */
 
@@ -35,20 +38,35 @@
 #include "queue.h"
 #include "logging.h"
 #include "semaphore.h"
+#include "probes.h"
+#include "trace.h"
+#include "criticalRegion.h"
 #include "sharedMemory.h"
+#include "remote.h"
+#include "entities.h"
+
+#ifndef REMOTE
 
 /** \brief logging file name */
 static char *nFic;
 
-/** \brief shared memory block access identifier */
-static int shmid;
-
 /** \brief semaphore set access identifier */
 static int semgid;
 
 /** \brief pointer to shared memory region */
 static SHARED_DATA *sh;
 
+/** \brief identification of the shop each customer is visiting (the coordinator serves several customers) */
+static unsigned int shopId[N];
+
+/** \brief each customer has already visited some shop */
+static bool visited[N];
+
+#endif /* REMOTE */
+
+/** \brief life cycle of the customer [internal] operation */
+static void customerLife(unsigned int n);
+
 /** \brief go shopping operation */
 static void goShopping(unsigned int custId);
 
@@ -69,7 +87,6 @@ static void iWantThis(unsigned int custId, unsigned int nGoods);
 
 /** \brief exit the shop operation */
 static void exitShop(unsigned int custId);
-;
 
 /** \brief end of operations customer operation */
 static bool endOperCustomer(unsigned int custId);
@@ -77,8 +94,25 @@ static bool endOperCustomer(unsigned int custId);
 /** \brief living normal life [internal] operation */
 static void livingNormalLife(void);
 
+#ifndef REMOTE
+
+/** \brief binding to the shared region [internal] operation */
+static void customerBind(unsigned int n, char *fic, int sgid, SHARED_DATA *shr, bool barrier);
+
 /** \brief pick up [internal] operation */
-static unsigned int pickUp(void);
+static unsigned int pickUp(unsigned int custId);
+
+/** \brief choose a shop [internal] operation */
+static unsigned int chooseShop(unsigned int custId);
+
+#else
+
+/** \brief remote call [internal] operation */
+static uint32_t call(unsigned int custId, unsigned int op, uint32_t arg);
+
+#endif /* REMOTE */
+
+#if !defined(ZYGOTE) && !defined(REMOTE)
 
 /**
  *  \brief Main program.
@@ -88,6 +122,7 @@ static unsigned int pickUp(void);
 
 int main(int argc, char *argv[]) {
     int key; /*access key to shared memory and semaphore set */
+    int shmid; /* shared memory block access identifier */
     char *tinp; /* numerical parameters test flag */
     unsigned int n; /* customer identification */
 
@@ -125,9 +160,158 @@ int main(int argc, char *argv[]) {
         perror("error on mapping the shared region on the process address space");
         exit(EXIT_FAILURE);
     }
+    customerRun(n, nFic, semgid, sh); /* simulation of the life cycle of the customer */
+
+    /* unmapping the shared region off the process address space */
+
+    if (shmemDettach(sh) == -1) {
+        perror("error on unmapping the shared region off the process address space");
+        exit(EXIT_FAILURE);
+    }
+
+    exit(EXIT_SUCCESS);
+}
+
+#endif /* !ZYGOTE && !REMOTE */
+
+#ifndef REMOTE
+
+/**
+ *  \brief Life cycle of the customer.
+ *
+ *  The process must be already connected to the semaphore set and have the shared region mapped on its address
+ *  space. The function is called either by the main program or, in zygote mode, by a child of the launcher.
+ *
+ *  \param n customer identification
+ *  \param fic logging file name
+ *  \param sgid semaphore set access identifier
+ *  \param shr pointer to shared memory region
+ */
+
+void customerRun(unsigned int n, char *fic, int sgid, SHARED_DATA *shr) {
+    customerBind(n, fic, sgid, shr, true);
+    customerLife(n);
+}
+
+#ifdef ZYGOTE
+
+/**
+ *  \brief Binding of a customer run by an entity host, at the coordinator.
+ *
+ *  The customer is bound to the shared region as it would be, except that it does not wait at the start barrier, as
+ *  its operations are only carried out by the coordinator once the simulation has started.
+ *
+ *  \param n customer identification
+ *  \param fic logging file name
+ *  \param sgid semaphore set access identifier
+ *  \param shr pointer to shared memory region
+ */
+
+void customerAttach(unsigned int n, char *fic, int sgid, SHARED_DATA *shr) {
+    customerBind(n, fic, sgid, shr, false);
+}
+
+/**
+ *  \brief Carrying out of an operation of a customer run by an entity host, at the coordinator.
+ *
+ *  The calling thread acts for the customer while the operation lasts. The operations of different customers may be
+ *  carried out at the same time, by different threads, but a customer has a single one in progress.
+ *
+ *  \param n customer identification
+ *  \param p_rq pointer to the location where the request is stored, and where the reply is to be stored
+ */
+
+void customerServe(unsigned int n, REMREC *p_rq) {
+    semProbeBind(1 + n); /* identification reported by the probes */
+    crAdopt(1 + n); /* the critical region is entered on behalf of the customer */
+    switch (p_rq->op) {
+        case REM_GO_SHOPPING: goShopping(n);
+            break;
+        case REM_IS_DOOR_OPEN: p_rq->val = isDoorOpen(n);
+            break;
+        case REM_TRY_AGAIN_LATER: tryAgainLater(n);
+            break;
+        case REM_ENTER_SHOP: enterShop(n);
+            break;
+        case REM_PERUSING_AROUND: p_rq->val = perusingAround(n);
+            break;
+        case REM_I_WANT_THIS: iWantThis(n, p_rq->val);
+            break;
+        case REM_EXIT_SHOP: exitShop(n);
+            break;
+        case REM_END_OPER_CUST: p_rq->val = endOperCustomer(n);
+            break;
+        default: fprintf(stderr, "Remote operation %u is not a customer operation!\n", p_rq->op);
+            exit(EXIT_FAILURE);
+    }
+}
+
+#endif /* ZYGOTE */
+
+/**
+ *  \brief Binding to the shared region.
+ *
+ *  The customer binds to the shared logging, tracing and critical region information and waits at the start barrier,
+ *  if so requested (internal operation).
+ *
+ *  \param n customer identification
+ *  \param fic logging file name
+ *  \param sgid semaphore set access identifier
+ *  \param shr pointer to shared memory region
+ *  \param barrier the customer waits at the start barrier (not when its operations are carried out by the
+ *         coordinator)
+ */
 
-    /* simulation of the life cycle of the customer */
+static void customerBind(unsigned int n, char *fic, int sgid, SHARED_DATA *shr, bool barrier) {
+    nFic = fic;
+    semgid = sgid;
+    sh = shr;
 
+    logBind(&(sh->log)); /* binding to the shared logging information */
+    traceBind(&(sh->trace)); /* binding to the shared tracing information */
+    semProbeBind(1 + n); /* identification reported by the probes */
+    if (crBind(&(sh->cr), semgid, sh->lockSem, sh->turn, 1 + n) == -1) { /* binding to the critical region access */
+        perror("error on binding to the critical region information");
+        exit(EXIT_FAILURE);
+    }
+
+    /* waiting at the start barrier until every intervening entity is attached */
+
+    if (!barrier)
+        return;
+    if (semUp(semgid, sh->attached) == -1) {
+        perror("error on executing the up operation for semaphore attached");
+        exit(EXIT_FAILURE);
+    }
+    if (semDown(semgid, sh->start) == -1) {
+        perror("error on executing the down operation for semaphore start");
+        exit(EXIT_FAILURE);
+    }
+}
+
+#else
+
+/**
+ *  \brief Life cycle of a customer run by an entity host.
+ *
+ *  The operations are carried out by the coordinator.
+ *
+ *  \param n customer identification
+ */
+
+void customerRemote(unsigned int n) {
+    customerLife(n);
+}
+
+#endif /* REMOTE */
+
+/**
+ *  \brief Simulation of the life cycle of the customer (internal operation).
+ *
+ *  \param n customer identification
+ */
+
+static void customerLife(unsigned int n) {
     unsigned int ng; /* number of selected goods */
 
     while (!endOperCustomer(n)) {
@@ -144,40 +328,40 @@ int main(int argc, char *argv[]) {
             iWantThis(n, ng); /* the customer queues by the counter to pay for the selected goods */
         exitShop(n); /* the customer leaves the shop */
     }
-
-    /* unmapping the shared region off the process address space */
-
-    if (shmemDettach(sh) == -1) {
-        perror("error on unmapping the shared region off the process address space");
-        exit(EXIT_FAILURE);
-    }
-
-    exit(EXIT_SUCCESS);
 }
 
+#ifndef REMOTE
+
 /**
  *  \brief Go shopping operation.
  *
- *  The customer decides to visit the handicraft shop.
+ *  The customer decides to visit the handicraft shop. When there are several, the shop is picked by the routing
+ *  policy.
  *
  *  \param custId identification of the customer
  */
 
 static void goShopping(unsigned int custId) {
-    if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+    PROBE_ENTRY(goShopping, 1 + custId);
+
+    if (crEnter(CR_SELF) == -1) /* enter critical region */ {
         perror("error on executing the down operation for semaphore access");
         exit(EXIT_FAILURE);
     }
 
     /* insert your code here */
     sh->fSt.st.custStat[custId].stat = CHECKING_SHOP_DOOR_OPEN; // change state
+    shopId[custId] = chooseShop(custId); // the routing policy picks the shop to be visited
+    visited[custId] = true;
     saveState(nFic,&(sh->fSt));
 
 
-    if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+    if (crExit() == -1) /* exit critical region */ {
         perror("error on executing the up operation for semaphore access");
         exit(EXIT_FAILURE);
     }
+
+    PROBE_RETURN(goShopping, 1 + custId);
 }
 
 /**
@@ -192,34 +376,53 @@ static void goShopping(unsigned int custId) {
  */
 
 static bool isDoorOpen(unsigned int custId) {
-    if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+    PROBE_ENTRY(isDoorOpen, 1 + custId);
+
+    if (crEnter(CR_SHOP(shopId[custId])) == -1) /* enter critical region */ {
         perror("error on executing the down operation for semaphore access");
         exit(EXIT_FAILURE);
     }
 
     /* insert your code here */
 
-    return sh->fSt.shop.stat == SOPEN; //change state
+    PROBE_RETURN(isDoorOpen, 1 + custId);
+    return sh->fSt.shop[shopId[custId]].stat == SOPEN; //change state
 }
 
 /**
  *  \brief Try again later operation.
  *
  *  The customer goes back to perform his daily chores.
+ *  In door gate mode, he does not come back until the entrepreneur opens the shop again, or her shop goes out of
+ *  business.
  *
  *  \param custId identification of the customer
  */
 
 static void tryAgainLater(unsigned int custId) {
+    bool blk; /* the customer waits for the door to open */
+
+    PROBE_ENTRY(tryAgainLater, 1 + custId);
 
     /* insert your code here */
     sh->fSt.st.custStat[custId].stat = CARRYING_OUT_DAILY_CHORES; // change the state
     saveState(nFic,&(sh->fSt));
+    // nobody is left to open the door of a shop out of business
+    blk = sh->doorGateOn && sh->inBusiness[shopId[custId]];
+    if (blk)
+        sh->nCustomersBlk[shopId[custId]]++; // one more customer waiting for the door to open
 
-    if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+    if (crExit() == -1) /* exit critical region */ {
         perror("error on executing the up operation for semaphore access");
         exit(EXIT_FAILURE);
     }
+
+    if (blk && (crWait(semgid, sh->doorGate[shopId[custId]]) == -1)) { // wait until the shop is opened again
+        perror("error on executing the down operation for semaphore doorGate");
+        exit(EXIT_FAILURE);
+    }
+
+    PROBE_RETURN(tryAgainLater, 1 + custId);
 }
 
 /**
@@ -231,16 +434,19 @@ static void tryAgainLater(unsigned int custId) {
  */
 
 static void enterShop(unsigned int custId) {
+    PROBE_ENTRY(enterShop, 1 + custId);
 
     /* insert your code here */
     sh->fSt.st.custStat[custId].stat = APPRAISING_OFFER_IN_DISPLAY; // change state
-    sh->fSt.shop.nCustIn++; // one more customer in the shop
+    sh->fSt.shop[shopId[custId]].nCustIn++; // one more customer in the shop
     saveState(nFic,&(sh->fSt));
 
-    if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+    if (crExit() == -1) /* exit critical region */ {
         perror("error on executing the up operation for semaphore access");
         exit(EXIT_FAILURE);
     }
+
+    PROBE_RETURN(enterShop, 1 + custId);
 }
 
 /**
@@ -255,7 +461,9 @@ static void enterShop(unsigned int custId) {
  */
 
 static unsigned int perusingAround(unsigned int custId) {
-    if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+    PROBE_ENTRY(perusingAround, 1 + custId);
+
+    if (crEnter(CR_SHOP(shopId[custId])) == -1) /* enter critical region */ {
         perror("error on executing the down operation for semaphore access");
         exit(EXIT_FAILURE);
     }
@@ -263,19 +471,20 @@ static unsigned int perusingAround(unsigned int custId) {
     /* insert your code here */
     unsigned int nProd = 0; // number of pieces picked up
 
-    if (sh->fSt.shop.nProdIn > 0) // is there anything to buy?
-        nProd = pickUp(); // randomly pick something or not
+    if (sh->fSt.shop[shopId[custId]].nProdIn > 0) // is there anything to buy?
+        nProd = pickUp(custId); // randomly pick something or not
 
     if(nProd != 0){
-        sh->fSt.shop.nProdIn -= nProd; // customer picked nProd pieces
+        sh->fSt.shop[shopId[custId]].nProdIn -= nProd; // customer picked nProd pieces
         saveState (nFic, &(sh->fSt));
     }
 
-    if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+    if (crExit() == -1) /* exit critical region */ {
         perror("error on executing the up operation for semaphore access");
         exit(EXIT_FAILURE);
     }
 
+    PROBE_RETURN(perusingAround, 1 + custId);
     return nProd;
 }
 
@@ -289,7 +498,9 @@ static unsigned int perusingAround(unsigned int custId) {
  */
 
 static void iWantThis(unsigned int custId, unsigned int nGoods) {
-    if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+    PROBE_ENTRY(iWantThis, 1 + custId);
+
+    if (crEnter(CR_SHOP(shopId[custId])) == -1) /* enter critical region */ {
         perror("error on executing the down operation for semaphore access");
         exit(EXIT_FAILURE);
     }
@@ -297,15 +508,17 @@ static void iWantThis(unsigned int custId, unsigned int nGoods) {
     /* insert your code here */
     sh->fSt.st.custStat[custId].stat = BUYING_SOME_GOODS; // change the state
     sh->fSt.st.custStat[custId].boughtPieces += nGoods; // number of goods to buy
-    queueIn(&(sh->fSt.shop.queue), custId); // go to the buying queue
+    // the request is registered
+    schedRequest(&sh->sched[shopId[custId]], &sh->fSt.shop[shopId[custId]], SCHED_C, custId);
+    queueIn(&(sh->fSt.shop[shopId[custId]].queue), custId); // go to the buying queue
 
-    if (semUp (semgid, sh->proceed) == -1){
+    if (semUp (semgid, sh->proceed[shopId[custId]]) == -1){
         perror("error on executing the up operation for semaphore proceed");
         exit(EXIT_FAILURE);
     }
     saveState (nFic, &(sh->fSt));
 
-    if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+    if (crExit() == -1) /* exit critical region */ {
         perror("error on executing the up operation for semaphore access");
         exit(EXIT_FAILURE);
     }
@@ -316,6 +529,7 @@ static void iWantThis(unsigned int custId, unsigned int nGoods) {
         exit(EXIT_FAILURE);
     }
 
+    PROBE_RETURN(iWantThis, 1 + custId);
 }
 
 /**
@@ -327,25 +541,29 @@ static void iWantThis(unsigned int custId, unsigned int nGoods) {
  */
 
 static void exitShop(unsigned int custId) {
-    if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+    PROBE_ENTRY(exitShop, 1 + custId);
+
+    if (crEnter(CR_SHOP(shopId[custId])) == -1) /* enter critical region */ {
         perror("error on executing the down operation for semaphore access");
         exit(EXIT_FAILURE);
     }
 
     /* insert your code here */
     sh->fSt.st.custStat[custId].stat = CARRYING_OUT_DAILY_CHORES; // state change
-    sh->fSt.shop.nCustIn--; // one less customer inside the shop
+    sh->fSt.shop[shopId[custId]].nCustIn--; // one less customer inside the shop
 
-    if (semUp (semgid, sh->proceed) == -1){
+    if (semUp (semgid, sh->proceed[shopId[custId]]) == -1){
         perror("error on executing the up operation for semaphore proceed");
         exit (EXIT_FAILURE);
     }
     saveState (nFic, &(sh->fSt));
 
-    if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+    if (crExit() == -1) /* exit critical region */ {
         perror("error on executing the up operation for semaphore access");
         exit(EXIT_FAILURE);
     }
+
+    PROBE_RETURN(exitShop, 1 + custId);
 }
 
 /**
@@ -364,38 +582,172 @@ static void exitShop(unsigned int custId) {
 static bool endOperCustomer(unsigned int custId) {
     bool stat; /* customer status */
     unsigned int nOpCust, /* number of customers still operative */
+            nProdIn, /* number of products in display in all the shops */
             i; /* counting variable */
 
-    if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+    PROBE_ENTRY(endOperCustomer, 1 + custId);
+
+    if (crEnter(CR_WORKSHOP) == -1) /* enter critical region */ {
         perror("error on executing the down operation for semaphore access");
         exit(EXIT_FAILURE);
     }
 
     stat = (sh->fSt.workShop.nPMatIn == 0) && /* all prime materials at the workshop have been spent and */
             (sh->fSt.workShop.NSPMat == NP); /* all the delivers of prime materials have been carried out */
-    if (stat) {
+
+    if (crExit() == -1) /* exit critical region */ {
+        perror("error on executing the up operation for semaphore access");
+        exit(EXIT_FAILURE);
+    }
+
+    if (stat) { /* it stays so from then on, so only now all the shops are looked at */
+        if (crEnter(CR_ALL) == -1) /* enter critical region */ {
+            perror("error on executing the down operation for semaphore access");
+            exit(EXIT_FAILURE);
+        }
         nOpCust = 0; /* find out how many customers are still operative */
         for (i = 0; i < N; i++)
             if (sh->fSt.st.custStat[i].readyToWork) nOpCust += 1;
-        stat = (((sh->fSt.shop.nProdIn + sh->fSt.workShop.nProdIn) < 2 * nOpCust) && /* the amount of products still */
+        nProdIn = 0;
+        for (i = 0; i < NS; i++)
+            nProdIn += sh->fSt.shop[i].nProdIn;
+        stat = (((nProdIn + sh->fSt.workShop.nProdIn) < 2 * nOpCust) && /* the amount of products still */
                 (nOpCust != 1)) || /* remaining to be sold is less than the number of customers still
                                                                                                    operative times 2 */
-                ((sh->fSt.shop.nProdIn + sh->fSt.workShop.nProdIn + sh->fSt.workShop.NTPMat -
+                ((nProdIn + sh->fSt.workShop.nProdIn + sh->fSt.workShop.NTPMat -
                 PP * sh->fSt.workShop.NTProd) == 0); /* or is equal to zero */
         if (stat)
             sh->fSt.st.custStat[custId].readyToWork = false; /* the customer is signaled non operative from now on */
-    }
-
-    if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
-        perror("error on executing the up operation for semaphore access");
-        exit(EXIT_FAILURE);
+        if (crExit() == -1) /* exit critical region */ {
+            perror("error on executing the up operation for semaphore access");
+            exit(EXIT_FAILURE);
+        }
     }
 
     //pickUp(); /*         <---            remove this instruction for normal operation */
     //stat = true; /*         <---            remove this instruction for normal operation */
+
+    PROBE_RETURN(endOperCustomer, 1 + custId);
     return stat;
 }
 
+#else
+
+/**
+ *  \brief Remote call of an operation.
+ *
+ *  The coordinator carries it out (internal operation).
+ *
+ *  \param custId identification of the customer
+ *  \param op operation
+ *  \param arg argument of the operation
+ *
+ *  \return value returned by the operation
+ */
+
+static uint32_t call(unsigned int custId, unsigned int op, uint32_t arg) {
+    uint32_t val; /* value returned */
+
+    if (remCall(1 + custId, op, arg, &val) == -1) {
+        perror("error on the remote call of a customer operation");
+        exit(EXIT_FAILURE);
+    }
+    return val;
+}
+
+/**
+ *  \brief Go shopping operation (remote call).
+ *
+ *  \param custId identification of the customer
+ */
+
+static void goShopping(unsigned int custId) {
+    call(custId, REM_GO_SHOPPING, 0);
+}
+
+/**
+ *  \brief Is door open operation (remote call).
+ *
+ *  The critical region of the shop is left entered at the coordinator, to be exited by the next operation.
+ *
+ *  \param custId identification of the customer
+ *
+ *  \return -c true, if the shop door is open
+ *  \return -c false, otherwise
+ */
+
+static bool isDoorOpen(unsigned int custId) {
+    return call(custId, REM_IS_DOOR_OPEN, 0) != 0;
+}
+
+/**
+ *  \brief Try again later operation (remote call).
+ *
+ *  \param custId identification of the customer
+ */
+
+static void tryAgainLater(unsigned int custId) {
+    call(custId, REM_TRY_AGAIN_LATER, 0);
+}
+
+/**
+ *  \brief Enter the shop operation (remote call).
+ *
+ *  \param custId identification of the customer
+ */
+
+static void enterShop(unsigned int custId) {
+    call(custId, REM_ENTER_SHOP, 0);
+}
+
+/**
+ *  \brief Perusing around operation (remote call).
+ *
+ *  \param custId identification of the customer
+ *
+ *  \return number of goods to buy
+ */
+
+static unsigned int perusingAround(unsigned int custId) {
+    return call(custId, REM_PERUSING_AROUND, 0);
+}
+
+/**
+ *  \brief I want this operation (remote call).
+ *
+ *  \param custId identification of the customer
+ *  \param nGoods number of selected goods
+ */
+
+static void iWantThis(unsigned int custId, unsigned int nGoods) {
+    call(custId, REM_I_WANT_THIS, nGoods);
+}
+
+/**
+ *  \brief Exit the shop operation (remote call).
+ *
+ *  \param custId identification of the customer
+ */
+
+static void exitShop(unsigned int custId) {
+    call(custId, REM_EXIT_SHOP, 0);
+}
+
+/**
+ *  \brief End of operations for the customer (remote call).
+ *
+ *  \param custId identification of the customer
+ *
+ *  \return -c true, if the life cycle of the customer has come to an end
+ *  \return -c false, otherwise
+ */
+
+static bool endOperCustomer(unsigned int custId) {
+    return call(custId, REM_END_OPER_CUST, 0) != 0;
+}
+
+#endif /* REMOTE */
+
 /**
  *  \brief Living normal life operation.
  *
@@ -403,22 +755,74 @@ static bool endOperCustomer(unsigned int custId) {
  */
 
 static void livingNormalLife(void) {
-    usleep((unsigned int) floor(40.0 * random() / RAND_MAX + 1.5));
+    crDelay((unsigned int) floor(40.0 * random() / RAND_MAX + 1.5));
 }
 
+#ifndef REMOTE
+
 /**
  *  \brief Pick up operation.
  *
  *  Random generated value (internal operation).
  *
+ *  \param custId identification of the customer
+ *
  *  \return 0, 1 or 2
  */
 
-static unsigned int pickUp(void) {
+static unsigned int pickUp(unsigned int custId) {
     unsigned long val; /* auxiliary variable */
 
-    val = (unsigned long) random();
-    if ((val < (unsigned long) floor(0.3 * RAND_MAX)) || (sh->fSt.shop.nProdIn == 0)) return 0;
-    else if ((val < (unsigned long) floor(0.7 * RAND_MAX)) || (sh->fSt.shop.nProdIn == 1)) return 1;
+    val = (unsigned long) crValue((unsigned int) random()); // the outcome recorded, when replaying
+    if ((val < (unsigned long) floor(0.3 * RAND_MAX)) || (sh->fSt.shop[shopId[custId]].nProdIn == 0)) return 0;
+    else if ((val < (unsigned long) floor(0.7 * RAND_MAX)) || (sh->fSt.shop[shopId[custId]].nProdIn == 1)) return 1;
     else return 2;
 }
+
+/**
+ *  \brief Choose a shop operation.
+ *
+ *  The shop to be visited is picked by the routing policy among the open shops or, if none is, among the shops still
+ *  in business (internal operation). No random choice is made when there is a single candidate.
+ *  The shops are looked at without taking their locks: the pick is only a hint, the door being checked again within
+ *  the critical region of the shop picked.
+ *
+ *  \param custId identification of the customer
+ *
+ *  \return identification of the shop
+ */
+
+static unsigned int chooseShop(unsigned int custId) {
+    unsigned int cand[NS]; /* candidate shops */
+    unsigned int nCand = 0, /* number of candidate shops */
+            best, /* shop with the shortest queue */
+            i; /* counting variable */
+
+    for (i = 0; i < NS; i++) // the open shops come first
+        if (sh->fSt.shop[i].stat == SOPEN) cand[nCand++] = i;
+    if (nCand == 0)
+        for (i = 0; i < NS; i++) // then the ones whose entrepreneur is still operative
+            if (sh->inBusiness[i]) cand[nCand++] = i;
+    if (nCand == 0)
+        for (i = 0; i < NS; i++) // and any shop at all, if every one is out of business
+            cand[nCand++] = i;
+    if (nCand == 1) return cand[0];
+
+    switch (sh->routing) {
+        case ROUTE_SHORTEST: // the shortest queue by the counter, the best stocked shop on a tie
+            best = cand[0];
+            for (i = 1; i < nCand; i++)
+                if ((queueLen(&sh->fSt.shop[cand[i]].queue) < queueLen(&sh->fSt.shop[best].queue)) ||
+                        ((queueLen(&sh->fSt.shop[cand[i]].queue) == queueLen(&sh->fSt.shop[best].queue)) &&
+                        (sh->fSt.shop[cand[i]].nProdIn > sh->fSt.shop[best].nProdIn)))
+                    best = cand[i];
+            return best;
+        case ROUTE_STICKY: // the shop visited last time, while it is a candidate
+            for (i = 0; i < nCand; i++)
+                if (visited[custId] && (cand[i] == shopId[custId])) return shopId[custId];
+            break;
+    }
+    return cand[crValue((unsigned int) random()) % nCand]; // the outcome recorded, when replaying
+}
+
+#endif /* REMOTE */
@@ -38,20 +38,27 @@
 #include "queue.h"
 #include "logging.h"
 #include "semaphore.h"
+#include "probes.h"
+#include "trace.h"
+#include "criticalRegion.h"
 #include "sharedMemory.h"
+#include "entities.h"
 
 /** \brief logging file name */
 static char *nFic;
 
-/** \brief shared memory block access identifier */
-static int shmid;
-
 /** \brief semaphore set access identifier */
 static int semgid;
 
 /** \brief pointer to shared memory region */
 static SHARED_DATA *sh;
 
+/** \brief identification of the shop run by the entrepreneur */
+static unsigned int shopId;
+
+/** \brief entrepreneur identification */
+static unsigned int entrepId;
+
 /** \brief prepare to work operation */
 static void prepareToWork(void);
 
@@ -88,6 +95,8 @@ static bool endOperEntrep(void);
 /** \brief service customer [internal] operation */
 static void serviceCustomer(void);
 
+#ifndef ZYGOTE
+
 /**
  *  \brief Main program.
  *
@@ -96,17 +105,26 @@ static void serviceCustomer(void);
 
 int main(int argc, char *argv[]) {
     int key; /*access key to shared memory and semaphore set */
+    int shmid; /* shared memory block access identifier */
     char *tinp; /* numerical parameters test flag */
+    unsigned int s = 0; /* shop identification */
 
-    /* validation of passed parameters */
+    /* validation of passed parameters (the shop identification may be omitted for the first shop) */
 
-    if (argc != 4) {
+    if ((argc != 4) && (argc != 5)) {
         freopen("error_GET", "a", stderr);
         fprintf(stderr, "Number of parameters is incorrect!\n");
         exit(EXIT_FAILURE);
-    } else freopen(argv[3], "w", stderr);
-    nFic = argv[1];
-    key = (unsigned int) strtol(argv[2], &tinp, 0);
+    } else freopen(argv[argc-1], "w", stderr);
+    if (argc == 5) {
+        s = (unsigned int) strtol(argv[1], &tinp, 0);
+        if ((*tinp != '\0') || (s >= NS)) {
+            fprintf(stderr, "Error on the shop identification!\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    nFic = argv[argc-3];
+    key = (unsigned int) strtol(argv[argc-2], &tinp, 0);
     if (*tinp != '\0') {
         fprintf(stderr, "Error on the access key communication!\n");
         exit(EXIT_FAILURE);
@@ -127,6 +145,57 @@ int main(int argc, char *argv[]) {
         perror("error on mapping the shared region on the process address space");
         exit(EXIT_FAILURE);
     }
+    entrepreneurRun(s, nFic, semgid, sh); /* simulation of the life cycle of the entrepreneur */
+
+    /* unmapping the shared region off the process address space */
+
+    if (shmemDettach(sh) == -1) {
+        perror("error on unmapping the shared region off the process address space");
+        exit(EXIT_FAILURE);
+    }
+
+    exit(EXIT_SUCCESS);
+}
+
+#endif /* ZYGOTE */
+
+/**
+ *  \brief Life cycle of the entrepreneur.
+ *
+ *  The process must be already connected to the semaphore set and have the shared region mapped on its address
+ *  space. The function is called either by the main program or, in zygote mode, by a child of the launcher.
+ *
+ *  \param s shop identification
+ *  \param fic logging file name
+ *  \param sgid semaphore set access identifier
+ *  \param shr pointer to shared memory region
+ */
+
+void entrepreneurRun(unsigned int s, char *fic, int sgid, SHARED_DATA *shr) {
+    shopId = s;
+    entrepId = ENTREP(s);
+    nFic = fic;
+    semgid = sgid;
+    sh = shr;
+
+    logBind(&(sh->log)); /* binding to the shared logging information */
+    traceBind(&(sh->trace)); /* binding to the shared tracing information */
+    semProbeBind(entrepId); /* identification reported by the probes */
+    if (crBind(&(sh->cr), semgid, sh->lockSem, sh->turn, entrepId) == -1) { /* binding to the critical region access */
+        perror("error on binding to the critical region information");
+        exit(EXIT_FAILURE);
+    }
+
+    /* waiting at the start barrier until every intervening entity is attached */
+
+    if (semUp(semgid, sh->attached) == -1) {
+        perror("error on executing the up operation for semaphore attached");
+        exit(EXIT_FAILURE);
+    }
+    if (semDown(semgid, sh->start) == -1) {
+        perror("error on executing the down operation for semaphore start");
+        exit(EXIT_FAILURE);
+    }
 
     /* simulation of the life cicle of the entrepreneur */
 
@@ -163,39 +232,43 @@ int main(int argc, char *argv[]) {
                                                                                        delivers them to the workshop */
         returnToShop(); /* the entrepreneur goes back to the shop */
     }
-
-    /* unmapping the shared region off the process address space */
-
-    if (shmemDettach(sh) == -1) {
-        perror("error on unmapping the shared region off the process address space");
-        exit(EXIT_FAILURE);
-    }
-
-    exit(EXIT_SUCCESS);
 }
 
 /**
  *  \brief Prepare to work operation.
  *
  *  The entrepreneur opens the shop and gets ready to perform her duties.
+ *  In door gate mode, the customers who found the door closed are all waken up.
  */
 
 static void prepareToWork(void) {
-    if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+    PROBE_ENTRY(prepareToWork, entrepId);
+
+    if (crEnter(CR_SHOP(shopId)) == -1) /* enter critical region */ {
         perror("error on executing the down operation for semaphore access");
         exit(EXIT_FAILURE);
     }
 
     /* insert your code here */
 
-    sh->fSt.st.entrepStat = WAITING_FOR_NEXT_TASK; // change entrepreneur state
-    sh->fSt.shop.stat = SOPEN; // open the shop
+    sh->fSt.st.entrepStat[shopId] = WAITING_FOR_NEXT_TASK; // change entrepreneur state
+    sh->fSt.shop[shopId].stat = SOPEN; // open the shop
     saveState(nFic, &(sh->fSt));
 
-    if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+    if (sh->nCustomersBlk[shopId] > 0) { // door gate mode: wake up every customer who found the door closed at once
+        if (semUpN(semgid, sh->doorGate[shopId], sh->nCustomersBlk[shopId]) == -1) {
+            perror("error on executing the up operation for semaphore doorGate");
+            exit(EXIT_FAILURE);
+        }
+        sh->nCustomersBlk[shopId] = 0;
+    }
+
+    if (crExit() == -1) /* exit critical region */ {
         perror("error on executing the up operation for semaphore access");
         exit(EXIT_FAILURE);
     }
+
+    PROBE_RETURN(prepareToWork, entrepId);
 }
 
 /**
@@ -214,7 +287,9 @@ static void prepareToWork(void) {
  */
 
 static char appraiseSit(void) {
-    if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+    PROBE_ENTRY(appraiseSit, entrepId);
+
+    if (crEnter(CR_SHOP(shopId)) == -1) /* enter critical region */ {
         perror("error on executing the down operation for semaphore access");
         exit(EXIT_FAILURE);
     }
@@ -223,54 +298,51 @@ static char appraiseSit(void) {
     char nextTask; // control what the next state is going to be
 
     while(true){
-        if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+        if (crExit() == -1) /* exit critical region */ {
             perror("error on executing the up operation for semaphore access");
             exit(EXIT_FAILURE);
         }
 
-        if (semDown(semgid, sh->proceed) == -1) {
+        if (semDown(semgid, sh->proceed[shopId]) == -1) {
             perror("error on executing the down operation for semaphore proceed");
             exit(EXIT_FAILURE);
         }
 
-        if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+        if (crEnter(CR_SHOP(shopId)) == -1) /* enter critical region */ {
             perror("error on executing the down operation for semaphore access");
             exit(EXIT_FAILURE);
         }
 
-        if (!queueEmpty(&sh->fSt.shop.queue)) {
-            nextTask = 'C'; // attend the customer
+        // the scheduling policy picks among pending customers ('C'), prime materials ('P') and batch collection ('G');
+        // it only peeks at the workshop without its lock, the stock there being a hint on which request to serve first
+        nextTask = schedNext(&sh->sched[shopId], &sh->fSt.shop[shopId], &sh->fSt.workShop, sh->nCraftsmenBlk);
+        if (nextTask != '\0')
             break;
-        }
-
-        if (sh->fSt.shop.primeMatReq) {
-            nextTask = 'P'; // prime materials needed
-            break;
-        }
-
-        if (sh->fSt.shop.prodTransfer) {
-            nextTask = 'G'; // go to workshop collect pieces
-            break;
-        }
 
-        if ((sh->fSt.shop.nCustIn == 0) && /* the shop has no customers in and */
-                (sh->fSt.shop.nProdIn == 0) && /* all products in display have been sold and */
-                !sh->fSt.shop.primeMatReq && /* no craftsman has phoned to request prime materials or */
-                !sh->fSt.shop.prodTransfer && /* to ask for a batch of products to be collected and */
-                (sh->fSt.workShop.nProdIn == 0) && /* there are no finished products in the storeroom at the workshop and */
-                (sh->fSt.workShop.nPMatIn == 0) && /* all prime materials at the workshop have been spent and */
-                (sh->fSt.workShop.NSPMat == NP) && /* all the delivers of prime materials have been carried out and */
-                (sh->fSt.workShop.NTPMat == PP * sh->fSt.workShop.NTProd)) {
-            nextTask = 'E'; // nothing more to do
-            break;
+        if ((sh->fSt.shop[shopId].nCustIn == 0) && /* the shop has no customers in and */
+                (sh->fSt.shop[shopId].nProdIn == 0) && /* all products in display have been sold and */
+                !sh->fSt.shop[shopId].primeMatReq && /* no craftsman has phoned to request prime materials or */
+                !sh->fSt.shop[shopId].prodTransfer) { /* to ask for a batch of products to be collected */
+            if (crEnter(CR_WORKSHOP) == -1) /* the workshop is looked at only when the shop is done */ {
+                perror("error on executing the down operation for semaphore access");
+                exit(EXIT_FAILURE);
+            }
+            if ((sh->fSt.workShop.nProdIn == 0) && /* no finished products are left in the storeroom and */
+                    (sh->fSt.workShop.nPMatIn == 0) && /* all prime materials at the workshop have been spent and */
+                    (sh->fSt.workShop.NSPMat == NP) && /* all the delivers of prime materials are done and */
+                    (sh->fSt.workShop.NTPMat == PP * sh->fSt.workShop.NTProd)) {
+                nextTask = 'E'; // nothing more to do
+                break;
+            }
         }
     }
 
-    if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+    if (crExit() == -1) /* exit critical region */ {
         perror("error on executing the up operation for semaphore access");
         exit(EXIT_FAILURE);
     }
 
+    PROBE_RETURN(appraiseSit, entrepId);
     return nextTask;
 }
 
@@ -283,7 +355,9 @@ static char appraiseSit(void) {
  */
 
 static unsigned int addressACustomer(void) {
-    if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+    PROBE_ENTRY(addressACustomer, entrepId);
+
+    if (crEnter(CR_SHOP(shopId)) == -1) /* enter critical region */ {
         perror("error on executing the down operation for semaphore access");
         exit(EXIT_FAILURE);
     }
@@ -296,27 +370,31 @@ static unsigned int addressACustomer(void) {
 
     unsigned int customerIdx; // customer id
 
-    sh->fSt.st.entrepStat = ATTENDING_A_CUSTOMER; // change state
+    sh->fSt.st.entrepStat[shopId] = ATTENDING_A_CUSTOMER; // change state
 
-    if (queueEmpty(&(sh->fSt.shop.queue))) {
+    if (queueEmpty(&(sh->fSt.shop[shopId].queue))) {
         perror("addressACustomer() - there is no customers in the queue");
         exit(EXIT_FAILURE);
     }
 
-    queueOut(&(sh->fSt.shop.queue), &customerIdx); // retrieve a value from the queue to customerIdx
+    queueOut(&(sh->fSt.shop[shopId].queue), &customerIdx); // retrieve a value from the queue to customerIdx
 
     if (customerIdx >= N) { // quick check customerIdx consistency
         perror("addressACustomer() - customer ID is inconsistent");
         exit(EXIT_FAILURE);
     }
 
+    sh->addrStamp[customerIdx] = histClock(); // queueing latency: from joining the queue until being addressed
+    histAdd(&sh->queueLat[customerIdx], sh->addrStamp[customerIdx] - sh->sched[shopId].custStamp[customerIdx]);
+
     saveState(nFic, &(sh->fSt));
 
-    if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+    if (crExit() == -1) /* exit critical region */ {
         perror("error on executing the up operation for semaphore access");
         exit(EXIT_FAILURE);
     }
 
+    PROBE_RETURN(addressACustomer, entrepId);
     return customerIdx; // return the if of the attended customer
 }
 
@@ -329,7 +407,9 @@ static unsigned int addressACustomer(void) {
  */
 
 static void sayGoodByeToCustomer(unsigned int custId) {
-    if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+    PROBE_ENTRY(sayGoodByeToCustomer, entrepId);
+
+    if (crEnter(CR_SHOP(shopId)) == -1) /* enter critical region */ {
         perror("error on executing the down operation for semaphore access");
         exit(EXIT_FAILURE);
     }
@@ -339,7 +419,12 @@ static void sayGoodByeToCustomer(unsigned int custId) {
     // mudar o estado
     // save state no fim
 
-    sh->fSt.st.entrepStat = WAITING_FOR_NEXT_TASK; // change state
+    uint64_t lat; // service latency (in ns)
+
+    sh->fSt.st.entrepStat[shopId] = WAITING_FOR_NEXT_TASK; // change state
+
+    lat = histClock() - sh->addrStamp[custId]; // service latency: from being addressed until being released
+    histAdd(&sh->serviceLat[custId], lat);
 
     if (semUp(semgid, sh->waitForService[custId]) == -1) {
         perror("error on executing the down operation for semaphore access");
@@ -348,10 +433,12 @@ static void sayGoodByeToCustomer(unsigned int custId) {
 
     saveState(nFic, &sh->fSt);
 
-    if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+    if (crExit() == -1) /* exit critical region */ {
         perror("error on executing the up operation for semaphore access");
         exit(EXIT_FAILURE);
     }
+
+    PROBE_RETURN(sayGoodByeToCustomer, entrepId);
 }
 
 /**
@@ -364,7 +451,9 @@ static void sayGoodByeToCustomer(unsigned int custId) {
  */
 
 static bool customersInTheShop(void) {
-    if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+    PROBE_ENTRY(customersInTheShop, entrepId);
+
+    if (crEnter(CR_SHOP(shopId)) == -1) /* enter critical region */ {
         perror("error on executing the down operation for semaphore access");
         exit(EXIT_FAILURE);
     }
@@ -372,13 +461,14 @@ static bool customersInTheShop(void) {
     /* insert your code here */
     bool customersInside; // control variable if there are customers in the shop
 
-    customersInside = sh->fSt.shop.nCustIn != 0; // check clients in the shop status
+    customersInside = sh->fSt.shop[shopId].nCustIn != 0; // check clients in the shop status
 
-    if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+    if (crExit() == -1) /* exit critical region */ {
         perror("error on executing the up operation for semaphore access");
         exit(EXIT_FAILURE);
     }
 
+    PROBE_RETURN(customersInTheShop, entrepId);
     return customersInside;
 }
 
@@ -389,19 +479,23 @@ static bool customersInTheShop(void) {
  */
 
 static void closeTheDoor(void) {
-    if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+    PROBE_ENTRY(closeTheDoor, entrepId);
+
+    if (crEnter(CR_SHOP(shopId)) == -1) /* enter critical region */ {
         perror("error on executing the down operation for semaphore access");
         exit(EXIT_FAILURE);
     }
 
     /* insert your code here */
-    sh->fSt.shop.stat = SDCLOSED; // state change
+    sh->fSt.shop[shopId].stat = SDCLOSED; // state change
     saveState(nFic, &(sh->fSt));
 
-    if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+    if (crExit() == -1) /* exit critical region */ {
         perror("error on executing the up operation for semaphore access");
         exit(EXIT_FAILURE);
     }
+
+    PROBE_RETURN(closeTheDoor, entrepId);
 }
 
 /**
@@ -411,7 +505,9 @@ static void closeTheDoor(void) {
  */
 
 static void prepareToLeave(void) {
-    if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+    PROBE_ENTRY(prepareToLeave, entrepId);
+
+    if (crEnter(CR_SHOP(shopId)) == -1) /* enter critical region */ {
         perror("error on executing the down operation for semaphore access");
         exit(EXIT_FAILURE);
     }
@@ -419,14 +515,16 @@ static void prepareToLeave(void) {
     /* insert your code here */
     // SO MUDANCA DE ESTADO
 
-    sh->fSt.shop.stat = SCLOSED;
-    sh->fSt.st.entrepStat = CLOSING_THE_SHOP;
+    sh->fSt.shop[shopId].stat = SCLOSED;
+    sh->fSt.st.entrepStat[shopId] = CLOSING_THE_SHOP;
     saveState(nFic, &(sh->fSt));
 
-    if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+    if (crExit() == -1) /* exit critical region */ {
         perror("error on executing the up operation for semaphore access");
         exit(EXIT_FAILURE);
     }
+
+    PROBE_RETURN(prepareToLeave, entrepId);
 }
 
 /**
@@ -436,7 +534,9 @@ static void prepareToLeave(void) {
  */
 
 static void goToWorkShop(void) {
-    if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+    PROBE_ENTRY(goToWorkShop, entrepId);
+
+    if (crEnter(CR_SHOP(shopId) | CR_WORKSHOP) == -1) /* enter critical region */ {
         perror("error on executing the down operation for semaphore access");
         exit(EXIT_FAILURE);
     }
@@ -445,59 +545,62 @@ static void goToWorkShop(void) {
     // mudar o estado
     // acordar o numero de artesaos que está em nCraftmemeBlk
 
-    sh->fSt.st.entrepStat = COLLECTING_A_BATCH_OF_PRODUCTS; //change state
-    sh->fSt.shop.nProdIn += sh->fSt.workShop.nProdIn; // added to products in shop the products in the workshop
+    sh->fSt.st.entrepStat[shopId] = COLLECTING_A_BATCH_OF_PRODUCTS; //change state
+    sh->fSt.shop[shopId].nProdIn += sh->fSt.workShop.nProdIn; // added to products in shop the products in the workshop
     sh->fSt.workShop.nProdIn = 0; // all products are now in the shop
-    sh->fSt.shop.prodTransfer = false; // reset flag
+    sh->fSt.shop[shopId].prodTransfer = false; // reset flag
     saveState(nFic, &(sh->fSt));
 
-    if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+    if (crExit() == -1) /* exit critical region */ {
         perror("error on executing the up operation for semaphore access");
         exit(EXIT_FAILURE);
     }
+
+    PROBE_RETURN(goToWorkShop, entrepId);
 }
 
 /**
  *  \brief Visit suppliers operation.
  *
  *  The entrepreneur goes shopping for prime materials and delivers them to the workshop.
+ *  Only as many craftsmen blocked waiting for prime materials as the portions in store can satisfy are waken up.
  */
 
 static void visitSuppliers(void) {
-    if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+    PROBE_ENTRY(visitSuppliers, entrepId);
+
+    if (crEnter(CR_SHOP(shopId) | CR_WORKSHOP) == -1) /* enter critical region */ {
         perror("error on executing the down operation for semaphore access");
         exit(EXIT_FAILURE);
     }
 
     /* insert your code here */
-    unsigned int craftmenCounter;
+    unsigned int nWake; // number of blocked craftsmen to be waken up
 
-    sh->fSt.st.entrepStat = DELIVERING_PRIME_MATERIALS; // change state
-    sh->fSt.shop.primeMatReq = false; // reset flag
+    sh->fSt.st.entrepStat[shopId] = DELIVERING_PRIME_MATERIALS; // change state
+    sh->fSt.shop[shopId].primeMatReq = false; // reset flag
 
     if (sh->fSt.workShop.NSPMat < NP) { // if we havent supplied the max times materials are supplied
         sh->fSt.workShop.nPMatIn += sh->fSt.primeMaterials[sh->fSt.workShop.NSPMat]; // add colected materials to the workshop
         sh->fSt.workShop.NTPMat += sh->fSt.primeMaterials[sh->fSt.workShop.NSPMat++]; // add to total amount of supplied materials and then increase index to next time
     }
 
-    craftmenCounter = 0;
-
-    while (sh->nCraftsmenBlk > craftmenCounter) { // while there are blocked craftsman continue to unlock
-        // fazer nCraftsmenBlk n vezes up a um semaforo
-        if (semUp(semgid, sh->waitForMaterials) == -1) {
-            perror("visitSuppliers() error during semUP waiting for materials");
-            exit(EXIT_FAILURE);
-        }
-        craftmenCounter++;
+    nWake = sh->fSt.workShop.nPMatIn / PP; // only as many blocked craftsmen as the portions in store can satisfy
+    if (nWake > sh->nCraftsmenBlk)
+        nWake = sh->nCraftsmenBlk;
+    if ((nWake > 0) && (semUpN(semgid, sh->waitForMaterials, nWake) == -1)) { // wake them all in a single operation
+        perror("visitSuppliers() error during semUpN waiting for materials");
+        exit(EXIT_FAILURE);
     }
-
-    sh->nCraftsmenBlk = 0; // there isn't any more Blk craftsman
+    sh->nCraftsmenBlk -= nWake; // the others stay blocked until the next deliver
     saveState(nFic, &(sh->fSt));
 
-    if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+    if (crExit() == -1) /* exit critical region */ {
         perror("error on executing the up operation for semaphore access");
         exit(EXIT_FAILURE);
     }
+
+    PROBE_RETURN(visitSuppliers, entrepId);
 }
 
 /**
@@ -507,19 +610,23 @@ static void visitSuppliers(void) {
  */
 
 static void returnToShop(void) {
-    if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+    PROBE_ENTRY(returnToShop, entrepId);
+
+    if (crEnter(CR_SHOP(shopId)) == -1) /* enter critical region */ {
         perror("error on executing the down operation for semaphore access");
         exit(EXIT_FAILURE);
     }
 
     /* insert your code here */
-    sh->fSt.st.entrepStat = OPENING_THE_SHOP; // change state
+    sh->fSt.st.entrepStat[shopId] = OPENING_THE_SHOP; // change state
     saveState(nFic, &(sh->fSt));
 
-    if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+    if (crExit() == -1) /* exit critical region */ {
         perror("error on executing the up operation for semaphore access");
         exit(EXIT_FAILURE);
     }
+
+    PROBE_RETURN(returnToShop, entrepId);
 }
 
 /**
@@ -529,6 +636,8 @@ static void returnToShop(void) {
  *
  *  The entrepreneur stops if all prime materials have been converted into products and if all products have been
  *  sold and there are no requests of service pending and the shop is empty.
+ *  The shop then goes out of business: the customers waiting for its door to open are waken up and so are the
+ *  entrepreneurs of the other shops, which may be waiting for the workshop to close down.
  *
  *  \return -c true, if the life cycle of the entrepreneur has come to an end
  *  \return -c false, otherwise
@@ -536,28 +645,49 @@ static void returnToShop(void) {
 
 static bool endOperEntrep(void) {
     bool stat; /* entrepreneur status */
+    unsigned int t; /* counting variable */
 
-    if (semDown(semgid, sh->access) == -1) /* enter critical region */ {
+    PROBE_ENTRY(endOperEntrep, entrepId);
+
+    if (crEnter(CR_SHOP(shopId) | CR_WORKSHOP) == -1) /* enter critical region */ {
         perror("error on executing the down operation for semaphore access");
         exit(EXIT_FAILURE);
     }
 
-    stat = (sh->fSt.shop.nCustIn == 0) && /* the shop has no customers in and */
-            (sh->fSt.shop.nProdIn == 0) && /* all products in display have been sold and */
-            !sh->fSt.shop.primeMatReq && /* no craftsman has phoned to request prime materials or */
-            !sh->fSt.shop.prodTransfer && /* to ask for a batch of products to be collected and */
+    stat = (sh->fSt.shop[shopId].nCustIn == 0) && /* the shop has no customers in and */
+            (sh->fSt.shop[shopId].nProdIn == 0) && /* all products in display have been sold and */
+            !sh->fSt.shop[shopId].primeMatReq && /* no craftsman has phoned to request prime materials or */
+            !sh->fSt.shop[shopId].prodTransfer && /* to ask for a batch of products to be collected and */
             (sh->fSt.workShop.nProdIn == 0) && /* there are no finished products in the storeroom at the workshop and */
             (sh->fSt.workShop.nPMatIn == 0) && /* all prime materials at the workshop have been spent and */
             (sh->fSt.workShop.NSPMat == NP) && /* all the delivers of prime materials have been carried out and */
             (sh->fSt.workShop.NTPMat == PP * sh->fSt.workShop.NTProd); /* all prime matrials have been turned
                                                                                                        into products */
 
-    if (semUp(semgid, sh->access) == -1) /* exit critical region */ {
+    if (stat) { // the shop goes out of business
+        sh->inBusiness[shopId] = false;
+        if (sh->nCustomersBlk[shopId] > 0) { // door gate mode: its waiting customers must look elsewhere
+            if (semUpN(semgid, sh->doorGate[shopId], sh->nCustomersBlk[shopId]) == -1) {
+                perror("error on executing the up operation for semaphore doorGate");
+                exit(EXIT_FAILURE);
+            }
+            sh->nCustomersBlk[shopId] = 0;
+        }
+        for (t = 0; t < NS; t++) // the entrepreneurs of the other shops may be waiting for the workshop to close down
+            if ((t != shopId) && sh->inBusiness[t] && (semUp(semgid, sh->proceed[t]) == -1)) {
+                perror("error on executing the up operation for semaphore proceed");
+                exit(EXIT_FAILURE);
+            }
+    }
+
+    if (crExit() == -1) /* exit critical region */ {
         perror("error on executing the up operation for semaphore access");
         exit(EXIT_FAILURE);
     }
 
     //stat = true; /*         <---            remove this instruction for normal operation */
+
+    PROBE_RETURN(endOperEntrep, entrepId);
     return stat;
 }
 
@@ -568,5 +698,5 @@ static bool endOperEntrep(void) {
  */
 
 static void serviceCustomer(void) {
-    usleep((unsigned int) floor(20.0 * random() / RAND_MAX + 1.5));
+    crDelay((unsigned int) floor(20.0 * random() / RAND_MAX + 1.5));
 }
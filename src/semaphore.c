@@ -9,19 +9,31 @@
  *     \li destruction of a previously created set of semaphores
  *     \li signalling start of operations
  *     \li <em>down</em> of a semaphore within the set
- *     \li <em>up</em> of a semaphore within the set.
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li <em>down</em> of a semaphore within the set by several units at once
+ *     \li <em>up</em> of a semaphore within the set by several units at once
+ *     \li reading of the values of all the semaphores in the set
+ *     \li binding of the entity identification reported by the probes.
  *
  *  \author António Rui Borges - October 1995
  */
 
 #include <stdio.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/sem.h>
 
+#include "probes.h"
+#include "trace.h"
+
 /** \brief access permission: user r-w */
 #define  MASK           0600
 
+/** \brief identification of the entity reported by the probes of the calling thread (the launcher, until it is
+ *         bound) */
+static __thread unsigned int probeId = (unsigned int) -1;
+
 /**
  *  \brief Creation of a set of semaphores.
  *
@@ -112,9 +124,16 @@ int semSignal (int semgid)
 int semDown (int semgid, unsigned int sindex)
 {
   struct sembuf down = { 0, -1, 0 };                                                      /* specific down operation */
+  int stat;                                                                                      /* operation status */
+  uint64_t t0 = 0;                                                                              /* start of the wait */
 
   down.sem_num = (unsigned short) sindex;
-  return semop (semgid, &down, 1);
+  PROBE3 (sem_down, probeId, sindex, 1);
+  if (traceOn ()) t0 = traceClock ();
+  stat = semop (semgid, &down, 1);
+  if (traceOn ()) traceWait (probeId, sindex, t0);
+  PROBE3 (sem_downed, probeId, sindex, 1);
+  return stat;
 }
 
 /**
@@ -132,7 +151,104 @@ int semDown (int semgid, unsigned int sindex)
 int semUp (int semgid, unsigned int sindex)
 {
   struct sembuf up = { 0, 1, 0 };                                                           /* specific up operation */
+  int stat;                                                                                      /* operation status */
 
   up.sem_num = (unsigned short) sindex;
-  return semop (semgid, &up, 1);
+  PROBE3 (sem_up, probeId, sindex, 1);
+  stat = semop (semgid, &up, 1);
+  PROBE3 (sem_upped, probeId, sindex, 1);
+  return stat;
+}
+
+/**
+ *  \brief <em>Down</em> of a semaphore within the set by several units at once.
+ *
+ *  The process is blocked until the semaphore value is at least <tt>n</tt>, which is then decremented atomically.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDownN (int semgid, unsigned int sindex, unsigned int n)
+{
+  struct sembuf down = { 0, 0, 0 };                                                       /* specific down operation */
+  int stat;                                                                                      /* operation status */
+  uint64_t t0 = 0;                                                                              /* start of the wait */
+
+  down.sem_num = (unsigned short) sindex;
+  down.sem_op = -(short) n;
+  PROBE3 (sem_down, probeId, sindex, n);
+  if (traceOn ()) t0 = traceClock ();
+  stat = semop (semgid, &down, 1);
+  if (traceOn ()) traceWait (probeId, sindex, t0);
+  PROBE3 (sem_downed, probeId, sindex, n);
+  return stat;
+}
+
+/**
+ *  \brief <em>Up</em> of a semaphore within the set by several units at once.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semUpN (int semgid, unsigned int sindex, unsigned int n)
+{
+  struct sembuf up = { 0, 0, 0 };                                                           /* specific up operation */
+  int stat;                                                                                      /* operation status */
+
+  up.sem_num = (unsigned short) sindex;
+  up.sem_op = (short) n;
+  PROBE3 (sem_up, probeId, sindex, n);
+  stat = semop (semgid, &up, 1);
+  PROBE3 (sem_upped, probeId, sindex, n);
+  return stat;
+}
+
+/**
+ *  \brief Reading of the values of all the semaphores in the set.
+ *
+ *  The values are read at once, so they are consistent with one another.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param val pointer to the region where the values are to be stored (snum+1 elements, index 0 included)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semGetAll (int semgid, unsigned short *val)
+{
+  union semun { int val;
+                struct semid_ds *buf;
+                unsigned short *array;
+              } arg;                                                                    /* argument of the operation */
+
+  arg.array = val;
+  return semctl (semgid, 0, GETALL, arg);
+}
+
+/**
+ *  \brief Binding of the entity identification reported by the probes.
+ *
+ *  The identification applies to the calling thread.
+ *
+ *  \param id entity identification (0 for the entrepreneur, 1 .. N for the customers, N+1 .. N+M for the craftsmen)
+ */
+
+void semProbeBind (unsigned int id)
+{
+  probeId = id;
 }
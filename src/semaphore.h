@@ -9,7 +9,11 @@
  *     \li destruction of a previously created set of semaphores
  *     \li signalling start of operations
  *     \li <em>down</em> of a semaphore within the set
- *     \li <em>up</em> of a semaphore within the set.
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li <em>down</em> of a semaphore within the set by several units at once
+ *     \li <em>up</em> of a semaphore within the set by several units at once
+ *     \li reading of the values of all the semaphores in the set
+ *     \li binding of the entity identification reported by the probes.
  *
  *  \author António Rui Borges - October 1995
  */
@@ -99,4 +103,58 @@ extern int semDown (int semgid, unsigned int sindex);
 
 extern int semUp (int semgid, unsigned int sindex);
 
+/**
+ *  \brief <em>Down</em> of a semaphore within the set by several units at once.
+ *
+ *  The process is blocked until the semaphore value is at least <tt>n</tt>, which is then decremented atomically.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semDownN (int semgid, unsigned int sindex, unsigned int n);
+
+/**
+ *  \brief <em>Up</em> of a semaphore within the set by several units at once.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semUpN (int semgid, unsigned int sindex, unsigned int n);
+
+/**
+ *  \brief Reading of the values of all the semaphores in the set.
+ *
+ *  The values are read at once, so they are consistent with one another.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param val pointer to the region where the values are to be stored (snum+1 elements, index 0 included)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semGetAll (int semgid, unsigned short *val);
+
+/**
+ *  \brief Binding of the entity identification reported by the probes.
+ *
+ *  \param id entity identification (0 for the entrepreneur, 1 .. N for the customers, N+1 .. N+M for the craftsmen)
+ */
+
+extern void semProbeBind (unsigned int id);
+
 #endif /* SEMAPHORE_H_ */
@@ -21,6 +21,11 @@
 
 #include "probConst.h"
 #include "probDataStruct.h"
+#include "logging.h"
+#include "schedPolicy.h"
+#include "histogram.h"
+#include "trace.h"
+#include "criticalRegion.h"
 
 /**
  *  \brief Definition of <em>shared information</em> data type.
@@ -30,18 +35,63 @@ typedef struct
           FULL_STAT fSt;
           /** \brief identification of critical region protection semaphore – val = 1 */
           unsigned int access;
-          /** \brief identification of entrepreneur appraise situation semaphore – val = 0 */
-          unsigned int proceed;
+          /** \brief identification of entrepreneur appraise situation semaphore array – val = 0 (one per shop) */
+          unsigned int proceed[NS];
           /** \brief identification of customers waiting for service semaphore array – val = 0 (one per customer) */
           unsigned int waitForService[N];
           /** \brief identification of craftsmen waiting for prime materials semaphore – val = 0 */
           unsigned int waitForMaterials;
           /** \brief number of craftsmen who are blocked waiting for the availability of prime materials */
           unsigned int nCraftsmenBlk;
+          /** \brief logging information shared by all the intervening entities */
+          LOGINFO log;
+          /** \brief identification of entities attached to the shared region semaphore – val = 0 */
+          unsigned int attached;
+          /** \brief identification of start of operations semaphore – val = 0 */
+          unsigned int start;
+          /** \brief number of pieces a craftsman produces per visit to the store (1 - one piece at a time) */
+          unsigned int batchSize;
+          /** \brief door gate mode: customers who find the door closed block until the shop is opened again */
+          bool doorGateOn;
+          /** \brief identification of customers waiting for the door to open semaphore array – val = 0 (one per
+           *         shop) */
+          unsigned int doorGate[NS];
+          /** \brief number of customers who are blocked waiting for the door of each shop to open */
+          unsigned int nCustomersBlk[NS];
+          /** \brief scheduling information used by the entrepreneur of each shop to choose her next task */
+          SCHEDINFO sched[NS];
+          /** \brief routing policy of the customers among the shops: either ROUTE_RANDOM, ROUTE_SHORTEST or
+           *         ROUTE_STICKY */
+          unsigned int routing;
+          /** \brief the entrepreneur of each shop is still operative */
+          bool inBusiness[NS];
+          /** \brief instant each customer was addressed by the entrepreneur at the counter (in ns) */
+          uint64_t addrStamp[N];
+          /** \brief queueing latency histograms: one per customer, followed by the global one (merged at the end) */
+          HISTOGRAM queueLat[N+1];
+          /** \brief service latency histograms: one per customer, followed by the global one (merged at the end) */
+          HISTOGRAM serviceLat[N+1];
+          /** \brief tracing information */
+          TRACEINFO trace;
+          /** \brief critical region information: mode of operation and record and replay of the interleaving */
+          CRINFO cr;
+          /** \brief identification of turn to enter the critical region semaphore array – val = 0 (one per entity,
+           *         only used in replay mode) */
+          unsigned int turn[N+M+NS];
+          /** \brief identification of the critical region lock semaphores – val = 1 (one per lock: the shops, the
+           *         workshop and the log; the first one is access) */
+          unsigned int lockSem[CR_NLOCK];
         } SHARED_DATA;
 
+/** \brief routing policy: each visit goes to a shop chosen at random among the open ones */
+#define  ROUTE_RANDOM      0
+/** \brief routing policy: each visit goes to the open shop with the shortest queue by the counter */
+#define  ROUTE_SHORTEST    1
+/** \brief routing policy: a customer keeps going to the same shop while it is open */
+#define  ROUTE_STICKY      2
+
 /** \brief number of semaphores in the set */
-#define SEM_NU                 (N+3)
+#define SEM_NU                     (B_LOCK+CR_NLOCK-2)
 
 /** \brief index of critical region protection semaphore */
 #define ACCESS                     1
@@ -55,4 +105,26 @@ typedef struct
 /** \brief base index of customers waiting for service semaphore array (one per customer) */
 #define B_WAITFORSERVICE           4
 
+/** \brief index of entities attached to the shared region semaphore */
+#define ATTACHED                   (B_WAITFORSERVICE+N)
+
+/** \brief index of start of operations semaphore */
+#define START                      (B_WAITFORSERVICE+N+1)
+
+/** \brief index of customers waiting for the door to open semaphore */
+#define DOORGATE                   (B_WAITFORSERVICE+N+2)
+
+/** \brief base index of the entities turn to enter the critical region semaphore array (one per entity) */
+#define B_TURN                     (B_WAITFORSERVICE+N+3)
+
+/** \brief base index of entrepreneur appraise situation semaphore array of the shops other than the first one */
+#define B_PROCEED                  (B_TURN+N+M+NS)
+
+/** \brief base index of customers waiting for the door to open semaphore array of the shops other than the first
+ *         one */
+#define B_DOORGATE                 (B_PROCEED+NS-1)
+
+/** \brief base index of the critical region lock semaphore array of the locks other than the first one */
+#define B_LOCK                     (B_DOORGATE+NS-1)
+
 #endif /* SHAREDDATASYNC_H_ */
@@ -5,21 +5,157 @@
  *
  *   Operations defined on shared memory:
  *      \li creation of a new block
+ *      \li creation of a new block backed by huge pages, whenever they are available
  *      \li connection to a previously created block
  *      \li destruction of a previously created block
  *      \li mapping of the block previously created on the process address space
  *      \li unmapping of the block off the process address space.
  *
+ *  Two implementations are provided, chosen at compile time:
+ *      \li SysV shared memory (default) - blocks are created with <tt>shmget</tt> and mapped with <tt>shmat</tt>
+ *      \li POSIX shared memory (<tt>SHMEM_POSIX</tt> defined) - each block is a named object,
+ *          <tt>/dev/shm/handicraft.\<key\></tt>, created with <tt>shm_open</tt> and sized with <tt>ftruncate</tt>,
+ *          so it is not limited by <tt>SHMMAX</tt> / <tt>SHMALL</tt>, and mapped with <tt>mmap</tt>, the pages being
+ *          prefaulted upon mapping (<tt>MAP_POPULATE</tt>); external tools may map the object read-only by name.
+ *          The block identifier is a file descriptor; a process may map each block only once at a time.
+ *
  *  \author António Rui Borges - October 1995
  */
 
 #include <stdio.h>
+#include <stdbool.h>
+#include <errno.h>
 #include <sys/types.h>
 #include <sys/shm.h>
+#ifdef SHMEM_POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 /** \brief access permission: user r-w */
 #define  MASK           0600
 
+/** \brief huge page size assumed when it can not be found out (in bytes) */
+#define  HUGEPAGESZ     (2UL << 20)
+
+#ifdef SHMEM_POSIX
+
+/** \brief maximum number of blocks a process may be connected to */
+#define  MAXBLK         8
+
+/**
+ *  \brief Definition of <em>block in use by the process</em> data type.
+ */
+
+typedef struct
+        { /** \brief block identifier (file descriptor, -1 if the entry is free) */
+          int fd;
+          /** \brief creation key */
+          int key;
+          /** \brief local address of the mapped block (NULL if not mapped) */
+          void *add;
+          /** \brief length of the mapping (in bytes) */
+          size_t len;
+        } BLOCK;
+
+/** \brief blocks the process is connected to */
+static BLOCK blk[MAXBLK] = {{ -1, 0, NULL, 0 }, { -1, 0, NULL, 0 }, { -1, 0, NULL, 0 }, { -1, 0, NULL, 0 },
+                            { -1, 0, NULL, 0 }, { -1, 0, NULL, 0 }, { -1, 0, NULL, 0 }, { -1, 0, NULL, 0 }};
+
+/**
+ *  \brief Name of the shared memory object of a block (internal operation).
+ *
+ *  \param key creation key
+ *  \param name pointer to the region where the name is to be stored (at least 32 bytes)
+ */
+
+static void blockName (int key, char *name)
+{
+  sprintf (name, "/handicraft.%08x", (unsigned int) key);
+}
+
+/**
+ *  \brief Opening of the shared memory object of a block and registering it (internal operation).
+ *
+ *  \param key creation key
+ *  \param flags opening flags
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+static int openBlock (int key, int flags)
+{
+  char name[32];                                                                        /* name of the shared object */
+  unsigned int i;                                                                               /* counting variable */
+
+  for (i = 0; i < MAXBLK; i++)
+    if (blk[i].fd == -1) break;
+  if (i == MAXBLK)
+     { errno = EMFILE;
+       return -1;
+     }
+  blockName (key, name);
+  if ((blk[i].fd = shm_open (name, flags, MASK)) == -1)
+     return -1;
+  blk[i].key = key;
+  blk[i].add = NULL;
+  blk[i].len = 0;
+  return blk[i].fd;
+}
+
+/**
+ *  \brief Finding the entry of a block the process is connected to (internal operation).
+ *
+ *  \param fd block identifier
+ *  \param add local address of the mapped block (if <tt>fd</tt> is -1)
+ *
+ *  \return pointer to the entry, upon success
+ *  \return \c NULL, when the block is unknown (<tt>errno</tt> is set to <tt>EINVAL</tt>)
+ */
+
+static BLOCK *findBlock (int fd, void *add)
+{
+  unsigned int i;                                                                               /* counting variable */
+
+  for (i = 0; i < MAXBLK; i++)
+    if ((blk[i].fd != -1) && ((fd != -1) ? (blk[i].fd == fd) : (blk[i].add == add)))
+       return &blk[i];
+  errno = EINVAL;
+  return NULL;
+}
+
+#endif /* SHMEM_POSIX */
+
+#if defined (SHM_HUGETLB) && !defined (SHMEM_POSIX)
+
+/**
+ *  \brief Getting the huge page size (internal operation).
+ *
+ *  \return huge page size (in bytes)
+ */
+
+static unsigned long hugePageSize (void)
+{
+  FILE *fic;                                                                                      /* file descriptor */
+  char line[128];                                                                                       /* line read */
+  unsigned long kb;                                                                         /* huge page size in KiB */
+
+  if ((fic = fopen ("/proc/meminfo", "r")) == NULL)
+     return HUGEPAGESZ;
+  while (fgets (line, sizeof (line), fic) != NULL)
+    if (sscanf (line, "Hugepagesize: %lu kB", &kb) == 1)
+       { fclose (fic);
+         return kb << 10;
+       }
+  fclose (fic);
+  return HUGEPAGESZ;
+}
+
+#endif
+
 /**
  *  \brief Creation of a new block.
  *
@@ -34,7 +170,57 @@
 
 int shmemCreate (int key, unsigned int size)
 {
+#ifdef SHMEM_POSIX
+  int fd;                                                                                        /* block identifier */
+  char name[32];                                                                        /* name of the shared object */
+
+  if ((fd = openBlock (key, O_RDWR | O_CREAT | O_EXCL)) == -1)
+     return -1;
+  if (ftruncate (fd, (off_t) size) == -1)
+     { blockName (key, name);
+       shm_unlink (name);
+       findBlock (fd, NULL)->fd = -1;
+       close (fd);
+       return -1;
+     }
+  return fd;
+#else
   return shmget ((key_t) key, size, MASK | IPC_CREAT | IPC_EXCL);
+#endif
+}
+
+/**
+ *  \brief Creation of a new block backed by huge pages, whenever they are available.
+ *
+ *  The block size is rounded up to a multiple of the huge page size. If the block can not be backed by huge pages
+ *  (no huge pages are reserved in the system, or the process lacks the required privilege), an ordinary block is
+ *  created instead. POSIX shared memory objects are always ordinary blocks.
+ *  The function fails if there is already a block of shared memory with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *  \param size block size (in bytes)
+ *  \param pHuge pointer to the location where it is stored whether the block is backed by huge pages
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemCreateHuge (int key, unsigned int size, bool *pHuge)
+{
+#if defined (SHM_HUGETLB) && !defined (SHMEM_POSIX)                           /* POSIX objects live in tmpfs instead */
+  unsigned long hps = hugePageSize ();                                                             /* huge page size */
+  int shmid;                                                                                     /* block identifier */
+
+  shmid = shmget ((key_t) key, (size + hps - 1) / hps * hps, MASK | IPC_CREAT | IPC_EXCL | SHM_HUGETLB);
+  if (shmid != -1)
+     { *pHuge = true;
+       return shmid;
+     }
+  if (errno == EEXIST)
+     return -1;
+#endif
+  *pHuge = false;                                                          /* fall back to an ordinary block */
+  return shmemCreate (key, size);
 }
 
 /**
@@ -50,7 +236,11 @@ int shmemCreate (int key, unsigned int size)
 
 int shmemConnect (int key)
 {
+#ifdef SHMEM_POSIX
+  return openBlock (key, O_RDWR);
+#else
   return shmget ((key_t) key, 1, MASK);
+#endif
 }
 
 /**
@@ -66,7 +256,20 @@ int shmemConnect (int key)
 
 int shmemDestroy (int shmid)
 {
+#ifdef SHMEM_POSIX
+  BLOCK *b;                                                                                    /* entry of the block */
+  char name[32];                                                                        /* name of the shared object */
+
+  if ((b = findBlock (shmid, NULL)) == NULL)
+     return -1;
+  blockName (b->key, name);
+  if (shm_unlink (name) == -1)
+     return -1;
+  b->fd = -1;
+  return close (shmid);
+#else
   return shmctl (shmid, IPC_RMID, (struct shmid_ds *) NULL);
+#endif
 }
 
 /**
@@ -84,6 +287,20 @@ int shmemDestroy (int shmid)
 int shmemAttach (int shmid, void **pAttAdd)
 {
   void *add;                                                                                    /* temporary pointer */
+#ifdef SHMEM_POSIX
+  BLOCK *b;                                                                                    /* entry of the block */
+  struct stat st;                                                                               /* object attributes */
+
+  if (((b = findBlock (shmid, NULL)) == NULL) || (fstat (shmid, &st) == -1))
+     return -1;
+  add = mmap (NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, shmid, 0);
+  if (add == MAP_FAILED)
+     return -1;
+  b->add = add;
+  b->len = (size_t) st.st_size;
+  *pAttAdd = add;
+  return 0;
+#else
 
   add = shmat (shmid, (char *) NULL, 0);
   if (add != (void *) -1)
@@ -91,6 +308,7 @@ int shmemAttach (int shmid, void **pAttAdd)
        return 0;
      }
      else return 1;
+#endif
 }
 
 /**
@@ -107,5 +325,14 @@ int shmemAttach (int shmid, void **pAttAdd)
 
 int shmemDettach (void *attAdd)
 {
+#ifdef SHMEM_POSIX
+  BLOCK *b;                                                                                    /* entry of the block */
+
+  if ((b = findBlock (-1, attAdd)) == NULL)
+     return -1;
+  b->add = NULL;
+  return munmap (attAdd, b->len);
+#else
   return shmdt (attAdd);
+#endif
 }
@@ -5,17 +5,23 @@
  *
  *   Operations defined on shared memory:
  *      \li creation of a new block
+ *      \li creation of a new block backed by huge pages, whenever they are available
  *      \li connection to a previously created block
  *      \li destruction of a previously created block
  *      \li mapping of the block previously created on the process address space
  *      \li unmapping of the block off the process address space.
  *
+ *  Blocks are SysV shared memory segments, or POSIX shared memory objects named <tt>/dev/shm/handicraft.\<key\></tt>
+ *  when <tt>SHMEM_POSIX</tt> is defined at compile time.
+ *
  *  \author António Rui Borges - October 1995
  */
 
 #ifndef SHAREDMEMORY_H_
 #define SHAREDMEMORY_H_
 
+#include <stdbool.h>
+
 /**
  *  \brief Creation of a new block.
  *
@@ -30,6 +36,24 @@
 
 extern int shmemCreate (int key, unsigned int size);
 
+/**
+ *  \brief Creation of a new block backed by huge pages, whenever they are available.
+ *
+ *  The block size is rounded up to a multiple of the huge page size. If the block can not be backed by huge pages
+ *  (no huge pages are reserved in the system, or the process lacks the required privilege), an ordinary block is
+ *  created instead. POSIX shared memory objects are always ordinary blocks.
+ *  The function fails if there is already a block of shared memory with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *  \param size block size (in bytes)
+ *  \param pHuge pointer to the location where it is stored whether the block is backed by huge pages
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int shmemCreateHuge (int key, unsigned int size, bool *pHuge);
+
 /**
  *  \brief Connection to a previously created block.
  *
@@ -0,0 +1,285 @@
+/**
+ *  \file trace.c (implementation file)
+ *
+ *  Problem name: Aveiro Handicraft SARL
+ *
+ *  Concept: Pedro Mariano
+ *
+ *  \brief Recording of timestamped entity timelines.
+ *
+ *  Defined operations:
+ *     \li initialization of the tracing information and creation of the trace file
+ *     \li binding of the tracing information shared by all processes
+ *     \li checking whether tracing is on
+ *     \li reading of the clock used to take timestamps
+ *     \li recording of the changes of state of the intervening entities
+ *     \li recording of a wait on a semaphore
+ *     \li writing of the records still buffered
+ *     \li name of a state of an intervening entity.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/types.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "trace.h"
+
+/** \brief number of records gathered by a process before they are written to the file */
+#define  TRACE_BUFSZ     256
+
+/** \brief tracing information the process is bound to */
+static TRACEINFO *p_trInfo = NULL;
+
+/** \brief tracing flag, copied upon binding (the records are written upon termination, when the shared region may
+ *         be no longer mapped) */
+static bool trOn = false;
+
+/** \brief name of the trace file, copied upon binding */
+static char trFile[TRACE_NAMESZ];
+
+/** \brief file descriptor of the trace file */
+static int trFd = -1;
+
+/** \brief records gathered by the process */
+static TRACEREC trBuf[TRACE_BUFSZ];
+
+/** \brief number of records gathered by the process */
+static unsigned int nBuf = 0;
+
+/** \brief process the records gathered belong to (records inherited through fork are discarded) */
+static pid_t bufPid = 0;
+
+/** \brief the records gathered are being accessed by a thread (the coordinator serves several entities at once) */
+static bool bufBusy = false;
+
+/** \brief codes of the entrepreneur states */
+static const char *entrepName[] = { "OPTS", "WFNT", "ATAC", "CLTS", "CBOP", "DLPM" };
+
+/** \brief codes of the customer states */
+static const char *custName[] = { "CODC", "CSDO", "AOID", "BYSG" };
+
+/** \brief codes of the craftsman states */
+static const char *craftName[] = { "FTPM", "PANP", "SIFT", "CTTE" };
+
+/**
+ *  \brief Writing of the records gathered (internal operation, called with the buffer taken).
+ */
+
+static void writeBuf (void)
+{
+  size_t len = nBuf * sizeof (TRACEREC);                                                 /* number of bytes to write */
+
+  if ((nBuf == 0) || (bufPid != getpid ()) || !trOn) return;
+  nBuf = 0;
+  if ((trFd == -1) && ((trFd = open (trFile, O_WRONLY | O_APPEND)) == -1))
+     { perror ("error on opening the trace file");
+       return;
+     }
+  if (write (trFd, trBuf, len) != (ssize_t) len)            /* a single append, so it is not interleaved with others */
+     perror ("error on writing to trace file");
+}
+
+/**
+ *  \brief Gathering of a record (internal operation).
+ *
+ *  \param kind kind of record
+ *  \param ent entity identification
+ *  \param arg new state of the entity, or semaphore index
+ *  \param t0 instant of the change of state, or start of the wait
+ *  \param t1 end of the wait
+ */
+
+static void putRecord (unsigned int kind, unsigned int ent, unsigned int arg, uint64_t t0, uint64_t t1)
+{
+  while (__atomic_test_and_set (&bufBusy, __ATOMIC_ACQUIRE))                        /* held for a few stores at most */
+    sched_yield ();
+  if (bufPid != getpid ())
+     { nBuf = 0;
+       bufPid = getpid ();
+     }
+  trBuf[nBuf].t0 = t0;
+  trBuf[nBuf].t1 = t1;
+  trBuf[nBuf].kind = (uint16_t) kind;
+  trBuf[nBuf].ent = (uint16_t) ent;
+  trBuf[nBuf].arg = (uint16_t) arg;
+  trBuf[nBuf].pad = 0;
+  if (++nBuf == TRACE_BUFSZ) writeBuf ();
+  __atomic_clear (&bufBusy, __ATOMIC_RELEASE);
+}
+
+/**
+ *  \brief Initialization of the tracing information and creation of the trace file.
+ *
+ *  The function must be called by the process that creates the shared memory region before the initial state is
+ *  saved. The calling process is bound to the tracing information.
+ *  If <tt>fName</tt> is a null pointer, tracing is off.
+ *
+ *  \param p_tr pointer to the location where the tracing information is stored
+ *  \param fName name of the trace file
+ */
+
+void traceInit (TRACEINFO *p_tr, char *fName)
+{
+  FILE *fic;                                                                                      /* file descriptor */
+  unsigned int i;                                                                               /* counting variable */
+
+  p_tr->on = (fName != NULL);
+  p_tr->file[0] = '\0';
+  for (i = 0; i < N+M+NS; i++)
+    p_tr->last[i] = (unsigned int) -1;                                         /* so the initial states are recorded */
+  if (p_tr->on)
+     { strncpy (p_tr->file, fName, TRACE_NAMESZ - 1);
+       p_tr->file[TRACE_NAMESZ-1] = '\0';
+       if ((fic = fopen (p_tr->file, "w")) == NULL)
+          { perror ("error on the creation of trace file");
+            exit (EXIT_FAILURE);
+          }
+       if (fwrite (TRACE_MAGIC, 1, TRACE_MAGICSZ, fic) != TRACE_MAGICSZ)
+          { perror ("error on writing to trace file");
+            exit (EXIT_FAILURE);
+          }
+       if (fclose (fic) == EOF)
+          { perror ("error on closing of trace file");
+            exit (EXIT_FAILURE);
+          }
+     }
+  traceBind (p_tr);
+}
+
+/**
+ *  \brief Binding to the tracing information.
+ *
+ *  The function must be called by every intervening entity upon mapping the shared memory region on its address space.
+ *  If it is not called, nothing is recorded.
+ *
+ *  \param p_tr pointer to the location where the tracing information is stored
+ */
+
+void traceBind (TRACEINFO *p_tr)
+{
+  static bool registered = false;                                          /* writing upon termination is registered */
+
+  p_trInfo = p_tr;
+  trOn = p_tr->on;
+  strcpy (trFile, p_tr->file);
+  if (trOn && !registered)
+     { atexit (traceFlush);
+       registered = true;
+     }
+}
+
+/**
+ *  \brief Checking whether tracing is on.
+ *
+ *  \return \c true, if the process is bound to tracing information whose tracing flag is set
+ *  \return \c false, otherwise
+ */
+
+bool traceOn (void)
+{
+  return trOn;
+}
+
+/**
+ *  \brief Reading of the clock used to take timestamps.
+ *
+ *  \return present value of the monotonic clock (in ns)
+ */
+
+uint64_t traceClock (void)
+{
+  struct timespec ts;                                                                                /* present time */
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+/**
+ *  \brief Recording of the changes of state of the intervening entities.
+ *
+ *  The state of each entity is compared to the last one recorded and a record is made for every entity whose state
+ *  has changed. The function must be called within the critical region.
+ *
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+
+void traceState (FULL_STAT *p_fSt)
+{
+  uint64_t t;                                                                                     /* present instant */
+  unsigned int stat,                                                                   /* present state of an entity */
+               i;                                                                               /* counting variable */
+
+  if (!traceOn ()) return;
+  t = traceClock ();
+  for (i = 0; i < N+M+NS; i++)
+  { if (i == 0)
+       stat = p_fSt->st.entrepStat[0];
+       else if (i <= N)
+               stat = p_fSt->st.custStat[i-1].stat;
+               else if (i <= N+M)
+                       stat = p_fSt->st.craftStat[i-N-1].stat;
+                       else stat = p_fSt->st.entrepStat[i-N-M];
+    if (stat != p_trInfo->last[i])
+       { putRecord (TRACE_STATE, i, stat, t, 0);
+         p_trInfo->last[i] = stat;
+       }
+  }
+}
+
+/**
+ *  \brief Recording of a wait on a semaphore, ending now.
+ *
+ *  Waits by processes other than the intervening entities are not recorded.
+ *
+ *  \param ent entity identification
+ *  \param sindex semaphore index
+ *  \param t0 start of the wait (in ns)
+ */
+
+void traceWait (unsigned int ent, unsigned int sindex, uint64_t t0)
+{
+  if (traceOn () && (ent < N+M+NS))
+     putRecord (TRACE_WAIT, ent, sindex, t0, traceClock ());
+}
+
+/**
+ *  \brief Writing of the records still buffered by the calling process.
+ *
+ *  It is called automatically upon process termination. A failure is reported, but does not stop the simulation:
+ *  the records are lost.
+ */
+
+void traceFlush (void)
+{
+  while (__atomic_test_and_set (&bufBusy, __ATOMIC_ACQUIRE))
+    sched_yield ();
+  writeBuf ();
+  __atomic_clear (&bufBusy, __ATOMIC_RELEASE);
+}
+
+/**
+ *  \brief Name of a state of an intervening entity.
+ *
+ *  \param ent entity identification
+ *  \param stat state
+ *
+ *  \return the four letter code of the state used in the log file
+ */
+
+const char *traceStateName (unsigned int ent, unsigned int stat)
+{
+  if ((ent == 0) || (ent > N+M))
+     return (stat < sizeof (entrepName) / sizeof (entrepName[0])) ? entrepName[stat] : "****";
+     else if (ent <= N)
+             return (stat < sizeof (custName) / sizeof (custName[0])) ? custName[stat] : "****";
+             else return (stat < sizeof (craftName) / sizeof (craftName[0])) ? craftName[stat] : "****";
+}
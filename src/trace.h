@@ -0,0 +1,171 @@
+/**
+ *  \file trace.h (interface file)
+ *
+ *  Problem name: Aveiro Handicraft SARL
+ *
+ *  Concept: Pedro Mariano
+ *
+ *  \brief Recording of timestamped entity timelines.
+ *
+ *  When tracing is on, every change of state of an intervening entity and every wait on a semaphore are recorded,
+ *  with nanosecond timestamps, in a binary trace file. The <em>tracejson</em> tool converts it into the Chrome
+ *  trace-event format, which may be opened in Perfetto or in <tt>chrome://tracing</tt>.
+ *
+ *  Each process gathers its records in a private buffer and appends it to the file, in a single write, whenever
+ *  it fills up and upon termination, so records from different processes are interleaved in no particular order.
+ *  A trace file starts with the magic string <tt>TRACE_MAGIC</tt> and is followed by a sequence of records.
+ *
+ *  Defined operations:
+ *     \li initialization of the tracing information and creation of the trace file
+ *     \li binding of the tracing information shared by all processes
+ *     \li checking whether tracing is on
+ *     \li reading of the clock used to take timestamps
+ *     \li recording of the changes of state of the intervening entities
+ *     \li recording of a wait on a semaphore
+ *     \li writing of the records still buffered
+ *     \li name of a state of an intervening entity.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+
+/** \brief record of a change of state */
+#define  TRACE_STATE     0
+/** \brief record of a wait on a semaphore */
+#define  TRACE_WAIT      1
+
+/** \brief maximum length of the name of the trace file (including the terminating null character) */
+#define  TRACE_NAMESZ    64
+
+/** \brief magic string at the beginning of a trace file */
+#define  TRACE_MAGIC     "AHTRACE1"
+
+/** \brief size of the magic string at the beginning of a trace file (in bytes) */
+#define  TRACE_MAGICSZ   8
+
+/**
+ *  \brief Definition of <em>trace record</em> data type.
+ */
+
+typedef struct
+        { /** \brief instant of the change of state, or start of the wait (in ns) */
+          uint64_t t0;
+          /** \brief end of the wait (in ns; zero for a change of state) */
+          uint64_t t1;
+          /** \brief kind of record: either TRACE_STATE, or TRACE_WAIT */
+          uint16_t kind;
+          /** \brief entity identification (0 - entrepreneur, 1 to N - customers, N+1 to N+M - craftsmen, N+M+1 to
+           *         N+M+NS-1 - entrepreneurs of the other shops) */
+          uint16_t ent;
+          /** \brief new state of the entity, or semaphore index */
+          uint16_t arg;
+          /** \brief padding */
+          uint16_t pad;
+        } TRACEREC;
+
+/**
+ *  \brief Definition of <em>tracing information</em> data type.
+ *
+ *  It is kept in shared memory. The last states recorded must only be accessed within the critical region.
+ */
+
+typedef struct
+        { /** \brief tracing flag */
+          bool on;
+          /** \brief name of the trace file */
+          char file[TRACE_NAMESZ];
+          /** \brief last state recorded for each intervening entity */
+          unsigned int last[N+M+NS];
+        } TRACEINFO;
+
+/**
+ *  \brief Initialization of the tracing information and creation of the trace file.
+ *
+ *  The function must be called by the process that creates the shared memory region before the initial state is
+ *  saved. The calling process is bound to the tracing information.
+ *  If <tt>fName</tt> is a null pointer, tracing is off.
+ *
+ *  \param p_tr pointer to the location where the tracing information is stored
+ *  \param fName name of the trace file
+ */
+
+extern void traceInit (TRACEINFO *p_tr, char *fName);
+
+/**
+ *  \brief Binding to the tracing information.
+ *
+ *  The function must be called by every intervening entity upon mapping the shared memory region on its address space.
+ *  If it is not called, nothing is recorded.
+ *
+ *  \param p_tr pointer to the location where the tracing information is stored
+ */
+
+extern void traceBind (TRACEINFO *p_tr);
+
+/**
+ *  \brief Checking whether tracing is on.
+ *
+ *  \return \c true, if the process is bound to tracing information whose tracing flag is set
+ *  \return \c false, otherwise
+ */
+
+extern bool traceOn (void);
+
+/**
+ *  \brief Reading of the clock used to take timestamps.
+ *
+ *  \return present value of the monotonic clock (in ns)
+ */
+
+extern uint64_t traceClock (void);
+
+/**
+ *  \brief Recording of the changes of state of the intervening entities.
+ *
+ *  The state of each entity is compared to the last one recorded and a record is made for every entity whose state
+ *  has changed. The function must be called within the critical region.
+ *
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+
+extern void traceState (FULL_STAT *p_fSt);
+
+/**
+ *  \brief Recording of a wait on a semaphore, ending now.
+ *
+ *  Waits by processes other than the intervening entities are not recorded.
+ *
+ *  \param ent entity identification
+ *  \param sindex semaphore index
+ *  \param t0 start of the wait (in ns)
+ */
+
+extern void traceWait (unsigned int ent, unsigned int sindex, uint64_t t0);
+
+/**
+ *  \brief Writing of the records still buffered by the calling process.
+ *
+ *  It is called automatically upon process termination. A failure is reported, but does not stop the simulation:
+ *  the records are lost.
+ */
+
+extern void traceFlush (void);
+
+/**
+ *  \brief Name of a state of an intervening entity.
+ *
+ *  \param ent entity identification
+ *  \param stat state
+ *
+ *  \return the four letter code of the state used in the log file
+ */
+
+extern const char *traceStateName (unsigned int ent, unsigned int stat);
+
+#endif /* TRACE_H_ */
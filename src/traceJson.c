@@ -0,0 +1,228 @@
+/**
+ *  \file traceJson.c (implementation file)
+ *
+ *  \brief Problem name: Aveiro Handicraft SARL.
+ *
+ *  \brief Concept: Pedro Mariano.
+ *
+ *  Conversion of trace files into the Chrome trace-event format.
+ *
+ *  The trace file is written to the standard output as a JSON document which may be opened in Perfetto
+ *  (<tt>ui.perfetto.dev</tt>) or in <tt>chrome://tracing</tt>. Two processes are shown, each with a track per
+ *  intervening entity: <em>entity states</em>, with a span for every state the entity went through, named as in the
+ *  log file, and <em>semaphore waits</em>, with a span for every <em>down</em> operation, named after the semaphore.
+ *  Timestamps are in microseconds from the first record.
+ *
+ *  Upon execution, the following parameters are expected:
+ *    \li name of the trace file
+ *    \li (optional) minimum duration of the semaphore waits to be shown (in us; all are shown by default).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "sharedDataSync.h"
+#include "trace.h"
+
+/** \brief process of the entity state spans */
+#define  PID_STATE       1
+
+/** \brief process of the semaphore wait spans */
+#define  PID_WAIT        2
+
+/** \brief records read */
+static TRACEREC *rec;
+
+/**
+ *  \brief Comparison of two records by start time, for sorting (internal operation).
+ *
+ *  Records with the same start time keep the order they were read in, as the changes of state made within a single
+ *  critical region are recorded in the order of the entities and must not be swapped.
+ *
+ *  \param a pointer to the index of the first record
+ *  \param b pointer to the index of the second record
+ *
+ *  \return negative, zero or positive, as the first record is to come before, with or after the second one
+ */
+
+static int byTime (const void *a, const void *b)
+{
+  unsigned int i = *(const unsigned int *) a,                                               /* index of first record */
+               j = *(const unsigned int *) b;                                              /* index of second record */
+
+  if (rec[i].t0 != rec[j].t0)
+     return (rec[i].t0 < rec[j].t0) ? -1 : 1;
+  return (i < j) ? -1 : ((i > j) ? 1 : 0);
+}
+
+/**
+ *  \brief Name of a semaphore (internal operation).
+ *
+ *  \param sindex semaphore index
+ *  \param name pointer to the region where the name is to be stored (at least 32 bytes)
+ */
+
+static void semName (unsigned int sindex, char *name)
+{
+  switch (sindex)
+  { case ACCESS:           strcpy (name, "access");
+                           break;
+    case PROCEED:          strcpy (name, "proceed");
+                           break;
+    case WAITFORMATERIALS: strcpy (name, "waitForMaterials");
+                           break;
+    case ATTACHED:         strcpy (name, "attached");
+                           break;
+    case START:            strcpy (name, "start");
+                           break;
+    case DOORGATE:         strcpy (name, "doorGate");
+                           break;
+    default:               if ((sindex >= B_WAITFORSERVICE) && (sindex < B_WAITFORSERVICE + N))
+                              sprintf (name, "waitForService[%u]", sindex - B_WAITFORSERVICE);
+                              else if ((sindex >= B_TURN) && (sindex < B_TURN + N+M+NS))
+                                      sprintf (name, "turn[%u]", sindex - B_TURN);
+                              else if ((sindex >= B_PROCEED) && (sindex < B_PROCEED + NS-1))
+                                      sprintf (name, "proceed[%u]", sindex - B_PROCEED + 1);
+                              else if ((sindex >= B_DOORGATE) && (sindex < B_DOORGATE + NS-1))
+                                      sprintf (name, "doorGate[%u]", sindex - B_DOORGATE + 1);
+                                      else sprintf (name, "semaphore %u", sindex);
+  }
+}
+
+/**
+ *  \brief Name of an intervening entity (internal operation).
+ *
+ *  \param ent entity identification
+ *  \param name pointer to the region where the name is to be stored (at least 32 bytes)
+ */
+
+static void entName (unsigned int ent, char *name)
+{
+  if (ent == 0)
+     strcpy (name, (NS == 1) ? "entrepreneur" : "entrepreneur 0");
+     else if (ent <= N)
+             sprintf (name, "customer %u", ent - 1);
+             else if (ent <= N+M)
+                     sprintf (name, "craftsman %u", ent - N - 1);
+                     else sprintf (name, "entrepreneur %u", ent - N - M);
+}
+
+/**
+ *  \brief Main program.
+ */
+
+int main (int argc, char *argv[])
+{
+  FILE *fic;                                                                                      /* file descriptor */
+  char magic[TRACE_MAGICSZ];                                                              /* start of the trace file */
+  char name[32];                                                                         /* entity or semaphore name */
+  unsigned int *ord;                                                                /* record indices sorted by time */
+  unsigned int nRec = 0,                                                                        /* number of records */
+               cap = 4096,                                                               /* capacity of record array */
+               i, e;                                                                           /* counting variables */
+  double minWait = 0.0;                                                          /* minimum duration of a wait shown */
+  uint64_t base,                                                                      /* instant of the first record */
+           end;                                                                        /* instant of the last record */
+  uint64_t since[N+M+NS];                                                  /* start of the present state of entities */
+  unsigned int stat[N+M+NS];                                                        /* present state of the entities */
+  bool known[N+M+NS];                                                      /* present state of the entities is known */
+  char *tinp;                                                                      /* numerical parameters test flag */
+
+  if ((argc < 2) || (argc > 3))
+     { fprintf (stderr, "Usage: %s trace_file [minimum_wait_us]\n", argv[0]);
+       exit (EXIT_FAILURE);
+     }
+  if (argc == 3)
+     { minWait = strtod (argv[2], &tinp);
+       if ((*tinp != '\0') || (minWait < 0.0))
+          { fprintf (stderr, "Minimum wait is invalid!\n");
+            exit (EXIT_FAILURE);
+          }
+     }
+  if ((fic = fopen (argv[1], "r")) == NULL)
+     { perror ("error on opening the trace file");
+       exit (EXIT_FAILURE);
+     }
+  if ((fread (magic, 1, TRACE_MAGICSZ, fic) != TRACE_MAGICSZ) || (memcmp (magic, TRACE_MAGIC, TRACE_MAGICSZ) != 0))
+     { fprintf (stderr, "%s is not a trace file!\n", argv[1]);
+       exit (EXIT_FAILURE);
+     }
+
+  /* reading and sorting the records */
+
+  if ((rec = malloc (cap * sizeof (TRACEREC))) == NULL)
+     { perror ("error on allocating the records");
+       exit (EXIT_FAILURE);
+     }
+  while (fread (&rec[nRec], sizeof (TRACEREC), 1, fic) == 1)
+    if ((++nRec == cap) && ((rec = realloc (rec, (cap *= 2) * sizeof (TRACEREC))) == NULL))
+       { perror ("error on allocating the records");
+         exit (EXIT_FAILURE);
+       }
+  fclose (fic);
+  if ((ord = malloc ((nRec + 1) * sizeof (unsigned int))) == NULL)
+     { perror ("error on allocating the records");
+       exit (EXIT_FAILURE);
+     }
+  for (i = 0; i < nRec; i++)
+    ord[i] = i;
+  qsort (ord, nRec, sizeof (unsigned int), byTime);
+  base = (nRec == 0) ? 0 : rec[ord[0]].t0;
+  for (end = base, i = 0; i < nRec; i++)
+  { if (rec[i].t0 > end) end = rec[i].t0;
+    if (rec[i].t1 > end) end = rec[i].t1;
+  }
+
+  /* metadata: a process for the states and another for the waits, with a track per entity in both */
+
+  printf ("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  printf ("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"entity states\"}},\n", PID_STATE);
+  printf ("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"semaphore waits\"}}", PID_WAIT);
+  for (e = 0; e < N+M+NS; e++)
+  { entName (e, name);
+    printf (",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+            PID_STATE, e, name);
+    printf (",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+            PID_WAIT, e, name);
+    known[e] = false;
+  }
+
+  /* a span per state, from the change into it until the next change, and a span per wait */
+
+  for (i = 0; i < nRec; i++)
+  { TRACEREC *r = &rec[ord[i]];                                                                    /* present record */
+
+    if (r->ent >= N+M+NS) continue;
+    if (r->kind == TRACE_STATE)
+       { e = r->ent;
+         if (known[e] && (r->arg != stat[e]))
+            printf (",\n{\"name\":\"%s\",\"cat\":\"state\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,"
+                    "\"dur\":%.3f}", traceStateName (e, stat[e]), PID_STATE, e,
+                    (since[e] - base) / 1e3, (r->t0 - since[e]) / 1e3);
+         if (!known[e] || (r->arg != stat[e]))
+            { since[e] = r->t0;
+              stat[e] = r->arg;
+              known[e] = true;
+            }
+       }
+       else if ((r->kind == TRACE_WAIT) && ((r->t1 - r->t0) / 1e3 >= minWait))
+               { semName (r->arg, name);
+                 printf (",\n{\"name\":\"%s\",\"cat\":\"semaphore\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,"
+                         "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"index\":%u}}", name, PID_WAIT,
+                         r->ent, (r->t0 - base) / 1e3, (r->t1 - r->t0) / 1e3, r->arg);
+               }
+  }
+  for (e = 0; e < N+M+NS; e++)                                          /* the last states last until the trace ends */
+    if (known[e])
+       printf (",\n{\"name\":\"%s\",\"cat\":\"state\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+               traceStateName (e, stat[e]), PID_STATE, e, (since[e] - base) / 1e3, (end - since[e]) / 1e3);
+  printf ("\n]}\n");
+
+  free (ord);
+  free (rec);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,221 @@
+/**
+ *  \file uring.c (implementation file)
+ *
+ *  Problem name: Aveiro Handicraft SARL
+ *
+ *  Concept: Pedro Mariano
+ *
+ *  \brief Minimal io_uring interface, for writing a file at given offsets.
+ *
+ *  The ring is set up with deferred task running: the kernel only completes the writes when the process enters it
+ *  for that purpose, on submitting or waiting, so the completions never interrupt the other system calls of the
+ *  process, such as the semaphore operations, which would fail with <tt>EINTR</tt>. The flag requires Linux 6.1.
+ *
+ *  The user data of a submission carries the tag of the write in its upper half and the number of bytes to be
+ *  written in its lower half, so a short write is told apart upon completion.
+ *
+ *  Defined operations:
+ *     \li set up of a ring
+ *     \li queueing a write
+ *     \li submission of the writes queued
+ *     \li reaping completions
+ *     \li tear down of a ring.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#include "uring.h"
+
+/**
+ *  \brief Set up of a ring.
+ *
+ *  \param p_r pointer to the location where the ring is to be stored
+ *  \param depth number of entries of the submission queue (a power of two)
+ *  \param fd descriptor of the file to be registered
+ *  \param buf pointer to the buffer to be registered
+ *  \param len buffer length
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>; nothing is left set up)
+ */
+
+int uringSetup (URING *p_r, unsigned int depth, int fd, void *buf, size_t len)
+{
+  struct io_uring_params par;                                                                     /* ring parameters */
+  struct iovec iov;                                                                             /* registered buffer */
+  char *sq, *cq;                                                                                    /* ring mappings */
+  int err;                                                                                            /* saved errno */
+
+  memset (p_r, 0, sizeof (URING));
+  memset (&par, 0, sizeof (par));
+  par.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+  if ((p_r->fd = (int) syscall (__NR_io_uring_setup, depth, &par)) == -1)
+     return -1;
+  p_r->sqLen = par.sq_off.array + par.sq_entries * sizeof (unsigned int);
+  p_r->cqLen = par.cq_off.cqes + par.cq_entries * sizeof (struct io_uring_cqe);
+  if (par.features & IORING_FEAT_SINGLE_MMAP)                                   /* both rings share a single mapping */
+     { if (p_r->cqLen > p_r->sqLen) p_r->sqLen = p_r->cqLen;
+       p_r->cqLen = 0;
+     }
+  p_r->sqeLen = par.sq_entries * sizeof (struct io_uring_sqe);
+  p_r->sqMap = p_r->cqMap = p_r->sqe = MAP_FAILED;
+  p_r->sqMap = mmap (NULL, p_r->sqLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, p_r->fd,
+                     IORING_OFF_SQ_RING);
+  if ((p_r->sqMap != MAP_FAILED) && (p_r->cqLen != 0))
+     p_r->cqMap = mmap (NULL, p_r->cqLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, p_r->fd,
+                        IORING_OFF_CQ_RING);
+     else p_r->cqMap = p_r->sqMap;
+  if (p_r->cqMap != MAP_FAILED)
+     p_r->sqe = mmap (NULL, p_r->sqeLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, p_r->fd,
+                      IORING_OFF_SQES);
+  if (p_r->sqe == MAP_FAILED)
+     { uringExit (p_r);
+       return -1;
+     }
+  sq = p_r->sqMap;
+  cq = p_r->cqMap;
+  p_r->sqHead = (unsigned int *) (sq + par.sq_off.head);
+  p_r->sqTail = (unsigned int *) (sq + par.sq_off.tail);
+  p_r->sqMask = (unsigned int *) (sq + par.sq_off.ring_mask);
+  p_r->sqArray = (unsigned int *) (sq + par.sq_off.array);
+  p_r->cqHead = (unsigned int *) (cq + par.cq_off.head);
+  p_r->cqTail = (unsigned int *) (cq + par.cq_off.tail);
+  p_r->cqMask = (unsigned int *) (cq + par.cq_off.ring_mask);
+  p_r->cqe = (struct io_uring_cqe *) (cq + par.cq_off.cqes);
+
+  /* registration of the file and of the buffer */
+
+  iov.iov_base = buf;
+  iov.iov_len = len;
+  if ((syscall (__NR_io_uring_register, p_r->fd, IORING_REGISTER_FILES, &fd, 1) == -1) ||
+      (syscall (__NR_io_uring_register, p_r->fd, IORING_REGISTER_BUFFERS, &iov, 1) == -1))
+     { err = errno;
+       uringExit (p_r);
+       errno = err;
+       return -1;
+     }
+
+  return 0;
+}
+
+/**
+ *  \brief Queueing a write.
+ *
+ *  No system call is issued. The caller must make sure no more than <tt>depth</tt> writes are outstanding, either
+ *  queued or in flight.
+ *
+ *  \param p_r pointer to the location where the ring is stored
+ *  \param buf pointer to the region of the registered buffer to be written
+ *  \param len region length
+ *  \param off file offset
+ *  \param tag value returned upon completion
+ */
+
+void uringWrite (URING *p_r, void *buf, unsigned int len, uint64_t off, uint32_t tag)
+{
+  unsigned int tail = *p_r->sqTail,                                              /* only this process moves the tail */
+               idx = tail & *p_r->sqMask;                                                      /* entry to be filled */
+  struct io_uring_sqe *p_sqe = &p_r->sqe[idx];                                               /* pointer to the entry */
+
+  memset (p_sqe, 0, sizeof (struct io_uring_sqe));
+  p_sqe->opcode = IORING_OP_WRITE_FIXED;
+  p_sqe->flags = IOSQE_FIXED_FILE;
+  p_sqe->fd = 0;                                                                     /* index of the registered file */
+  p_sqe->addr = (uint64_t) (uintptr_t) buf;
+  p_sqe->len = len;
+  p_sqe->off = off;
+  p_sqe->buf_index = 0;                                                            /* index of the registered buffer */
+  p_sqe->user_data = ((uint64_t) tag << 32) | len;
+  p_r->sqArray[idx] = idx;
+  __atomic_store_n (p_r->sqTail, tail + 1, __ATOMIC_RELEASE);
+  p_r->pending += 1;
+}
+
+/**
+ *  \brief Submission of the writes queued.
+ *
+ *  The completions already due are posted as well.
+ *
+ *  \param p_r pointer to the location where the ring is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int uringSubmit (URING *p_r)
+{
+  long n;                                                                              /* number of writes submitted */
+
+  do
+  { if ((n = syscall (__NR_io_uring_enter, p_r->fd, p_r->pending, 0, IORING_ENTER_GETEVENTS, NULL, 0)) == -1)
+       { if (errno == EINTR) continue;
+         return -1;
+       }
+    p_r->pending -= (unsigned int) n;
+    p_r->inFlight += (unsigned int) n;
+  } while (p_r->pending != 0);
+  return 0;
+}
+
+/**
+ *  \brief Reaping completions.
+ *
+ *  \param p_r pointer to the location where the ring is stored
+ *  \param wait number of completions to wait for (\c 0, if the caller is not to be blocked)
+ *  \param tag pointer to the region where the tags of the writes completed are to be stored
+ *  \param max maximum number of completions to be reaped
+ *
+ *  \return number of completions reaped, upon success
+ *  \return -\c 1, when an error occurs or a write has failed or was short (the actual situation is reported in
+ *          <tt>errno</tt>)
+ */
+
+int uringReap (URING *p_r, unsigned int wait, uint32_t *tag, unsigned int max)
+{
+  unsigned int head = *p_r->cqHead,                                              /* only this process moves the head */
+               n = 0;                                                                /* number of completions reaped */
+  struct io_uring_cqe *p_cqe;                                                                    /* completion entry */
+
+  if (wait > p_r->inFlight) wait = p_r->inFlight;
+  if (wait > max) wait = max;
+  if ((wait != 0) && ((__atomic_load_n (p_r->cqTail, __ATOMIC_ACQUIRE) - head) < wait))
+     while (syscall (__NR_io_uring_enter, p_r->fd, 0, wait, IORING_ENTER_GETEVENTS, NULL, 0) == -1)
+       if (errno != EINTR) return -1;
+  while ((n < max) && (head != __atomic_load_n (p_r->cqTail, __ATOMIC_ACQUIRE)))
+  { p_cqe = &p_r->cqe[head & *p_r->cqMask];
+    if (p_cqe->res != (int32_t) (p_cqe->user_data & 0xFFFFFFFF))
+       { errno = (p_cqe->res < 0) ? -p_cqe->res : EIO;
+         return -1;
+       }
+    tag[n++] = (uint32_t) (p_cqe->user_data >> 32);
+    head += 1;
+    __atomic_store_n (p_r->cqHead, head, __ATOMIC_RELEASE);
+    p_r->inFlight -= 1;
+  }
+  return (int) n;
+}
+
+/**
+ *  \brief Tear down of a ring.
+ *
+ *  Writes still in flight are carried out by the kernel.
+ *
+ *  \param p_r pointer to the location where the ring is stored
+ */
+
+void uringExit (URING *p_r)
+{
+  if (p_r->sqe != MAP_FAILED) munmap (p_r->sqe, p_r->sqeLen);
+  if ((p_r->cqMap != MAP_FAILED) && (p_r->cqMap != p_r->sqMap)) munmap (p_r->cqMap, p_r->cqLen);
+  if (p_r->sqMap != MAP_FAILED) munmap (p_r->sqMap, p_r->sqLen);
+  close (p_r->fd);
+  p_r->fd = -1;
+}
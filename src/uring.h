@@ -0,0 +1,123 @@
+/**
+ *  \file uring.h (interface file)
+ *
+ *  Problem name: Aveiro Handicraft SARL
+ *
+ *  Concept: Pedro Mariano
+ *
+ *  \brief Minimal io_uring interface, for writing a file at given offsets.
+ *
+ *  The ring is set up through the raw system calls, so no library is required. A single file and a single buffer
+ *  are registered with it: every write is a <tt>IORING_OP_WRITE_FIXED</tt> of a region of the buffer to the fixed
+ *  file. Writes are queued with no system call and submitted in batches; the completions due are posted upon every
+ *  submission and reaped from the completion queue with no further system call, unless the caller has to wait for
+ *  them.
+ *
+ *  A ring belongs to the process which set it up: the mappings a child inherits upon <tt>fork</tt> are not to be used.
+ *
+ *  Defined operations:
+ *     \li set up of a ring
+ *     \li queueing a write
+ *     \li submission of the writes queued
+ *     \li reaping completions
+ *     \li tear down of a ring.
+ */
+
+#ifndef URING_H_
+#define URING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <linux/io_uring.h>
+
+/**
+ *  \brief Definition of <em>ring</em> data type.
+ */
+
+typedef struct
+        { /** \brief ring file descriptor */
+          int fd;
+          /** \brief submission queue: head, tail, mask, index array and entries */
+          unsigned int *sqHead, *sqTail, *sqMask, *sqArray;
+          struct io_uring_sqe *sqe;
+          /** \brief completion queue: head, tail, mask and entries */
+          unsigned int *cqHead, *cqTail, *cqMask;
+          struct io_uring_cqe *cqe;
+          /** \brief mappings of the rings and of the submission queue entries, and their lengths */
+          void *sqMap, *cqMap;
+          size_t sqLen, cqLen, sqeLen;
+          /** \brief number of writes queued, but not yet submitted */
+          unsigned int pending;
+          /** \brief number of writes submitted, but not yet reaped */
+          unsigned int inFlight;
+        } URING;
+
+/**
+ *  \brief Set up of a ring.
+ *
+ *  \param p_r pointer to the location where the ring is to be stored
+ *  \param depth number of entries of the submission queue (a power of two)
+ *  \param fd descriptor of the file to be registered
+ *  \param buf pointer to the buffer to be registered
+ *  \param len buffer length
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>; nothing is left set up)
+ */
+
+extern int uringSetup (URING *p_r, unsigned int depth, int fd, void *buf, size_t len);
+
+/**
+ *  \brief Queueing a write.
+ *
+ *  No system call is issued. The caller must make sure no more than <tt>depth</tt> writes are outstanding, either
+ *  queued or in flight.
+ *
+ *  \param p_r pointer to the location where the ring is stored
+ *  \param buf pointer to the region of the registered buffer to be written
+ *  \param len region length
+ *  \param off file offset
+ *  \param tag value returned upon completion
+ */
+
+extern void uringWrite (URING *p_r, void *buf, unsigned int len, uint64_t off, uint32_t tag);
+
+/**
+ *  \brief Submission of the writes queued.
+ *
+ *  The completions already due are posted as well.
+ *
+ *  \param p_r pointer to the location where the ring is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int uringSubmit (URING *p_r);
+
+/**
+ *  \brief Reaping completions.
+ *
+ *  \param p_r pointer to the location where the ring is stored
+ *  \param wait number of completions to wait for (\c 0, if the caller is not to be blocked)
+ *  \param tag pointer to the region where the tags of the writes completed are to be stored
+ *  \param max maximum number of completions to be reaped
+ *
+ *  \return number of completions reaped, upon success
+ *  \return -\c 1, when an error occurs or a write has failed or was short (the actual situation is reported in
+ *          <tt>errno</tt>)
+ */
+
+extern int uringReap (URING *p_r, unsigned int wait, uint32_t *tag, unsigned int max);
+
+/**
+ *  \brief Tear down of a ring.
+ *
+ *  Writes still in flight are carried out by the kernel.
+ *
+ *  \param p_r pointer to the location where the ring is stored
+ */
+
+extern void uringExit (URING *p_r);
+
+#endif /* URING_H_ */